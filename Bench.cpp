@@ -0,0 +1,383 @@
+//Headless benchmark runner for OpenGLIntro.
+//Creates an offscreen EGL context, runs one benchmark mode for a fixed number of frames
+//and prints its report (frame-time percentiles, per phase CPU time, GL call counts, ...) as JSON.
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "Bench.h"
+#include "FramePacer.h"
+#include "GLPlatform.h"
+#include "HeadlessContext.h"
+#include "Json.h"
+#include "OcclusionCuller.h"
+
+static void printUsage() {
+    std::cerr <<
+        "Usage: OpenGLIntroBench [options]\n"
+        "  --mode NAME      loop (the app's render loop), instanced, startup, commands, jobs, transform\n"
+        "                   import, meshcache, meshopt, vertexformat, replay, scenegraph, drift, indirect,\n"
+        "                   lod, occlusion, software, capture or pacing\n"
+        "                   (default loop)\n"
+        "  --frames N       measured frames (per instance count in instanced mode, default 1000)\n"
+        "  --warmup N       unmeasured frames before measuring (default 30)\n"
+        "  --size WxH       framebuffer size (default 1024x768)\n"
+        "  --out PATH       write the JSON report to PATH instead of stdout\n"
+        "  --outline MODE   single (one draw, geometry shader) or two-pass (GL_FILL + GL_LINE) (default single)\n"
+        "  --outline-width PX  single pass outline width in pixels (default 3)\n"
+        "  --no-state-cache issue every state change and uniform upload, even redundant ones\n"
+        "loop, jobs and replay modes:\n"
+        "  --script NAME    scripted input: cycle (one key at a time), idle, all (default cycle)\n"
+        "loop and replay modes:\n"
+        "  --profile        time the loop phases and GPU passes, report rolling statistics\n"
+        "  --trace PATH     also write the measured frames as a Chrome trace (chrome://tracing, Perfetto)\n"
+        "loop mode:\n"
+        "  --log PATH       transform log file, 'none' to disable (default bench_output.txt)\n"
+        "  --log-mode MODE  sync (std::endl on the render thread), text or binary (async writer) (default text)\n"
+        "  --frame-dt S     seconds fed to the fixed timestep per frame, or 'real' for wall time (default 1/60)\n"
+        "  --frame-budget MS  exit with code 2 if the p95 frame time is above MS, or with --profile if over 10% of\n"
+        "                   the GPU frames were dropped\n"
+        "  --record PATH    record the scripted key events and frame steps for --mode replay\n"
+        "instanced mode:\n"
+        "  --instances LIST comma separated instance counts (default 1,100,10000,100000,1000000)\n"
+        "  --no-persistent  upload with glBufferSubData instead of the persistently mapped ring\n"
+        "startup mode:\n"
+        "  --cache-dir PATH program binary cache directory, emptied before the cold run (default shader_cache)\n"
+        "  --permutations N copies of each of the app's programs to build (default 16)\n"
+        "  --no-parallel-compile  do not enable KHR_parallel_shader_compile\n"
+        "  --keep-cache     leave the binaries in the cache directory\n"
+        "  --salt TEXT      fixed text mixed into the sources (default: new per run, defeats driver caches)\n"
+        "commands mode:\n"
+        "  --objects LIST   comma separated object counts (default 1000,10000,100000)\n"
+        "  --threads N      job system threads including the GL thread (default: hardware threads)\n"
+        "  --meshes N       VAOs the objects are spread over, 1-256 (default 4)\n"
+        "  --no-sort        submit packets in recording order\n"
+        "jobs mode:\n"
+        "  --objects LIST   comma separated object counts (default 1000000)\n"
+        "  --threads N      measure 1, 2, 4, ... up to N threads (default: hardware threads)\n"
+        "transform mode:\n"
+        "  --vertices LIST  comma separated vertex counts (default 1000,10000,...,100000000)\n"
+        "  --threads N      job system threads for the threaded cases (default: hardware threads)\n"
+        "import mode:\n"
+        "  --mesh PATH      OBJ or glTF (.glb) file to import, repeat for several (default: generated grid)\n"
+        "  --triangles N    generated grid size (default 2000000)\n"
+        "  --threads N      job system threads for the parallel import (default: hardware threads)\n"
+        "meshcache mode:\n"
+        "  --mesh PATH      OBJ or glTF (.glb) source, repeat for several (default: generated grid)\n"
+        "  --triangles N    generated grid size (default 2000000)\n"
+        "  --geometry-cache PATH  geometry pack directory, its packs for the sources are rebuilt (default geometry_cache)\n"
+        "  --keep-cache     leave the packs in the cache directory\n"
+        "  --threads N      job system threads for hashing and importing (default: hardware threads)\n"
+        "meshopt mode:\n"
+        "  --mesh PATH      OBJ or glTF (.glb) file to optimize, repeat for several (default: generated grid)\n"
+        "  --triangles N    generated grid size (default 2000000)\n"
+        "vertexformat mode:\n"
+        "  --mesh PATH      OBJ or glTF (.glb) file to encode, repeat for several\n"
+        "                   (default: generated grids of 100000 and --triangles triangles)\n"
+        "  --triangles N    larger generated grid size (default 2000000)\n"
+        "replay mode:\n"
+        "  --replay PATH    input recording to play back (default: record --script for --frames frames first)\n"
+        "  --no-render      simulate only, nothing is drawn\n"
+        "  --frame-trace PATH  per frame timing CSV\n"
+        "  --frame-dt S     seconds per frame when recording the script (default 1/60)\n"
+        "  exits with code 3 if the replayed transform differs from the recording\n"
+        "scenegraph mode:\n"
+        "  --nodes N        scene graph nodes (default 1000000)\n"
+        "  --moving F       share of the nodes animated every frame (default 0.01)\n"
+        "  --threads N      job system threads for the parallel cases (default: hardware threads)\n"
+        "drift mode:\n"
+        "  --updates N      simulation steps each key combination is held for (default 10000000)\n"
+        "  exits with code 4 if the transform drifts or its update cost grows beyond the bounds in BenchDrift.cpp\n"
+        "indirect mode:\n"
+        "  --objects LIST   comma separated object counts (default 10000,100000,1000000)\n"
+        "  --meshes N       mesh variants in the merged buffers, 1-256 (default 4)\n"
+        "  exits with code 1 if the GPU and CPU culling disagree on any object\n"
+        "lod mode:\n"
+        "  --objects N      objects on the ground plane (default 100000)\n"
+        "  --mesh PATH      OBJ or glTF (.glb) mesh to build the LOD chain of (default: generated sphere)\n"
+        "  --lod-error PX   projected error allowed per level in pixels (default 1)\n"
+        "  --hysteresis F   share of the error a coarser level must stay below before it is taken (default 0.25)\n"
+        "occlusion mode:\n"
+        "  --objects N      pyramids in the field (default 100000)\n"
+        "  --threads N      job system threads for culling and tile rasterization (default: hardware threads)\n"
+        "  --occlusion-width N  software depth buffer width in pixels (default 256)\n"
+        "software mode (runs without a GL context too, then nothing is compared):\n"
+        "  --objects LIST   comma separated pyramid grid sizes, after the app's pyramid (default 1000,100000)\n"
+        "  --threads N      job system threads for binning and tile rasterization (default: hardware threads)\n"
+        "  --image PATH     write each case's framebuffer as PNG, the case name inserted before the extension\n"
+        "capture mode:\n"
+        "  --capture-fps F  pace the frames to F per second, 0 = as fast as possible (default 60)\n"
+        "  --capture-latency N  frames between a PBO read and its map (default 2)\n"
+        "  --capture-dir PATH   directory for the PNG case (default: a temporary one, removed afterwards)\n"
+        "  --capture-pipe CMD   command the raw frames are piped into (default: discard them)\n"
+        "pacing mode (vsync is emulated, a scripted key is pressed every second):\n"
+        "  --pacing LIST    comma separated policies: uncapped, vsync, capped, on-demand, low-latency (default all)\n"
+        "  --pacing-fps F   capped rate and the emulated refresh rate (default 60)\n"
+        "  --pacing-seconds S  run length per policy (default 6)\n";
+}
+
+//Parse "1,100,10000"
+static bool parseCounts(const char* text, std::vector<size_t>& counts) {
+    counts.clear();
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        long long value = std::atoll(item.c_str());
+        if (value <= 0)
+            return false;
+        counts.push_back((size_t)value);
+    }
+    return !counts.empty();
+}
+
+//Parse "vsync,on-demand"
+static bool parsePacingModes(const char* text, std::vector<std::string>& modes) {
+    modes.clear();
+    std::stringstream stream(text);
+    std::string item;
+    PacingMode mode;
+    while (std::getline(stream, item, ',')) {
+        if (!parsePacingMode(item.c_str(), mode))
+            return false;
+        modes.push_back(item);
+    }
+    return !modes.empty();
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--mode" && hasValue) options.mode = argv[++i];
+        else if (arg == "--frames" && hasValue) options.frames = std::atoi(argv[++i]);
+        else if (arg == "--warmup" && hasValue) options.warmupFrames = std::atoi(argv[++i]);
+        else if (arg == "--size" && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2)
+                return false;
+        }
+        else if (arg == "--out" && hasValue) options.outPath = argv[++i];
+        else if (arg == "--outline" && hasValue) options.outline = argv[++i];
+        else if (arg == "--no-state-cache") options.stateCache = false;
+        else if (arg == "--outline-width" && hasValue) options.outlineWidth = (float)std::atof(argv[++i]);
+        else if (arg == "--script" && hasValue) options.script = argv[++i];
+        else if (arg == "--log" && hasValue) options.logPath = argv[++i];
+        else if (arg == "--log-mode" && hasValue) options.logMode = argv[++i];
+        else if (arg == "--frame-dt" && hasValue) {
+            std::string value = argv[++i];
+            options.frameDt = value == "real" ? 0.0 : std::atof(value.c_str());
+            if (value != "real" && options.frameDt <= 0.0)
+                return false;
+        }
+        else if (arg == "--profile") options.profile = true;
+        else if (arg == "--trace" && hasValue) {
+            options.tracePath = argv[++i];
+            options.profile = true;
+        }
+        else if (arg == "--frame-budget" && hasValue) {
+            options.frameBudgetMs = std::atof(argv[++i]);
+            if (options.frameBudgetMs <= 0.0)
+                return false;
+        }
+        else if (arg == "--record" && hasValue) options.recordPath = argv[++i];
+        else if (arg == "--replay" && hasValue) options.replayPath = argv[++i];
+        else if (arg == "--no-render") options.render = false;
+        else if (arg == "--frame-trace" && hasValue) options.frameTracePath = argv[++i];
+        else if (arg == "--nodes" && hasValue) {
+            long long nodes = std::atoll(argv[++i]);
+            if (nodes <= 0 || nodes >= 0xFFFFFFFFll)
+                return false;
+            options.nodes = (size_t)nodes;
+        }
+        else if (arg == "--moving" && hasValue) {
+            options.movingFraction = std::atof(argv[++i]);
+            if (options.movingFraction <= 0.0 || options.movingFraction > 1.0)
+                return false;
+        }
+        else if (arg == "--updates" && hasValue) {
+            long long updates = std::atoll(argv[++i]);
+            if (updates <= 0)
+                return false;
+            options.updates = (size_t)updates;
+        }
+        else if (arg == "--instances" && hasValue) {
+            if (!parseCounts(argv[++i], options.instanceCounts))
+                return false;
+        }
+        else if (arg == "--no-persistent") options.persistentMapping = false;
+        else if (arg == "--cache-dir" && hasValue) options.cacheDir = argv[++i];
+        else if (arg == "--permutations" && hasValue) options.permutations = std::atoi(argv[++i]);
+        else if (arg == "--no-parallel-compile") options.parallelCompile = false;
+        else if (arg == "--keep-cache") options.keepCache = true;
+        else if (arg == "--salt" && hasValue) options.shaderSalt = argv[++i];
+        else if (arg == "--objects" && hasValue) {
+            if (!parseCounts(argv[++i], options.objectCounts))
+                return false;
+        }
+        else if (arg == "--threads" && hasValue) options.threads = std::atoi(argv[++i]);
+        else if (arg == "--meshes" && hasValue) options.meshes = std::atoi(argv[++i]);
+        else if (arg == "--no-sort") options.sortCommands = false;
+        else if (arg == "--mesh" && hasValue) options.meshPaths.push_back(argv[++i]);
+        else if (arg == "--triangles" && hasValue) {
+            long long triangles = std::atoll(argv[++i]);
+            if (triangles <= 0)
+                return false;
+            options.triangles = (size_t)triangles;
+        }
+        else if (arg == "--geometry-cache" && hasValue) options.geometryCacheDir = argv[++i];
+        else if (arg == "--lod-error" && hasValue) {
+            options.lodError = (float)std::atof(argv[++i]);
+            if (options.lodError <= 0.0f)
+                return false;
+        }
+        else if (arg == "--hysteresis" && hasValue) {
+            options.lodHysteresis = (float)std::atof(argv[++i]);
+            if (options.lodHysteresis < 0.0f || options.lodHysteresis >= 1.0f)
+                return false;
+        }
+        else if (arg == "--occlusion-width" && hasValue) {
+            options.occlusionWidth = std::atoi(argv[++i]);
+            if (options.occlusionWidth < occlusionTileSize)
+                return false;
+        }
+        else if (arg == "--image" && hasValue) options.imagePath = argv[++i];
+        else if (arg == "--capture-fps" && hasValue) {
+            options.captureFps = std::atof(argv[++i]);
+            if (options.captureFps < 0.0)
+                return false;
+        }
+        else if (arg == "--capture-latency" && hasValue) {
+            options.captureLatency = std::atoi(argv[++i]);
+            if (options.captureLatency < 1)
+                return false;
+        }
+        else if (arg == "--capture-dir" && hasValue) options.captureDir = argv[++i];
+        else if (arg == "--capture-pipe" && hasValue) options.capturePipe = argv[++i];
+        else if (arg == "--pacing" && hasValue) {
+            if (!parsePacingModes(argv[++i], options.pacingModes))
+                return false;
+        }
+        else if (arg == "--pacing-fps" && hasValue) {
+            options.pacingFps = std::atof(argv[++i]);
+            if (options.pacingFps <= 0.0)
+                return false;
+        }
+        else if (arg == "--pacing-seconds" && hasValue) {
+            options.pacingSeconds = std::atof(argv[++i]);
+            if (options.pacingSeconds <= 0.0)
+                return false;
+        }
+        else if (arg == "--vertices" && hasValue) {
+            if (!parseCounts(argv[++i], options.vertexCounts))
+                return false;
+        }
+        else return false;
+    }
+    return options.frames > 0 && options.warmupFrames >= 0 && options.width > 0 && options.height > 0 &&
+        (options.mode == "loop" || options.mode == "instanced" || options.mode == "startup" ||
+            options.mode == "commands" || options.mode == "jobs" || options.mode == "transform" ||
+            options.mode == "import" || options.mode == "meshcache" ||
+            options.mode == "meshopt" || options.mode == "vertexformat" || options.mode == "replay" ||
+            options.mode == "scenegraph" || options.mode == "drift" ||
+            options.mode == "indirect" || options.mode == "lod" ||
+            options.mode == "occlusion" || options.mode == "software" ||
+            options.mode == "capture" || options.mode == "pacing") &&
+        options.permutations > 0 && options.threads >= 0 && options.meshes >= 1 && options.meshes <= 256 &&
+        (options.outline == "single" || options.outline == "two-pass") && options.outlineWidth > 0.0f &&
+        (options.script == "cycle" || options.script == "idle" || options.script == "all") &&
+        (options.logMode == "sync" || options.logMode == "text" || options.logMode == "binary");
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    //======================OUTPUT======================
+    std::ofstream reportFile;
+    if (!options.outPath.empty()) {
+        reportFile.open(options.outPath, std::ios::out | std::ios::trunc);
+        if (!reportFile) {
+            std::cerr << "Error opening report file " << options.outPath << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& reportOut = reportFile.is_open() ? (std::ostream&)reportFile : std::cout;
+
+    //======================CONTEXT======================
+    //Software mode is for machines without GL, so it carries on without a context
+    HeadlessContext context;
+    if (!createHeadlessContext(context, options.width, options.height)) {
+        if (options.mode != "software")
+            return -1;
+        options.glContext = false;
+    }
+
+    //Enable depth testing
+    if (options.glContext) {
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LESS);
+    }
+
+    //======================RUN======================
+    JsonWriter json(reportOut);
+    json.beginObject();
+    json.value("benchmark", options.mode == "loop" ? "render_loop" : options.mode);
+    if (options.glContext) {
+        json.value("gl_vendor", (const char*)glGetString(GL_VENDOR));
+        json.value("gl_renderer", (const char*)glGetString(GL_RENDERER));
+        json.value("gl_version", (const char*)glGetString(GL_VERSION));
+    }
+    json.value("width", options.width);
+    json.value("height", options.height);
+
+    int result = 0;
+    if (options.mode == "loop")
+        result = runRenderLoopBench(options, json);
+    else if (options.mode == "instanced")
+        result = runInstancedBench(options, json);
+    else if (options.mode == "startup")
+        result = runStartupBench(options, json);
+    else if (options.mode == "commands")
+        result = runCommandsBench(options, json);
+    else if (options.mode == "jobs")
+        result = runJobsBench(options, json);
+    else if (options.mode == "transform")
+        result = runTransformBench(options, json);
+    else if (options.mode == "import")
+        result = runImportBench(options, json);
+    else if (options.mode == "meshcache")
+        result = runMeshCacheBench(options, json);
+    else if (options.mode == "meshopt")
+        result = runMeshOptBench(options, json);
+    else if (options.mode == "vertexformat")
+        result = runVertexFormatBench(options, json);
+    else if (options.mode == "replay")
+        result = runReplayBench(options, json);
+    else if (options.mode == "scenegraph")
+        result = runSceneGraphBench(options, json);
+    else if (options.mode == "drift")
+        result = runDriftBench(options, json);
+    else if (options.mode == "indirect")
+        result = runIndirectBench(options, json);
+    else if (options.mode == "lod")
+        result = runLodBench(options, json);
+    else if (options.mode == "occlusion")
+        result = runOcclusionBench(options, json);
+    else if (options.mode == "software")
+        result = runSoftwareBench(options, json);
+    else if (options.mode == "capture")
+        result = runCaptureBench(options, json);
+    else if (options.mode == "pacing")
+        result = runPacingBench(options, json);
+    json.endObject();
+
+    //======================EXIT======================
+    if (options.glContext)
+        destroyHeadlessContext(context);
+    return result;
+}
@@ -0,0 +1,126 @@
+#pragma once
+//Options shared by the OpenGLIntroBench modes. Each mode lives in its own Bench*.cpp and appends its
+//results to the JSON report; main() in Bench.cpp owns the GL context and the report file.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Simulation.h"
+
+class InputSystem;
+class JsonWriter;
+
+//-- Command line options
+struct BenchOptions {
+    std::string mode = "loop";             //loop | instanced | startup | commands | jobs | transform | import | meshcache | meshopt | vertexformat | replay | scenegraph | drift | indirect | lod | occlusion | software | capture | pacing
+    int frames = 1000;
+    int warmupFrames = 30;
+    int width = 1024;
+    int height = 768;
+    std::string outPath;                   //empty = stdout
+    std::string outline = "single";        //single (geometry shader edge distance) | two-pass (GL_FILL + GL_LINE)
+    float outlineWidth = 3.0f;             //pixels, single pass outline only
+    bool stateCache = true;                //false = GLStateCache passes every call through
+    bool glContext = true;                 //set by main: false when software mode runs without a GL context
+
+    //loop
+    std::string script = "cycle";          //cycle | idle | all
+    std::string logPath = "bench_output.txt"; //"none" disables the transform log
+    std::string logMode = "text";          //sync (old std::endl path) | text | binary
+    double frameDt = simulationStep;       //simulated seconds per rendered frame, <= 0 = measured wall time
+    bool profile = false;                  //CPU zones and GPU pass timers (Profiler.h), "profile" in the report
+    std::string tracePath;                 //Chrome trace of the measured frames, implies profile
+    double frameBudgetMs = 0.0;            //fail with exit code 2 when the p95 frame time is above, 0 = off
+    std::string recordPath;                //input recording of the run (InputRecording.h), empty = none
+
+    //scenegraph
+    size_t nodes = 1000000;
+    double movingFraction = 0.01;          //share of the nodes animated every frame
+
+    //drift
+    size_t updates = 10000000;             //steps each key combination is held for
+
+    //replay
+    std::string replayPath;                //empty = record --script for --frames frames first
+    bool render = true;                    //false = simulation only
+    std::string frameTracePath;            //per frame timing CSV, empty = none
+
+    //instanced
+    std::vector<size_t> instanceCounts = { 1, 100, 10000, 100000, 1000000 };
+    bool persistentMapping = true;         //false forces the glBufferSubData upload path
+
+    //startup
+    std::string cacheDir = "shader_cache";
+    int permutations = 16;                 //copies of each program with a different #define
+    bool parallelCompile = true;           //KHR_parallel_shader_compile when available
+    bool keepCache = false;                //leave the binaries in cacheDir afterwards
+    std::string shaderSalt;                //empty = new per run, see BenchStartup.cpp
+
+    //lod
+    float lodError = 1.0f;                 //projected error allowed per level, pixels
+    float lodHysteresis = 0.25f;           //see LodSelection
+
+    //occlusion
+    int occlusionWidth = 256;              //software depth buffer width, height follows the aspect ratio
+
+    //capture
+    double captureFps = 60.0;              //frames paced to this rate, 0 = as fast as possible
+    int captureLatency = 2;                //frames between a PBO read and its map
+    std::string captureDir;                //PNG directory, empty = a temporary one removed afterwards
+    std::string capturePipe;               //raw frame consumer command, empty = discard
+
+    //pacing
+    std::vector<std::string> pacingModes = { "uncapped", "vsync", "capped", "on-demand", "low-latency" };
+    double pacingFps = 60.0;               //capped rate and the emulated refresh rate
+    double pacingSeconds = 6.0;            //run length per policy
+
+    //software
+    std::string imagePath;                 //PNG per case with the case name inserted, empty = none
+
+    //commands, jobs, transform, scenegraph, indirect, lod, occlusion, software
+    std::vector<size_t> objectCounts;      //empty = the mode's default
+    int threads = 0;                       //job system threads including the GL thread, 0 = hardware threads
+    int meshes = 4;                        //VAOs the objects are spread over
+    bool sortCommands = true;              //false submits in recording order
+
+    //transform
+    std::vector<size_t> vertexCounts;      //empty = 10^3 to 10^8
+
+    //import, meshcache, meshopt, vertexformat, lod
+    std::vector<std::string> meshPaths;    //empty = generate a grid in both formats
+    size_t triangles = 2000000;            //generated grid size
+
+    //meshcache
+    std::string geometryCacheDir = "geometry_cache";
+};
+
+//-- Scripted stand-in for a person at the keyboard, fed through the same key event path as the window.
+//Driven by simulation step, not frame, so the result does not depend on --frame-dt. See BenchLoop.cpp.
+void scriptedKeyEvents(const std::string& script, uint64_t step, InputSystem& input);
+
+//Write a heightfield grid of about triangles triangles as OBJ and as glTF (.glb) to the temp directory and
+//return the two paths, empty on failure. See BenchImport.cpp.
+std::vector<std::string> writeBenchGrid(size_t triangles);
+
+//Run one mode against the current GL context, writing members of the already open report object.
+//Return 0 on success.
+int runRenderLoopBench(const BenchOptions& options, JsonWriter& json);
+int runInstancedBench(const BenchOptions& options, JsonWriter& json);
+int runStartupBench(const BenchOptions& options, JsonWriter& json);
+int runCommandsBench(const BenchOptions& options, JsonWriter& json);
+int runJobsBench(const BenchOptions& options, JsonWriter& json);
+int runTransformBench(const BenchOptions& options, JsonWriter& json);
+int runImportBench(const BenchOptions& options, JsonWriter& json);
+int runMeshCacheBench(const BenchOptions& options, JsonWriter& json);
+int runMeshOptBench(const BenchOptions& options, JsonWriter& json);
+int runVertexFormatBench(const BenchOptions& options, JsonWriter& json);
+int runReplayBench(const BenchOptions& options, JsonWriter& json);
+int runSceneGraphBench(const BenchOptions& options, JsonWriter& json);
+int runDriftBench(const BenchOptions& options, JsonWriter& json);
+int runIndirectBench(const BenchOptions& options, JsonWriter& json);
+int runLodBench(const BenchOptions& options, JsonWriter& json);
+int runOcclusionBench(const BenchOptions& options, JsonWriter& json);
+int runSoftwareBench(const BenchOptions& options, JsonWriter& json);
+int runCaptureBench(const BenchOptions& options, JsonWriter& json);
+int runPacingBench(const BenchOptions& options, JsonWriter& json);
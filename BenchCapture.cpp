@@ -0,0 +1,150 @@
+//Frame capture benchmark: the app's spinning pyramid at --capture-fps, recorded four ways.
+//    off      - no capture, the baseline
+//    sync     - glReadPixels into memory after drawing, before the swap stand-in (the stall FrameCapture avoids)
+//    pbo_png  - FrameCapture.h into PNG files
+//    pbo_raw  - FrameCapture.h into a pipe (--capture-pipe)
+//frame_ms is the frame's work from its start to the end of the swap stand-in (glFinish), without the sleep that
+//paces it; overhead_percent compares its mean with off. frame_cpu_ms is the render thread's CPU time over the same
+//span: with fewer cores than threads the encoder takes turns with the renderer (and with llvmpipe, which renders on
+//the CPU), which shows in frame_ms but not there. Frames the capture had no free PBO for are dropped.
+//The capture counts cover the whole case, warm-up included, since frames read then are written during it.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtc/matrix_transform.hpp>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "FrameCapture.h"
+#include "GLPlatform.h"
+#include "GLStateCache.h"
+#include "Json.h"
+#include "Renderer.h"
+
+//Stop measuring one case after this much wall time even if --frames is not reached
+static const double secondsPerCase = 10.0;
+static const int minimumFrames = 3;
+
+#ifdef _WIN32
+static const char* defaultCapturePipe = "more > NUL";
+#else
+static const char* defaultCapturePipe = "cat > /dev/null";
+#endif
+
+int runCaptureBench(const BenchOptions& options, JsonWriter& json) {
+    PyramidRenderer renderer;
+    if (!createPyramidRenderer(renderer, options.outline == "single"))
+        return -1;
+    if (renderer.singlePassOutline)
+        setOutlineWidth(renderer.outline, options.outlineWidth);
+
+    //PNGs go to a temporary directory unless one is given
+    std::filesystem::path directory = options.captureDir;
+    bool temporaryDirectory = directory.empty();
+    if (temporaryDirectory)
+        directory = std::filesystem::temp_directory_path() / "opengl_intro_capture";
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::string pipeCommand = options.capturePipe.empty() ? defaultCapturePipe : options.capturePipe;
+
+    json.value("frames_requested", options.frames);
+    json.value("warmup_frames", options.warmupFrames);
+    json.value("target_fps", options.captureFps);
+    json.value("latency_frames", options.captureLatency);
+    json.value("pipe", pipeCommand);
+    json.beginArray("runs");
+
+    const char* cases[] = { "off", "sync", "pbo_png", "pbo_raw" };
+    double offMeanMs = 0.0, offCpuMs = 0.0;
+    int result = 0;
+    std::vector<uint8_t> pixels((size_t)options.width * options.height * 4);
+    for (const char* name : cases) {
+        std::string mode = name;
+        FrameCapture capture;
+        bool opened = true;
+        if (mode == "pbo_png")
+            opened = capture.openPng(directory.string().c_str(), options.width, options.height, options.captureLatency);
+        else if (mode == "pbo_raw")
+            opened = capture.openPipe(pipeCommand.c_str(), options.width, options.height, options.captureLatency);
+        if (!opened) {
+            result = -1;
+            break;
+        }
+
+        GLStateCache glState;
+        glState.filtering = options.stateCache;
+        std::vector<double> frameMs, frameCpuMs;
+        double period = options.captureFps > 0.0 ? 1.0 / options.captureFps : 0.0;
+        double nextFrame = wallSeconds();
+        double measureStart = 0.0;
+        int frame = 0;
+        for (;;) {
+            if (frame == options.warmupFrames) {
+                frameMs.clear();
+                frameCpuMs.clear();
+                measureStart = wallSeconds();
+            }
+            int measured = frame - options.warmupFrames;
+            if (measured >= options.frames ||
+                (measured >= minimumFrames && wallSeconds() - measureStart > secondsPerCase))
+                break;
+
+            //Paced like a display at the target rate; a late frame starts at once and the schedule restarts from it
+            double now = wallSeconds();
+            if (now < nextFrame)
+                std::this_thread::sleep_for(std::chrono::duration<double>(nextFrame - now));
+            double frameStart = wallSeconds();
+            double cpuStart = threadCpuSeconds();
+            nextFrame = std::max(nextFrame + period, frameStart);
+
+            float angle = (float)frame * 0.02f;
+            glm::mat4 transform = glm::rotate(glm::mat4(1.0f), angle, glm::normalize(glm::vec3(1.0f, 1.0f, 0.0f)));
+            renderFrame(renderer, transform, glState);
+            if (mode == "sync") {
+                glPixelStorei(GL_PACK_ALIGNMENT, 4);
+                glReadPixels(0, 0, options.width, options.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            } else {
+                capture.capture();
+            }
+            //Stand-in for glfwSwapBuffers
+            glFinish();
+            frameMs.push_back((wallSeconds() - frameStart) * 1000.0);
+            frameCpuMs.push_back((threadCpuSeconds() - cpuStart) * 1000.0);
+            frame++;
+        }
+        capture.close();
+
+        SampleStats frameStats = computeStats(frameMs), cpuStats = computeStats(frameCpuMs);
+        if (mode == "off") {
+            offMeanMs = frameStats.mean;
+            offCpuMs = cpuStats.mean;
+        }
+        json.beginObject();
+        json.value("case", mode);
+        writeStats(json, "frame_ms", frameStats);
+        writeStats(json, "frame_cpu_ms", cpuStats);
+        json.value("overhead_percent", offMeanMs > 0.0 ? (frameStats.mean / offMeanMs - 1.0) * 100.0 : 0.0);
+        json.value("cpu_overhead_percent", offCpuMs > 0.0 ? (cpuStats.mean / offCpuMs - 1.0) * 100.0 : 0.0);
+        if (mode == "pbo_png" || mode == "pbo_raw") {
+            json.value("captured_frames", capture.capturedFrames());
+            json.value("dropped_frames", capture.droppedFrames());
+            json.value("written_frames", capture.writtenFrames());
+            json.value("failed_frames", capture.failedFrames());
+            json.value("bytes_written", capture.bytesWritten());
+            json.value("encode_ms_per_frame",
+                capture.writtenFrames() > 0 ? capture.encodeSeconds() * 1000.0 / (double)capture.writtenFrames() : 0.0);
+        }
+        json.endObject();
+    }
+    json.endArray();
+
+    if (temporaryDirectory)
+        std::filesystem::remove_all(directory, error);
+    destroyPyramidRenderer(renderer);
+    return result;
+}
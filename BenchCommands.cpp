@@ -0,0 +1,215 @@
+//Command recording benchmark: cull and record on worker threads, radix sort, submit on the GL thread.
+//Reports the cost of each phase per object as the object count grows.
+#include <cstring>
+#include <vector>
+
+#include <gtc/matrix_transform.hpp>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "InstancedRenderer.h"
+#include "JobSystem.h"
+#include "Json.h"
+#include "RenderCommands.h"
+#include "Renderer.h"
+#include "Scene.h"
+
+//Stop measuring one object count after this much wall time even if --frames is not reached
+static const double secondsPerCount = 10.0;
+static const int minimumFrames = 3;
+static const int materialCount = 64;
+//Objects per recording job
+static const size_t recordGrain = 4096;
+
+//-- Copy of the pyramid in its own VAO and buffers, stands in for a distinct mesh
+static CommandMesh createMeshCopy(std::vector<unsigned int>& buffers) {
+    CommandMesh mesh;
+    unsigned int VBO = 0, EBO = 0;
+    glGenVertexArrays(1, &mesh.VAO);
+    glBindVertexArray(mesh.VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(verticesPyramid), verticesPyramid, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    buffers.push_back(VBO);
+    buffers.push_back(EBO);
+    mesh.indexCount = pyramidIndexCount;
+    return mesh;
+}
+
+//-- Static scene description, object i uses program/mesh/material from its hash so submission order matters
+struct CommandScene {
+    std::vector<InstanceData> objects;
+    std::vector<unsigned char> program;
+    std::vector<unsigned char> mesh;
+    std::vector<unsigned short> material;
+};
+
+static void buildScene(CommandScene& scene, size_t count, int programCount, int meshCount) {
+    scene.objects.resize(count);
+    writeInstances(scene.objects.data(), 0, count, count, 0.0f);
+    scene.program.resize(count);
+    scene.mesh.resize(count);
+    scene.material.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        unsigned int h = (unsigned int)i * 2654435761u;
+        scene.program[i] = (unsigned char)((h >> 7) % programCount);
+        scene.mesh[i] = (unsigned char)((h >> 13) % meshCount);
+        scene.material[i] = (unsigned short)((h >> 19) % materialCount);
+    }
+}
+
+//Cull objects [begin, end) against the clip volume and record the visible ones
+static void recordObjects(const CommandScene& scene, const glm::mat4& view, size_t begin, size_t end,
+    glm::mat4* transforms, CommandBuffer& buffer) {
+    for (size_t i = begin; i < end; i++) {
+        glm::mat4 model;
+        std::memcpy(&model[0][0], scene.objects[i].transform, sizeof(model));
+        glm::mat4 mvp = view * model;
+
+        //Bounding sphere of the pyramid, radius ~0.87 around its origin
+        if (!isSphereInClip(mvp, clipRadius(mvp, pyramidBoundingRadius)))
+            continue;
+
+        transforms[i] = mvp;
+        float depth = mvp[3].z / mvp[3].w * 0.5f + 0.5f;
+        buffer.draw(makeSortKey(scene.program[i], scene.mesh[i], scene.material[i], depth), (uint32_t)i);
+    }
+}
+
+int runCommandsBench(const BenchOptions& options, JsonWriter& json) {
+    JobSystem jobs(options.threads);
+    json.value("threads", jobs.threadCount());
+    json.value("sorted", options.sortCommands);
+
+    //Two programs (plain and single pass outline, both take transform + ourColor) and a few meshes
+    PyramidRenderer pyramid;
+    if (!createPyramidRenderer(pyramid, true))
+        return -1;
+    CommandTables tables;
+    ProgramReflection plain = reflectProgram(pyramid.shaderProgram);
+    tables.programs.push_back(CommandProgram{ pyramid.shaderProgram, plain.location("transform"), plain.location("ourColor") });
+    if (pyramid.singlePassOutline)
+        tables.programs.push_back(CommandProgram{ pyramid.outline.program, pyramid.outline.transformLoc, pyramid.outline.fillColorLoc });
+    std::vector<unsigned int> meshBuffers;
+    for (int i = 0; i < options.meshes; i++)
+        tables.meshes.push_back(createMeshCopy(meshBuffers));
+    for (int i = 0; i < materialCount; i++) {
+        unsigned int h = (unsigned int)i * 2246822519u;
+        tables.materials.push_back(glm::vec3((h & 0xFF) / 255.0f, ((h >> 8) & 0xFF) / 255.0f, ((h >> 16) & 0xFF) / 255.0f));
+    }
+    json.value("programs", (int)tables.programs.size());
+    json.value("meshes", (int)tables.meshes.size());
+    json.value("materials", materialCount);
+
+    std::vector<size_t> objectCounts = options.objectCounts;
+    if (objectCounts.empty())
+        objectCounts = { 1000, 10000, 100000 };
+
+    json.beginArray("runs");
+    for (size_t count : objectCounts) {
+        CommandScene scene;
+        buildScene(scene, count, (int)tables.programs.size(), (int)tables.meshes.size());
+        std::vector<glm::mat4> transforms(count);
+        std::vector<CommandBuffer> buffers(jobs.threadCount());
+        std::vector<DrawPacket> packets, scratch;
+        GLStateCache glState;
+
+        std::vector<double> recordMs, sortMs, submitMs, frameMs;
+        SubmitStats submitted;
+        unsigned long long visible = 0;
+        double measureStart = 0.0;
+        int frame = 0;
+        for (;;) {
+            if (frame == options.warmupFrames) {
+                recordMs.clear(); sortMs.clear(); submitMs.clear(); frameMs.clear();
+                submitted = SubmitStats();
+                visible = 0;
+                glState.counters.reset();
+                measureStart = wallSeconds();
+            }
+            int measured = frame - options.warmupFrames;
+            if (measured >= options.frames ||
+                (measured >= minimumFrames && wallSeconds() - measureStart > secondsPerCount))
+                break;
+
+            //Camera zoomed in on the grid and turning, so culling rejects part of it every frame
+            float time = (float)frame * (float)simulationStep;
+            glm::mat4 view = glm::scale(glm::mat4(1.0f), glm::vec3(1.5f, 1.5f, 0.5f));
+            view = glm::rotate(view, time, glm::vec3(0.0f, 0.0f, 1.0f));
+
+            double start = wallSeconds();
+            for (CommandBuffer& buffer : buffers)
+                buffer.clear();
+            auto record = [&](size_t begin, size_t end, int worker) {
+                recordObjects(scene, view, begin, end, transforms.data(), buffers[worker]);
+            };
+            JobCounter recording;
+            jobs.parallelFor(count, recordGrain, record, recording);
+            jobs.wait(recording);
+            double recorded = wallSeconds();
+
+            mergeCommandBuffers(buffers, packets);
+            if (options.sortCommands)
+                radixSortPackets(packets, scratch);
+            double sorted = wallSeconds();
+
+            glState.clearColor(0.2f, 0.3f, 0.3f, 0.1f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glState.countCalls(1);
+            SubmitStats stats = submitPackets(packets, tables, transforms.data(), glState);
+            glFlush();
+            double submittedAt = wallSeconds();
+            glFinish();
+            double end = wallSeconds();
+
+            recordMs.push_back((recorded - start) * 1000.0);
+            sortMs.push_back((sorted - recorded) * 1000.0);
+            submitMs.push_back((submittedAt - sorted) * 1000.0);
+            frameMs.push_back((end - start) * 1000.0);
+            submitted.draws += stats.draws;
+            submitted.programSwitches += stats.programSwitches;
+            submitted.meshSwitches += stats.meshSwitches;
+            submitted.materialSwitches += stats.materialSwitches;
+            visible += packets.size();
+            frame++;
+        }
+
+        int frames = (int)recordMs.size();
+        double perFrame = frames > 0 ? 1.0 / frames : 0.0;
+        SampleStats record = computeStats(recordMs);
+        SampleStats sort = computeStats(sortMs);
+        SampleStats submit = computeStats(submitMs);
+        double drawsPerFrame = submitted.draws * perFrame;
+
+        json.beginObject();
+        json.value("objects", (uint64_t)count);
+        json.value("frames", frames);
+        json.value("visible_per_frame", visible * perFrame);
+        json.value("record_ns_per_object", record.mean * 1e6 / count);
+        json.value("sort_ns_per_packet", drawsPerFrame > 0.0 ? sort.mean * 1e6 / drawsPerFrame : 0.0);
+        json.value("submit_ns_per_draw", drawsPerFrame > 0.0 ? submit.mean * 1e6 / drawsPerFrame : 0.0);
+        json.value("program_switches_per_frame", submitted.programSwitches * perFrame);
+        json.value("mesh_switches_per_frame", submitted.meshSwitches * perFrame);
+        json.value("material_switches_per_frame", submitted.materialSwitches * perFrame);
+        json.value("gl_calls_per_frame", glState.counters.total * perFrame);
+        json.value("skipped_calls_per_frame", glState.counters.skipped() * perFrame);
+        writeStats(json, "record_ms", record);
+        writeStats(json, "sort_ms", sort);
+        writeStats(json, "submit_ms", submit);
+        writeStats(json, "frame_ms", computeStats(frameMs));
+        json.endObject();
+    }
+    json.endArray();
+
+    for (const CommandMesh& mesh : tables.meshes)
+        glDeleteVertexArrays(1, &mesh.VAO);
+    glDeleteBuffers((GLsizei)meshBuffers.size(), meshBuffers.data());
+    destroyPyramidRenderer(pyramid);
+    return 0;
+}
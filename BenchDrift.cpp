@@ -0,0 +1,239 @@
+//Transform drift benchmark: holds keys for --updates simulation steps through processInput (TransformState) and
+//through the old accumulated matrix (glm::translate / rotate / scale multiplied in every step), and compares both
+//against the same steps in double precision.
+//    rotate_z     Q
+//    rotate_xyz   Q, Z, T: rotation about all three axes every step
+//    move_rotate  W, Q, T: translation in the rotating frame
+//    all_keys     every transform key, each pair cancels out and the exact result is the identity
+//Per path: nanoseconds per update (for TransformState also per frame with drawTransform), the growth of that cost
+//over the run, how far the 3x3 part is from orthonormal and the largest element error of the matrix.
+//The growth compares the median chunk of the last quarter of the run with that of the first. Chunks are timed in
+//thread CPU time and each is the fastest of a few slices, so a busy machine preempting the run does not count.
+//Returns 4 when the TransformState path drifts or slows down beyond the bounds below.
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <gtc/matrix_transform.hpp>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "Json.h"
+#include "Scene.h"
+#include "Simulation.h"
+
+//Bounds for the TransformState path after all updates
+static const double maxOrthonormalError = 1e-5;
+static const double maxQuaternionNormError = 1e-5;
+static const double maxCostGrowth = 2.0;
+//The run is timed in this many equal parts, each the fastest of this many equal slices
+static const int timingChunks = 20;
+static const int chunkSlices = 3;
+
+struct DriftCase {
+    const char* name;
+    std::vector<Command> keys;
+};
+
+//What processInput did before TransformState, kept here as the baseline
+static void accumulateMatrix(const CommandState& commands, glm::mat4& transform, float d, float s) {
+    for (int i = 0; i < commandCount; i++) {
+        if (!commands.held[i])
+            continue;
+        const CommandAction& action = commandActions[i];
+        switch (action.kind) {
+        case CommandAction::Translate:
+            transform = glm::translate(transform, action.axis * d);
+            break;
+        case CommandAction::Rotate:
+            transform = glm::rotate(transform, glm::radians(action.amount), action.axis);
+            break;
+        case CommandAction::Scale: {
+            float factor = action.amount > 0.0f ? s : 1.0f / s;
+            transform = glm::scale(transform, glm::vec3(1.0f) + action.axis * (factor - 1.0f));
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+//-- The same steps as processInput in double precision
+struct ReferenceTransform {
+    glm::dvec3 translation = glm::dvec3(0.0);
+    glm::dquat rotation = glm::dquat(1.0, 0.0, 0.0, 0.0);
+    glm::dvec3 scale = glm::dvec3(1.0);
+
+    void apply(const CommandState& commands, double d, double s) {
+        for (int i = 0; i < commandCount; i++) {
+            if (!commands.held[i])
+                continue;
+            const CommandAction& action = commandActions[i];
+            glm::dvec3 axis(action.axis);
+            switch (action.kind) {
+            case CommandAction::Translate:
+                translation += rotation * (scale * axis * d);
+                break;
+            case CommandAction::Rotate:
+                rotation = glm::normalize(rotation * glm::angleAxis(glm::radians((double)action.amount), axis));
+                break;
+            case CommandAction::Scale:
+                scale *= glm::dvec3(1.0) + axis * ((action.amount > 0.0f ? s : 1.0 / s) - 1.0);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    glm::dmat4 matrix() const {
+        glm::dmat3 r = glm::mat3_cast(rotation);
+        glm::dmat4 m;
+        for (int c = 0; c < 3; c++)
+            m[c] = glm::dvec4(r[c] * scale[c], 0.0);
+        m[3] = glm::dvec4(translation, 1.0);
+        return m;
+    }
+};
+
+//Largest element of |R^T R - I| for the 3x3 part with the reference scale divided out
+static double orthonormalError(const glm::mat4& m, const glm::dvec3& scale) {
+    glm::dvec3 columns[3];
+    for (int c = 0; c < 3; c++)
+        columns[c] = glm::dvec3(m[c]) / scale[c];
+    double error = 0.0;
+    for (int a = 0; a < 3; a++) {
+        for (int b = 0; b < 3; b++)
+            error = std::max(error, std::fabs(glm::dot(columns[a], columns[b]) - (a == b ? 1.0 : 0.0)));
+    }
+    return error;
+}
+
+static double matrixError(const glm::mat4& m, const glm::dmat4& reference) {
+    double error = 0.0;
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++)
+            error = std::max(error, std::fabs((double)m[c][r] - reference[c][r]));
+    }
+    return error;
+}
+
+//-- Timing of one path, nanoseconds per update
+struct PathTiming {
+    double nsPerUpdate = 0.0;
+    double growth = 0.0;      //median of the last quarter of the chunks / median of the first quarter, CPU time
+};
+
+//Run update() updates times in timingChunks parts
+template <typename Update>
+static PathTiming timeUpdates(size_t updates, Update update) {
+    size_t slice = std::max<size_t>(1, updates / (timingChunks * chunkSlices));
+    std::vector<double> chunkTicks;
+    double start = wallSeconds();
+    double fastest = 0.0;
+    int slices = 0;
+    for (size_t done = 0; done < updates;) {
+        size_t count = std::min(slice, updates - done);
+        uint64_t sliceStart = threadCpuTicks();
+        for (size_t i = 0; i < count; i++)
+            update();
+        double ticks = (double)(threadCpuTicks() - sliceStart) / count;
+        fastest = slices == 0 ? ticks : std::min(fastest, ticks);
+        done += count;
+        if (++slices == chunkSlices || done == updates) {
+            chunkTicks.push_back(fastest);
+            slices = 0;
+        }
+    }
+    PathTiming timing;
+    timing.nsPerUpdate = (wallSeconds() - start) * 1e9 / updates;
+    size_t quarter = std::max<size_t>(1, chunkTicks.size() / 4);
+    std::vector<double> first(chunkTicks.begin(), chunkTicks.begin() + quarter);
+    std::vector<double> last(chunkTicks.end() - quarter, chunkTicks.end());
+    double firstMedian = computeStats(first).p50;
+    timing.growth = firstMedian > 0.0 ? computeStats(last).p50 / firstMedian : 1.0;
+    return timing;
+}
+
+int runDriftBench(const BenchOptions& options, JsonWriter& json) {
+    std::vector<DriftCase> cases = {
+        { "rotate_z", { Command::RotateZPositive } },
+        { "rotate_xyz", { Command::RotateZPositive, Command::RotateYPositive, Command::RotateXPositive } },
+        { "move_rotate", { Command::MoveUp, Command::RotateZPositive, Command::RotateXPositive } },
+        { "all_keys", {} },
+    };
+    for (int i = 0; i < commandCount; i++) {
+        if (commandActions[i].kind != CommandAction::None)
+            cases.back().keys.push_back((Command)i);
+    }
+
+    size_t updates = options.updates;
+    json.value("updates", (uint64_t)updates);
+    json.beginObject("bounds");
+    json.value("orthonormal_error", maxOrthonormalError);
+    json.value("quaternion_norm_error", maxQuaternionNormError);
+    json.value("cost_growth", maxCostGrowth);
+    json.endObject();
+
+    bool bounded = true;
+    json.beginArray("cases");
+    for (const DriftCase& driftCase : cases) {
+        CommandState commands;
+        for (Command key : driftCase.keys)
+            commands.held[(int)key] = true;
+
+        ReferenceTransform reference;
+        for (size_t i = 0; i < updates; i++)
+            reference.apply(commands, translateStep, scaleStep);
+        glm::dmat4 expected = reference.matrix();
+
+        glm::mat4 accumulated(1.0f);
+        PathTiming matrixTiming = timeUpdates(updates, [&]() { accumulateMatrix(commands, accumulated, translateStep, scaleStep); });
+
+        TransformState transform;
+        PathTiming stateTiming = timeUpdates(updates, [&]() { processInput(commands, transform, translateStep, scaleStep); });
+        glm::mat4 composed = transform.matrix();
+
+        //A frame per step as in the loop: beginStep, processInput, drawTransform at a moving alpha
+        SimulationState state;
+        float alpha = 0.0f;
+        double checksum = 0.0;
+        PathTiming frameTiming = timeUpdates(updates, [&]() {
+            state.beginStep();
+            processInput(commands, state.current, translateStep, scaleStep);
+            alpha = alpha >= 0.75f ? 0.0f : alpha + 0.25f;
+            checksum += state.drawTransform(alpha)[3][0];
+        });
+
+        double quaternionNormError = std::fabs(1.0 - (double)glm::length(transform.rotation));
+        double stateOrthonormal = orthonormalError(composed, reference.scale);
+        bool caseBounded = stateOrthonormal <= maxOrthonormalError && quaternionNormError <= maxQuaternionNormError &&
+            stateTiming.growth <= maxCostGrowth && frameTiming.growth <= maxCostGrowth;
+        bounded = bounded && caseBounded;
+
+        json.beginObject();
+        json.value("case", driftCase.name);
+        json.beginObject("matrix");
+        json.value("ns_per_update", matrixTiming.nsPerUpdate);
+        json.value("cost_growth", matrixTiming.growth);
+        json.value("orthonormal_error", orthonormalError(accumulated, reference.scale));
+        json.value("max_abs_error", matrixError(accumulated, expected));
+        json.endObject();
+        json.beginObject("transform_state");
+        json.value("ns_per_update", stateTiming.nsPerUpdate);
+        json.value("cost_growth", stateTiming.growth);
+        json.value("ns_per_frame", frameTiming.nsPerUpdate);
+        json.value("frame_cost_growth", frameTiming.growth);
+        json.value("frame_checksum", checksum);
+        json.value("orthonormal_error", stateOrthonormal);
+        json.value("quaternion_norm_error", quaternionNormError);
+        json.value("max_abs_error", matrixError(composed, expected));
+        json.endObject();
+        json.value("bounded", caseBounded);
+        json.endObject();
+    }
+    json.endArray();
+    json.value("bounded", bounded);
+    return bounded ? 0 : 4;
+}
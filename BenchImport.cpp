@@ -0,0 +1,290 @@
+//Mesh import benchmark: load OBJ / glTF files with MeshImporter on 1 and N threads and report MB/s and
+//triangles/s per phase. Without --mesh it generates a heightfield grid of --triangles triangles in both formats.
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "GLPlatform.h"
+#include "JobSystem.h"
+#include "Json.h"
+#include "MeshImporter.h"
+
+//Import each file at least minimumRepeats times, more while under secondsPerFile
+static const int minimumRepeats = 3;
+static const double secondsPerFile = 2.0;
+
+//-- Generated grid: (n + 1)^2 shared vertices, 2 n^2 triangles
+struct GridMesh {
+    size_t n = 0;
+    size_t vertexCount() const { return (n + 1) * (n + 1); }
+    size_t triangleCount() const { return 2 * n * n; }
+
+    glm::vec3 position(size_t x, size_t z) const {
+        float u = (float)x / n, v = (float)z / n;
+        return glm::vec3(u - 0.5f, 0.05f * std::sin(u * 25.0f) * std::cos(v * 25.0f), v - 0.5f);
+    }
+    glm::vec3 normal(size_t x, size_t z) const {
+        float u = (float)x / n, v = (float)z / n;
+        float dx = 0.05f * 25.0f * std::cos(u * 25.0f) * std::cos(v * 25.0f);
+        float dz = -0.05f * 25.0f * std::sin(u * 25.0f) * std::sin(v * 25.0f);
+        return glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+    }
+    //Vertex index of grid point (x, z), and the 6 corners of quad (x, z)
+    size_t index(size_t x, size_t z) const { return z * (n + 1) + x; }
+    void quad(size_t x, size_t z, size_t corners[6]) const {
+        size_t a = index(x, z), b = index(x + 1, z), c = index(x + 1, z + 1), d = index(x, z + 1);
+        size_t order[6] = { a, c, b, a, d, c };
+        std::memcpy(corners, order, sizeof(order));
+    }
+};
+
+//Flush the text buffer to the file once it is large
+static bool flushText(std::string& text, FILE* file, bool force) {
+    if (!force && text.size() < (4u << 20))
+        return true;
+    bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    text.clear();
+    return ok;
+}
+
+static bool writeGridObj(const GridMesh& grid, const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        std::cerr << "Error creating " << path << std::endl;
+        return false;
+    }
+    std::string text = "# OpenGLIntroBench heightfield\no grid\n";
+    char line[128];
+    bool ok = true;
+    for (size_t z = 0; z <= grid.n && ok; z++) {
+        for (size_t x = 0; x <= grid.n; x++) {
+            glm::vec3 p = grid.position(x, z);
+            text.append(line, std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", p.x, p.y, p.z));
+        }
+        ok = flushText(text, file, false);
+    }
+    for (size_t z = 0; z <= grid.n && ok; z++) {
+        for (size_t x = 0; x <= grid.n; x++) {
+            glm::vec3 n = grid.normal(x, z);
+            text.append(line, std::snprintf(line, sizeof(line), "vn %.5f %.5f %.5f\n", n.x, n.y, n.z));
+        }
+        ok = flushText(text, file, false);
+    }
+    size_t corners[6];
+    for (size_t z = 0; z < grid.n && ok; z++) {
+        for (size_t x = 0; x < grid.n; x++) {
+            grid.quad(x, z, corners);
+            for (int t = 0; t < 6; t += 3) {
+                text.append(line, std::snprintf(line, sizeof(line), "f %zu//%zu %zu//%zu %zu//%zu\n",
+                    corners[t] + 1, corners[t] + 1, corners[t + 1] + 1, corners[t + 1] + 1, corners[t + 2] + 1, corners[t + 2] + 1));
+            }
+        }
+        ok = flushText(text, file, false);
+    }
+    ok = ok && flushText(text, file, true);
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok)
+        std::cerr << "Error writing " << path << std::endl;
+    return ok;
+}
+
+//Every triangle gets its own three interleaved position/normal vertices, as exporters that split per face do,
+//so the importer has 3x the vertices to deduplicate
+static bool writeGridGlb(const GridMesh& grid, const std::string& path) {
+    size_t triangles = grid.triangleCount();
+    size_t vertexCount = triangles * 3;
+    std::vector<float> vertices(vertexCount * 6);
+    std::vector<uint32_t> indices(vertexCount);
+    size_t corners[6];
+    size_t v = 0;
+    for (size_t z = 0; z < grid.n; z++) {
+        for (size_t x = 0; x < grid.n; x++) {
+            grid.quad(x, z, corners);
+            for (int c = 0; c < 6; c++, v++) {
+                size_t px = corners[c] % (grid.n + 1), pz = corners[c] / (grid.n + 1);
+                glm::vec3 p = grid.position(px, pz), n = grid.normal(px, pz);
+                float vertex[6] = { p.x, p.y, p.z, n.x, n.y, n.z };
+                std::memcpy(&vertices[v * 6], vertex, sizeof(vertex));
+                indices[v] = (uint32_t)v;
+            }
+        }
+    }
+    glm::vec3 low = grid.position(0, 0), high = grid.position(grid.n, grid.n);
+    size_t vertexBytes = vertices.size() * sizeof(float), indexBytes = indices.size() * sizeof(uint32_t);
+
+    char json[2048];
+    int jsonLength = std::snprintf(json, sizeof(json),
+        "{\"asset\":{\"version\":\"2.0\",\"generator\":\"OpenGLIntroBench\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+        "\"nodes\":[{\"mesh\":0,\"translation\":[0,0.25,0]}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1},\"indices\":2,\"mode\":4}]}],"
+        "\"accessors\":["
+        "{\"bufferView\":0,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\",\"min\":[%g,-0.05,%g],\"max\":[%g,0.05,%g]},"
+        "{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},"
+        "{\"bufferView\":1,\"componentType\":5125,\"count\":%zu,\"type\":\"SCALAR\"}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%zu,\"byteStride\":24,\"target\":34962},"
+        "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"target\":34963}],"
+        "\"buffers\":[{\"byteLength\":%zu}]}",
+        vertexCount, low.x, low.z, high.x, high.z, vertexCount, vertexCount,
+        vertexBytes, vertexBytes, indexBytes, vertexBytes + indexBytes);
+    //Chunks are 4 byte aligned, JSON padded with spaces
+    std::string jsonChunk(json, jsonLength);
+    while (jsonChunk.size() % 4 != 0)
+        jsonChunk += ' ';
+    uint32_t binLength = (uint32_t)(vertexBytes + indexBytes);
+    uint32_t header[3] = { 0x46546C67, 2, (uint32_t)(12 + 8 + jsonChunk.size() + 8 + binLength) };
+    uint32_t jsonHeader[2] = { (uint32_t)jsonChunk.size(), 0x4E4F534A };
+    uint32_t binHeader[2] = { binLength, 0x004E4942 };
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        std::cerr << "Error creating " << path << std::endl;
+        return false;
+    }
+    bool ok = std::fwrite(header, sizeof(header), 1, file) == 1 &&
+        std::fwrite(jsonHeader, sizeof(jsonHeader), 1, file) == 1 &&
+        std::fwrite(jsonChunk.data(), 1, jsonChunk.size(), file) == jsonChunk.size() &&
+        std::fwrite(binHeader, sizeof(binHeader), 1, file) == 1 &&
+        std::fwrite(vertices.data(), 1, vertexBytes, file) == vertexBytes &&
+        std::fwrite(indices.data(), 1, indexBytes, file) == indexBytes;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok)
+        std::cerr << "Error writing " << path << std::endl;
+    return ok;
+}
+
+//Import path repeatedly on jobs, report the run with the median total time
+static bool measureImport(const std::string& path, JobSystem& jobs, JsonWriter& json, MeshData& mesh, double& medianMs) {
+    std::vector<MeshImportStats> runs;
+    double start = wallSeconds();
+    while ((int)runs.size() < minimumRepeats || wallSeconds() - start < secondsPerFile) {
+        MeshImportStats stats;
+        if (!importMesh(path.c_str(), mesh, &jobs, &stats))
+            return false;
+        runs.push_back(stats);
+        if ((int)runs.size() >= minimumRepeats && wallSeconds() - start >= secondsPerFile)
+            break;
+    }
+    std::vector<double> totals;
+    for (const MeshImportStats& stats : runs)
+        totals.push_back(stats.totalMs);
+    SampleStats totalStats = computeStats(totals);
+    const MeshImportStats* median = &runs[0];
+    for (const MeshImportStats& stats : runs) {
+        if (std::fabs(stats.totalMs - totalStats.p50) < std::fabs(median->totalMs - totalStats.p50))
+            median = &stats;
+    }
+
+    medianMs = median->totalMs;
+    double seconds = median->totalMs / 1000.0;
+    json.value("threads", jobs.threadCount());
+    json.value("repeats", (int)runs.size());
+    json.value("total_ms", median->totalMs);
+    json.value("map_ms", median->mapMs);
+    json.value("parse_ms", median->parseMs);
+    json.value("dedup_ms", median->dedupMs);
+    json.value("build_ms", median->buildMs);
+    json.value("mb_per_second", seconds > 0.0 ? median->fileBytes / seconds / 1e6 : 0.0);
+    json.value("mtriangles_per_second", seconds > 0.0 ? mesh.triangleCount() / seconds / 1e6 : 0.0);
+    writeStats(json, "total_ms_stats", totalStats);
+    return true;
+}
+
+static GridMesh gridForTriangles(size_t triangles) {
+    GridMesh grid;
+    grid.n = (size_t)std::ceil(std::sqrt((double)triangles / 2.0));
+    return grid;
+}
+
+std::vector<std::string> writeBenchGrid(size_t triangles) {
+    GridMesh grid = gridForTriangles(triangles);
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    std::vector<std::string> paths;
+    paths.push_back((directory / "OpenGLIntroBench_grid.obj").string());
+    paths.push_back((directory / "OpenGLIntroBench_grid.glb").string());
+    if (!writeGridObj(grid, paths[0]) || !writeGridGlb(grid, paths[1]))
+        return std::vector<std::string>();
+    return paths;
+}
+
+int runImportBench(const BenchOptions& options, JsonWriter& json) {
+    std::vector<std::string> paths = options.meshPaths;
+    std::vector<std::string> generated;
+    GridMesh grid;
+    if (paths.empty()) {
+        grid = gridForTriangles(options.triangles);
+        double start = wallSeconds();
+        generated = writeBenchGrid(options.triangles);
+        if (generated.empty())
+            return 1;
+        json.value("generated_triangles", (uint64_t)grid.triangleCount());
+        json.value("generate_ms", (wallSeconds() - start) * 1000.0);
+        paths = generated;
+    }
+
+    JobSystem jobs(options.threads);
+    JobSystem single(1);
+    int result = 0;
+    json.beginArray("files");
+    for (const std::string& path : paths) {
+        json.beginObject();
+        json.value("path", path);
+        MeshData mesh;
+        MeshImportStats stats;
+        if (!importMesh(path.c_str(), mesh, &jobs, &stats)) {
+            json.value("error", "import failed");
+            json.endObject();
+            result = 1;
+            continue;
+        }
+        json.value("file_mb", stats.fileBytes / 1e6);
+        json.value("source_vertices", (uint64_t)stats.sourceVertices);
+        json.value("vertices", (uint64_t)mesh.vertexCount());
+        json.value("triangles", (uint64_t)mesh.triangleCount());
+        json.value("has_normals", !mesh.normals.empty());
+        //Both generated files hold the same grid, so dedup must find exactly its shared vertices
+        if (!generated.empty())
+            json.value("dedup_matches_grid", mesh.vertexCount() == grid.vertexCount() && mesh.triangleCount() == grid.triangleCount());
+
+        double singleMs = 0.0, multiMs = 0.0;
+        json.beginObject("single_thread");
+        bool ok = measureImport(path, single, json, mesh, singleMs);
+        json.endObject();
+        if (jobs.threadCount() > 1 && ok) {
+            json.beginObject("multi_thread");
+            ok = measureImport(path, jobs, json, mesh, multiMs);
+            json.value("speedup", multiMs > 0.0 ? singleMs / multiMs : 0.0);
+            json.endObject();
+        }
+
+        //What the VAO setup then costs for the imported buffers
+        if (ok) {
+            unsigned int buffers[2];
+            glGenBuffers(2, buffers);
+            double start = wallSeconds();
+            glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+            glBufferData(GL_ARRAY_BUFFER, mesh.positions.size() * sizeof(float), mesh.positions.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+            glFinish();
+            json.value("upload_ms", (wallSeconds() - start) * 1000.0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+            glDeleteBuffers(2, buffers);
+        }
+        else {
+            result = 1;
+        }
+        json.endObject();
+    }
+    json.endArray();
+
+    for (const std::string& path : generated)
+        std::remove(path.c_str());
+    return result;
+}
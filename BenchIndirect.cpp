@@ -0,0 +1,193 @@
+//GPU driven culling benchmark (IndirectRenderer.h): the same scene of --objects pyramids over --meshes mesh
+//variants in one merged VBO/EBO, under a zooming, turning camera so part of it is culled every frame.
+//    per_object    cull on the CPU, then one glDrawElementsBaseVertex with its own uniforms per visible object
+//    cpu_indirect  IndirectCulling::Cpu: cull on the CPU, upload instances and commands, one glMultiDrawElementsIndirect
+//    gpu_indirect  IndirectCulling::Gpu: compute shader cull, one glMultiDrawElementsIndirect
+//cpu_ms is the render thread's time until the last call returns, frame_ms includes glFinish (under llvmpipe the
+//vertex work of each draw already runs inside the call). Afterwards the GPU
+//and CPU visible sets are compared for several camera angles; any difference fails the run.
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include <gtc/matrix_transform.hpp>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "IndirectRenderer.h"
+#include "Json.h"
+#include "Scene.h"
+
+//Stop measuring one case after this much wall time even if --frames is not reached
+static const double secondsPerCase = 10.0;
+static const int minimumFrames = 3;
+//Camera angles the GPU and CPU visible sets are compared at
+static const int checkAngles = 8;
+
+//Pyramid with its apex raised per variant, so every mesh has its own vertices in the merged buffer
+static void buildGeometry(IndirectGeometry& geometry, int meshCount) {
+    for (int mesh = 0; mesh < meshCount; mesh++) {
+        float vertices[pyramidVertexCount * 3];
+        std::memcpy(vertices, verticesPyramid, sizeof(vertices));
+        vertices[4 * 3 + 1] = 0.5f + 0.5f * (float)mesh / (float)meshCount;
+        geometry.addMesh(vertices, pyramidVertexCount, indices, pyramidIndexCount);
+    }
+}
+
+static void buildObjects(std::vector<IndirectObject>& objects, size_t count, const IndirectGeometry& geometry) {
+    std::vector<InstanceData> instances(count);
+    writeInstances(instances.data(), 0, count, count, 0.0f);
+    objects.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        unsigned int h = (unsigned int)i * 2654435761u;
+        objects[i].instance = instances[i];
+        objects[i].mesh = (h >> 13) % (unsigned int)geometry.meshes.size();
+        objects[i].radius = geometry.meshes[objects[i].mesh].boundingRadius;
+        objects[i].reserved = 0;
+    }
+}
+
+//Zoomed in on the grid and turning, as in the commands benchmark
+static glm::mat4 cameraAt(float time) {
+    glm::mat4 view = glm::scale(glm::mat4(1.0f), glm::vec3(1.5f, 1.5f, 0.5f));
+    return glm::rotate(view, time, glm::vec3(0.0f, 0.0f, 1.0f));
+}
+
+//The old way: one draw and its uniforms per visible object
+static void renderPerObject(IndirectRenderer& renderer, const OutlineProgram& outline, const glm::mat4& view,
+    GLStateCache& state) {
+    state.clearColor(0.2f, 0.3f, 0.3f, 0.1f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    state.countCalls(1);
+    state.useProgram(outline.program);
+    state.bindVertexArray(renderer.VAO);
+    for (const IndirectObject& object : renderer.objects) {
+        if (!isIndirectObjectInClip(view, object))
+            continue;
+        glm::mat4 model;
+        std::memcpy(&model[0][0], object.instance.transform, sizeof(model));
+        state.uniformMatrix4(outline.transformLoc, view * model);
+        state.uniform3f(outline.fillColorLoc, object.instance.color[0] / 255.0f, object.instance.color[1] / 255.0f,
+            object.instance.color[2] / 255.0f);
+        const IndirectMesh& mesh = renderer.meshes[object.mesh];
+        glDrawElementsBaseVertex(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT,
+            (void*)(mesh.firstIndex * sizeof(unsigned int)), mesh.baseVertex);
+        state.countCalls(1, 1);
+    }
+}
+
+int runIndirectBench(const BenchOptions& options, JsonWriter& json) {
+    if (!isIndirectRenderingSupported()) {
+        std::cerr << "Indirect mode needs a GL 4.3 context" << std::endl;
+        return 1;
+    }
+    std::vector<size_t> objectCounts = options.objectCounts;
+    if (objectCounts.empty())
+        objectCounts = { 10000, 100000, 1000000 };
+    size_t capacity = 0;
+    for (size_t count : objectCounts)
+        capacity = std::max(capacity, count);
+
+    IndirectGeometry geometry;
+    buildGeometry(geometry, options.meshes);
+    IndirectRenderer renderer;
+    PyramidRenderer pyramid;
+    if (!createIndirectRenderer(renderer, geometry, capacity, options.outline == "single"))
+        return -1;
+    //Only for its single pyramid outline program (transform + ourColor), the per object baseline
+    if (!createPyramidRenderer(pyramid, true) || !pyramid.singlePassOutline) {
+        destroyIndirectRenderer(renderer);
+        return -1;
+    }
+    setOutlineViewport(renderer.outline, options.width, options.height);
+    setOutlineViewport(pyramid.outline, options.width, options.height);
+    json.value("meshes", (int)geometry.meshes.size());
+    json.value("single_pass_outline", renderer.singlePassOutline);
+
+    const char* caseNames[] = { "per_object", "cpu_indirect", "gpu_indirect" };
+    bool setsMatch = true;
+    json.beginArray("runs");
+    for (size_t count : objectCounts) {
+        std::vector<IndirectObject> objects;
+        buildObjects(objects, count, geometry);
+        if (!setIndirectObjects(renderer, objects.data(), count))
+            return 1;
+
+        json.beginObject();
+        json.value("objects", (uint64_t)count);
+        json.beginArray("cases");
+        for (int caseIndex = 0; caseIndex < 3; caseIndex++) {
+            renderer.culling = caseIndex == 2 ? IndirectCulling::Gpu : IndirectCulling::Cpu;
+            GLStateCache glState;
+            std::vector<double> cpuMs, frameMs;
+            double measureStart = 0.0;
+            for (int frame = 0;; frame++) {
+                if (frame == options.warmupFrames) {
+                    cpuMs.clear();
+                    frameMs.clear();
+                    glState.counters.reset();
+                    measureStart = wallSeconds();
+                }
+                int measured = frame - options.warmupFrames;
+                if (measured >= options.frames || (measured >= minimumFrames && wallSeconds() - measureStart > secondsPerCase))
+                    break;
+
+                glm::mat4 view = cameraAt((float)frame * (float)simulationStep);
+                double start = wallSeconds();
+                if (caseIndex == 0)
+                    renderPerObject(renderer, pyramid.outline, view, glState);
+                else
+                    renderIndirectFrame(renderer, view, glState);
+                double submitted = wallSeconds();
+                glFinish();
+                cpuMs.push_back((submitted - start) * 1000.0);
+                frameMs.push_back((wallSeconds() - start) * 1000.0);
+            }
+            double frames = (double)std::max<size_t>(1, frameMs.size());
+            json.beginObject();
+            json.value("case", caseNames[caseIndex]);
+            json.value("frames", (uint64_t)frameMs.size());
+            json.value("draw_calls_per_frame", glState.counters.draws / frames);
+            json.value("gl_calls_per_frame", glState.counters.total / frames);
+            writeStats(json, "cpu_ms", computeStats(cpuMs));
+            writeStats(json, "frame_ms", computeStats(frameMs));
+            json.endObject();
+        }
+        json.endArray();
+
+        //GPU against CPU visible sets, object by object
+        GLStateCache glState;
+        uint64_t visibleTotal = 0, mismatches = 0;
+        std::vector<std::vector<uint32_t>> gpuSet, cpuSet;
+        for (int angle = 0; angle < checkAngles; angle++) {
+            glm::mat4 view = cameraAt(6.2831853f * angle / checkAngles);
+            renderer.culling = IndirectCulling::Gpu;
+            cullIndirectObjects(renderer, view, glState);
+            readIndirectVisibleSet(renderer, gpuSet);
+            renderer.culling = IndirectCulling::Cpu;
+            cullIndirectObjects(renderer, view, glState);
+            readIndirectVisibleSet(renderer, cpuSet);
+            for (size_t mesh = 0; mesh < cpuSet.size(); mesh++) {
+                visibleTotal += cpuSet[mesh].size();
+                if (gpuSet[mesh] == cpuSet[mesh])
+                    continue;
+                std::vector<uint32_t> difference;
+                std::set_symmetric_difference(gpuSet[mesh].begin(), gpuSet[mesh].end(), cpuSet[mesh].begin(),
+                    cpuSet[mesh].end(), std::back_inserter(difference));
+                mismatches += difference.size();
+            }
+        }
+        json.value("visible_per_frame", (double)visibleTotal / checkAngles);
+        json.value("visible_set_mismatches", mismatches);
+        json.endObject();
+        setsMatch = setsMatch && mismatches == 0;
+    }
+    json.endArray();
+    json.value("visible_sets_match", setsMatch);
+
+    destroyPyramidRenderer(pyramid);
+    destroyIndirectRenderer(renderer);
+    return setsMatch ? 0 : 1;
+}
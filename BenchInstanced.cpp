@@ -0,0 +1,104 @@
+//Instanced rendering benchmark: how upload and draw submission cost scale with the instance count.
+#include <iostream>
+#include <vector>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "InstancedRenderer.h"
+#include "Json.h"
+
+//Stop measuring one instance count after this much wall time even if --frames is not reached
+static const double secondsPerCount = 10.0;
+static const int minimumFrames = 3;
+
+int runInstancedBench(const BenchOptions& options, JsonWriter& json) {
+    json.value("frames_requested", options.frames);
+    json.value("warmup_frames", options.warmupFrames);
+    json.beginArray("runs");
+
+    for (size_t count : options.instanceCounts) {
+        InstancedRenderer renderer;
+        if (!createInstancedRenderer(renderer, count, options.persistentMapping, options.outline == "single")) {
+            json.endArray();
+            return -1;
+        }
+        if (renderer.singlePassOutline)
+            setOutlineWidth(renderer.outline, options.outlineWidth);
+
+        std::vector<double> frameMs, uploadMs, submitMs, waitMs;
+        GLStateCache glState;
+        glState.filtering = options.stateCache;
+        const GLCallCounters& calls = glState.counters;
+        glm::mat4 transform(1.0f);
+        double measureStart = 0.0;
+        double previousFrameStart = wallSeconds();
+        int frame = 0;
+        for (;;) {
+            if (frame == options.warmupFrames) {
+                frameMs.clear(); uploadMs.clear(); submitMs.clear(); waitMs.clear();
+                glState.counters.reset();
+                renderer.stream.fenceWaitSeconds = 0.0;
+                renderer.stream.uploadSeconds = 0.0;
+                renderer.stream.blockedWaits = 0;
+                measureStart = wallSeconds();
+            }
+            int measured = frame - options.warmupFrames;
+            if (measured >= options.frames ||
+                (measured >= minimumFrames && wallSeconds() - measureStart > secondsPerCount))
+                break;
+
+            double frameStart = wallSeconds();
+            if (frame > 0)
+                frameMs.push_back((frameStart - previousFrameStart) * 1000.0);
+            previousFrameStart = frameStart;
+
+            //Upload: fence wait + writing every instance (+ glBufferSubData on the fallback path)
+            double waitBefore = renderer.stream.fenceWaitSeconds;
+            updateInstances(renderer, (float)frame * (float)simulationStep);
+            double afterUpload = wallSeconds();
+            double wait = renderer.stream.fenceWaitSeconds - waitBefore;
+            waitMs.push_back(wait * 1000.0);
+            uploadMs.push_back((afterUpload - frameStart - wait) * 1000.0);
+
+            //Submit: the GL calls of the frame, no waiting on the GPU
+            renderInstancedFrame(renderer, transform, glState);
+            glFlush();
+            submitMs.push_back((wallSeconds() - afterUpload) * 1000.0);
+            frame++;
+        }
+        glFinish();
+        //The first measured frame has no previous measured frame to diff against
+        if (!frameMs.empty() && frameMs.size() > uploadMs.size())
+            frameMs.erase(frameMs.begin());
+
+        int measuredFrames = (int)uploadMs.size();
+        SampleStats upload = computeStats(uploadMs);
+        SampleStats submit = computeStats(submitMs);
+        double bytesPerFrame = (double)count * sizeof(InstanceData);
+
+        json.beginObject();
+        json.value("instances", (uint64_t)count);
+        json.value("persistent_mapping", renderer.stream.isPersistent());
+        json.value("outline", renderer.singlePassOutline ? "single" : "two-pass");
+        json.value("frames", measuredFrames);
+        json.value("triangles_per_frame", (uint64_t)count * 6);
+        json.value("draw_calls_per_frame", measuredFrames > 0 ? (double)calls.draws / measuredFrames : 0.0);
+        json.value("gl_calls_per_frame", measuredFrames > 0 ? (double)calls.total / measuredFrames : 0.0);
+        json.value("skipped_calls_per_frame", measuredFrames > 0 ? (double)calls.skipped() / measuredFrames : 0.0);
+        json.value("upload_bytes_per_frame", bytesPerFrame);
+        json.value("upload_ns_per_instance", upload.mean * 1e6 / count);
+        json.value("upload_gb_per_second", upload.mean > 0.0 ? bytesPerFrame / (upload.mean * 1e-3) / 1e9 : 0.0);
+        json.value("submit_ns_per_instance", submit.mean * 1e6 / count);
+        json.value("blocked_fence_waits", (uint64_t)renderer.stream.blockedWaits);
+        writeStats(json, "frame_time_ms", computeStats(frameMs));
+        writeStats(json, "upload_ms", upload);
+        writeStats(json, "submit_ms", submit);
+        writeStats(json, "fence_wait_ms", computeStats(waitMs));
+        json.endObject();
+
+        destroyInstancedRenderer(renderer);
+    }
+
+    json.endArray();
+    return 0;
+}
@@ -0,0 +1,212 @@
+//Job system benchmark: one frame's update stages (input, simulation, transform propagation, culling,
+//command building) chained with dependency counters, measured from 1 to N threads.
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <gtc/matrix_transform.hpp>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "InstancedRenderer.h"
+#include "JobSystem.h"
+#include "Json.h"
+#include "RenderCommands.h"
+#include "Scene.h"
+
+//Stop measuring one thread count after this much wall time even if --frames is not reached
+static const double secondsPerRun = 5.0;
+static const int minimumFrames = 3;
+//Objects per job in the parallel stages
+static const size_t updateGrain = 4096;
+
+static const int stageCount = 5;
+static const char* stageNames[stageCount] = { "input", "simulation", "transforms", "culling", "commands" };
+
+//-- Everything the stages of one frame read and write
+struct FrameUpdate {
+    const BenchOptions* options = nullptr;
+    size_t objectCount = 0;
+    uint64_t step = 0;
+    float time = 0.0f;
+
+    InputSystem input;
+    CommandState commands;
+    SimulationState state;
+    glm::mat4 global = glm::mat4(1.0f);             //state.current composed, once per step
+
+    std::vector<glm::mat4> world;                   //per object, model * simulated transform
+    std::vector<unsigned char> visible;             //per object, culling result
+    std::vector<std::vector<InstanceData>> scratch; //per worker, local transforms of one job
+    std::vector<CommandBuffer> buffers;             //per worker
+    double stageEnd[stageCount] = {};
+};
+
+//Single job stages
+static void inputStage(void* data, size_t, size_t, int) {
+    FrameUpdate& frame = *(FrameUpdate*)data;
+    scriptedKeyEvents(frame.options->script, frame.step, frame.input);
+    frame.input.update(frame.commands);
+}
+
+static void simulationStage(void* data, size_t, size_t, int) {
+    FrameUpdate& frame = *(FrameUpdate*)data;
+    frame.state.beginStep();
+    processInput(frame.commands, frame.state.current, translateStep, scaleStep);
+    frame.global = frame.state.current.matrix();
+}
+
+//Records when a stage's counter reached zero
+struct StageMark {
+    FrameUpdate* frame;
+    int stage;
+};
+
+static void markStage(void* data, size_t, size_t, int) {
+    StageMark& mark = *(StageMark*)data;
+    mark.frame->stageEnd[mark.stage] = wallSeconds();
+}
+
+//Run one frame of update stages on jobs, return when the command buffers are complete
+static void updateFrame(JobSystem& jobs, FrameUpdate& frame) {
+    size_t count = frame.objectCount;
+
+    //Each object spins on its grid cell (writeInstances), then takes the simulated transform
+    auto propagate = [&frame](size_t begin, size_t end, int worker) {
+        std::vector<InstanceData>& local = frame.scratch[worker];
+        local.resize(end - begin);
+        writeInstances(local.data(), begin, end - begin, frame.objectCount, frame.time);
+        const glm::mat4& global = frame.global;
+        for (size_t i = begin; i < end; i++) {
+            glm::mat4 model;
+            std::memcpy(&model[0][0], local[i - begin].transform, sizeof(model));
+            frame.world[i] = global * model;
+        }
+    };
+    auto cull = [&frame](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; i++) {
+            const glm::mat4& mvp = frame.world[i];
+            frame.visible[i] = isSphereInClip(mvp, clipRadius(mvp, pyramidBoundingRadius)) ? 1 : 0;
+        }
+    };
+    auto build = [&frame](size_t begin, size_t end, int worker) {
+        CommandBuffer& buffer = frame.buffers[worker];
+        for (size_t i = begin; i < end; i++) {
+            if (!frame.visible[i])
+                continue;
+            const glm::vec4& center = frame.world[i][3];
+            float depth = center.z / center.w * 0.5f + 0.5f;
+            buffer.draw(makeSortKey(0, 0, (unsigned int)(i % 64), depth), (uint32_t)i);
+        }
+    };
+
+    for (CommandBuffer& buffer : frame.buffers)
+        buffer.clear();
+
+    //Stages chain through their counters; every call returns immediately
+    JobCounter inputDone, simulationDone, transformsDone, cullingDone, commandsDone, marksDone;
+    JobCounter* stageCounters[stageCount] = { &inputDone, &simulationDone, &transformsDone, &cullingDone, &commandsDone };
+    jobs.run(inputStage, &frame, &inputDone);
+    jobs.runAfter(inputDone, simulationStage, &frame, &simulationDone);
+    jobs.parallelForAfter(simulationDone, count, updateGrain, propagate, transformsDone);
+    jobs.parallelForAfter(transformsDone, count, updateGrain, cull, cullingDone);
+    jobs.parallelForAfter(cullingDone, count, updateGrain, build, commandsDone);
+
+    StageMark marks[stageCount];
+    for (int stage = 0; stage < stageCount; stage++) {
+        marks[stage] = StageMark{ &frame, stage };
+        jobs.runAfter(*stageCounters[stage], markStage, &marks[stage], &marksDone);
+    }
+    jobs.wait(commandsDone);
+    jobs.wait(marksDone);
+}
+
+int runJobsBench(const BenchOptions& options, JsonWriter& json) {
+    std::vector<size_t> objectCounts = options.objectCounts;
+    if (objectCounts.empty())
+        objectCounts = { 1000000 };
+    int maxThreads = options.threads > 0 ? options.threads : (int)std::thread::hardware_concurrency();
+    if (maxThreads <= 0)
+        maxThreads = 1;
+    //1, 2, 4, ... and the maximum itself
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    json.value("hardware_threads", (int)std::thread::hardware_concurrency());
+    json.value("grain", (uint64_t)updateGrain);
+    json.beginArray("runs");
+    for (size_t count : objectCounts) {
+        double singleThreadMs = 0.0;
+        for (int threads : threadCounts) {
+            JobSystem jobs(threads);
+            FrameUpdate frame;
+            frame.options = &options;
+            frame.objectCount = count;
+            frame.world.resize(count);
+            frame.visible.resize(count);
+            frame.scratch.resize(jobs.threadCount());
+            frame.buffers.resize(jobs.threadCount());
+
+            std::vector<double> updateMs;
+            std::vector<double> stageMs[stageCount];
+            unsigned long long stealsBefore = 0, visible = 0;
+            double measureStart = 0.0;
+            int frameIndex = 0;
+            for (;;) {
+                if (frameIndex == options.warmupFrames) {
+                    updateMs.clear();
+                    for (std::vector<double>& stage : stageMs)
+                        stage.clear();
+                    stealsBefore = jobs.stolenJobs();
+                    visible = 0;
+                    measureStart = wallSeconds();
+                }
+                int measured = frameIndex - options.warmupFrames;
+                if (measured >= options.frames ||
+                    (measured >= minimumFrames && wallSeconds() - measureStart > secondsPerRun))
+                    break;
+
+                frame.step = (uint64_t)frameIndex;
+                frame.time = (float)frameIndex * (float)simulationStep;
+                double start = wallSeconds();
+                updateFrame(jobs, frame);
+                double end = wallSeconds();
+
+                updateMs.push_back((end - start) * 1000.0);
+                double previous = start;
+                for (int stage = 0; stage < stageCount; stage++) {
+                    stageMs[stage].push_back((frame.stageEnd[stage] - previous) * 1000.0);
+                    previous = frame.stageEnd[stage];
+                }
+                for (const CommandBuffer& buffer : frame.buffers)
+                    visible += buffer.packets.size();
+                frameIndex++;
+            }
+
+            int frames = (int)updateMs.size();
+            SampleStats update = computeStats(updateMs);
+            if (threads == 1)
+                singleThreadMs = update.mean;
+
+            json.beginObject();
+            json.value("objects", (uint64_t)count);
+            json.value("threads", threads);
+            json.value("frames", frames);
+            json.value("visible_per_frame", frames > 0 ? (double)visible / frames : 0.0);
+            json.value("update_ns_per_object", update.mean * 1e6 / count);
+            json.value("speedup", update.mean > 0.0 && singleThreadMs > 0.0 ? singleThreadMs / update.mean : 0.0);
+            json.value("efficiency", update.mean > 0.0 && singleThreadMs > 0.0 ? singleThreadMs / update.mean / threads : 0.0);
+            json.value("steals_per_frame", frames > 0 ? (double)(jobs.stolenJobs() - stealsBefore) / frames : 0.0);
+            writeStats(json, "update_ms", update);
+            json.beginObject("stage_ms");
+            for (int stage = 0; stage < stageCount; stage++)
+                json.value(stageNames[stage], computeStats(stageMs[stage]).mean);
+            json.endObject();
+            json.endObject();
+        }
+    }
+    json.endArray();
+    return 0;
+}
@@ -0,0 +1,282 @@
+//LOD benchmark: --objects copies of one mesh (a bumpy sphere, or the first --mesh fitted to the unit box) spread
+//over a ground plane and seen in perspective by a camera that drifts back and forth, drawn through IndirectRenderer
+//with CPU culling. The mesh gets a LOD chain (Lod.h) whose levels share its vertex buffer; each level is one mesh
+//of the merged buffers, so an object switches level by switching mesh.
+//    full              every object at level 0
+//    lod               levels chosen by selectLod every frame (--lod-error, --hysteresis)
+//    lod_no_hysteresis the same without hysteresis, for the level switches it saves
+//Triangles per frame count the visible instances of each level. select_ms is the per object level choice,
+//included in cpu_ms.
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <gtc/matrix_transform.hpp>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "IndirectRenderer.h"
+#include "Json.h"
+#include "Lod.h"
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+
+//Stop measuring one case after this much wall time even if --frames is not reached; warm up for at most
+//warmupSeconds even if --warmup is not reached
+static const double secondsPerCase = 10.0;
+static const double warmupSeconds = 3.0;
+static const int minimumFrames = 3;
+//Generated sphere resolution, 2 * segments * (rings - 1) triangles
+static const int sphereSegments = 40;
+static const int sphereRings = 20;
+//Ground plane cell per object, and the camera
+static const float objectSpacing = 2.0f;
+static const float cameraFovY = 1.0471976f;  //60 degrees
+static const float cameraHeight = 3.0f;
+
+//Sphere of radius 0.5 with bumps large enough that the simplifier has shape to lose
+static void buildSphere(MeshData& mesh) {
+    mesh = MeshData();
+    auto push = [&](float theta, float phi) {
+        float bump = 1.0f + 0.08f * std::sin(7.0f * phi) * std::sin(5.0f * theta);
+        float r = 0.5f * bump;
+        mesh.positions.push_back(r * std::sin(theta) * std::cos(phi));
+        mesh.positions.push_back(r * std::cos(theta));
+        mesh.positions.push_back(r * std::sin(theta) * std::sin(phi));
+    };
+    const float pi = 3.14159265f;
+    push(0.0f, 0.0f);
+    for (int ring = 1; ring < sphereRings; ring++) {
+        for (int segment = 0; segment < sphereSegments; segment++)
+            push(pi * ring / sphereRings, 2.0f * pi * segment / sphereSegments);
+    }
+    push(pi, 0.0f);
+
+    unsigned int south = (unsigned int)(mesh.positions.size() / 3 - 1);
+    auto at = [](int ring, int segment) {
+        return (unsigned int)(1 + (ring - 1) * sphereSegments + segment % sphereSegments);
+    };
+    //Counter-clockwise seen from outside
+    for (int segment = 0; segment < sphereSegments; segment++) {
+        unsigned int fan[3] = { 0, at(1, segment + 1), at(1, segment) };
+        mesh.indices.insert(mesh.indices.end(), fan, fan + 3);
+    }
+    for (int ring = 1; ring < sphereRings - 1; ring++) {
+        for (int segment = 0; segment < sphereSegments; segment++) {
+            unsigned int a = at(ring, segment), b = at(ring, segment + 1);
+            unsigned int c = at(ring + 1, segment + 1), d = at(ring + 1, segment);
+            unsigned int quad[6] = { a, b, c, a, c, d };
+            mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+        }
+    }
+    for (int segment = 0; segment < sphereSegments; segment++) {
+        unsigned int fan[3] = { south, at(sphereRings - 1, segment), at(sphereRings - 1, segment + 1) };
+        mesh.indices.insert(mesh.indices.end(), fan, fan + 3);
+    }
+}
+
+//Imported mesh with its positions moved into the unit box around the origin
+static bool loadMesh(const std::string& path, MeshData& mesh) {
+    if (!importMesh(path.c_str(), mesh))
+        return false;
+    glm::mat4 fit = unitBoxTransform(mesh.boundsMin, mesh.boundsMax);
+    for (size_t i = 0; i < mesh.vertexCount(); i++) {
+        glm::vec4 p = fit * glm::vec4(mesh.positions[i * 3], mesh.positions[i * 3 + 1], mesh.positions[i * 3 + 2], 1.0f);
+        mesh.positions[i * 3] = p.x;
+        mesh.positions[i * 3 + 1] = p.y;
+        mesh.positions[i * 3 + 2] = p.z;
+    }
+    return true;
+}
+
+//Square field on the XZ plane centered on the origin, each object turned and scaled by its index
+static void buildObjects(std::vector<IndirectObject>& objects, std::vector<float>& scales, size_t count, float radius) {
+    size_t side = (size_t)std::ceil(std::sqrt((double)count));
+    float half = 0.5f * objectSpacing * (float)side;
+    objects.resize(count);
+    scales.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        unsigned int h = (unsigned int)i * 2654435761u;
+        float scale = 0.75f + 0.5f * (float)(h & 0xFF) / 255.0f;
+        float angle = (float)((h >> 8) & 0xFF) / 255.0f * 6.2831853f;
+        glm::vec3 position(-half + objectSpacing * ((float)(i % side) + 0.5f), 0.0f,
+            -half + objectSpacing * ((float)(i / side) + 0.5f));
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+        model = glm::rotate(model, angle, glm::vec3(0.0f, 1.0f, 0.0f));
+        model = glm::scale(model, glm::vec3(scale));
+        std::memcpy(objects[i].instance.transform, &model[0][0], sizeof(objects[i].instance.transform));
+        objects[i].instance.color[0] = (unsigned char)(128 + (h & 0x7F));
+        objects[i].instance.color[1] = (unsigned char)((h >> 8) & 0x7F);
+        objects[i].instance.color[2] = (unsigned char)((h >> 16) & 0x7F);
+        objects[i].instance.color[3] = 255;
+        objects[i].mesh = 0;
+        objects[i].radius = radius;
+        objects[i].reserved = 0;
+        scales[i] = scale;
+    }
+}
+
+//Just outside one edge of the field looking across it, drifting forward and back and turning a little
+static glm::vec3 cameraPosition(float time, float half) {
+    return glm::vec3(0.0f, cameraHeight, -half - 4.0f + 3.0f * std::sin(time));
+}
+
+static glm::mat4 cameraAt(float time, float half, float aspect) {
+    glm::vec3 eye = cameraPosition(time, half);
+    glm::vec3 forward(0.3f * std::sin(0.5f * time), -0.12f, 1.0f);
+    glm::mat4 view = glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f));
+    return glm::perspective(cameraFovY, aspect, 0.1f, 4.0f * half + 10.0f) * view;
+}
+
+int runLodBench(const BenchOptions& options, JsonWriter& json) {
+    if (!isIndirectRenderingSupported()) {
+        std::cerr << "LOD mode draws through IndirectRenderer and needs a GL 4.3 context" << std::endl;
+        return 1;
+    }
+    size_t count = options.objectCounts.empty() ? 100000 : options.objectCounts[0];
+
+    //======================CHAIN======================
+    MeshData mesh;
+    if (options.meshPaths.empty())
+        buildSphere(mesh);
+    else if (!loadMesh(options.meshPaths[0], mesh))
+        return 1;
+    LodChain chain;
+    LodBuildStats buildStats;
+    buildLodChain(mesh, chain, 6, 16, &buildStats);
+
+    json.value("mesh", options.meshPaths.empty() ? std::string("sphere") : options.meshPaths[0]);
+    json.value("objects", (uint64_t)count);
+    json.value("lod_error_pixels", options.lodError);
+    json.value("hysteresis", options.lodHysteresis);
+    json.beginObject("chain");
+    json.value("vertices", (uint64_t)mesh.vertexCount());
+    json.value("build_ms", buildStats.buildMs);
+    json.value("collapses", (uint64_t)buildStats.collapses);
+    json.value("rejected_collapses", (uint64_t)buildStats.rejectedCollapses);
+    json.value("locked_vertices", (uint64_t)buildStats.lockedVertices);
+    json.beginArray("levels");
+    for (size_t level = 0; level < chain.levels.size(); level++) {
+        const LodLevel& lod = chain.levels[level];
+        VertexCacheStats cache = analyzeVertexCache(&chain.indices[lod.firstIndex], lod.indexCount, mesh.vertexCount());
+        json.beginObject();
+        json.value("triangles", (uint64_t)chain.triangleCount(level));
+        json.value("error", (double)lod.error);
+        json.value("acmr", cache.acmr);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+
+    //One mesh per level over the same vertices
+    IndirectGeometry geometry;
+    geometry.addMesh(mesh.positions.data(), mesh.vertexCount(), chain.indices.data(), chain.levels[0].indexCount);
+    for (size_t level = 1; level < chain.levels.size(); level++)
+        geometry.addMeshLevel(0, &chain.indices[chain.levels[level].firstIndex], chain.levels[level].indexCount);
+    IndirectRenderer renderer;
+    if (!createIndirectRenderer(renderer, geometry, count, options.outline == "single"))
+        return -1;
+    renderer.culling = IndirectCulling::Cpu;
+    setOutlineViewport(renderer.outline, options.width, options.height);
+
+    std::vector<float> scales;
+    buildObjects(renderer.objects, scales, count, geometry.meshes[0].boundingRadius);
+    float half = 0.5f * objectSpacing * (float)std::ceil(std::sqrt((double)count));
+    float aspect = (float)options.width / (float)options.height;
+    float pixelScale = lodPixelScale((float)options.height, cameraFovY);
+
+    //======================RUN======================
+    const char* caseNames[] = { "full", "lod", "lod_no_hysteresis" };
+    json.beginArray("cases");
+    for (int caseIndex = 0; caseIndex < 3; caseIndex++) {
+        LodSelection selection;
+        selection.pixelError = options.lodError;
+        selection.hysteresis = caseIndex == 1 ? options.lodHysteresis : 0.0f;
+        std::vector<uint8_t> levels(count, 0);
+        for (IndirectObject& object : renderer.objects)
+            object.mesh = 0;
+        if (!setIndirectObjects(renderer, renderer.objects.data(), count)) {
+            destroyIndirectRenderer(renderer);
+            return 1;
+        }
+
+        GLStateCache glState;
+        std::vector<double> cpuMs, frameMs, selectMs;
+        double triangles = 0.0, switches = 0.0, visible = 0.0;
+        std::vector<double> visiblePerLevel(chain.levels.size(), 0.0);
+        double caseStart = wallSeconds(), measureStart = 0.0;
+        int warmup = -1;
+        for (int frame = 0;; frame++) {
+            if (warmup < 0 && (frame >= options.warmupFrames || (frame > 0 && wallSeconds() - caseStart > warmupSeconds))) {
+                warmup = frame;
+                cpuMs.clear();
+                frameMs.clear();
+                selectMs.clear();
+                triangles = switches = visible = 0.0;
+                std::fill(visiblePerLevel.begin(), visiblePerLevel.end(), 0.0);
+                glState.counters.reset();
+                measureStart = wallSeconds();
+            }
+            int measured = warmup < 0 ? -1 : frame - warmup;
+            if (measured >= options.frames || (measured >= minimumFrames && wallSeconds() - measureStart > secondsPerCase))
+                break;
+
+            float time = (float)frame * (float)simulationStep;
+            glm::vec3 eye = cameraPosition(time, half);
+            glm::mat4 transform = cameraAt(time, half, aspect);
+            double start = wallSeconds();
+            if (caseIndex != 0) {
+                //Pixels per model unit from the distance to the nearest point of each bounding sphere
+                for (size_t i = 0; i < count; i++) {
+                    IndirectObject& object = renderer.objects[i];
+                    const float* m = object.instance.transform;
+                    float distance = glm::length(glm::vec3(m[12], m[13], m[14]) - eye) - object.radius * scales[i];
+                    float pixelsPerUnit = pixelScale * scales[i] / std::max(distance, 0.1f);
+                    size_t level = selectLod(chain, levels[i], pixelsPerUnit, selection);
+                    switches += level != levels[i] ? 1.0 : 0.0;
+                    levels[i] = (uint8_t)level;
+                    object.mesh = (uint32_t)level;
+                }
+                setIndirectObjects(renderer, renderer.objects.data(), count);
+            }
+            double selected = wallSeconds();
+            renderIndirectFrame(renderer, transform, glState);
+            double submitted = wallSeconds();
+            glFinish();
+            selectMs.push_back((selected - start) * 1000.0);
+            cpuMs.push_back((submitted - start) * 1000.0);
+            frameMs.push_back((wallSeconds() - start) * 1000.0);
+            for (size_t level = 0; level < renderer.commands.size(); level++) {
+                const DrawElementsIndirectCommand& command = renderer.commands[level];
+                triangles += (double)command.instanceCount * (command.count / 3);
+                visible += command.instanceCount;
+                visiblePerLevel[level] += command.instanceCount;
+            }
+        }
+
+        double frames = (double)std::max<size_t>(1, frameMs.size());
+        SampleStats frameStats = computeStats(frameMs);
+        json.beginObject();
+        json.value("case", caseNames[caseIndex]);
+        json.value("frames", (uint64_t)frameMs.size());
+        json.value("visible_per_frame", visible / frames);
+        json.value("triangles_per_frame", triangles / frames);
+        json.value("mtriangles_per_second", frameStats.mean > 0.0 ? triangles / frames / frameStats.mean / 1000.0 : 0.0);
+        json.value("level_switches_per_frame", switches / frames);
+        json.beginArray("visible_per_level");
+        for (double levelVisible : visiblePerLevel)
+            json.value(nullptr, levelVisible / frames);
+        json.endArray();
+        json.value("draw_calls_per_frame", glState.counters.draws / frames);
+        writeStats(json, "select_ms", computeStats(selectMs));
+        writeStats(json, "cpu_ms", computeStats(cpuMs));
+        writeStats(json, "frame_ms", frameStats);
+        json.endObject();
+    }
+    json.endArray();
+
+    destroyIndirectRenderer(renderer);
+    return 0;
+}
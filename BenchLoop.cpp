@@ -0,0 +1,312 @@
+//Render loop benchmark: the windowed app's update -> log -> draw -> present loop with scripted input.
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "InputRecording.h"
+#include "Json.h"
+#include "Profiler.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Simulation.h"
+#include "TransformLog.h"
+
+//--frame-budget with --profile fails above this share of GPU frames dropped
+static const double maxGpuDroppedShare = 0.1;
+
+//cycle: each of the 12 transform keys is held for 30 steps in turn, followed by 30 idle steps.
+void scriptedKeyEvents(const std::string& script, uint64_t step, InputSystem& input) {
+    const int transformKeyCount = 12; //defaultKeyBindings without ESC
+    double now = inputTimestamp();
+    if (script == "all") {
+        if (step == 0) {
+            for (int i = 0; i < transformKeyCount; i++)
+                input.onKey(defaultKeyBindings[i].key, GLFW_PRESS, now);
+        }
+        return;
+    }
+    if (script != "cycle" || step % 30 != 0)
+        return;
+    int slot = (int)((step / 30) % (transformKeyCount + 1));
+    int previous = (slot + transformKeyCount) % (transformKeyCount + 1);
+    if (step > 0 && previous < transformKeyCount)
+        input.onKey(defaultKeyBindings[previous].key, GLFW_RELEASE, now);
+    if (slot < transformKeyCount)
+        input.onKey(defaultKeyBindings[slot].key, GLFW_PRESS, now);
+}
+
+int runRenderLoopBench(const BenchOptions& options, JsonWriter& json) {
+    //======================OUTPUT======================
+    //Transform log goes to a file like sample_output.txt in the app, JSON report to stdout or --out.
+    //sync keeps the old per-line flushing stream on the render thread for comparison.
+    std::ofstream logFile;
+    std::ostream nullStream(nullptr);
+    TransformLog transformLog;
+    bool logging = options.logPath != "none";
+    bool asyncLog = logging && options.logMode != "sync";
+    if (asyncLog) {
+        TransformLogFormat format = options.logMode == "binary" ? TransformLogFormat::Binary : TransformLogFormat::Text;
+        if (!transformLog.open(options.logPath.c_str(), format)) {
+            std::cerr << "Error opening log file " << options.logPath << std::endl;
+            return 1;
+        }
+    }
+    else if (logging) {
+        logFile.open(options.logPath, std::ios::out | std::ios::trunc);
+        if (!logFile) {
+            std::cerr << "Error opening log file " << options.logPath << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& logOut = logFile.is_open() ? (std::ostream&)logFile : nullStream;
+
+    PyramidRenderer renderer;
+    if (!createPyramidRenderer(renderer, options.outline == "single")) {
+        return -1;
+    }
+    if (renderer.singlePassOutline)
+        setOutlineWidth(renderer.outline, options.outlineWidth);
+
+    //-- Simulated transform at the last two steps, starts as identity
+    SimulationState state;
+    FixedTimestep timestep;
+    InputSystem input;
+    CommandState commands;
+    //Everything from the first warm-up frame, so a replay starts from the same identity transform
+    InputRecorder recorder;
+    if (!options.recordPath.empty()) {
+        if (!recorder.open(options.recordPath.c_str()))
+            return 1;
+        input.setRecorder(&recorder);
+    }
+    //Created after the renderer so its shadow starts from unknown state
+    GLStateCache glState;
+    glState.filtering = options.stateCache;
+    std::vector<double> issuedPerFrame, skippedPerFrame;
+
+    //Commands and transform of each step simulated this frame, written out in the log phase
+    struct StepSnapshot {
+        uint64_t step;
+        CommandState commands;
+        TransformState transform;
+    };
+    std::vector<StepSnapshot> steps;
+
+    PhaseTimes updatePhase, logPhase, renderPhase, presentPhase;
+    std::vector<double> frameMs, inputLatencyMs;
+    frameMs.reserve(options.frames);
+    unsigned long long loggedSteps = 0;
+    uint64_t measuredStepStart = 0;
+    double pendingEventTime = -1.0;
+    double lastFrameStart = wallSeconds();
+
+    //======================PROFILER======================
+    //Cost of a zone with the profiler off (the normal case) and on, measured before it is turned on for the loop
+    const int overheadZones = 1000000;
+    double disabledZoneNs = 0.0, enabledZoneNs = 0.0;
+    if (options.profile) {
+        double start = wallSeconds();
+        for (int i = 0; i < overheadZones; i++) {
+            PROFILE_ZONE("overhead");
+        }
+        disabledZoneNs = (wallSeconds() - start) * 1.0e9 / overheadZones;
+        ProfilerOptions profilerOptions;
+        profilerOptions.rollingFrames = (size_t)options.frames;
+        profilerOptions.traceEvents = options.tracePath.empty() ? 0 : 1000000;
+        enableProfiler(profilerOptions);
+        setProfilerThreadName("render loop");
+        start = wallSeconds();
+        for (int i = 0; i < overheadZones / 10; i++) {
+            PROFILE_ZONE("overhead");
+        }
+        enabledZoneNs = (wallSeconds() - start) * 1.0e9 / (overheadZones / 10);
+    }
+
+    //======================MAIN LOOP======================
+    const int totalFrames = options.warmupFrames + options.frames;
+    double cpuStart = 0.0, wallStart = 0.0;
+    int frame = 0;
+    do {
+        //Drop everything recorded during warm-up
+        if (frame == options.warmupFrames) {
+            updatePhase = PhaseTimes(); logPhase = PhaseTimes(); renderPhase = PhaseTimes(); presentPhase = PhaseTimes();
+            frameMs.clear();
+            inputLatencyMs.clear();
+            glState.counters.reset();
+            issuedPerFrame.clear();
+            skippedPerFrame.clear();
+            loggedSteps = 0;
+            measuredStepStart = timestep.totalSteps();
+            resetProfiler();
+            cpuStart = processCpuSeconds();
+            wallStart = wallSeconds();
+        }
+        double frameStart = wallSeconds();
+        double frameSeconds = options.frameDt > 0.0 ? options.frameDt : frameStart - lastFrameStart;
+        lastFrameStart = frameStart;
+
+        {
+            // Drain input and advance the simulation in fixed steps
+            PhaseTimer timer(updatePhase);
+            steps.clear();
+            int count = timestep.advance(frameSeconds);
+            for (int i = 0; i < count; i++) {
+                uint64_t step = timestep.totalSteps() - count + i;
+                {
+                    PROFILE_ZONE("input");
+                    scriptedKeyEvents(options.script, step, input);
+                    input.update(commands);
+                    if (commands.eventCount > 0 && pendingEventTime < 0.0)
+                        pendingEventTime = commands.oldestEventTime;
+                }
+                PROFILE_ZONE("update");
+                state.beginStep();
+                processInput(commands, state.current, translateStep, scaleStep);
+                steps.push_back({ step, commands, state.current });
+            }
+            recorder.endFrame(count, timestep.alpha());
+        }
+        {
+            PhaseTimer timer(logPhase);
+            PROFILE_ZONE("log");
+            for (const StepSnapshot& snapshot : steps) {
+                bool logged = asyncLog ? transformLog.log((uint32_t)snapshot.step, snapshot.commands, snapshot.transform)
+                    : snapshot.commands.anyLoggedCommandHeld() && logTransform(logOut, snapshot.commands, snapshot.transform.matrix());
+                if (logged)
+                    loggedSteps++;
+            }
+        }
+        {
+            PhaseTimer timer(renderPhase);
+            renderFrame(renderer, state.drawTransform(timestep.alpha()), glState);
+        }
+        {
+            //Stand-in for glfwSwapBuffers: wait until the frame is actually rendered
+            PhaseTimer timer(presentPhase);
+            PROFILE_ZONE("swap");
+            glFinish();
+            glState.countCalls(1);
+        }
+        profilerEndFrame();
+        issuedPerFrame.push_back((double)glState.counters.total);
+        skippedPerFrame.push_back((double)glState.counters.skipped());
+        //Input-to-present latency of the key events that reached this frame
+        if (pendingEventTime >= 0.0) {
+            inputLatencyMs.push_back((inputTimestamp() - pendingEventTime) * 1000.0);
+            pendingEventTime = -1.0;
+        }
+
+        frameMs.push_back((wallSeconds() - frameStart) * 1000.0);
+        frame++;
+    } while (frame < totalFrames);
+
+    double wallTotal = wallSeconds() - wallStart;
+    double cpuTotal = processCpuSeconds() - cpuStart;
+
+    //Flush whatever the writer thread has not written yet
+    transformLog.close();
+    if (recorder.isOpen() && !recorder.close(state.current.matrix()))
+        return 1;
+    if (options.profile) {
+        disableProfiler();
+        if (!options.tracePath.empty() && !writeChromeTrace(options.tracePath))
+            return 1;
+    }
+
+    //======================REPORT======================
+    json.value("script", options.script);
+    if (!options.recordPath.empty()) {
+        json.value("recording", options.recordPath);
+        json.value("recorded_frames", recorder.frameCount());
+        json.value("recorded_events", (uint64_t)recorder.eventCount());
+    }
+    json.value("outline", renderer.singlePassOutline ? "single" : "two-pass");
+    json.value("frames", options.frames);
+    json.value("warmup_frames", options.warmupFrames);
+    json.value("wall_seconds", wallTotal);
+    json.value("fps", options.frames / wallTotal);
+    json.value("process_cpu_seconds", cpuTotal);
+    json.beginObject("log");
+    json.value("mode", logging ? options.logMode : std::string("none"));
+    json.value("logged_steps", (uint64_t)loggedSteps);
+    if (asyncLog) {
+        //Totals include warm-up frames
+        json.value("queued_records", transformLog.queuedRecords());
+        json.value("dropped_records", transformLog.droppedRecords());
+        json.value("written_records", transformLog.writtenRecords());
+        json.value("bytes_written", transformLog.bytesWritten());
+    }
+    json.endObject();
+    writeStats(json, "frame_time_ms", computeStats(frameMs));
+    writeStats(json, "input_latency_ms", computeStats(inputLatencyMs));
+    if (options.profile) {
+        writeProfilerStats(json, "profile");
+        json.value("profile_zone_disabled_ns", disabledZoneNs);
+        json.value("profile_zone_enabled_ns", enabledZoneNs);
+    }
+
+    json.beginObject("simulation");
+    json.value("step_seconds", timestep.step());
+    json.value("frame_dt", options.frameDt > 0.0 ? options.frameDt : -1.0);
+    json.value("steps", timestep.totalSteps() - measuredStepStart);
+    json.value("steps_per_frame", (double)(timestep.totalSteps() - measuredStepStart) / options.frames);
+    json.value("dropped_seconds", timestep.droppedSeconds());
+    json.endObject();
+
+    json.beginObject("phases");
+    const char* phaseNames[] = { "update", "log", "render", "present" };
+    PhaseTimes* phases[] = { &updatePhase, &logPhase, &renderPhase, &presentPhase };
+    for (int i = 0; i < 4; i++) {
+        json.beginObject(phaseNames[i]);
+        SampleStats cpu = computeStats(phases[i]->cpuMs);
+        json.value("cpu_ms_total", cpu.total);
+        json.value("cpu_ms_per_frame", cpu.mean);
+        writeStats(json, "wall_ms", computeStats(phases[i]->wallMs));
+        json.endObject();
+    }
+    json.endObject();
+
+    //Counters are running totals, turn them into per frame counts
+    for (size_t i = issuedPerFrame.size(); i-- > 1;) {
+        issuedPerFrame[i] -= issuedPerFrame[i - 1];
+        skippedPerFrame[i] -= skippedPerFrame[i - 1];
+    }
+    const GLCallCounters& calls = glState.counters;
+    json.beginObject("gl_calls");
+    json.value("state_cache", glState.filtering);
+    json.value("total", (uint64_t)calls.total);
+    json.value("per_frame", (double)calls.total / options.frames);
+    json.value("draws", (uint64_t)calls.draws);
+    json.value("state_changes", (uint64_t)calls.stateChanges);
+    json.value("uniform_uploads", (uint64_t)calls.uniformUploads);
+    json.value("skipped_state_changes", (uint64_t)calls.skippedStateChanges);
+    json.value("skipped_uniform_uploads", (uint64_t)calls.skippedUniformUploads);
+    writeStats(json, "issued_per_frame", computeStats(issuedPerFrame));
+    writeStats(json, "skipped_per_frame", computeStats(skippedPerFrame));
+    json.endObject();
+
+    destroyPyramidRenderer(renderer);
+
+    //Frame time regression check for CI
+    if (options.frameBudgetMs > 0.0) {
+        double p95 = computeStats(frameMs).p95;
+        json.value("frame_budget_ms", options.frameBudgetMs);
+        json.value("within_frame_budget", p95 <= options.frameBudgetMs);
+        if (p95 > options.frameBudgetMs) {
+            std::cerr << "Frame time p95 " << p95 << " ms is over the " << options.frameBudgetMs << " ms budget" << std::endl;
+            return 2;
+        }
+        //A budget checked without the GPU side is no check of it
+        const ProfilerCounters& counters = profilerCounters();
+        uint64_t gpuFrames = counters.gpuFramesResolved + counters.gpuFramesDropped;
+        if (options.profile && gpuFrames > 0 &&
+            (double)counters.gpuFramesDropped > maxGpuDroppedShare * (double)gpuFrames) {
+            std::cerr << counters.gpuFramesDropped << " of " << gpuFrames << " GPU frames were dropped, "
+                "GPU pass times are missing" << std::endl;
+            return 2;
+        }
+    }
+    return 0;
+}
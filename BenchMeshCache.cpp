@@ -0,0 +1,194 @@
+//Geometry pack benchmark: time to first frame for a mesh loaded three ways, each ending in a finished frame
+//    source - import the OBJ / glTF (MeshImporter.h) and upload its arrays, what every start did before packs
+//    cold   - no pack yet: hash the source, import, write the pack, map it and upload from the mapping
+//    warm   - pack present: hash the source, map the pack and upload from the mapping
+//Without --mesh it uses the import benchmark's generated grid in both formats.
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "GeometryCache.h"
+#include "GLPlatform.h"
+#include "JobSystem.h"
+#include "Json.h"
+#include "MeshImporter.h"
+#include "Renderer.h"
+
+//Runs per way, the median is reported
+static const int repeats = 5;
+
+//-- One load up to the first finished frame
+struct FirstFrameSample {
+    double loadMs = 0.0;     //import, or the whole loadCachedGeometry
+    double uploadMs = 0.0;
+    double frameMs = 0.0;    //renderFrame + glFinish
+    double totalMs = 0.0;
+    GeometryCacheStats cache;
+    uint64_t packKey = 0;
+};
+
+static void drawFirstFrame(const PyramidRenderer& renderer, const glm::mat4& transform, FirstFrameSample& sample) {
+    double start = wallSeconds();
+    GLStateCache glState;
+    renderFrame(renderer, transform, glState);
+    glFinish();
+    sample.frameMs = (wallSeconds() - start) * 1000.0;
+}
+
+static bool loadFromSource(const std::string& path, PyramidRenderer& renderer, JobSystem& jobs, FirstFrameSample& sample) {
+    double start = wallSeconds();
+    MeshData mesh;
+    if (!importMesh(path.c_str(), mesh, &jobs))
+        return false;
+    double imported = wallSeconds();
+    if (!uploadMesh(renderer, mesh))
+        return false;
+    double uploaded = wallSeconds();
+    drawFirstFrame(renderer, unitBoxTransform(mesh.boundsMin, mesh.boundsMax), sample);
+    sample.loadMs = (imported - start) * 1000.0;
+    sample.uploadMs = (uploaded - imported) * 1000.0;
+    sample.totalMs = (wallSeconds() - start) * 1000.0;
+    return true;
+}
+
+static bool loadFromPack(const std::string& path, const std::string& directory, PyramidRenderer& renderer,
+    JobSystem& jobs, FirstFrameSample& sample) {
+    double start = wallSeconds();
+    GeometryPack pack;
+    if (!loadCachedGeometry(path.c_str(), directory, pack, &jobs, &sample.cache) || pack.meshCount() == 0)
+        return false;
+    double loaded = wallSeconds();
+    PackedMesh mesh = pack.mesh(0);
+    if (!uploadPackedMesh(renderer, mesh))
+        return false;
+    double uploaded = wallSeconds();
+    sample.packKey = pack.sourceKey();
+    pack.close();
+    drawFirstFrame(renderer, unitBoxTransform(mesh.boundsMin, mesh.boundsMax) * mesh.positionDecode, sample);
+    sample.loadMs = (loaded - start) * 1000.0;
+    sample.uploadMs = (uploaded - loaded) * 1000.0;
+    sample.totalMs = (wallSeconds() - start) * 1000.0;
+    return true;
+}
+
+static void writeSamples(JsonWriter& json, const char* key, const std::vector<FirstFrameSample>& samples, bool pack) {
+    std::vector<double> load, upload, frame, total, hash, import, write, open;
+    for (const FirstFrameSample& sample : samples) {
+        load.push_back(sample.loadMs);
+        upload.push_back(sample.uploadMs);
+        frame.push_back(sample.frameMs);
+        total.push_back(sample.totalMs);
+        hash.push_back(sample.cache.hashMs);
+        import.push_back(sample.cache.importMs);
+        write.push_back(sample.cache.writeMs);
+        open.push_back(sample.cache.openMs);
+    }
+    json.beginObject(key);
+    json.value("runs", (int)samples.size());
+    json.value("first_frame_ms", computeStats(total).p50);
+    json.value("load_ms", computeStats(load).p50);
+    if (pack) {
+        json.value("hash_ms", computeStats(hash).p50);
+        json.value("import_ms", computeStats(import).p50);
+        json.value("write_ms", computeStats(write).p50);
+        json.value("open_ms", computeStats(open).p50);
+    }
+    json.value("upload_ms", computeStats(upload).p50);
+    json.value("frame_ms", computeStats(frame).p50);
+    writeStats(json, "first_frame_ms_stats", computeStats(total));
+    json.endObject();
+}
+
+int runMeshCacheBench(const BenchOptions& options, JsonWriter& json) {
+    std::vector<std::string> paths = options.meshPaths;
+    std::vector<std::string> generated;
+    if (paths.empty()) {
+        generated = writeBenchGrid(options.triangles);
+        if (generated.empty())
+            return 1;
+        paths = generated;
+    }
+
+    PyramidRenderer renderer;
+    if (!createPyramidRenderer(renderer, options.outline == "single"))
+        return -1;
+    if (renderer.singlePassOutline)
+        setOutlineWidth(renderer.outline, options.outlineWidth);
+    setOutlineViewport(renderer.outline, options.width, options.height);
+
+    JobSystem jobs(options.threads);
+    json.value("threads", jobs.threadCount());
+    json.value("geometry_cache", options.geometryCacheDir);
+    int result = 0;
+    json.beginArray("files");
+    for (const std::string& path : paths) {
+        json.beginObject();
+        json.value("path", path);
+
+        std::vector<FirstFrameSample> source, cold, warm;
+        std::string packPath;
+        bool ok = true;
+        for (int i = 0; i < repeats && ok; i++) {
+            FirstFrameSample sample;
+            ok = loadFromSource(path, renderer, jobs, sample);
+            source.push_back(sample);
+        }
+        //Cold runs rebuild the pack each time, the last one leaves it for the warm runs
+        for (int i = 0; i < repeats && ok; i++) {
+            if (!packPath.empty())
+                std::remove(packPath.c_str());
+            FirstFrameSample sample;
+            ok = loadFromPack(path, options.geometryCacheDir, renderer, jobs, sample) && !sample.cache.hit;
+            cold.push_back(sample);
+            packPath = geometryPackPath(options.geometryCacheDir, sample.packKey);
+        }
+        for (int i = 0; i < repeats && ok; i++) {
+            FirstFrameSample sample;
+            ok = loadFromPack(path, options.geometryCacheDir, renderer, jobs, sample) && sample.cache.hit;
+            warm.push_back(sample);
+        }
+        if (!ok) {
+            json.value("error", "load failed");
+            json.endObject();
+            result = 1;
+            continue;
+        }
+
+        const GeometryCacheStats& cache = warm.back().cache;
+        json.value("source_mb", cache.sourceBytes / 1e6);
+        json.value("pack_mb", cache.packBytes / 1e6);
+        json.value("triangles", (uint64_t)(renderer.indexCount / 3));
+        writeSamples(json, "source", source, false);
+        writeSamples(json, "cold", cold, true);
+        writeSamples(json, "warm", warm, true);
+        //Load + upload alone too, the first frame's rasterization is the same either way
+        std::vector<double> sourceTotals, warmTotals, sourceLoads, warmLoads;
+        for (const FirstFrameSample& sample : source) {
+            sourceTotals.push_back(sample.totalMs);
+            sourceLoads.push_back(sample.loadMs + sample.uploadMs);
+        }
+        for (const FirstFrameSample& sample : warm) {
+            warmTotals.push_back(sample.totalMs);
+            warmLoads.push_back(sample.loadMs + sample.uploadMs);
+        }
+        double sourceMs = computeStats(sourceTotals).p50, warmMs = computeStats(warmTotals).p50;
+        double sourceLoadMs = computeStats(sourceLoads).p50, warmLoadMs = computeStats(warmLoads).p50;
+        json.value("warm_fraction_of_source", sourceMs > 0.0 ? warmMs / sourceMs : 0.0);
+        json.value("speedup", warmMs > 0.0 ? sourceMs / warmMs : 0.0);
+        json.value("load_upload_fraction_of_source", sourceLoadMs > 0.0 ? warmLoadMs / sourceLoadMs : 0.0);
+        json.value("load_upload_speedup", warmLoadMs > 0.0 ? sourceLoadMs / warmLoadMs : 0.0);
+        json.endObject();
+
+        if (!options.keepCache && !packPath.empty())
+            std::remove(packPath.c_str());
+    }
+    json.endArray();
+
+    destroyPyramidRenderer(renderer);
+    for (const std::string& path : generated)
+        std::remove(path.c_str());
+    return result;
+}
@@ -0,0 +1,191 @@
+//Mesh optimization benchmark: ACMR / ATVR, overdraw and draw cost of a mesh before and after optimizeMesh
+//(MeshOptimizer.h), for the order it was imported in and for a randomly shuffled triangle order.
+//    vertex stage - the plain pyramid program drawn with GL_RASTERIZER_DISCARD, so only vertex fetch and shading count
+//    overdraw     - fragments passing GL_LESS over pixels covered (GL_EQUAL pass on the final depth), averaged
+//                   over the six axis views
+//    frame        - the app's renderFrame (fill + outline) and glFinish
+//Without --mesh it uses the import benchmark's generated grid (OBJ only, the GLB holds the same grid).
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtc/matrix_transform.hpp>
+#include <gtc/type_ptr.hpp>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "GLPlatform.h"
+#include "Json.h"
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "Renderer.h"
+
+//Timed samples per measurement (median reported) and draws per vertex stage sample
+static const int samples = 7;
+static const int vertexStageDraws = 4;
+
+//Look along +-X, +-Y, +-Z at the mesh fitted to the unit box
+static std::vector<glm::mat4> axisViews(const MeshData& mesh) {
+    glm::mat4 fit = unitBoxTransform(mesh.boundsMin, mesh.boundsMax);
+    glm::mat4 identity(1.0f);
+    std::vector<glm::mat4> views;
+    views.push_back(fit);
+    views.push_back(glm::rotate(identity, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * fit);
+    views.push_back(glm::rotate(identity, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * fit);
+    views.push_back(glm::rotate(identity, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * fit);
+    views.push_back(glm::rotate(identity, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f)) * fit);
+    views.push_back(glm::rotate(identity, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f)) * fit);
+    return views;
+}
+
+static void writeCacheStats(JsonWriter& json, const char* key, const MeshData& mesh) {
+    VertexCacheStats small = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount(), 16);
+    VertexCacheStats large = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount(), 32);
+    json.beginObject(key);
+    json.value("acmr", small.acmr);
+    json.value("atvr", small.atvr);
+    json.value("acmr_cache32", large.acmr);
+    json.value("atvr_cache32", large.atvr);
+    json.endObject();
+}
+
+//Upload mesh to renderer, then time the vertex stage, overdraw and a full frame
+static void measureDraws(JsonWriter& json, const char* key, PyramidRenderer& renderer, const MeshData& mesh) {
+    uploadMesh(renderer, mesh);
+    std::vector<glm::mat4> views = axisViews(mesh);
+    glUseProgram(renderer.shaderProgram);
+    glBindVertexArray(renderer.VAO);
+    glUniformMatrix4fv(renderer.transformLoc, 1, GL_FALSE, glm::value_ptr(views[0]));
+
+    std::vector<double> vertexStage;
+    glEnable(GL_RASTERIZER_DISCARD);
+    glDrawElements(GL_TRIANGLES, renderer.indexCount, renderer.indexType, 0);
+    glFinish();
+    for (int sample = 0; sample < samples; sample++) {
+        double start = wallSeconds();
+        for (int draw = 0; draw < vertexStageDraws; draw++)
+            glDrawElements(GL_TRIANGLES, renderer.indexCount, renderer.indexType, 0);
+        glFinish();
+        vertexStage.push_back((wallSeconds() - start) * 1000.0 / vertexStageDraws);
+    }
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    unsigned int query = 0;
+    glGenQueries(1, &query);
+    double overdrawSum = 0.0;
+    for (const glm::mat4& view : views) {
+        glUniformMatrix4fv(renderer.transformLoc, 1, GL_FALSE, glm::value_ptr(view));
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        GLuint shaded = 0, covered = 0;
+        glDepthFunc(GL_LESS);
+        glBeginQuery(GL_SAMPLES_PASSED, query);
+        glDrawElements(GL_TRIANGLES, renderer.indexCount, renderer.indexType, 0);
+        glEndQuery(GL_SAMPLES_PASSED);
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT, &shaded);
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+        glBeginQuery(GL_SAMPLES_PASSED, query);
+        glDrawElements(GL_TRIANGLES, renderer.indexCount, renderer.indexType, 0);
+        glEndQuery(GL_SAMPLES_PASSED);
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT, &covered);
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+        overdrawSum += covered > 0 ? (double)shaded / covered : 1.0;
+    }
+    glDeleteQueries(1, &query);
+
+    std::vector<double> frame;
+    for (int sample = 0; sample < samples; sample++) {
+        GLStateCache glState;
+        double start = wallSeconds();
+        renderFrame(renderer, views[0], glState);
+        glFinish();
+        frame.push_back((wallSeconds() - start) * 1000.0);
+    }
+
+    json.beginObject(key);
+    json.value("vertex_stage_ms", computeStats(vertexStage).p50);
+    json.value("overdraw", overdrawSum / views.size());
+    json.value("frame_ms", computeStats(frame).p50);
+    json.endObject();
+}
+
+static void runCase(JsonWriter& json, PyramidRenderer& renderer, MeshData mesh) {
+    writeCacheStats(json, "before", mesh);
+    measureDraws(json, "before_draw", renderer, mesh);
+    MeshOptimizeStats stats;
+    optimizeMesh(mesh, &stats);
+    json.beginObject("after_vertex_cache");
+    json.value("acmr", stats.afterVertexCache.acmr);
+    json.value("atvr", stats.afterVertexCache.atvr);
+    json.endObject();
+    writeCacheStats(json, "after", mesh);
+    measureDraws(json, "after_draw", renderer, mesh);
+    json.value("clusters", (uint64_t)stats.clusters);
+    json.value("vertex_cache_ms", stats.vertexCacheMs);
+    json.value("overdraw_ms", stats.overdrawMs);
+    json.value("vertex_fetch_ms", stats.vertexFetchMs);
+}
+
+int runMeshOptBench(const BenchOptions& options, JsonWriter& json) {
+    std::vector<std::string> paths = options.meshPaths;
+    std::vector<std::string> generated;
+    if (paths.empty()) {
+        generated = writeBenchGrid(options.triangles);
+        if (generated.empty())
+            return 1;
+        paths.push_back(generated[0]);
+    }
+
+    PyramidRenderer renderer;
+    if (!createPyramidRenderer(renderer, options.outline == "single"))
+        return -1;
+    if (renderer.singlePassOutline)
+        setOutlineWidth(renderer.outline, options.outlineWidth);
+    setOutlineViewport(renderer.outline, options.width, options.height);
+
+    int result = 0;
+    json.value("cache_size", (int)postTransformCacheSize);
+    json.beginArray("files");
+    for (const std::string& path : paths) {
+        json.beginObject();
+        json.value("path", path);
+        MeshData mesh;
+        if (!importMesh(path.c_str(), mesh)) {
+            json.value("error", "import failed");
+            json.endObject();
+            result = 1;
+            continue;
+        }
+        json.value("vertices", (uint64_t)mesh.vertexCount());
+        json.value("triangles", (uint64_t)mesh.triangleCount());
+
+        json.beginObject("imported_order");
+        runCase(json, renderer, mesh);
+        json.endObject();
+
+        //Same triangles in random order, what an unsorted exporter or a merge of many parts hands over
+        std::mt19937 random(12345);
+        std::vector<unsigned int> order(mesh.triangleCount());
+        for (size_t t = 0; t < order.size(); t++)
+            order[t] = (unsigned int)t;
+        std::shuffle(order.begin(), order.end(), random);
+        std::vector<unsigned int> shuffled(mesh.indices.size());
+        for (size_t t = 0; t < order.size(); t++)
+            std::copy(mesh.indices.begin() + order[t] * 3, mesh.indices.begin() + order[t] * 3 + 3, shuffled.begin() + t * 3);
+        mesh.indices.swap(shuffled);
+        json.beginObject("shuffled_order");
+        runCase(json, renderer, mesh);
+        json.endObject();
+        json.endObject();
+    }
+    json.endArray();
+
+    destroyPyramidRenderer(renderer);
+    for (const std::string& path : generated)
+        std::remove(path.c_str());
+    return result;
+}
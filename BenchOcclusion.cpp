@@ -0,0 +1,302 @@
+//Occlusion culling benchmark: a dense field of --objects pyramids of varying height seen from just above the
+//ground, so the front rows hide most of the rest. The command path of the commands benchmark (record on jobs,
+//radix sort, submit) runs with frustum culling only and with OcclusionCuller.h in front of the recording:
+//    frustum   - sphere against the clip volume, every survivor gets a draw
+//    occlusion - the same pass also bins the pyramids that cover more than occluderSize of the screen as
+//                occluders, the depth buffer is rasterized tile by tile on the jobs, and only the survivors
+//                whose box passes the Hi-Z test are recorded
+//cull_ms is everything before sorting (both passes and the rasterization), raster_ms the rasterization alone.
+//After the occlusion case, one frame is checked with GL occlusion queries: every object culled on the CPU is
+//drawn against the depth of the full frustum culled scene, and the ones with any sample passing are counted.
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <gtc/matrix_transform.hpp>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "GLPlatform.h"
+#include "JobSystem.h"
+#include "Json.h"
+#include "OcclusionCuller.h"
+#include "RenderCommands.h"
+#include "Renderer.h"
+#include "Scene.h"
+
+//Stop measuring one case after this much wall time even if --frames is not reached
+static const double secondsPerCase = 10.0;
+static const int minimumFrames = 3;
+static const int materialCount = 64;
+//Objects per culling job
+static const size_t cullGrain = 4096;
+//Ground plane cell per object, and the camera
+static const float objectSpacing = 1.5f;
+static const float cameraFovY = 1.0471976f;  //60 degrees
+//Pyramids whose clip radius over w is above this are occluders
+static const float occluderSize = 0.04f;
+
+//Pyramid box in model space, from verticesPyramid
+static const glm::vec3 pyramidBoundsMin(-0.5f, -0.5f, -0.5f);
+static const glm::vec3 pyramidBoundsMax(0.5f, 0.5f, 0.5f);
+
+//-- Per worker counts of one frame's passes
+struct WorkerCull {
+    size_t frustumVisible = 0;
+    size_t occluded = 0;
+    size_t occluders = 0;
+};
+
+//Square field on the XZ plane, each pyramid 1 to 3 high and turned by its index
+static void buildField(std::vector<glm::mat4>& models, std::vector<unsigned short>& materials, size_t count) {
+    size_t side = (size_t)std::ceil(std::sqrt((double)count));
+    float half = 0.5f * objectSpacing * (float)side;
+    models.resize(count);
+    materials.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        unsigned int h = (unsigned int)i * 2654435761u;
+        float height = 1.0f + 2.0f * (float)(h & 0xFF) / 255.0f;
+        float angle = (float)((h >> 8) & 0xFF) / 255.0f * 6.2831853f;
+        glm::vec3 position(-half + objectSpacing * ((float)(i % side) + 0.5f), 0.5f * height,
+            -half + objectSpacing * ((float)(i / side) + 0.5f));
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+        model = glm::rotate(model, angle, glm::vec3(0.0f, 1.0f, 0.0f));
+        models[i] = glm::scale(model, glm::vec3(1.0f, height, 1.0f));
+        materials[i] = (unsigned short)((h >> 19) % materialCount);
+    }
+}
+
+//Standing in the middle of the field at about the pyramids' height, turning slowly
+static glm::mat4 cameraAt(float time, float aspect, float half) {
+    glm::vec3 eye(0.0f, 1.8f, 0.0f);
+    glm::vec3 forward(std::sin(0.3f * time), -0.05f, std::cos(0.3f * time));
+    glm::mat4 view = glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f));
+    return glm::perspective(cameraFovY, aspect, 0.1f, 2.0f * half + 10.0f) * view;
+}
+
+//Frustum cull [begin, end); with a culler, bin the large survivors as occluders, otherwise record them all
+static void frustumPass(const std::vector<glm::mat4>& models, const glm::mat4& viewProjection, size_t begin, size_t end,
+    glm::mat4* transforms, unsigned char* visible, OcclusionCuller* culler, CommandBuffer& buffer, WorkerCull& worker,
+    int workerIndex, const std::vector<unsigned short>& materials) {
+    for (size_t i = begin; i < end; i++) {
+        glm::mat4 mvp = viewProjection * models[i];
+        float radius = clipRadius(mvp, pyramidBoundingRadius);
+        visible[i] = isSphereInClip(mvp, radius) && mvp[3].w + radius > 0.0f;
+        if (!visible[i])
+            continue;
+        transforms[i] = mvp;
+        worker.frustumVisible++;
+        float depth = mvp[3].z / mvp[3].w * 0.5f + 0.5f;
+        if (culler == nullptr) {
+            buffer.draw(makeSortKey(0, 0, materials[i], depth), (uint32_t)i);
+            continue;
+        }
+        if (mvp[3].w > 0.0f && radius > occluderSize * mvp[3].w) {
+            culler->addOccluder(mvp, verticesPyramid, pyramidVertexCount, indices, pyramidIndexCount, workerIndex);
+            worker.occluders++;
+        }
+    }
+}
+
+//Test the frustum survivors against the Hi-Z and record the visible ones
+static void occlusionPass(const OcclusionCuller& culler, const glm::mat4* transforms, const unsigned char* visible,
+    size_t begin, size_t end, CommandBuffer& buffer, WorkerCull& worker, const std::vector<unsigned short>& materials) {
+    for (size_t i = begin; i < end; i++) {
+        if (!visible[i])
+            continue;
+        const glm::mat4& mvp = transforms[i];
+        if (!culler.isVisible(mvp, pyramidBoundsMin, pyramidBoundsMax)) {
+            worker.occluded++;
+            continue;
+        }
+        float depth = mvp[3].z / mvp[3].w * 0.5f + 0.5f;
+        buffer.draw(makeSortKey(0, 0, materials[i], depth), (uint32_t)i);
+    }
+}
+
+int runOcclusionBench(const BenchOptions& options, JsonWriter& json) {
+    JobSystem jobs(options.threads);
+    size_t count = options.objectCounts.empty() ? 100000 : options.objectCounts[0];
+    float aspect = (float)options.width / (float)options.height;
+
+    PyramidRenderer pyramid;
+    if (!createPyramidRenderer(pyramid, options.outline == "single"))
+        return -1;
+    setOutlineViewport(pyramid.outline, options.width, options.height);
+    CommandTables tables;
+    if (pyramid.singlePassOutline)
+        tables.programs.push_back(CommandProgram{ pyramid.outline.program, pyramid.outline.transformLoc, pyramid.outline.fillColorLoc });
+    else
+        tables.programs.push_back(CommandProgram{ pyramid.shaderProgram, pyramid.transformLoc, pyramid.colorLoc });
+    tables.meshes.push_back(CommandMesh{ pyramid.VAO, pyramidIndexCount });
+    for (int i = 0; i < materialCount; i++) {
+        unsigned int h = (unsigned int)i * 2246822519u;
+        tables.materials.push_back(glm::vec3((h & 0xFF) / 255.0f, ((h >> 8) & 0xFF) / 255.0f, ((h >> 16) & 0xFF) / 255.0f));
+    }
+
+    std::vector<glm::mat4> models, transforms(count);
+    std::vector<unsigned short> materials;
+    std::vector<unsigned char> visible(count);
+    buildField(models, materials, count);
+    float half = 0.5f * objectSpacing * (float)std::ceil(std::sqrt((double)count));
+
+    OcclusionCuller culler;
+    culler.resize(options.occlusionWidth, (int)((float)options.occlusionWidth / aspect), jobs.threadCount());
+    json.value("objects", (uint64_t)count);
+    json.value("threads", jobs.threadCount());
+    json.value("depth_width", culler.width());
+    json.value("depth_height", culler.height());
+    json.value("tiles", (culler.width() / occlusionTileSize) * (culler.height() / occlusionTileSize));
+    json.value("raster_simd", OcclusionCuller::usesAvx() ? "avx" : "sse2");
+
+    std::vector<WorkerCull> workers(jobs.threadCount());
+    std::vector<CommandBuffer> buffers(jobs.threadCount());
+    std::vector<DrawPacket> packets, scratch;
+    const char* caseNames[] = { "frustum", "occlusion" };
+    json.beginArray("cases");
+    for (int caseIndex = 0; caseIndex < 2; caseIndex++) {
+        bool occlusion = caseIndex == 1;
+        GLStateCache glState;
+        std::vector<double> cullMs, rasterMs, frameMs, rejectedPercent;
+        double drawn = 0.0, frustumVisible = 0.0, occluders = 0.0, occluderTriangles = 0.0;
+        double measureStart = 0.0;
+        for (int frame = 0;; frame++) {
+            if (frame == options.warmupFrames) {
+                cullMs.clear();
+                rasterMs.clear();
+                frameMs.clear();
+                rejectedPercent.clear();
+                drawn = frustumVisible = occluders = occluderTriangles = 0.0;
+                glState.counters.reset();
+                measureStart = wallSeconds();
+            }
+            int measured = frame - options.warmupFrames;
+            if (measured >= options.frames || (measured >= minimumFrames && wallSeconds() - measureStart > secondsPerCase))
+                break;
+
+            float time = (float)frame * (float)simulationStep;
+            glm::mat4 viewProjection = cameraAt(time, aspect, half);
+            double start = wallSeconds();
+            for (size_t w = 0; w < workers.size(); w++) {
+                workers[w] = WorkerCull();
+                buffers[w].clear();
+            }
+            if (occlusion)
+                culler.beginFrame();
+            auto frustum = [&](size_t begin, size_t end, int worker) {
+                frustumPass(models, viewProjection, begin, end, transforms.data(), visible.data(),
+                    occlusion ? &culler : nullptr, buffers[worker], workers[worker], worker, materials);
+            };
+            JobCounter frustumDone;
+            jobs.parallelFor(count, cullGrain, frustum, frustumDone);
+            jobs.wait(frustumDone);
+            double rasterStart = wallSeconds(), rasterEnd = rasterStart;
+            if (occlusion) {
+                culler.rasterize(&jobs);
+                rasterEnd = wallSeconds();
+                auto test = [&](size_t begin, size_t end, int worker) {
+                    occlusionPass(culler, transforms.data(), visible.data(), begin, end, buffers[worker], workers[worker],
+                        materials);
+                };
+                JobCounter testDone;
+                jobs.parallelFor(count, cullGrain, test, testDone);
+                jobs.wait(testDone);
+            }
+            double culled = wallSeconds();
+
+            mergeCommandBuffers(buffers, packets);
+            radixSortPackets(packets, scratch);
+            glState.clearColor(0.2f, 0.3f, 0.3f, 0.1f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glState.countCalls(1);
+            submitPackets(packets, tables, transforms.data(), glState);
+            glFinish();
+            frameMs.push_back((wallSeconds() - start) * 1000.0);
+            cullMs.push_back((culled - start) * 1000.0);
+            rasterMs.push_back((rasterEnd - rasterStart) * 1000.0);
+
+            size_t frameVisible = 0, frameOccluded = 0, frameOccluders = 0;
+            for (const WorkerCull& worker : workers) {
+                frameVisible += worker.frustumVisible;
+                frameOccluded += worker.occluded;
+                frameOccluders += worker.occluders;
+            }
+            rejectedPercent.push_back(frameVisible > 0 ? 100.0 * frameOccluded / frameVisible : 0.0);
+            frustumVisible += frameVisible;
+            drawn += packets.size();
+            occluders += frameOccluders;
+            occluderTriangles += occlusion ? culler.occluderTriangles() : 0;
+        }
+
+        double frames = (double)std::max<size_t>(1, frameMs.size());
+        json.beginObject();
+        json.value("case", caseNames[caseIndex]);
+        json.value("frames", (uint64_t)frameMs.size());
+        json.value("frustum_visible_per_frame", frustumVisible / frames);
+        json.value("draws_per_frame", drawn / frames);
+        json.value("occluders_per_frame", occluders / frames);
+        json.value("occluder_triangles_per_frame", occluderTriangles / frames);
+        writeStats(json, "rejected_percent", computeStats(rejectedPercent));
+        writeStats(json, "cull_ms", computeStats(cullMs));
+        if (occlusion)
+            writeStats(json, "raster_ms", computeStats(rasterMs));
+        writeStats(json, "frame_ms", computeStats(frameMs));
+        json.endObject();
+    }
+    json.endArray();
+
+    //======================CHECK======================
+    //The last occlusion frame's rejects, queried against the depth of every frustum survivor at the same camera
+    std::vector<char> recorded(count, 0);
+    for (const DrawPacket& packet : packets)
+        recorded[packet.object] = 1;
+    std::vector<uint32_t> rejected;
+    for (size_t i = 0; i < count; i++) {
+        if (visible[i] && !recorded[i])
+            rejected.push_back((uint32_t)i);
+    }
+    std::vector<DrawPacket> frustumPackets;
+    for (size_t i = 0; i < count; i++) {
+        if (visible[i])
+            frustumPackets.push_back(DrawPacket{ makeSortKey(0, 0, materials[i], 0.0f), (uint32_t)i, 0 });
+    }
+    GLStateCache glState;
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    submitPackets(frustumPackets, tables, transforms.data(), glState);
+
+    std::vector<unsigned int> queries(rejected.size());
+    if (!queries.empty())
+        glGenQueries((GLsizei)queries.size(), queries.data());
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_LEQUAL);
+    glState.useProgram(pyramid.shaderProgram);
+    glState.bindVertexArray(pyramid.VAO);
+    for (size_t q = 0; q < rejected.size(); q++) {
+        glState.uniformMatrix4(pyramid.transformLoc, transforms[rejected[q]]);
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, queries[q]);
+        glDrawElements(GL_TRIANGLES, pyramidIndexCount, GL_UNSIGNED_INT, 0);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+    }
+    uint64_t wronglyCulled = 0;
+    for (unsigned int query : queries) {
+        unsigned int passed = 0;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT, &passed);
+        wronglyCulled += passed ? 1 : 0;
+    }
+    if (!queries.empty())
+        glDeleteQueries((GLsizei)queries.size(), queries.data());
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+
+    json.beginObject("query_check");
+    json.value("culled", (uint64_t)rejected.size());
+    json.value("visible_to_gl", wronglyCulled);
+    json.value("visible_share", rejected.empty() ? 0.0 : (double)wronglyCulled / rejected.size());
+    json.endObject();
+
+    destroyPyramidRenderer(pyramid);
+    return 0;
+}
@@ -0,0 +1,156 @@
+//Frame pacing benchmark: the app's loop under each FramePacer.h policy, with a person at the keyboard played by a
+//timeline. About every second one transform key is pressed for keyHoldSeconds, so most of the run nothing changes.
+//The period is off the refresh grid, so the presses land at every phase of a frame.
+//Events join the input queue when the loop polls, stamped with the time they were scheduled for, so input latency
+//runs from the key press to the present of the frame that first used it, waits for the next poll included.
+//There is no display: glFinish stands in for the swap, vsync and on-demand wait for the next 1 / fps boundary, and
+//the on-demand event wait sleeps until the next scheduled event or the idle timeout. Frame work is measured as in
+//the app, from shouldDraw to beforePresent, so the stand-in's rendering (llvmpipe draws at the finish) only counts
+//for low-latency, which finishes the frame before beforePresent.
+//Per policy: presented frames, CPU utilization of the process, present to present interval (mean and stddev;
+//intervals across an on-demand idle wait are left out) and input latency.
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "FramePacer.h"
+#include "GLPlatform.h"
+#include "GLStateCache.h"
+#include "Input.h"
+#include "Json.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Simulation.h"
+
+//Scripted key presses
+static const double firstKeySeconds = 0.2503;
+static const double keyPeriodSeconds = 0.9871;
+static const double keyHoldSeconds = 0.3;
+static const int transformKeyCount = 12; //defaultKeyBindings without ESC
+
+//-- One scripted key event
+struct TimedKey {
+    double time;  //seconds after the run starts
+    int key;
+    int action;
+};
+
+static std::vector<TimedKey> keyTimeline(double seconds) {
+    std::vector<TimedKey> events;
+    for (int i = 0; firstKeySeconds + i * keyPeriodSeconds + keyHoldSeconds < seconds; i++) {
+        int key = defaultKeyBindings[i % transformKeyCount].key;
+        double press = firstKeySeconds + i * keyPeriodSeconds;
+        events.push_back({ press, key, GLFW_PRESS });
+        events.push_back({ press + keyHoldSeconds, key, GLFW_RELEASE });
+    }
+    return events;
+}
+
+int runPacingBench(const BenchOptions& options, JsonWriter& json) {
+    PyramidRenderer renderer;
+    if (!createPyramidRenderer(renderer, options.outline == "single"))
+        return -1;
+    if (renderer.singlePassOutline)
+        setOutlineWidth(renderer.outline, options.outlineWidth);
+    std::vector<TimedKey> timeline = keyTimeline(options.pacingSeconds);
+
+    json.value("seconds_per_mode", options.pacingSeconds);
+    json.value("target_fps", options.pacingFps);
+    json.value("key_events", (uint64_t)timeline.size());
+    json.beginArray("runs");
+
+    int result = 0;
+    for (const std::string& name : options.pacingModes) {
+        PacingOptions pacingOptions;
+        if (!parsePacingMode(name.c_str(), pacingOptions.mode)) {
+            result = 1;
+            break;
+        }
+        pacingOptions.targetFps = options.pacingFps;
+        pacingOptions.emulateVsync = true;
+
+        InputSystem input;
+        CommandState commands;
+        SimulationState state;
+        FixedTimestep timestep;
+        GLStateCache glState;
+        glState.filtering = options.stateCache;
+        std::vector<double> latencyMs, workMs;
+        size_t nextEvent = 0;
+        double pendingEventTime = -1.0;
+        bool idled = false, firstFrame = true;
+
+        FramePacer pacer(pacingOptions);
+        double start = inputTimestamp();
+        double end = start + options.pacingSeconds;
+        double lastTime = start;
+        while (inputTimestamp() < end) {
+            bool dirty = firstFrame || commands.anyHeld() || !(state.previous == state.current);
+            double eventWait = pacer.beforeInput(dirty);
+            if (eventWait > 0.0) {
+                //Stand-in for glfwWaitEventsTimeout: back at the next key event or the timeout
+                double wake = inputTimestamp() + eventWait;
+                if (nextEvent < timeline.size())
+                    wake = std::min(wake, start + timeline[nextEvent].time);
+                preciseWaitUntil(std::min(wake, end), pacingOptions.spinSeconds);
+            }
+            //Stand-in for glfwPollEvents
+            double now = inputTimestamp();
+            for (; nextEvent < timeline.size() && start + timeline[nextEvent].time <= now; nextEvent++)
+                input.onKey(timeline[nextEvent].key, timeline[nextEvent].action, start + timeline[nextEvent].time);
+            if (!pacer.shouldDraw(dirty || input.pendingEvents() > 0)) {
+                idled = true;
+                continue;
+            }
+            firstFrame = false;
+
+            //Same simulation stepping as the app's loop
+            now = inputTimestamp();
+            if (idled) {
+                lastTime = now - timestep.step();
+                idled = false;
+            }
+            int steps = timestep.advance(now - lastTime);
+            lastTime = now;
+            for (int i = 0; i < steps; i++) {
+                input.update(commands);
+                if (commands.eventCount > 0 && pendingEventTime < 0.0)
+                    pendingEventTime = commands.oldestEventTime;
+                state.beginStep();
+                processInput(commands, state.current, translateStep, scaleStep);
+            }
+            renderFrame(renderer, state.drawTransform(timestep.alpha()), glState);
+            //Same order as the app: the work ends before the swap, whose stand-in is glFinish
+            if (pacer.finishFrames())
+                glFinish();
+            pacer.beforePresent();
+            glFinish();
+            pacer.afterPresent();
+            workMs.push_back(pacer.lastWorkSeconds() * 1000.0);
+            if (pendingEventTime >= 0.0) {
+                latencyMs.push_back((pacer.lastPresentTime() - pendingEventTime) * 1000.0);
+                pendingEventTime = -1.0;
+            }
+        }
+
+        PacingReport report = pacer.report();
+        json.beginObject();
+        json.value("mode", name);
+        json.value("frames", report.frames);
+        json.value("idle_waits", report.idleWaits);
+        json.value("fps", report.seconds > 0.0 ? (double)report.frames / report.seconds : 0.0);
+        json.value("cpu_utilization", report.cpuUtilization);
+        json.value("frame_interval_mean_ms", report.intervalMeanMs);
+        json.value("frame_interval_stddev_ms", report.intervalStddevMs);
+        json.value("frame_interval_variance_ms2", report.intervalStddevMs * report.intervalStddevMs);
+        writeStats(json, "frame_work_ms", computeStats(workMs));
+        writeStats(json, "input_latency_ms", computeStats(latencyMs));
+        json.endObject();
+    }
+    json.endArray();
+    destroyPyramidRenderer(renderer);
+    return result;
+}
@@ -0,0 +1,198 @@
+//Input replay benchmark: plays an input recording (InputRecording.h) back frame-exact through InputSystem and
+//processInput, checks the final transform against the recording and times every frame.
+//    --replay PATH  recording from the app (--record) or the loop benchmark (--record); without it the --script
+//                   input is recorded for --frames frames first, with nothing drawn
+//    --no-render    simulation only, for runs of millions of frames
+//    --frame-trace  per frame CSV: steps, events, update / render / total milliseconds
+//Returns 3 when the replayed transform differs from the recorded one.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gtc/type_ptr.hpp>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "InputRecording.h"
+#include "Json.h"
+#include "Profiler.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Simulation.h"
+
+//Record the scripted input through the same InputSystem path as the loop benchmark, without drawing
+static bool recordScript(const BenchOptions& options, const std::string& path) {
+    InputRecorder recorder;
+    if (!recorder.open(path.c_str()))
+        return false;
+    InputSystem input;
+    input.setRecorder(&recorder);
+    SimulationState state;
+    FixedTimestep timestep;
+    CommandState commands;
+    double frameDt = options.frameDt > 0.0 ? options.frameDt : simulationStep;
+    for (int frame = 0; frame < options.frames; frame++) {
+        int count = timestep.advance(frameDt);
+        for (int i = 0; i < count; i++) {
+            scriptedKeyEvents(options.script, timestep.totalSteps() - count + i, input);
+            input.update(commands);
+            state.beginStep();
+            processInput(commands, state.current, translateStep, scaleStep);
+        }
+        recorder.endFrame(count, timestep.alpha());
+    }
+    return recorder.close(state.current.matrix());
+}
+
+int runReplayBench(const BenchOptions& options, JsonWriter& json) {
+    std::string path = options.replayPath;
+    bool generated = path.empty();
+    if (generated) {
+        path = (std::filesystem::temp_directory_path() / ("opengl_intro_replay_" + options.script + ".oglrec")).string();
+        double start = wallSeconds();
+        if (!recordScript(options, path))
+            return 1;
+        json.value("record_seconds", wallSeconds() - start);
+    }
+    InputReplay replay;
+    if (!replay.open(path.c_str()))
+        return 1;
+    const InputRecordingHeader& header = replay.header();
+    if (header.translateStep != translateStep || header.scaleStep != scaleStep || header.stepSeconds != simulationStep)
+        std::cerr << "Recording was made with different simulation constants, the transform will not match" << std::endl;
+
+    PyramidRenderer renderer;
+    if (options.render) {
+        if (!createPyramidRenderer(renderer, options.outline == "single"))
+            return -1;
+        if (renderer.singlePassOutline)
+            setOutlineWidth(renderer.outline, options.outlineWidth);
+        setOutlineViewport(renderer.outline, options.width, options.height);
+    }
+    FILE* frameTrace = nullptr;
+    if (!options.frameTracePath.empty()) {
+        frameTrace = std::fopen(options.frameTracePath.c_str(), "w");
+        if (!frameTrace) {
+            std::cerr << "Error opening frame trace " << options.frameTracePath << std::endl;
+            return 1;
+        }
+        std::fprintf(frameTrace, "frame,steps,events,update_ms,render_ms,frame_ms\n");
+    }
+    if (options.profile) {
+        ProfilerOptions profilerOptions;
+        profilerOptions.gpuTimers = options.render;
+        profilerOptions.rollingFrames = (size_t)std::min<uint64_t>(replay.frameCount(), 100000);
+        profilerOptions.traceEvents = options.tracePath.empty() ? 0 : 1000000;
+        enableProfiler(profilerOptions);
+        setProfilerThreadName("replay");
+    }
+
+    SimulationState state;
+    InputSystem input;
+    CommandState commands;
+    GLStateCache glState;
+    glState.filtering = options.stateCache;
+    std::vector<double> frameMs, updateMs, renderMs;
+    frameMs.reserve((size_t)replay.frameCount());
+    updateMs.reserve((size_t)replay.frameCount());
+    uint64_t eventCount = 0;
+
+    //======================REPLAY======================
+    double cpuStart = processCpuSeconds();
+    double wallStart = wallSeconds();
+    for (uint64_t frame = 0; frame < replay.frameCount(); frame++) {
+        double frameStart = wallSeconds();
+        const RecordedFrame& recorded = replay.frame(frame);
+        int frameEvents = 0;
+        for (int i = 0; i < recorded.steps; i++) {
+            {
+                PROFILE_ZONE("input");
+                replay.feedStep(input, frameStart);
+                input.update(commands);
+                frameEvents += commands.eventCount;
+            }
+            PROFILE_ZONE("update");
+            state.beginStep();
+            processInput(commands, state.current, translateStep, scaleStep);
+        }
+        eventCount += frameEvents;
+        double updateEnd = wallSeconds();
+        double renderTime = 0.0;
+        if (options.render) {
+            renderFrame(renderer, state.drawTransform(replay.frameAlpha(frame)), glState);
+            PROFILE_ZONE("swap");
+            glFinish();
+            renderTime = (wallSeconds() - updateEnd) * 1000.0;
+            renderMs.push_back(renderTime);
+        }
+        profilerEndFrame();
+        double frameEnd = wallSeconds();
+        updateMs.push_back((updateEnd - frameStart) * 1000.0);
+        frameMs.push_back((frameEnd - frameStart) * 1000.0);
+        if (frameTrace)
+            std::fprintf(frameTrace, "%llu,%d,%d,%.6f,%.6f,%.6f\n", (unsigned long long)frame, (int)recorded.steps,
+                frameEvents, updateMs.back(), renderTime, frameMs.back());
+    }
+    double wallTotal = wallSeconds() - wallStart;
+    double cpuTotal = processCpuSeconds() - cpuStart;
+    if (frameTrace)
+        std::fclose(frameTrace);
+    if (options.profile) {
+        disableProfiler();
+        if (!options.tracePath.empty() && !writeChromeTrace(options.tracePath))
+            return 1;
+    }
+
+    //Bit for bit, the replay runs the same float math on the same inputs
+    glm::mat4 expected = replay.finalTransform();
+    glm::mat4 replayed = state.current.matrix();
+    bool exact = std::memcmp(glm::value_ptr(expected), glm::value_ptr(replayed), sizeof(glm::mat4)) == 0;
+    double maxError = 0.0;
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++)
+            maxError = std::max(maxError, (double)std::fabs(expected[c][r] - replayed[c][r]));
+    }
+
+    //======================REPORT======================
+    json.beginObject("recording");
+    json.value("path", path);
+    json.value("generated", generated);
+    json.value("bytes", (uint64_t)replay.fileSize());
+    json.value("frames", header.frameCount);
+    json.value("steps", header.stepCount);
+    json.value("events", header.eventCount);
+    json.endObject();
+    json.value("render", options.render);
+    json.value("wall_seconds", wallTotal);
+    json.value("process_cpu_seconds", cpuTotal);
+    json.value("frames_per_second", replay.frameCount() / wallTotal);
+    json.value("steps_per_second", header.stepCount / wallTotal);
+    json.value("replayed_steps", replay.currentStep());
+    json.value("replayed_events", eventCount);
+    writeStats(json, "frame_time_ms", computeStats(frameMs));
+    writeStats(json, "update_ms", computeStats(updateMs));
+    if (options.render)
+        writeStats(json, "render_ms", computeStats(renderMs));
+    if (options.profile)
+        writeProfilerStats(json, "profile");
+    json.beginObject("final_transform");
+    json.value("exact_match", exact);
+    json.value("max_abs_error", maxError);
+    json.endObject();
+
+    if (options.render)
+        destroyPyramidRenderer(renderer);
+    replay.close();
+    if (generated)
+        std::remove(path.c_str());
+    if (!exact) {
+        std::cerr << "Replayed transform differs from the recording (max error " << maxError << ")" << std::endl;
+        return 3;
+    }
+    return 0;
+}
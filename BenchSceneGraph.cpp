@@ -0,0 +1,151 @@
+//Scene graph benchmark: a mostly static hierarchy (SceneGraph.h) where a fixed set of --moving of the nodes is
+//animated every frame, updated through the dirty subtrees against recomputing every world matrix.
+//    full      - invalidateAll + updateWorld, what the graph costs without dirty tracking
+//    dirty     - the moving nodes' locals set, then updateWorld
+//    static    - nothing set, updateWorld returns at once
+//Each runs on the calling thread and on the job system (--threads). Afterwards the incrementally updated world
+//matrices are checked against a full recompute.
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "JobSystem.h"
+#include "Json.h"
+#include "SceneGraph.h"
+
+//Stop measuring one case after this much wall time even if --frames is not reached
+static const double secondsPerCase = 5.0;
+static const int minimumFrames = 3;
+//Independent hierarchies ("objects") per this many nodes
+static const size_t nodesPerRoot = 1000;
+
+//Roots first, then every node under a random earlier node: depth grows like log(nodes), early nodes carry
+//large subtrees and most nodes are leaves. Added to the graph depth first, the order a scene file would have.
+static void buildGraph(SceneGraph& graph, size_t nodes, std::mt19937& random) {
+    size_t rootCount = std::max<size_t>(1, nodes / nodesPerRoot);
+    std::vector<uint32_t> parents(nodes), firstChild(nodes, sceneGraphNoParent), nextSibling(nodes, sceneGraphNoParent);
+    for (size_t i = nodes; i-- > 0;) {
+        parents[i] = i < rootCount ? sceneGraphNoParent : (uint32_t)(random() % i);
+        if (parents[i] != sceneGraphNoParent) {
+            nextSibling[i] = firstChild[parents[i]];
+            firstChild[parents[i]] = (uint32_t)i;
+        }
+    }
+
+    std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+    std::vector<uint32_t> added(nodes), stack;
+    graph.reserve(nodes);
+    for (uint32_t root = 0; root < (uint32_t)rootCount; root++) {
+        stack.push_back(root);
+        while (!stack.empty()) {
+            uint32_t node = stack.back();
+            stack.pop_back();
+            glm::vec3 translation(offset(random), offset(random), offset(random));
+            glm::quat rotation = glm::angleAxis(offset(random) * 3.14159f, glm::normalize(glm::vec3(offset(random), offset(random), 1.0f)));
+            uint32_t parent = parents[node] == sceneGraphNoParent ? sceneGraphNoParent : added[parents[node]];
+            added[node] = graph.addNode(parent, translation, rotation, glm::vec3(0.9f));
+            //Reversed, so the first child comes off the stack first
+            size_t mark = stack.size();
+            for (uint32_t child = firstChild[node]; child != sceneGraphNoParent; child = nextSibling[child])
+                stack.push_back(child);
+            std::reverse(stack.begin() + mark, stack.end());
+        }
+    }
+    graph.updateWorld();
+}
+
+//Spin each moving node about its own z axis, by frame
+static void animate(SceneGraph& graph, const std::vector<uint32_t>& moving, const std::vector<glm::quat>& rest, int frame) {
+    glm::quat spin = glm::angleAxis(0.01f * (float)frame, glm::vec3(0.0f, 0.0f, 1.0f));
+    for (size_t i = 0; i < moving.size(); i++)
+        graph.setRotation(moving[i], rest[i] * spin);
+}
+
+int runSceneGraphBench(const BenchOptions& options, JsonWriter& json) {
+    int threads = options.threads > 0 ? options.threads : (int)std::thread::hardware_concurrency();
+    JobSystem jobs(threads > 0 ? threads : 1);
+
+    std::mt19937 random(12345);
+    SceneGraph graph;
+    double buildStart = wallSeconds();
+    buildGraph(graph, options.nodes, random);
+    double buildMs = (wallSeconds() - buildStart) * 1000.0;
+
+    size_t movingCount = std::max<size_t>(1, (size_t)(options.nodes * options.movingFraction));
+    std::vector<uint32_t> moving(graph.size());
+    for (uint32_t i = 0; i < (uint32_t)moving.size(); i++)
+        moving[i] = i;
+    std::shuffle(moving.begin(), moving.end(), random);
+    moving.resize(std::min(movingCount, moving.size()));
+    std::sort(moving.begin(), moving.end());
+    std::vector<glm::quat> rest;
+    for (uint32_t node : moving)
+        rest.push_back(graph.rotation(node));
+
+    json.value("nodes", (uint64_t)graph.size());
+    json.value("roots", (uint64_t)std::max<size_t>(1, options.nodes / nodesPerRoot));
+    json.value("moving_nodes", (uint64_t)moving.size());
+    json.value("threads", jobs.threadCount());
+    json.value("build_ms", buildMs);
+    json.value("depth_first", graph.isDepthFirst());
+
+    const char* caseNames[] = { "full", "dirty", "static" };
+    int frameCounter = 0;
+    json.beginArray("cases");
+    for (int caseIndex = 0; caseIndex < 3; caseIndex++) {
+        for (int parallel = 0; parallel < 2; parallel++) {
+            JobSystem* system = parallel ? &jobs : nullptr;
+            std::vector<double> frameMs;
+            SceneGraphUpdate totals;
+            double measureStart = 0.0;
+            for (int frame = 0;; frame++) {
+                if (frame == options.warmupFrames) {
+                    frameMs.clear();
+                    totals = SceneGraphUpdate();
+                    measureStart = wallSeconds();
+                }
+                int measured = frame - options.warmupFrames;
+                if (measured >= options.frames || (measured >= minimumFrames && wallSeconds() - measureStart > secondsPerCase))
+                    break;
+
+                double start = wallSeconds();
+                if (caseIndex == 0)
+                    graph.invalidateAll();
+                if (caseIndex != 2)
+                    animate(graph, moving, rest, ++frameCounter);
+                SceneGraphUpdate update = graph.updateWorld(system);
+                frameMs.push_back((wallSeconds() - start) * 1000.0);
+                totals.dirtyNodes += update.dirtyNodes;
+                totals.subtrees += update.subtrees;
+                totals.updatedNodes += update.updatedNodes;
+                totals.tasks += update.tasks;
+            }
+            double frames = (double)std::max<size_t>(1, frameMs.size());
+            json.beginObject();
+            json.value("case", caseNames[caseIndex]);
+            json.value("parallel", parallel != 0);
+            json.value("frames", (uint64_t)frameMs.size());
+            json.value("dirty_nodes_per_frame", totals.dirtyNodes / frames);
+            json.value("subtrees_per_frame", totals.subtrees / frames);
+            json.value("updated_nodes_per_frame", totals.updatedNodes / frames);
+            json.value("tasks_per_frame", totals.tasks / frames);
+            writeStats(json, "update_ms", computeStats(frameMs));
+            json.endObject();
+        }
+    }
+    json.endArray();
+
+    //Incremental result against everything recomputed from the same locals
+    animate(graph, moving, rest, ++frameCounter);
+    graph.updateWorld(&jobs);
+    std::vector<glm::mat4> incremental(graph.worldMatrices(), graph.worldMatrices() + graph.size());
+    graph.invalidateAll();
+    graph.updateWorld();
+    bool matches = std::memcmp(incremental.data(), graph.worldMatrices(), incremental.size() * sizeof(glm::mat4)) == 0;
+    json.value("matches_full_recompute", matches);
+    return matches ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+//Software renderer benchmark: SoftwareRenderer.h drawing what the app draws, on --threads workers.
+//    app         - the single red pyramid with its black outline, turned so three faces show (renderFrame)
+//    grid_N      - N outlined pyramids from writeInstances, one draw each (renderInstancedFrame's scene)
+//Each case reports submitted triangles per second (mtri_per_s), pixels written per second (mpix_per_s) and
+//framebuffers filled per second in pixels (framebuffer_mpix_per_s), with the geometry and raster passes apart.
+//When a GL context exists, the last frame of each case is compared with the same scene drawn by GL: a pixel
+//mismatches when a channel differs by more than mismatchTolerance. Runs without a context (no GPU, no llvmpipe)
+//skip the comparison. --image writes each case's framebuffer as PNG.
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gtc/matrix_transform.hpp>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "GLPlatform.h"
+#include "GLStateCache.h"
+#include "InstancedRenderer.h"
+#include "JobSystem.h"
+#include "Json.h"
+#include "PngWriter.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "SoftwareRenderer.h"
+
+//Stop measuring one case after this much wall time even if --frames is not reached
+static const double secondsPerCase = 10.0;
+static const int minimumFrames = 3;
+//Channel difference (of 255) still counted as a match: unorm rounding plus float differences in the outline blend
+static const int mismatchTolerance = 2;
+
+//The app's pyramid turned about a diagonal axis
+static glm::mat4 appTransform() {
+    return glm::rotate(glm::mat4(1.0f), 0.6f, glm::normalize(glm::vec3(1.0f, 1.0f, 0.0f)));
+}
+
+//Queue one case's frame: the app's pyramid (objects = 0) or the instanced grid
+static void queueScene(SoftwareRenderer& renderer, size_t objects, const std::vector<InstanceData>& instances) {
+    if (objects == 0) {
+        renderer.drawElements(appTransform(), verticesPyramid, pyramidVertexCount, indices, pyramidIndexCount,
+            glm::vec3(1.0f, 0.0f, 0.0f));
+        return;
+    }
+    for (const InstanceData& instance : instances) {
+        glm::mat4 model;
+        std::copy(instance.transform, instance.transform + 16, &model[0][0]);
+        glm::vec3 color(instance.color[0] / 255.0f, instance.color[1] / 255.0f, instance.color[2] / 255.0f);
+        renderer.drawElements(model, verticesPyramid, pyramidVertexCount, indices, pyramidIndexCount, color);
+    }
+}
+
+//Draw the same scene with GL and read it back, RGBA8 bottom row first. False if the renderers do not build.
+static bool renderWithGl(const BenchOptions& options, size_t objects, std::vector<uint8_t>& pixels) {
+    GLStateCache glState;
+    if (objects == 0) {
+        PyramidRenderer renderer;
+        if (!createPyramidRenderer(renderer, true))
+            return false;
+        setOutlineWidth(renderer.outline, options.outlineWidth);
+        renderFrame(renderer, appTransform(), glState);
+        destroyPyramidRenderer(renderer);
+    } else {
+        InstancedRenderer renderer;
+        if (!createInstancedRenderer(renderer, objects, true, true))
+            return false;
+        setOutlineWidth(renderer.outline, options.outlineWidth);
+        updateInstances(renderer, 0.0f);
+        renderInstancedFrame(renderer, glm::mat4(1.0f), glState);
+        destroyInstancedRenderer(renderer);
+    }
+    pixels.resize((size_t)options.width * options.height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, options.width, options.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return true;
+}
+
+//"frame.png" + "app" = "frame_app.png"
+static std::string imagePath(const std::string& path, const std::string& name) {
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return path + "_" + name + ".png";
+    return path.substr(0, dot) + "_" + name + path.substr(dot);
+}
+
+int runSoftwareBench(const BenchOptions& options, JsonWriter& json) {
+    std::vector<size_t> counts = { 0 };
+    if (options.objectCounts.empty()) {
+        counts.push_back(1000);
+        counts.push_back(100000);
+    } else {
+        counts.insert(counts.end(), options.objectCounts.begin(), options.objectCounts.end());
+    }
+
+    JobSystem jobs(options.threads);
+    json.value("frames_requested", options.frames);
+    json.value("warmup_frames", options.warmupFrames);
+    json.value("threads", jobs.threadCount());
+    json.value("tile_size", softwareTileSize);
+    json.value("outline_width", options.outlineWidth);
+    json.value("gl_compare", options.glContext);
+    json.beginArray("runs");
+
+    int result = 0;
+    SoftwareRenderer renderer;
+    renderer.resize(options.width, options.height);
+    renderer.setOutline(options.outlineWidth, glm::vec3(0.0f));
+    for (size_t objects : counts) {
+        std::string name = objects == 0 ? "app" : "grid_" + std::to_string(objects);
+        std::vector<InstanceData> instances(objects);
+        if (objects > 0)
+            writeInstances(instances.data(), 0, objects, objects, 0.0f);
+
+        std::vector<double> frameMs, geometryMs, rasterMs;
+        SoftwareFrameStats last;
+        double measureStart = 0.0;
+        int frame = 0;
+        for (;;) {
+            if (frame == options.warmupFrames) {
+                frameMs.clear(); geometryMs.clear(); rasterMs.clear();
+                measureStart = wallSeconds();
+            }
+            int measured = frame - options.warmupFrames;
+            if (measured >= options.frames ||
+                (measured >= minimumFrames && wallSeconds() - measureStart > secondsPerCase))
+                break;
+
+            double frameStart = wallSeconds();
+            queueScene(renderer, objects, instances);
+            last = renderer.flush(&jobs);
+            frameMs.push_back((wallSeconds() - frameStart) * 1000.0);
+            geometryMs.push_back(last.geometryMs);
+            rasterMs.push_back(last.rasterMs);
+            frame++;
+        }
+
+        SampleStats frameStats = computeStats(frameMs);
+        double seconds = frameStats.mean / 1000.0;
+        json.beginObject();
+        json.value("case", name);
+        json.value("objects", (uint64_t)objects);
+        json.value("frames", (uint64_t)frameStats.count);
+        json.value("draws", (uint64_t)last.draws);
+        json.value("triangles", (uint64_t)last.triangles);
+        json.value("binned_triangles", (uint64_t)last.binnedTriangles);
+        json.value("fragments", (uint64_t)last.fragments);
+        json.value("mtri_per_s", seconds > 0.0 ? (double)last.triangles / seconds / 1e6 : 0.0);
+        json.value("mpix_per_s", seconds > 0.0 ? (double)last.fragments / seconds / 1e6 : 0.0);
+        json.value("framebuffer_mpix_per_s",
+            seconds > 0.0 ? (double)options.width * options.height / seconds / 1e6 : 0.0);
+        writeStats(json, "frame_ms", frameStats);
+        writeStats(json, "geometry_ms", computeStats(geometryMs));
+        writeStats(json, "raster_ms", computeStats(rasterMs));
+
+        if (options.glContext) {
+            std::vector<uint8_t> reference;
+            if (!renderWithGl(options, objects, reference)) {
+                json.endObject();
+                result = -1;
+                break;
+            }
+            const uint8_t* pixels = renderer.color();
+            size_t mismatched = 0, pixelCount = (size_t)options.width * options.height;
+            int largest = 0;
+            for (size_t i = 0; i < pixelCount; i++) {
+                int difference = 0;
+                for (int channel = 0; channel < 3; channel++)
+                    difference = std::max(difference, std::abs((int)pixels[i * 4 + channel] - (int)reference[i * 4 + channel]));
+                largest = std::max(largest, difference);
+                if (difference > mismatchTolerance)
+                    mismatched++;
+            }
+            json.value("gl_mismatched_pixels", (uint64_t)mismatched);
+            json.value("gl_mismatched_fraction", (double)mismatched / (double)pixelCount);
+            json.value("gl_max_channel_difference", largest);
+        }
+        if (!options.imagePath.empty()) {
+            std::string path = imagePath(options.imagePath, name);
+            bool written = writePng(path.c_str(), renderer.color(), renderer.width(), renderer.height(), true);
+            json.value("image", written ? path : std::string());
+        }
+        json.endObject();
+    }
+    json.endArray();
+    return result;
+}
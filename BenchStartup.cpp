@@ -0,0 +1,134 @@
+//Startup benchmark: time to build every shader program with no cache, a cold cache and a warm cache.
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "Json.h"
+#include "ProgramCache.h"
+#include "Renderer.h"
+#include "Scene.h"
+
+//-- One program of the startup set, sources owned here
+struct StartupProgram {
+    std::string vertex;
+    std::string fragment;
+    std::string geometry; //empty = none
+};
+
+//Insert a line right after the #version directive (a comment or #define is enough to change the key)
+static std::string withLine(const char* source, const std::string& line) {
+    std::string text = source;
+    size_t version = text.find("#version");
+    size_t end = version == std::string::npos ? 0 : text.find('\n', version) + 1;
+    return text.insert(end, line + "\n");
+}
+
+//Every program the app builds, times permutations. salt goes into each source so the driver's own
+//shader cache (Mesa keeps one on disk) cannot answer for a previous run.
+static std::vector<StartupProgram> startupPrograms(int permutations, const std::string& salt) {
+    struct Combination { const char* vertex; const char* fragment; const char* geometry; };
+    const Combination combinations[] = {
+        { vertexShaderSource, fragmentShaderSource, nullptr },
+        { outlineVertexShaderSource, outlineFragmentShaderSource, outlineGeometryShaderSource },
+        { instancedVertexShaderSource, instancedFragmentShaderSource, nullptr },
+        { instancedVertexShaderSource, outlineFragmentShaderSource, outlineGeometryShaderSource },
+    };
+    std::vector<StartupProgram> programs;
+    for (int permutation = 0; permutation < permutations; permutation++) {
+        std::string line = "#define PERMUTATION " + std::to_string(permutation) + " //" + salt;
+        for (const Combination& combination : combinations) {
+            StartupProgram program;
+            program.vertex = withLine(combination.vertex, line);
+            program.fragment = withLine(combination.fragment, line);
+            if (combination.geometry != nullptr)
+                program.geometry = withLine(combination.geometry, line);
+            programs.push_back(program);
+        }
+    }
+    return programs;
+}
+
+//Begin every program, then finish them all; returns wall ms or -1 if one failed
+static double buildPrograms(const std::vector<StartupProgram>& programs) {
+    double start = wallSeconds();
+    std::vector<PendingProgram> pending;
+    pending.reserve(programs.size());
+    for (const StartupProgram& program : programs) {
+        pending.push_back(beginShaderProgram(program.vertex.c_str(), program.fragment.c_str(),
+            program.geometry.empty() ? nullptr : program.geometry.c_str()));
+    }
+    std::vector<unsigned int> built;
+    bool ok = true;
+    for (PendingProgram& program : pending) {
+        unsigned int id = finishShaderProgram(program);
+        ok = ok && id != 0;
+        built.push_back(id);
+    }
+    double ms = (wallSeconds() - start) * 1000.0;
+    for (unsigned int id : built)
+        glDeleteProgram(id);
+    return ok ? ms : -1.0;
+}
+
+static void writeRun(JsonWriter& json, const char* key, double ms, size_t programCount) {
+    const ProgramCacheStats& stats = programCacheStats();
+    json.beginObject(key);
+    json.value("total_ms", ms);
+    json.value("ms_per_program", ms / programCount);
+    json.value("cache_hits", stats.hits);
+    json.value("cache_misses", stats.misses);
+    json.value("cache_stale", stats.stale);
+    json.value("cache_stores", stats.stores);
+    json.endObject();
+}
+
+int runStartupBench(const BenchOptions& options, JsonWriter& json) {
+    bool parallel = options.parallelCompile && enableParallelShaderCompile();
+    //A fresh salt per process unless given, see startupPrograms
+    std::string salt = options.shaderSalt;
+    if (salt.empty()) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%llx", (unsigned long long)(wallSeconds() * 1e9));
+        salt = text;
+    }
+    std::vector<StartupProgram> programs = startupPrograms(options.permutations, salt);
+
+    json.value("programs", (uint64_t)programs.size());
+    json.value("parallel_compile", parallel);
+    json.value("cache_dir", options.cacheDir);
+
+    //No cache: plain compile and link, with its own salt so the cold run below compiles from scratch too
+    disableProgramCache();
+    resetProgramCacheStats();
+    double uncached = buildPrograms(startupPrograms(options.permutations, salt + "-uncached"));
+    if (uncached < 0.0)
+        return -1;
+    writeRun(json, "no_cache", uncached, programs.size());
+
+    bool cacheAvailable = enableProgramCache(options.cacheDir);
+    json.value("cache_available", cacheAvailable);
+    if (!cacheAvailable)
+        return 0;
+
+    //Cold: empty cache directory, every program compiles and its binary is written
+    clearProgramCache();
+    resetProgramCacheStats();
+    double cold = buildPrograms(programs);
+    if (cold < 0.0)
+        return -1;
+    writeRun(json, "cold_cache", cold, programs.size());
+
+    //Warm: same sources again, every program comes from glProgramBinary
+    resetProgramCacheStats();
+    double warm = buildPrograms(programs);
+    if (warm < 0.0)
+        return -1;
+    writeRun(json, "warm_cache", warm, programs.size());
+    json.value("warm_speedup", warm > 0.0 ? cold / warm : 0.0);
+
+    if (!options.keepCache)
+        clearProgramCache();
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "BenchStats.h"
+#include "Json.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+SampleStats computeStats(const std::vector<double>& samples) {
+    SampleStats stats;
+    stats.count = samples.size();
+    if (samples.empty())
+        return stats;
+
+    std::vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (double v : sorted)
+        sum += v;
+    stats.total = sum;
+    stats.mean = sum / sorted.size();
+
+    double variance = 0.0;
+    for (double v : sorted)
+        variance += (v - stats.mean) * (v - stats.mean);
+    stats.stddev = std::sqrt(variance / sorted.size());
+
+    //Nearest-rank percentile
+    auto percentile = [&](double p) {
+        size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+        return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+    };
+    stats.min = sorted.front();
+    stats.max = sorted.back();
+    stats.p50 = percentile(50.0);
+    stats.p90 = percentile(90.0);
+    stats.p95 = percentile(95.0);
+    stats.p99 = percentile(99.0);
+    return stats;
+}
+
+void writeStats(JsonWriter& json, const char* key, const SampleStats& stats) {
+    json.beginObject(key);
+    json.value("count", (uint64_t)stats.count);
+    json.value("mean", stats.mean);
+    json.value("stddev", stats.stddev);
+    json.value("min", stats.min);
+    json.value("p50", stats.p50);
+    json.value("p90", stats.p90);
+    json.value("p95", stats.p95);
+    json.value("p99", stats.p99);
+    json.value("max", stats.max);
+    json.value("total", stats.total);
+    json.endObject();
+}
+
+double threadCpuSeconds() {
+#ifdef _WIN32
+    FILETIME creation, exitTime, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exitTime, &kernel, &user);
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime; u.HighPart = user.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) * 1e-7;
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+    return wallSeconds();
+#endif
+}
+
+uint64_t threadCpuTicks() {
+#ifdef _WIN32
+    ULONG64 cycles = 0;
+    QueryThreadCycleTime(GetCurrentThread(), &cycles);
+    return cycles;
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#else
+    return (uint64_t)(wallSeconds() * 1e9);
+#endif
+}
+
+double processCpuSeconds() {
+#ifdef _WIN32
+    FILETIME creation, exitTime, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &creation, &exitTime, &kernel, &user);
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime; u.HighPart = user.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) * 1e-7;
+#else
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
@@ -0,0 +1,63 @@
+#pragma once
+//Timing helpers and summary statistics for the headless benchmark.
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+class JsonWriter;
+
+//-- Summary of a set of samples (units are whatever the samples are in)
+struct SampleStats {
+    size_t count = 0;
+    double mean = 0.0;
+    double stddev = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double total = 0.0;
+};
+
+//Percentiles use nearest-rank on a sorted copy
+SampleStats computeStats(const std::vector<double>& samples);
+void writeStats(JsonWriter& json, const char* key, const SampleStats& stats);
+
+//Monotonic wall clock in seconds
+inline double wallSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//CPU time consumed by the calling thread in seconds (wall clock where the OS has no per-thread clock)
+double threadCpuSeconds();
+
+//CPU time consumed by the whole process in seconds, includes driver and worker threads
+double processCpuSeconds();
+
+//CPU work of the calling thread in unspecified units (nanoseconds on Linux, cycles on Windows, whose thread times
+//tick every 15.6 ms). Fine grained everywhere but only good for ratios: time spent preempted does not count.
+uint64_t threadCpuTicks();
+
+//-- Wall and thread CPU time of one named phase, accumulated per frame
+struct PhaseTimes {
+    std::vector<double> wallMs;
+    std::vector<double> cpuMs;
+};
+
+//-- Starts timing on construction, appends one sample to the phase on destruction
+class PhaseTimer {
+public:
+    explicit PhaseTimer(PhaseTimes& phase) : phase(phase), wallStart(wallSeconds()), cpuStart(threadCpuSeconds()) {}
+    ~PhaseTimer() {
+        phase.wallMs.push_back((wallSeconds() - wallStart) * 1000.0);
+        phase.cpuMs.push_back((threadCpuSeconds() - cpuStart) * 1000.0);
+    }
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    PhaseTimes& phase;
+    double wallStart;
+    double cpuStart;
+};
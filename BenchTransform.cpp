@@ -0,0 +1,200 @@
+//Batch vertex transform benchmark: VertexTransform's scalar, SSE and AVX kernels on AoS and SoA streams,
+//with and without streaming stores and the job system, from 10^3 to 10^8 vertices.
+#include <cmath>
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <gtc/matrix_transform.hpp>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "JobSystem.h"
+#include "Json.h"
+#include "VertexTransform.h"
+
+//Repeat each case for at least this long (and at least minimumRepeats times) after one untimed pass
+static const double secondsPerCase = 0.2;
+static const int minimumRepeats = 3;
+//Vertices compared against glm per case
+static const size_t checkedVertices = 4096;
+
+//-- One measured configuration
+struct TransformCase {
+    const char* name;
+    bool soa;
+    VertexTransformPath path;
+    bool threaded;
+    bool stream;    //false forces cached stores
+};
+
+//Matrix with a perspective divide so every output component is meaningful
+static glm::mat4 benchMatrix() {
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -3.0f));
+    glm::mat4 model = glm::rotate(glm::mat4(1.0f), glm::radians(30.0f), glm::vec3(0.3f, 1.0f, 0.2f));
+    return projection * view * glm::scale(model, glm::vec3(1.0f, 1.0f, 1.5f));
+}
+
+//Deterministic positions in [-1, 1]
+static float randomCoordinate(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return (float)(state >> 8) / (float)(1u << 24) * 2.0f - 1.0f;
+}
+
+//Float arrays of count elements each, 64 byte aligned, carved out of one allocation
+static std::vector<float*> alignedArrays(std::vector<float>& storage, size_t count, int arrays) {
+    size_t padded = (count + 15) / 16 * 16;
+    storage.assign(padded * arrays + 16, 0.0f);
+    float* base = storage.data();
+    base += (64 - ((uintptr_t)base & 63)) % 64 / sizeof(float);
+    std::vector<float*> result;
+    for (int i = 0; i < arrays; i++)
+        result.push_back(base + padded * i);
+    return result;
+}
+
+static VertexTransformSettings caseSettings(const TransformCase& c, JobSystem& jobs) {
+    VertexTransformSettings settings;
+    settings.path = c.path;
+    settings.jobs = c.threaded ? &jobs : nullptr;
+    if (!c.stream)
+        settings.streamingThreshold = SIZE_MAX;
+    return settings;
+}
+
+//Run fn once untimed, then repeatedly; returns seconds per run
+template <class Function>
+static double timeRepeated(Function fn, int& repeats) {
+    fn();
+    repeats = 0;
+    double start = wallSeconds();
+    double elapsed = 0.0;
+    while (repeats < minimumRepeats || elapsed < secondsPerCase) {
+        fn();
+        repeats++;
+        elapsed = wallSeconds() - start;
+    }
+    return elapsed / repeats;
+}
+
+static void writeCase(JsonWriter& json, const TransformCase& c, size_t count, double seconds, int repeats,
+    double baselineSeconds, float maxError, bool streamed) {
+    json.beginObject();
+    json.value("name", c.name);
+    json.value("layout", c.soa ? "soa" : "aos");
+    json.value("kernel", vertexTransformPathName(c.path == VertexTransformPath::Auto ? bestVertexTransformPath() : c.path));
+    json.value("threaded", c.threaded);
+    json.value("streaming_stores", streamed);
+    json.value("repeats", repeats);
+    json.value("ns_per_vertex", seconds * 1e9 / count);
+    json.value("mvertices_per_second", count / seconds / 1e6);
+    //Positions read (12 bytes) plus results written (16 bytes)
+    json.value("gb_per_second", count * 28.0 / seconds / 1e9);
+    json.value("speedup", seconds > 0.0 ? baselineSeconds / seconds : 0.0);
+    json.value("max_abs_error", (double)maxError);
+    json.endObject();
+}
+
+int runTransformBench(const BenchOptions& options, JsonWriter& json) {
+    std::vector<size_t> vertexCounts = options.vertexCounts;
+    if (vertexCounts.empty())
+        vertexCounts = { 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+    JobSystem jobs(options.threads);
+    VertexTransformPath best = bestVertexTransformPath();
+    glm::mat4 matrix = benchMatrix();
+
+    std::vector<TransformCase> cases = {
+        { "aos_scalar", false, VertexTransformPath::Scalar, false, true },
+        { "aos_sse", false, VertexTransformPath::SSE, false, true },
+        { "aos_avx", false, VertexTransformPath::AVX, false, true },
+        { "aos_best_cached_stores", false, VertexTransformPath::Auto, false, false },
+        { "aos_best_threaded", false, VertexTransformPath::Auto, true, true },
+        { "soa_scalar", true, VertexTransformPath::Scalar, false, true },
+        { "soa_sse", true, VertexTransformPath::SSE, false, true },
+        { "soa_avx", true, VertexTransformPath::AVX, false, true },
+        { "soa_best_threaded", true, VertexTransformPath::Auto, true, true },
+    };
+    VertexTransformSettings defaults;
+
+    json.value("best_kernel", vertexTransformPathName(best));
+    json.value("threads", jobs.threadCount());
+    json.value("parallel_threshold", (uint64_t)defaults.parallelThreshold);
+    json.value("streaming_threshold_bytes", (uint64_t)defaults.streamingThreshold);
+    json.beginArray("runs");
+    for (size_t count : vertexCounts) {
+        json.beginObject();
+        json.value("vertices", (uint64_t)count);
+        bool streamed = count * sizeof(glm::vec4) >= defaults.streamingThreshold;
+        double baselineSeconds = 0.0;
+        try {
+            json.beginArray("cases");
+            //One layout's buffers at a time, 10^8 vertices is 2.8 GB per layout
+            for (int layout = 0; layout < 2; layout++) {
+                bool soa = layout == 1;
+                std::vector<float> positions, soaStorage;
+                std::vector<glm::vec4> aosOut;
+                float* soaIn[3] = {};
+                float* soaOut[4] = {};
+                uint32_t seed = 1;
+                if (soa) {
+                    std::vector<float*> arrays = alignedArrays(soaStorage, count, 7);
+                    for (int i = 0; i < 7; i++)
+                        (i < 3 ? soaIn[i] : soaOut[i - 3]) = arrays[i];
+                    for (size_t i = 0; i < count; i++) {
+                        for (int axis = 0; axis < 3; axis++)
+                            soaIn[axis][i] = randomCoordinate(seed);
+                    }
+                }
+                else {
+                    positions.resize(count * 3);
+                    for (float& value : positions)
+                        value = randomCoordinate(seed);
+                    aosOut.resize(count);
+                }
+                PositionStreams streams = { soaIn[0], soaIn[1], soaIn[2] };
+                TransformedStreams outStreams = { soaOut[0], soaOut[1], soaOut[2], soaOut[3] };
+
+                for (const TransformCase& c : cases) {
+                    if (c.soa != soa || !isVertexTransformPathSupported(c.path) ||
+                        (c.threaded && jobs.threadCount() < 2))
+                        continue;
+                    VertexTransformSettings settings = caseSettings(c, jobs);
+                    int repeats = 0;
+                    double seconds = timeRepeated([&]() {
+                        if (soa)
+                            transformPositions(matrix, streams, count, outStreams, settings);
+                        else
+                            transformPositions(matrix, positions.data(), 3, count, aosOut.data(), settings);
+                    }, repeats);
+                    if (c.path == VertexTransformPath::Scalar && !c.soa)
+                        baselineSeconds = seconds;
+
+                    //Compare a spread of vertices with glm's mat4 * vec4
+                    float maxError = 0.0f;
+                    size_t step = count > checkedVertices ? count / checkedVertices : 1;
+                    for (size_t i = 0; i < count; i += step) {
+                        glm::vec4 expected = soa ?
+                            matrix * glm::vec4(soaIn[0][i], soaIn[1][i], soaIn[2][i], 1.0f) :
+                            matrix * glm::vec4(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2], 1.0f);
+                        glm::vec4 actual = soa ?
+                            glm::vec4(soaOut[0][i], soaOut[1][i], soaOut[2][i], soaOut[3][i]) : aosOut[i];
+                        for (int k = 0; k < 4; k++)
+                            maxError = std::fmax(maxError, std::fabs(expected[k] - actual[k]));
+                    }
+                    writeCase(json, c, count, seconds, repeats, baselineSeconds, maxError,
+                        streamed && c.stream && c.path != VertexTransformPath::Scalar);
+                }
+            }
+            json.endArray();
+        }
+        catch (const std::bad_alloc&) {
+            json.endArray();
+            json.value("skipped", "out of memory");
+        }
+        json.endObject();
+    }
+    json.endArray();
+    return 0;
+}
@@ -0,0 +1,285 @@
+//Vertex format benchmark: memory, precision and draw cost of the VertexFormat.h encodings against the float32 layout
+//with 32 bit indices. Per mesh and format:
+//    bytes        - vertex + index buffer size and the ratio to float32
+//    error        - CPU decode against the source (position in model units and relative to the bounds diagonal,
+//                   normal angle, color channel)
+//    gpu_decode   - the generated GLSL decode run through transform feedback, compared the same way, so the shader
+//                   and CPU decode are checked against each other
+//    draw         - vertex stage (rasterizer discard) and full frame time through uploadPackedMesh
+//Colors are synthesized from the normals; imported meshes carry none. Without --mesh it uses generated grids of
+//100000 triangles (16 bit indices) and --triangles.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gtc/type_ptr.hpp>
+
+#include "Bench.h"
+#include "BenchStats.h"
+#include "GeometryCache.h"
+#include "GLPlatform.h"
+#include "Json.h"
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "Renderer.h"
+#include "VertexFormat.h"
+
+static const int samples = 7;
+static const int vertexStageDraws = 4;
+static const size_t smallGridTriangles = 100000;
+
+//-- Format under test; baseline keeps 32 bit indices like the original upload path
+struct FormatCase {
+    const char* name;
+    VertexFormat format;
+    bool baseline;
+};
+
+static unsigned int buildDecodeProgram(const VertexFormat& format) {
+    std::string source = "#version 330 core\n" + vertexDecodeShaderSource(format) +
+        "uniform mat4 decode;\n"
+        "out vec3 vPosition;\n"
+        "out vec3 vNormal;\n"
+        "out vec4 vColor;\n"
+        "void main() {\n"
+        "    vPosition = (decode * vec4(decodePosition(), 1.0)).xyz;\n"
+        "    vNormal = decodeNormal();\n"
+        "    vColor = decodeColor();\n"
+        "    gl_Position = vec4(0.0);\n"
+        "}\n";
+    const char* text = source.c_str();
+    unsigned int shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(shader, 1, &text, nullptr);
+    glCompileShader(shader);
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, shader);
+    const char* varyings[] = { "vPosition", "vNormal", "vColor" };
+    glTransformFeedbackVaryings(program, 3, varyings, GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(program);
+    glDeleteShader(shader);
+    int linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        std::cerr << "Generated decode shader failed:\n" << log << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+//Run the generated decode over every vertex of the bound VAO and compare with the source attributes
+static bool checkGpuDecode(JsonWriter& json, const VertexFormat& format, const PackedMesh& packed, const MeshData& mesh,
+    const std::vector<float>& colors) {
+    unsigned int program = buildDecodeProgram(format);
+    if (program == 0)
+        return false;
+    size_t floatsPerVertex = 10;
+    unsigned int buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, buffer);
+    glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, mesh.vertexCount() * floatsPerVertex * sizeof(float), nullptr, GL_STATIC_READ);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffer);
+    glUseProgram(program);
+    glUniformMatrix4fv(glGetUniformLocation(program, "decode"), 1, GL_FALSE, glm::value_ptr(packed.positionDecode));
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)mesh.vertexCount());
+    glEndTransformFeedback();
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    const float* decoded = (const float*)glMapBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0,
+        mesh.vertexCount() * floatsPerVertex * sizeof(float), GL_MAP_READ_BIT);
+    double positionMax = 0.0, normalMaxDegrees = 0.0, colorMax = 0.0;
+    bool hasNormals = !mesh.normals.empty() && format.normal != NormalEncoding::None;
+    for (size_t v = 0; decoded != nullptr && v < mesh.vertexCount(); v++) {
+        const float* out = decoded + v * floatsPerVertex;
+        glm::vec3 position(out[0], out[1], out[2]);
+        glm::vec3 source(mesh.positions[v * 3], mesh.positions[v * 3 + 1], mesh.positions[v * 3 + 2]);
+        positionMax = std::max(positionMax, (double)glm::length(position - source));
+        if (hasNormals) {
+            glm::dvec3 normal = glm::normalize(glm::dvec3(out[3], out[4], out[5]));
+            glm::dvec3 reference = glm::normalize(glm::dvec3(mesh.normals[v * 3], mesh.normals[v * 3 + 1], mesh.normals[v * 3 + 2]));
+            double cosine = std::min(std::max(glm::dot(normal, reference), -1.0), 1.0);
+            normalMaxDegrees = std::max(normalMaxDegrees, std::acos(cosine) * 180.0 / 3.14159265358979323846);
+        }
+        if (format.color != ColorEncoding::None) {
+            for (int channel = 0; channel < 4; channel++)
+                colorMax = std::max(colorMax, (double)std::fabs(out[6 + channel] - colors[v * 4 + channel]));
+        }
+    }
+    bool mapped = decoded != nullptr;
+    glUnmapBuffer(GL_TRANSFORM_FEEDBACK_BUFFER);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glDeleteBuffers(1, &buffer);
+    glDeleteProgram(program);
+
+    json.beginObject("gpu_decode");
+    json.value("position_max", positionMax);
+    json.value("normal_max_degrees", normalMaxDegrees);
+    json.value("color_max", colorMax);
+    json.endObject();
+    return mapped;
+}
+
+static void measureDraws(JsonWriter& json, const PyramidRenderer& renderer, const PackedMesh& packed) {
+    glm::mat4 transform = unitBoxTransform(packed.boundsMin, packed.boundsMax) * packed.positionDecode;
+    glUseProgram(renderer.shaderProgram);
+    glBindVertexArray(renderer.VAO);
+    glUniformMatrix4fv(renderer.transformLoc, 1, GL_FALSE, glm::value_ptr(transform));
+    std::vector<double> vertexStage, frame;
+    glEnable(GL_RASTERIZER_DISCARD);
+    glDrawElements(GL_TRIANGLES, renderer.indexCount, renderer.indexType, 0);
+    glFinish();
+    for (int sample = 0; sample < samples; sample++) {
+        double start = wallSeconds();
+        for (int draw = 0; draw < vertexStageDraws; draw++)
+            glDrawElements(GL_TRIANGLES, renderer.indexCount, renderer.indexType, 0);
+        glFinish();
+        vertexStage.push_back((wallSeconds() - start) * 1000.0 / vertexStageDraws);
+    }
+    glDisable(GL_RASTERIZER_DISCARD);
+    for (int sample = 0; sample < samples; sample++) {
+        GLStateCache glState;
+        double start = wallSeconds();
+        renderFrame(renderer, transform, glState);
+        glFinish();
+        frame.push_back((wallSeconds() - start) * 1000.0);
+    }
+    json.value("vertex_stage_ms", computeStats(vertexStage).p50);
+    json.value("frame_ms", computeStats(frame).p50);
+}
+
+static bool runMesh(JsonWriter& json, PyramidRenderer& renderer, const std::string& path) {
+    MeshData mesh;
+    if (!importMesh(path.c_str(), mesh))
+        return false;
+    optimizeMesh(mesh);
+    size_t vertexCount = mesh.vertexCount();
+    json.value("vertices", (uint64_t)vertexCount);
+    json.value("triangles", (uint64_t)mesh.triangleCount());
+    json.value("has_normals", !mesh.normals.empty());
+
+    std::vector<float> colors(vertexCount * 4, 1.0f);
+    for (size_t v = 0; v < vertexCount && !mesh.normals.empty(); v++) {
+        for (int channel = 0; channel < 3; channel++)
+            colors[v * 4 + channel] = mesh.normals[v * 3 + channel] * 0.5f + 0.5f;
+    }
+    NormalEncoding floatNormal = mesh.normals.empty() ? NormalEncoding::None : NormalEncoding::Float32;
+    NormalEncoding packedNormal = mesh.normals.empty() ? NormalEncoding::None : NormalEncoding::Octahedral;
+    FormatCase cases[] = {
+        { "float32", makeVertexFormat(PositionEncoding::Float32, floatNormal, ColorEncoding::Float32), true },
+        { "half", makeVertexFormat(PositionEncoding::Half, packedNormal, ColorEncoding::Unorm8), false },
+        { "snorm16", makeVertexFormat(PositionEncoding::Snorm16, packedNormal, ColorEncoding::Unorm8), false },
+    };
+
+    size_t baselineBytes = 0;
+    json.beginArray("formats");
+    for (const FormatCase& test : cases) {
+        json.beginObject();
+        json.value("name", test.name);
+        json.value("layout", vertexFormatName(test.format));
+        json.value("stride", (int)test.format.stride);
+
+        std::vector<unsigned char> vertices(vertexCount * test.format.stride);
+        double start = wallSeconds();
+        encodeVertices(test.format, mesh.positions.data(), mesh.normals.empty() ? nullptr : mesh.normals.data(),
+            colors.data(), vertexCount, mesh.boundsMin, mesh.boundsMax, vertices.data());
+        json.value("encode_ms", (wallSeconds() - start) * 1000.0);
+        unsigned int indexSize = test.baseline ? 4 : indexSizeFor(vertexCount);
+        std::vector<unsigned char> indices(mesh.indices.size() * indexSize);
+        writeIndices(mesh.indices.data(), mesh.indices.size(), indexSize, indices.data());
+
+        size_t bytes = vertices.size() + indices.size();
+        if (test.baseline)
+            baselineBytes = bytes;
+        json.value("index_size", (int)indexSize);
+        json.value("vertex_mb", vertices.size() / 1e6);
+        json.value("index_mb", indices.size() / 1e6);
+        json.value("bytes_ratio", baselineBytes > 0 ? (double)bytes / baselineBytes : 1.0);
+
+        VertexFormatError error = measureEncodingError(test.format, vertices.data(), mesh.positions.data(),
+            mesh.normals.empty() ? nullptr : mesh.normals.data(), colors.data(), vertexCount, mesh.boundsMin, mesh.boundsMax);
+        json.beginObject("error");
+        json.value("position_max", error.positionMax);
+        json.value("position_rms", error.positionRms);
+        json.value("position_max_relative", error.positionMaxRelative);
+        json.value("normal_max_degrees", error.normalMaxDegrees);
+        json.value("normal_mean_degrees", error.normalMeanDegrees);
+        json.value("color_max", error.colorMax);
+        json.endObject();
+
+        PackedMesh packed;
+        packed.vertices = vertices.data();
+        packed.vertexCount = vertexCount;
+        packed.vertexBytes = vertices.size();
+        packed.format = test.format;
+        packed.indices = indices.data();
+        packed.indexCount = mesh.indices.size();
+        packed.indexBytes = indices.size();
+        packed.indexSize = indexSize;
+        packed.boundsMin = mesh.boundsMin;
+        packed.boundsMax = mesh.boundsMax;
+        packed.positionDecode = positionDecodeTransform(test.format.position, mesh.boundsMin, mesh.boundsMax);
+        if (!uploadPackedMesh(renderer, packed) || !checkGpuDecode(json, test.format, packed, mesh, colors)) {
+            json.endObject();
+            json.endArray();
+            return false;
+        }
+        measureDraws(json, renderer, packed);
+        json.endObject();
+    }
+    json.endArray();
+    return true;
+}
+
+int runVertexFormatBench(const BenchOptions& options, JsonWriter& json) {
+    PyramidRenderer renderer;
+    if (!createPyramidRenderer(renderer, options.outline == "single"))
+        return -1;
+    if (renderer.singlePassOutline)
+        setOutlineWidth(renderer.outline, options.outlineWidth);
+    setOutlineViewport(renderer.outline, options.width, options.height);
+
+    //Generated grids are written one at a time, they share the file names
+    std::vector<std::string> sources = options.meshPaths;
+    std::vector<size_t> gridSizes;
+    if (sources.empty())
+        gridSizes = { smallGridTriangles, options.triangles };
+
+    int result = 0;
+    json.beginArray("files");
+    size_t count = sources.empty() ? gridSizes.size() : sources.size();
+    for (size_t i = 0; i < count; i++) {
+        std::vector<std::string> generated;
+        std::string path;
+        if (sources.empty()) {
+            generated = writeBenchGrid(gridSizes[i]);
+            if (generated.empty()) {
+                result = 1;
+                continue;
+            }
+            path = generated[0];
+        }
+        else {
+            path = sources[i];
+        }
+        json.beginObject();
+        json.value("path", path);
+        if (!runMesh(json, renderer, path)) {
+            json.value("error", "failed");
+            result = 1;
+        }
+        json.endObject();
+        for (const std::string& file : generated)
+            std::remove(file.c_str());
+    }
+    json.endArray();
+
+    destroyPyramidRenderer(renderer);
+    return result;
+}
@@ -0,0 +1,233 @@
+#include "FrameCapture.h"
+
+#include <chrono>
+#include <iostream>
+
+#include "PngWriter.h"
+
+#ifdef _WIN32
+#define openPipeStream(command) _popen(command, "wb")
+#define closePipeStream(stream) _pclose(stream)
+#else
+#define openPipeStream(command) popen(command, "w")
+#define closePipeStream(stream) pclose(stream)
+#endif
+
+//Encoder thread sleep when it has nothing to do
+static const std::chrono::milliseconds encoderIdleSleep(1);
+//How long close() waits for each read still in flight
+static const GLuint64 closeWaitNanoseconds = 1000000000;
+
+bool FrameCapture::openPng(const char* path, int width, int height, int frames) {
+    if (isOpen())
+        return false;
+    directory = path;
+    return open(CaptureFormat::Png, width, height, frames);
+}
+
+bool FrameCapture::openPipe(const char* command, int width, int height, int frames) {
+    if (isOpen())
+        return false;
+    stream = openPipeStream(command);
+    if (stream == nullptr) {
+        std::cerr << "Error starting capture pipe " << command << std::endl;
+        return false;
+    }
+    pipe = true;
+    if (!open(CaptureFormat::Raw, width, height, frames)) {
+        closePipeStream(stream);
+        stream = nullptr;
+        pipe = false;
+        return false;
+    }
+    return true;
+}
+
+bool FrameCapture::openStream(FILE* out, int width, int height, int frames) {
+    if (isOpen() || out == nullptr)
+        return false;
+    stream = out;
+    pipe = false;
+    return open(CaptureFormat::Raw, width, height, frames);
+}
+
+bool FrameCapture::open(CaptureFormat captureFormat, int width, int height, int frames) {
+    if (width <= 0 || height <= 0 || frames < 1)
+        return false;
+    format = captureFormat;
+    frameWidth = width;
+    frameHeight = height;
+    latency = frames;
+    slotCount = latency + captureEncodeSlots;
+    slots.reset(new Slot[slotCount]);
+    size_t frameBytes = (size_t)width * height * 4;
+    for (int i = 0; i < slotCount; i++) {
+        glGenBuffers(1, &slots[i].buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)frameBytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    nextSlot = 0;
+    oldestSlot = 0;
+    frame = 0;
+    queue.reset(new SpscRing<int>((size_t)slotCount));
+    captured = 0;
+    dropped = 0;
+    written = 0;
+    failed = 0;
+    bytes = 0;
+    encodeMicroseconds = 0;
+    stopping = false;
+    encoder = std::thread(&FrameCapture::encoderLoop, this);
+    return true;
+}
+
+void FrameCapture::close() {
+    if (!isOpen())
+        return;
+    //Everything read so far still gets written
+    while (slots[oldestSlot].state.load(std::memory_order_relaxed) == Reading) {
+        Slot& slot = slots[oldestSlot];
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, closeWaitNanoseconds);
+        if (!mapSlot(slot))
+            failed++;
+        oldestSlot = (oldestSlot + 1) % slotCount;
+    }
+    stopping.store(true, std::memory_order_release);
+    encoder.join();
+    unmapEncoded();
+    for (int i = 0; i < slotCount; i++)
+        glDeleteBuffers(1, &slots[i].buffer);
+    slots.reset();
+    queue.reset();
+    if (stream != nullptr) {
+        std::fflush(stream);
+        if (pipe)
+            closePipeStream(stream);
+    }
+    stream = nullptr;
+    pipe = false;
+}
+
+//======================RENDER THREAD======================
+//Map a read whose fence has signaled and queue it for the encoder. False (slot freed) if the map fails.
+bool FrameCapture::mapSlot(Slot& slot) {
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    slot.mapped = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+        (GLsizeiptr)frameWidth * frameHeight * 4, GL_MAP_READ_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (slot.mapped == nullptr) {
+        slot.state.store(Free, std::memory_order_relaxed);
+        return false;
+    }
+    slot.state.store(Encoding, std::memory_order_relaxed);
+    //Never full: it holds at most one entry per slot
+    queue->tryPush((int)(&slot - slots.get()));
+    return true;
+}
+
+//Give the PBOs the encoder is done with back to the ring
+void FrameCapture::unmapEncoded() {
+    for (int i = 0; i < slotCount; i++) {
+        Slot& slot = slots[i];
+        if (slot.state.load(std::memory_order_acquire) != Encoded)
+            continue;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        slot.mapped = nullptr;
+        slot.state.store(Free, std::memory_order_relaxed);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void FrameCapture::capture() {
+    if (!isOpen())
+        return;
+    unmapEncoded();
+
+    //Map the reads at least latency frames old whose fence has signaled, oldest first so frames stay in order
+    while (slots[oldestSlot].state.load(std::memory_order_relaxed) == Reading) {
+        Slot& slot = slots[oldestSlot];
+        if (slot.frame + (uint64_t)latency > frame)
+            break;
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        if (!mapSlot(slot))
+            failed++;
+        oldestSlot = (oldestSlot + 1) % slotCount;
+    }
+
+    //This frame's read, or a drop if the ring is full
+    Slot& slot = slots[nextSlot];
+    if (slot.state.load(std::memory_order_relaxed) == Free) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, frameWidth, frameHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.frame = frame;
+        slot.state.store(Reading, std::memory_order_relaxed);
+        nextSlot = (nextSlot + 1) % slotCount;
+        captured++;
+    } else {
+        dropped++;
+    }
+    frame++;
+}
+
+//======================ENCODER THREAD======================
+void FrameCapture::encode(Slot& slot, std::vector<uint8_t>& png) {
+    auto start = std::chrono::steady_clock::now();
+    bool ok = true;
+    size_t size = 0;
+    if (format == CaptureFormat::Png) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/frame_%06llu.png", (unsigned long long)slot.frame);
+        std::string path = directory + name;
+        encodePng(slot.mapped, frameWidth, frameHeight, true, png);
+        FILE* file = std::fopen(path.c_str(), "wb");
+        ok = file != nullptr && std::fwrite(png.data(), 1, png.size(), file) == png.size();
+        if (file != nullptr)
+            ok = std::fclose(file) == 0 && ok;
+        //One message, not one per frame
+        if (!ok && failed.load(std::memory_order_relaxed) == 0)
+            std::cerr << "Error writing captured frame " << path << std::endl;
+        size = png.size();
+    } else {
+        //GL rows are bottom first
+        size_t rowBytes = (size_t)frameWidth * 4;
+        for (int y = frameHeight - 1; y >= 0 && ok; y--)
+            ok = std::fwrite(slot.mapped + (size_t)y * rowBytes, 1, rowBytes, stream) == rowBytes;
+        if (!ok && failed.load(std::memory_order_relaxed) == 0)
+            std::cerr << "Error writing captured frame to the stream" << std::endl;
+        size = rowBytes * frameHeight;
+    }
+    if (ok) {
+        written.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+    } else {
+        failed.fetch_add(1, std::memory_order_relaxed);
+    }
+    encodeMicroseconds.fetch_add((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+    slot.state.store(Encoded, std::memory_order_release);
+}
+
+void FrameCapture::encoderLoop() {
+    std::vector<uint8_t> png;
+    for (;;) {
+        bool stop = stopping.load(std::memory_order_acquire);
+        int index = 0;
+        if (queue->tryPop(index)) {
+            encode(slots[index], png);
+            continue;
+        }
+        //Everything queued before stop was requested has been written
+        if (stop)
+            break;
+        std::this_thread::sleep_for(encoderIdleSleep);
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+/*Asynchronous frame capture.
+A synchronous glReadPixels after drawing waits for the GPU to finish the frame and then for the copy. Here every
+frame's read goes into one of a ring of pixel pack buffers (PBOs) with a fence behind it, and returns at once:
+    read    - capture() issues glReadPixels into the next free PBO, then glFenceSync
+    map     - latency frames later, once its fence has signaled, the PBO is mapped (never waited on: a read whose
+              fence is still pending stays in the ring until a later frame)
+    encode  - the mapped pointer goes to a background thread through a lock-free ring. It writes a PNG per frame
+              (PngWriter.h) or streams the raw rows to a pipe, then hands the PBO back to be unmapped.
+A frame is dropped and counted, instead of stalling, when no PBO is free: the GPU or the encoder is behind.
+Raw frames are width x height RGBA8, top row first, back to back: "ffmpeg -f rawvideo -pix_fmt rgba -s WxH -i -"
+reads them as they come.*/
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GLPlatform.h"
+#include "SpscRing.h"
+
+enum class CaptureFormat {
+    Png,   //directory/frame_000000.png, ...
+    Raw    //one stream, usually a pipe to an encoder
+};
+
+//Frames between issuing a read and mapping it
+const int defaultCaptureLatency = 2;
+//PBOs beyond the latency ones, held by frames the encoder has not finished yet
+const int captureEncodeSlots = 3;
+
+class FrameCapture {
+public:
+    FrameCapture() = default;
+    ~FrameCapture() { close(); }
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    //Capture width x height frames as PNG files into directory (which must exist). Expects a current GL context.
+    bool openPng(const char* directory, int width, int height, int latency = defaultCaptureLatency);
+    //Stream raw frames into command's standard input (popen)
+    bool openPipe(const char* command, int width, int height, int latency = defaultCaptureLatency);
+    //Same into an already open stream, not closed afterwards (e.g. stdout)
+    bool openStream(FILE* stream, int width, int height, int latency = defaultCaptureLatency);
+
+    //Wait for the reads in flight, finish encoding them, stop the thread and delete the PBOs. Context current.
+    void close();
+    bool isOpen() const { return encoder.joinable(); }
+
+    //GL thread, after drawing and before the swap: queue a read of the bound read framebuffer's lower left
+    //width x height pixels, and hand the reads that are ready to the encoder. Never blocks.
+    void capture();
+
+    uint64_t capturedFrames() const { return captured; }                              //reads issued
+    uint64_t droppedFrames() const { return dropped; }                                //no free PBO
+    uint64_t writtenFrames() const { return written.load(std::memory_order_relaxed); }
+    uint64_t failedFrames() const { return failed.load(std::memory_order_relaxed); }  //map or write errors
+    uint64_t bytesWritten() const { return bytes.load(std::memory_order_relaxed); }
+    //Encoder thread time spent encoding and writing, in total
+    double encodeSeconds() const { return encodeMicroseconds.load(std::memory_order_relaxed) * 1e-6; }
+
+private:
+    enum SlotState { Free, Reading, Encoding, Encoded };
+    //-- One PBO of the ring
+    struct Slot {
+        unsigned int buffer = 0;
+        GLsync fence = nullptr;
+        uint64_t frame = 0;
+        const uint8_t* mapped = nullptr;
+        std::atomic<int> state{ Free };
+    };
+
+    bool open(CaptureFormat format, int width, int height, int latency);
+    bool mapSlot(Slot& slot);
+    void unmapEncoded();
+    void encoderLoop();
+    void encode(Slot& slot, std::vector<uint8_t>& png);
+
+    CaptureFormat format = CaptureFormat::Png;
+    std::string directory;
+    FILE* stream = nullptr;
+    bool pipe = false;
+    int frameWidth = 0;
+    int frameHeight = 0;
+    int latency = defaultCaptureLatency;
+    std::unique_ptr<Slot[]> slots;
+    int slotCount = 0;
+    int nextSlot = 0;        //issued round robin, so reads map and encode in frame order
+    int oldestSlot = 0;      //oldest read not yet mapped
+    uint64_t frame = 0;
+    std::unique_ptr<SpscRing<int>> queue;
+    std::thread encoder;
+    std::atomic<bool> stopping{ false };
+
+    uint64_t captured = 0;
+    uint64_t dropped = 0;
+    std::atomic<uint64_t> written{ 0 };
+    std::atomic<uint64_t> failed{ 0 };
+    std::atomic<uint64_t> bytes{ 0 };
+    std::atomic<uint64_t> encodeMicroseconds{ 0 };
+};
@@ -0,0 +1,122 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include "BenchStats.h"
+#include "Input.h"
+
+static const char* const pacingModeNames[] = { "uncapped", "vsync", "capped", "on-demand", "low-latency" };
+
+bool parsePacingMode(const char* name, PacingMode& mode) {
+    for (int i = 0; i < 5; i++) {
+        if (std::strcmp(name, pacingModeNames[i]) == 0) {
+            mode = (PacingMode)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* pacingModeName(PacingMode mode) {
+    return pacingModeNames[(int)mode];
+}
+
+void preciseWaitUntil(double deadline, double spinSeconds) {
+    double remaining = deadline - inputTimestamp();
+    if (remaining > spinSeconds)
+        std::this_thread::sleep_for(std::chrono::duration<double>(remaining - spinSeconds));
+    while (inputTimestamp() < deadline)
+        std::this_thread::yield();
+}
+
+FramePacer::FramePacer(const PacingOptions& options) : settings(options) {
+    startTime = inputTimestamp();
+    startCpu = processCpuSeconds();
+}
+
+int FramePacer::swapInterval() const {
+    return settings.mode == PacingMode::Uncapped || settings.mode == PacingMode::Capped ? 0 : 1;
+}
+
+double FramePacer::predictedWork() const {
+    double slowest = 0.0;
+    for (double work : workHistory)
+        slowest = std::max(slowest, work);
+    return slowest + settings.lowLatencyMarginSeconds;
+}
+
+double FramePacer::beforeInput(bool dirty) {
+    if (settings.mode == PacingMode::LowLatency) {
+        //Input is sampled as late as still makes the next refresh
+        if (nextDeadline > 0.0)
+            preciseWaitUntil(nextDeadline - predictedWork(), settings.spinSeconds);
+    }
+    eventWait = settings.mode == PacingMode::OnDemand && !dirty;
+    return eventWait ? settings.idleTimeoutSeconds : 0.0;
+}
+
+bool FramePacer::shouldDraw(bool dirty) {
+    workStart = inputTimestamp();
+    if (!eventWait)
+        return true;
+    //The next present is not paced against the last one, whether the wait ended with an event or not
+    eventWait = false;
+    lastPresent = -1.0;
+    if (!dirty) {
+        idleWaits++;
+        return false;
+    }
+    return true;
+}
+
+void FramePacer::beforePresent() {
+    lastWork = inputTimestamp() - workStart;
+    workHistory[frames % pacingWorkHistory] = lastWork;
+}
+
+void FramePacer::afterPresent() {
+    double now = inputTimestamp();
+    frames++;
+
+    if (settings.emulateVsync && swapInterval() == 1 && period() > 0.0) {
+        //Where a blocking swap would have returned: the next refresh boundary
+        double refreshes = std::ceil((now - startTime) / period());
+        preciseWaitUntil(startTime + refreshes * period(), settings.spinSeconds);
+        now = inputTimestamp();
+    }
+    if (lastPresent >= 0.0) {
+        double interval = now - lastPresent;
+        intervalSum += interval;
+        intervalSquares += interval * interval;
+        intervals++;
+    }
+    lastPresent = now;
+
+    if (settings.mode == PacingMode::Capped) {
+        //A late frame restarts the schedule instead of rushing the next ones to catch up
+        nextDeadline = std::max(nextDeadline + period(), now);
+        preciseWaitUntil(nextDeadline, settings.spinSeconds);
+    } else if (settings.mode == PacingMode::LowLatency) {
+        //The finished swap returned at a refresh
+        nextDeadline = now + period();
+    }
+}
+
+PacingReport FramePacer::report() const {
+    PacingReport result;
+    result.frames = frames;
+    result.idleWaits = idleWaits;
+    result.seconds = inputTimestamp() - startTime;
+    result.cpuUtilization = result.seconds > 0.0 ? (processCpuSeconds() - startCpu) / result.seconds : 0.0;
+    if (intervals > 0) {
+        double mean = intervalSum / (double)intervals;
+        double variance = std::max(0.0, intervalSquares / (double)intervals - mean * mean);
+        result.intervalMeanMs = mean * 1000.0;
+        result.intervalStddevMs = std::sqrt(variance) * 1000.0;
+    }
+    return result;
+}
@@ -0,0 +1,99 @@
+#pragma once
+/*Frame pacing: when the loop samples input, draws and presents.
+    uncapped    - draw again as soon as the last frame is presented (swap interval 0)
+    vsync       - let the swap block until the display refresh (swap interval 1)
+    capped      - swap interval 0, then wait for the next 1 / fps slot: sleep most of the way and spin the last
+                  spinSeconds, since a plain sleep can overshoot by a scheduler tick
+    on-demand   - like vsync while something changes on screen; with nothing dirty the loop blocks in its event
+                  wait (glfwWaitEventsTimeout) and draws nothing until an event arrives or idleTimeout passes
+    low-latency - vsync, but the wait for the refresh moves before input: the loop sleeps until the next refresh
+                  minus the predicted work (slowest of the recent frames plus a margin), then samples input and
+                  draws, so the frame makes that refresh with the input a few milliseconds old instead of a frame.
+                  The frame is finished (glFinish) before beforePresent, so the work the prediction learns from
+                  includes the GPU's, and again after the swap, so the driver queues nothing and the swap returns
+                  at the refresh, which is where the next one is predicted from (targetFps is the refresh rate).
+The work of a frame runs from shouldDraw to beforePresent, just before the swap: a vsync swap blocks until the
+refresh, and counting that wait as work would make low-latency predict a whole period and never sample late.
+The pacer only decides and waits on the clock; the loop owns the window, the event wait and the swap, so the
+same policies drive the headless benchmark.*/
+#include <cstdint>
+
+enum class PacingMode { Uncapped, Vsync, Capped, OnDemand, LowLatency };
+
+//"uncapped", "vsync", "capped", "on-demand", "low-latency"
+bool parsePacingMode(const char* name, PacingMode& mode);
+const char* pacingModeName(PacingMode mode);
+
+//-- Pacing policy and its tuning
+struct PacingOptions {
+    PacingMode mode = PacingMode::Vsync;
+    double targetFps = 60.0;              //capped rate; the refresh rate low-latency and emulated vsync assume
+    double spinSeconds = 0.002;           //end of each wait spent spinning instead of sleeping; has to cover how far a
+                                          //sleep overshoots (Windows' default 15.6 ms tick needs timeBeginPeriod(1))
+    double idleTimeoutSeconds = 0.5;      //on-demand: longest event wait with nothing dirty
+    double lowLatencyMarginSeconds = 0.001;
+    bool emulateVsync = false;            //no display (headless): swap interval 1 waits for the next 1 / fps boundary
+};
+
+//Frames whose work time low-latency predicts from
+const int pacingWorkHistory = 16;
+
+//Sleep until deadline (inputTimestamp() clock), spinning the last spinSeconds
+void preciseWaitUntil(double deadline, double spinSeconds);
+
+//-- What pacing cost and delivered so far
+struct PacingReport {
+    uint64_t frames = 0;          //presented
+    uint64_t idleWaits = 0;       //on-demand event waits that drew nothing
+    double seconds = 0.0;         //wall time since the pacer was created
+    double cpuUtilization = 0.0;  //process CPU time over wall time, 1 = one core busy
+    double intervalMeanMs = 0.0;  //present to present
+    double intervalStddevMs = 0.0;
+};
+
+class FramePacer {
+public:
+    explicit FramePacer(const PacingOptions& options);
+
+    const PacingOptions& options() const { return settings; }
+    //Value for glfwSwapInterval
+    int swapInterval() const;
+    //Whether to glFinish before beforePresent and right after the swap
+    bool finishFrames() const { return settings.mode == PacingMode::LowLatency; }
+
+    //Before sampling input. dirty = the next frame would differ from the last one presented.
+    //Low-latency sleeps here. Returns how long the loop should block waiting for events, 0 = poll only.
+    double beforeInput(bool dirty);
+    //After the event wait or poll: draw this frame? False only for on-demand when nothing became dirty during the
+    //wait (the loop skips drawing and presenting, and calls beforeInput again).
+    bool shouldDraw(bool dirty);
+    //Just before the swap: ends the frame's work
+    void beforePresent();
+    //After the swap (and the finish): capped and emulated vsync wait for the next slot here
+    void afterPresent();
+
+    //Seconds of the last presented frame from the end of the event wait to beforePresent
+    double lastWorkSeconds() const { return lastWork; }
+    //inputTimestamp() of the last present (the emulated refresh boundary when emulating vsync)
+    double lastPresentTime() const { return lastPresent; }
+    PacingReport report() const;
+
+private:
+    double period() const { return settings.targetFps > 0.0 ? 1.0 / settings.targetFps : 0.0; }
+    double predictedWork() const;
+
+    PacingOptions settings;
+    double startTime = 0.0;
+    double startCpu = 0.0;
+    double nextDeadline = 0.0;    //capped slot / low-latency refresh
+    bool eventWait = false;       //beforeInput asked for an event wait
+    double workStart = 0.0;
+    double lastWork = 0.0;
+    double workHistory[pacingWorkHistory] = {};
+    uint64_t frames = 0;
+    uint64_t idleWaits = 0;
+    double lastPresent = -1.0;
+    double intervalSum = 0.0;
+    double intervalSquares = 0.0;
+    uint64_t intervals = 0;
+};
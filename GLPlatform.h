@@ -0,0 +1,13 @@
+#pragma once
+/*Single place that pulls in the OpenGL declarations.
+The windowed Visual Studio build loads entry points through GLEW.
+The headless Linux build (OPENGLINTRO_HEADLESS) links straight against libOpenGL/EGL,
+so it uses the Khronos core profile header with prototypes enabled instead.*/
+#ifdef OPENGLINTRO_HEADLESS
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#include <GL/glcorearb.h>
+#else
+#include <GL/glew.h>
+#endif
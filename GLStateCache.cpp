@@ -0,0 +1,171 @@
+#include "GLStateCache.h"
+
+#include <cstring>
+
+#include <gtc/type_ptr.hpp>
+
+//======================REFLECTION======================
+int ProgramReflection::location(const char* name) const {
+    for (const UniformInfo& uniform : uniforms) {
+        if (uniform.name == name)
+            return uniform.location;
+    }
+    return -1;
+}
+
+ProgramReflection reflectProgram(unsigned int program) {
+    ProgramReflection reflection;
+    reflection.program = program;
+    if (program == 0)
+        return reflection;
+
+    int count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> name(maxLength > 0 ? maxLength : 1);
+    for (int i = 0; i < count; i++) {
+        UniformInfo uniform;
+        GLsizei length = 0;
+        glGetActiveUniform(program, (GLuint)i, (GLsizei)name.size(), &length, &uniform.size, &uniform.type, name.data());
+        uniform.name.assign(name.data(), length);
+        //Arrays are reported as "name[0]"
+        if (uniform.name.size() > 3 && uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0)
+            uniform.name.resize(uniform.name.size() - 3);
+        //Uniforms inside uniform blocks have no location
+        uniform.location = glGetUniformLocation(program, name.data());
+        reflection.uniforms.push_back(uniform);
+    }
+    return reflection;
+}
+
+//======================STATE CACHE======================
+void GLStateCache::invalidate() {
+    programKnown = false;
+    programShadow = -1;
+    vertexArrayKnown = false;
+    polygonModeValue = 0;
+    lineWidthValue = -1.0f;
+    clearColorKnown = false;
+    programs.clear();
+}
+
+//Count a state change as issued or skipped, returns true if it has to be issued
+bool GLStateCache::stateChanged(bool same) {
+    if (same && filtering) {
+        counters.skippedStateChanges++;
+        return false;
+    }
+    counters.stateChanges++;
+    counters.total++;
+    return true;
+}
+
+void GLStateCache::useProgram(unsigned int newProgram) {
+    if (!stateChanged(programKnown && program == newProgram))
+        return;
+    glUseProgram(newProgram);
+    programKnown = true;
+    program = newProgram;
+
+    //Find (or start) the uniform shadow of this program
+    programShadow = -1;
+    for (size_t i = 0; i < programs.size(); i++) {
+        if (programs[i].program == newProgram) {
+            programShadow = (int)i;
+            break;
+        }
+    }
+    if (programShadow < 0) {
+        programs.push_back(ProgramShadow{ newProgram, {} });
+        programShadow = (int)programs.size() - 1;
+    }
+}
+
+void GLStateCache::bindVertexArray(unsigned int newVertexArray) {
+    if (!stateChanged(vertexArrayKnown && vertexArray == newVertexArray))
+        return;
+    glBindVertexArray(newVertexArray);
+    vertexArrayKnown = true;
+    vertexArray = newVertexArray;
+}
+
+void GLStateCache::polygonMode(GLenum mode) {
+    if (!stateChanged(polygonModeValue == mode))
+        return;
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+    polygonModeValue = mode;
+}
+
+void GLStateCache::lineWidth(float width) {
+    if (!stateChanged(lineWidthValue == width))
+        return;
+    glLineWidth(width);
+    lineWidthValue = width;
+}
+
+void GLStateCache::clearColor(float red, float green, float blue, float alpha) {
+    float color[4] = { red, green, blue, alpha };
+    if (!stateChanged(clearColorKnown && std::memcmp(clearColorValue, color, sizeof(color)) == 0))
+        return;
+    glClearColor(red, green, blue, alpha);
+    std::memcpy(clearColorValue, color, sizeof(color));
+    clearColorKnown = true;
+}
+
+bool GLStateCache::uniformChanged(int location, const float* value, int components) {
+    if (location < 0)
+        return false;
+    //Without a known program the upload target is unknown too, always issue
+    UniformShadow* shadow = nullptr;
+    if (programShadow >= 0) {
+        for (UniformShadow& uniform : programs[programShadow].uniforms) {
+            if (uniform.location == location) {
+                shadow = &uniform;
+                break;
+            }
+        }
+        if (shadow == nullptr) {
+            programs[programShadow].uniforms.push_back(UniformShadow{ location, 0, {} });
+            shadow = &programs[programShadow].uniforms.back();
+        }
+        else if (filtering && shadow->components == components &&
+            std::memcmp(shadow->value, value, components * sizeof(float)) == 0) {
+            counters.skippedUniformUploads++;
+            return false;
+        }
+        shadow->components = components;
+        std::memcpy(shadow->value, value, components * sizeof(float));
+    }
+    counters.uniformUploads++;
+    counters.total++;
+    return true;
+}
+
+void GLStateCache::uniform1f(int location, float x) {
+    if (uniformChanged(location, &x, 1))
+        glUniform1f(location, x);
+}
+
+void GLStateCache::uniform2f(int location, float x, float y) {
+    float value[2] = { x, y };
+    if (uniformChanged(location, value, 2))
+        glUniform2f(location, x, y);
+}
+
+void GLStateCache::uniform3f(int location, float x, float y, float z) {
+    float value[3] = { x, y, z };
+    if (uniformChanged(location, value, 3))
+        glUniform3f(location, x, y, z);
+}
+
+void GLStateCache::uniform4f(int location, float x, float y, float z, float w) {
+    float value[4] = { x, y, z, w };
+    if (uniformChanged(location, value, 4))
+        glUniform4f(location, x, y, z, w);
+}
+
+void GLStateCache::uniformMatrix4(int location, const glm::mat4& matrix) {
+    const float* value = glm::value_ptr(matrix);
+    if (uniformChanged(location, value, 16))
+        glUniformMatrix4fv(location, 1, GL_FALSE, value);
+}
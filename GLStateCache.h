@@ -0,0 +1,99 @@
+#pragma once
+/*Thin shadow of the GL state the renderers touch.
+Every setter compares against the last value it issued and skips the GL call when nothing would change.
+Uniform values are shadowed per program and location, so a uniform is only uploaded when its value changes.
+The shadow starts out unknown (the first call of each kind is always issued). Call invalidate() after
+GL state was changed without going through the cache: renderer creation, setOutlineWidth, deleting programs.*/
+#include <string>
+#include <vector>
+
+#include "GLPlatform.h"
+
+#include <glm.hpp>
+
+//-- Running count of GL calls issued by the render code, and of the calls the state cache skipped
+struct GLCallCounters {
+    unsigned long long total = 0;          //every GL call issued
+    unsigned long long draws = 0;          //glDraw*
+    unsigned long long stateChanges = 0;   //binds, polygon mode, line width, clear state
+    unsigned long long uniformUploads = 0; //glUniform*
+    unsigned long long skippedStateChanges = 0;   //redundant, not issued
+    unsigned long long skippedUniformUploads = 0; //value unchanged, not issued
+
+    unsigned long long skipped() const { return skippedStateChanges + skippedUniformUploads; }
+    void reset() { *this = GLCallCounters(); }
+};
+
+//-- Active uniform of a linked program, from glGetActiveUniform
+struct UniformInfo {
+    std::string name;   //arrays without the "[0]"
+    int location = -1;
+    GLenum type = 0;
+    int size = 0;       //array length, 1 otherwise
+};
+
+//-- Uniforms of one program, read once after linking instead of a glGetUniformLocation per name
+struct ProgramReflection {
+    unsigned int program = 0;
+    std::vector<UniformInfo> uniforms;
+
+    //Location of the named uniform, -1 if the program has no such active uniform (same as glGetUniformLocation)
+    int location(const char* name) const;
+};
+
+ProgramReflection reflectProgram(unsigned int program);
+
+class GLStateCache {
+public:
+    GLCallCounters counters;
+    //false = pass every call through (for measuring what the cache saves)
+    bool filtering = true;
+
+    //Forget everything known about the current GL state
+    void invalidate();
+
+    void useProgram(unsigned int program);
+    void bindVertexArray(unsigned int vertexArray);
+    void polygonMode(GLenum mode); //GL_FRONT_AND_BACK
+    void lineWidth(float width);
+    void clearColor(float red, float green, float blue, float alpha);
+
+    //Uniforms of the current program (set with useProgram). Location -1 is ignored like in GL.
+    void uniform1f(int location, float x);
+    void uniform2f(int location, float x, float y);
+    void uniform3f(int location, float x, float y, float z);
+    void uniform4f(int location, float x, float y, float z, float w);
+    void uniformMatrix4(int location, const glm::mat4& matrix);
+
+    //Calls that are not state (clear, draw, fence), issued by the caller and only counted here
+    void countCalls(unsigned long long calls, unsigned long long draws = 0) {
+        counters.total += calls;
+        counters.draws += draws;
+    }
+
+private:
+    struct UniformShadow {
+        int location;
+        int components;
+        float value[16];
+    };
+    struct ProgramShadow {
+        unsigned int program;
+        std::vector<UniformShadow> uniforms;
+    };
+
+    bool stateChanged(bool same);
+    //Compare value with the shadow of location in the current program and remember it. True = upload needed.
+    bool uniformChanged(int location, const float* value, int components);
+
+    bool programKnown = false;
+    unsigned int program = 0;
+    int programShadow = -1;            //index into programs
+    bool vertexArrayKnown = false;
+    unsigned int vertexArray = 0;
+    GLenum polygonModeValue = 0;       //0 = unknown
+    float lineWidthValue = -1.0f;      //< 0 = unknown
+    bool clearColorKnown = false;
+    float clearColorValue[4] = {};
+    std::vector<ProgramShadow> programs;
+};
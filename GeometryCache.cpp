@@ -0,0 +1,297 @@
+#include "GeometryCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "JobSystem.h"
+#include "MeshImporter.h"
+#include "Utility.h"
+
+static const char* geometryPackExtension = ".gpak";
+//Source bytes per hash job; fixed so the key does not depend on the thread count
+static const size_t sourceHashChunk = 4 << 20;
+
+//======================HELPERS======================
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+//Four independent multiply lanes over 32 byte blocks, so hashing runs near memory speed (FNV goes byte by byte)
+static uint64_t hashChunk(const char* data, size_t length) {
+    uint64_t lanes[4] = { 0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull, 0x27d4eb2f165667c5ull };
+    size_t blocks = length / 32;
+    for (size_t block = 0; block < blocks; block++) {
+        uint64_t words[4];
+        std::memcpy(words, data + block * 32, sizeof(words));
+        for (int lane = 0; lane < 4; lane++) {
+            uint64_t x = (lanes[lane] ^ words[lane]) * 0x9fb21c651e98df25ull;
+            lanes[lane] = (x << 31) | (x >> 33);
+        }
+    }
+    uint64_t hash = hashBytes(14695981039346656037ull, data + blocks * 32, length - blocks * 32);
+    for (int lane = 0; lane < 4; lane++)
+        hash = mixHash(hash ^ lanes[lane]);
+    return hash;
+}
+
+static bool fileExists(const char* path) {
+    FILE* file = std::fopen(path, "rb");
+    if (file == nullptr)
+        return false;
+    std::fclose(file);
+    return true;
+}
+
+//======================PACK======================
+bool GeometryPack::open(const char* path, uint64_t expectedKey) {
+    close();
+    //A miss is the normal case, keep MappedFile from reporting it
+    if (!fileExists(path) || !file.open(path))
+        return false;
+
+    const char* data = file.data();
+    size_t size = file.size();
+    const GeometryPackHeader* candidate = (const GeometryPackHeader*)data;
+    bool valid = size >= sizeof(GeometryPackHeader) &&
+        std::memcmp(candidate->magic, geometryPackMagic, sizeof(candidate->magic)) == 0 &&
+        candidate->version == geometryPackVersion && candidate->fileSize == size &&
+        (expectedKey == 0 || candidate->sourceKey == expectedKey) &&
+        candidate->tocOffset % 8 == 0 && candidate->tocOffset <= size &&
+        candidate->meshCount <= (size - candidate->tocOffset) / sizeof(GeometryPackEntry);
+    if (valid) {
+        const GeometryPackEntry* toc = (const GeometryPackEntry*)(data + candidate->tocOffset);
+        for (uint32_t i = 0; i < candidate->meshCount && valid; i++) {
+            const GeometryPackEntry& entry = toc[i];
+            VertexFormat format;
+            valid = vertexFormatFromCode(entry.vertexFormat, format) && entry.vertexStride == format.stride &&
+                (entry.indexSize == 4 || (entry.indexSize == 2 && entry.vertexCount <= 65536)) &&
+                entry.vertexCount <= size / format.stride && entry.vertexBytes == entry.vertexCount * format.stride &&
+                entry.vertexOffset <= size && entry.vertexBytes <= size - entry.vertexOffset &&
+                entry.indexCount <= size / entry.indexSize && entry.indexBytes == entry.indexCount * entry.indexSize &&
+                entry.indexOffset <= size && entry.indexBytes <= size - entry.indexOffset;
+        }
+        entries = toc;
+    }
+    if (!valid) {
+        close();
+        return false;
+    }
+    header = candidate;
+    return true;
+}
+
+void GeometryPack::close() {
+    file.close();
+    header = nullptr;
+    entries = nullptr;
+}
+
+PackedMesh GeometryPack::mesh(size_t index) const {
+    PackedMesh mesh;
+    if (header == nullptr || index >= header->meshCount)
+        return mesh;
+    const GeometryPackEntry& entry = entries[index];
+    const char* data = file.data();
+    mesh.vertices = data + entry.vertexOffset;
+    mesh.vertexCount = (size_t)entry.vertexCount;
+    mesh.vertexBytes = (size_t)entry.vertexBytes;
+    vertexFormatFromCode(entry.vertexFormat, mesh.format);
+    mesh.indices = data + entry.indexOffset;
+    mesh.indexCount = (size_t)entry.indexCount;
+    mesh.indexBytes = (size_t)entry.indexBytes;
+    mesh.indexSize = entry.indexSize;
+    mesh.boundsMin = glm::vec3(entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2]);
+    mesh.boundsMax = glm::vec3(entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2]);
+    mesh.positionDecode = positionDecodeTransform(mesh.format.position, mesh.boundsMin, mesh.boundsMax);
+    return mesh;
+}
+
+//======================WRITING======================
+uint64_t geometrySourceKey(const char* data, size_t length, JobSystem* jobs) {
+    size_t chunkCount = (length + sourceHashChunk - 1) / sourceHashChunk;
+    std::vector<uint64_t> chunkHashes(chunkCount);
+    auto hashChunks = [&](size_t begin, size_t end, int) {
+        for (size_t chunk = begin; chunk < end; chunk++) {
+            size_t first = chunk * sourceHashChunk;
+            size_t bytes = length - first < sourceHashChunk ? length - first : sourceHashChunk;
+            chunkHashes[chunk] = hashChunk(data + first, bytes);
+        }
+    };
+    if (jobs != nullptr && chunkCount > 1) {
+        JobCounter done;
+        jobs->parallelFor(chunkCount, 1, hashChunks, done);
+        jobs->wait(done);
+    } else {
+        hashChunks(0, chunkCount, 0);
+    }
+
+    //The version is part of the key, a format change never opens an old pack
+    uint64_t key = 14695981039346656037ull;
+    key = hashBytes(key, &geometryPackVersion, sizeof(geometryPackVersion));
+    uint64_t length64 = length;
+    key = hashBytes(key, &length64, sizeof(length64));
+    key = hashBytes(key, chunkHashes.data(), chunkHashes.size() * sizeof(uint64_t));
+    //0 means "any key" to GeometryPack::open
+    return key != 0 ? key : 1;
+}
+
+std::string geometryPackPath(const std::string& directory, uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+    return directory + "/" + name + geometryPackExtension;
+}
+
+//Zero bytes up to the next multiple of geometryPackAlignment
+static bool writePadding(FILE* file, uint64_t& offset) {
+    static const char zeros[geometryPackAlignment] = {};
+    uint64_t padding = alignUp(offset, geometryPackAlignment) - offset;
+    offset += padding;
+    return padding == 0 || std::fwrite(zeros, 1, (size_t)padding, file) == padding;
+}
+
+//Encode through a small staging buffer instead of building the whole blob
+static bool writeVertices(FILE* file, const MeshData& mesh, const VertexFormat& format) {
+    const size_t batch = 16384;
+    std::vector<unsigned char> staging(batch * format.stride);
+    size_t vertexCount = mesh.vertexCount();
+    for (size_t first = 0; first < vertexCount; first += batch) {
+        size_t count = vertexCount - first < batch ? vertexCount - first : batch;
+        encodeVertices(format, &mesh.positions[first * 3], mesh.normals.empty() ? nullptr : &mesh.normals[first * 3],
+            nullptr, count, mesh.boundsMin, mesh.boundsMax, staging.data());
+        if (std::fwrite(staging.data(), format.stride, count, file) != count)
+            return false;
+    }
+    return true;
+}
+
+static bool writeIndexBlob(FILE* file, const MeshData& mesh, unsigned int indexSize) {
+    if (indexSize == sizeof(unsigned int))
+        return mesh.indices.empty() || std::fwrite(mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int), 1, file) == 1;
+    std::vector<uint16_t> narrow(mesh.indices.size());
+    writeIndices(mesh.indices.data(), mesh.indices.size(), indexSize, narrow.data());
+    return narrow.empty() || std::fwrite(narrow.data(), narrow.size() * sizeof(uint16_t), 1, file) == 1;
+}
+
+bool writeGeometryPack(const std::string& path, const MeshData* meshes, size_t meshCount, uint64_t sourceKey,
+    PositionEncoding position, NormalEncoding normal) {
+    GeometryPackHeader header = {};
+    std::memcpy(header.magic, geometryPackMagic, sizeof(header.magic));
+    header.version = geometryPackVersion;
+    header.meshCount = (uint32_t)meshCount;
+    header.sourceKey = sourceKey;
+    header.tocOffset = sizeof(GeometryPackHeader);
+
+    //Lay the blobs out first, the table of contents sits in front of them
+    std::vector<GeometryPackEntry> toc(meshCount);
+    std::vector<VertexFormat> formats(meshCount);
+    uint64_t offset = header.tocOffset + meshCount * sizeof(GeometryPackEntry);
+    for (size_t i = 0; i < meshCount; i++) {
+        const MeshData& mesh = meshes[i];
+        GeometryPackEntry& entry = toc[i];
+        formats[i] = makeVertexFormat(position, mesh.normals.empty() ? NormalEncoding::None : normal);
+        entry.vertexFormat = vertexFormatCode(formats[i]);
+        entry.vertexStride = formats[i].stride;
+        entry.indexSize = indexSizeFor(mesh.vertexCount());
+        entry.vertexCount = mesh.vertexCount();
+        entry.vertexOffset = alignUp(offset, geometryPackAlignment);
+        entry.vertexBytes = entry.vertexCount * entry.vertexStride;
+        entry.indexCount = mesh.indices.size();
+        entry.indexOffset = alignUp(entry.vertexOffset + entry.vertexBytes, geometryPackAlignment);
+        entry.indexBytes = entry.indexCount * entry.indexSize;
+        for (int axis = 0; axis < 3; axis++) {
+            entry.boundsMin[axis] = mesh.boundsMin[axis];
+            entry.boundsMax[axis] = mesh.boundsMax[axis];
+        }
+        offset = entry.indexOffset + entry.indexBytes;
+    }
+    header.fileSize = offset;
+
+    //Write to a temporary name first so a crash never leaves a truncated pack under the real name
+    std::string temporary = path + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        std::cerr << "Error creating " << temporary << std::endl;
+        return false;
+    }
+    offset = 0;
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+        (meshCount == 0 || std::fwrite(toc.data(), sizeof(GeometryPackEntry), meshCount, file) == meshCount);
+    offset = header.tocOffset + meshCount * sizeof(GeometryPackEntry);
+    for (size_t i = 0; i < meshCount && written; i++) {
+        const MeshData& mesh = meshes[i];
+        written = writePadding(file, offset) && writeVertices(file, mesh, formats[i]);
+        offset += toc[i].vertexBytes;
+        written = written && writePadding(file, offset) && writeIndexBlob(file, mesh, toc[i].indexSize);
+        offset += toc[i].indexBytes;
+    }
+    written = std::fclose(file) == 0 && written;
+    std::remove(path.c_str());
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error writing geometry pack " << path << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+//======================CACHE======================
+bool loadCachedGeometry(const char* sourcePath, const std::string& directory, GeometryPack& pack,
+    JobSystem* jobs, GeometryCacheStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    GeometryCacheStats local;
+    GeometryCacheStats& result = stats != nullptr ? *stats : local;
+    result = GeometryCacheStats();
+    pack.close();
+
+    uint64_t key = 0;
+    {
+        MappedFile source;
+        if (!source.open(sourcePath))
+            return false;
+        result.sourceBytes = source.size();
+        key = geometrySourceKey(source.data(), source.size(), jobs);
+    }
+    result.hashMs = millisecondsSince(start);
+
+    std::string path = geometryPackPath(directory, key);
+    auto opening = std::chrono::steady_clock::now();
+    if (pack.open(path.c_str(), key)) {
+        result.hit = true;
+        result.openMs = millisecondsSince(opening);
+        result.packBytes = pack.fileSize();
+        result.totalMs = millisecondsSince(start);
+        return true;
+    }
+
+    auto importing = std::chrono::steady_clock::now();
+    MeshData mesh;
+    if (!importMesh(sourcePath, mesh, jobs))
+        return false;
+    result.importMs = millisecondsSince(importing);
+
+    auto optimizing = std::chrono::steady_clock::now();
+    optimizeMesh(mesh, &result.optimize);
+    result.optimizeMs = millisecondsSince(optimizing);
+
+    auto writing = std::chrono::steady_clock::now();
+    if (!makeDirectory(directory)) {
+        std::cerr << "Error creating geometry cache directory " << directory << std::endl;
+        return false;
+    }
+    if (!writeGeometryPack(path, &mesh, 1, key))
+        return false;
+    result.writeMs = millisecondsSince(writing);
+
+    opening = std::chrono::steady_clock::now();
+    if (!pack.open(path.c_str(), key)) {
+        std::cerr << "Error reading back geometry pack " << path << std::endl;
+        return false;
+    }
+    result.openMs = millisecondsSince(opening);
+    result.packBytes = pack.fileSize();
+    result.totalMs = millisecondsSince(start);
+    return true;
+}
@@ -0,0 +1,112 @@
+#pragma once
+/*On-disk cache of imported meshes ("geometry packs").
+A pack is the importer's output, reordered by MeshOptimizer.h and baked for upload: a header, a table of contents with one entry per mesh, then
+per mesh an interleaved vertex blob in a quantized VertexFormat.h layout and an index blob (16 bit when the vertex
+count allows), each starting on a 4 KB boundary. GeometryPack maps the file and hands out pointers into the mapping, so the pages go straight to
+glBufferData (uploadPackedMesh in Renderer.h) without being read into a buffer first.
+Packs are named after a 64 bit key hashed from the source file's contents and the pack version, so editing the
+source or changing the format simply misses and the source is imported again.*/
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <glm.hpp>
+
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "VertexFormat.h"
+
+class JobSystem;
+struct MeshData;
+
+//-- Start of a pack file
+struct GeometryPackHeader {
+    char magic[8];          //"OGLGPAK"
+    uint32_t version;
+    uint32_t meshCount;
+    uint64_t sourceKey;     //geometrySourceKey of the file it was built from
+    uint64_t fileSize;      //guards against truncated files
+    uint64_t tocOffset;     //GeometryPackEntry array
+};
+
+//-- Table of contents entry, offsets from the start of the file
+struct GeometryPackEntry {
+    uint32_t vertexFormat;  //vertexFormatCode
+    uint32_t vertexStride;  //bytes
+    uint32_t indexSize;     //bytes per index
+    uint32_t reserved;
+    uint64_t vertexCount;
+    uint64_t vertexOffset;
+    uint64_t vertexBytes;
+    uint64_t indexCount;
+    uint64_t indexOffset;
+    uint64_t indexBytes;
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+const char geometryPackMagic[8] = { 'O', 'G', 'L', 'G', 'P', 'A', 'K', '\0' };
+const uint32_t geometryPackVersion = 3;   //2: optimized order (MeshOptimizer.h), 3: quantized vertices, 16 bit indices
+const uint64_t geometryPackAlignment = 4096;
+
+//-- One mesh of an open pack; the pointers are into the mapping and valid until the pack is closed
+struct PackedMesh {
+    const void* vertices = nullptr;
+    size_t vertexCount = 0;
+    size_t vertexBytes = 0;
+    VertexFormat format;
+    const void* indices = nullptr;
+    size_t indexCount = 0;
+    size_t indexBytes = 0;
+    unsigned int indexSize = 4;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    glm::mat4 positionDecode = glm::mat4(1.0f);  //model matrix for the stored positions (positionDecodeTransform)
+};
+
+class GeometryPack {
+public:
+    //Map and validate path. expectedKey != 0 also requires the pack to be built from that source.
+    //Returns false without printing when the file is missing or does not match.
+    bool open(const char* path, uint64_t expectedKey = 0);
+    void close();
+
+    bool isOpen() const { return header != nullptr; }
+    size_t meshCount() const { return header != nullptr ? header->meshCount : 0; }
+    PackedMesh mesh(size_t index) const;
+    uint64_t sourceKey() const { return header != nullptr ? header->sourceKey : 0; }
+    size_t fileSize() const { return file.size(); }
+
+private:
+    MappedFile file;
+    const GeometryPackHeader* header = nullptr;
+    const GeometryPackEntry* entries = nullptr;
+};
+
+//Key of a source file's contents (hashed in parallel chunks on jobs when given)
+uint64_t geometrySourceKey(const char* data, size_t length, JobSystem* jobs = nullptr);
+//Where the pack for key lives in directory
+std::string geometryPackPath(const std::string& directory, uint64_t key);
+//Encode meshes and write them as a pack (temporary file, then renamed over path). Meshes without normals
+//store none; indices take indexSizeFor(vertex count) bytes.
+bool writeGeometryPack(const std::string& path, const MeshData* meshes, size_t meshCount, uint64_t sourceKey,
+    PositionEncoding position = PositionEncoding::Snorm16, NormalEncoding normal = NormalEncoding::Octahedral);
+
+//-- What loadCachedGeometry did
+struct GeometryCacheStats {
+    bool hit = false;
+    uint64_t sourceBytes = 0;
+    uint64_t packBytes = 0;
+    double hashMs = 0.0;
+    double importMs = 0.0;   //miss only
+    double optimizeMs = 0.0; //miss only
+    double writeMs = 0.0;    //miss only
+    double openMs = 0.0;
+    double totalMs = 0.0;
+    MeshOptimizeStats optimize;  //miss only
+};
+
+//Open the pack for sourcePath from directory, importing and optimizing the source and writing the pack first
+//if there is none for its current contents. The directory is created if missing.
+bool loadCachedGeometry(const char* sourcePath, const std::string& directory, GeometryPack& pack,
+    JobSystem* jobs = nullptr, GeometryCacheStats* stats = nullptr);
@@ -0,0 +1,129 @@
+#include "HeadlessContext.h"
+
+#include <iostream>
+#include <string>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+//Prefer the Mesa surfaceless platform, it needs neither X11 nor a render node
+static EGLDisplay openDisplay() {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay != nullptr) {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display != EGL_NO_DISPLAY)
+            return display;
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+bool createHeadlessContext(HeadlessContext& ctx, int width, int height, int major, int minor) {
+    EGLDisplay display = openDisplay();
+    EGLint eglMajor = 0, eglMinor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor)) {
+        std::cerr << "Failed to initialize EGL." << std::endl;
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "EGL has no desktop OpenGL support." << std::endl;
+        eglTerminate(display);
+        return false;
+    }
+
+    //Same hints the window uses: core profile, requested version
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, major,
+        EGL_CONTEXT_MINOR_VERSION, minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    //Surfaceless first, fall back to a 1x1 pbuffer when the driver lacks it
+    EGLConfig config = nullptr;
+    EGLSurface surface = EGL_NO_SURFACE;
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    bool surfaceless = extensions != nullptr &&
+        std::string(extensions).find("EGL_KHR_surfaceless_context") != std::string::npos;
+    if (!surfaceless) {
+        const EGLint configAttribs[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLint count = 0;
+        if (!eglChooseConfig(display, configAttribs, &config, 1, &count) || count == 0) {
+            std::cerr << "No EGL pbuffer config available." << std::endl;
+            eglTerminate(display);
+            return false;
+        }
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+    }
+
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "Failed to create a GL " << major << "." << minor << " core context (EGL error 0x"
+            << std::hex << eglGetError() << std::dec << ")." << std::endl;
+        eglTerminate(display);
+        return false;
+    }
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        std::cerr << "Failed to make the EGL context current." << std::endl;
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        return false;
+    }
+
+    ctx.display = display;
+    ctx.context = context;
+    ctx.surface = surface;
+    ctx.width = width;
+    ctx.height = height;
+
+    //======================FRAMEBUFFER======================
+    //Color and depth attachments the size of the window
+    glGenRenderbuffers(1, &ctx.colorRBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, ctx.colorRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &ctx.depthRBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, ctx.depthRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    glGenFramebuffers(1, &ctx.FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, ctx.FBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ctx.colorRBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, ctx.depthRBO);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Offscreen framebuffer is incomplete." << std::endl;
+        destroyHeadlessContext(ctx);
+        return false;
+    }
+    glViewport(0, 0, width, height);
+    return true;
+}
+
+void destroyHeadlessContext(HeadlessContext& ctx) {
+    if (ctx.display == nullptr)
+        return;
+    EGLDisplay display = (EGLDisplay)ctx.display;
+    if (ctx.FBO != 0) {
+        glDeleteFramebuffers(1, &ctx.FBO);
+        glDeleteRenderbuffers(1, &ctx.colorRBO);
+        glDeleteRenderbuffers(1, &ctx.depthRBO);
+    }
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (ctx.surface != nullptr)
+        eglDestroySurface(display, (EGLSurface)ctx.surface);
+    eglDestroyContext(display, (EGLContext)ctx.context);
+    eglTerminate(display);
+    ctx = HeadlessContext();
+}
+
+void* headlessProcAddress(const char* name) {
+    return (void*)eglGetProcAddress(name);
+}
@@ -0,0 +1,22 @@
+#pragma once
+//Offscreen GL context for machines without a display or GPU (EGL surfaceless, Mesa llvmpipe works).
+//Rendering goes into a framebuffer object that stands in for the window's back buffer.
+#include "GLPlatform.h"
+
+struct HeadlessContext {
+    void* display = nullptr;   //EGLDisplay
+    void* context = nullptr;   //EGLContext
+    void* surface = nullptr;   //EGLSurface, only used when surfaceless contexts are unavailable
+    unsigned int FBO = 0;
+    unsigned int colorRBO = 0;
+    unsigned int depthRBO = 0;
+    int width = 0;
+    int height = 0;
+};
+
+//Create a core profile context of at least the requested version and bind a width*height FBO with depth
+bool createHeadlessContext(HeadlessContext& ctx, int width, int height, int major = 3, int minor = 3);
+void destroyHeadlessContext(HeadlessContext& ctx);
+
+//Equivalent of glfwGetProcAddress for the headless context
+void* headlessProcAddress(const char* name);
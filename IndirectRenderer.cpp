@@ -0,0 +1,305 @@
+#include "IndirectRenderer.h"
+#include "Profiler.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+static_assert(sizeof(InstanceData) == 68, "instance layout, std430 Instance in indirectCullShaderSource");
+static_assert(sizeof(IndirectObject) == 80, "object layout, std430 Object in indirectCullShaderSource");
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "GL draw command layout");
+
+uint32_t IndirectGeometry::addMesh(const float* meshPositions, size_t vertexCount, const unsigned int* meshIndices,
+    size_t indexCount) {
+    IndirectMesh mesh;
+    mesh.firstIndex = (uint32_t)indices.size();
+    mesh.indexCount = (uint32_t)indexCount;
+    mesh.baseVertex = (int32_t)(positions.size() / 3);
+    mesh.vertexCount = (uint32_t)vertexCount;
+    float radiusSquared = 0.0f;
+    for (size_t i = 0; i < vertexCount; i++) {
+        const float* p = meshPositions + i * 3;
+        radiusSquared = std::max(radiusSquared, p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+    }
+    mesh.boundingRadius = std::sqrt(radiusSquared);
+    positions.insert(positions.end(), meshPositions, meshPositions + vertexCount * 3);
+    indices.insert(indices.end(), meshIndices, meshIndices + indexCount);
+    meshes.push_back(mesh);
+    return (uint32_t)(meshes.size() - 1);
+}
+
+uint32_t IndirectGeometry::addMeshLevel(uint32_t mesh, const unsigned int* meshIndices, size_t indexCount) {
+    IndirectMesh level = meshes[mesh];
+    level.firstIndex = (uint32_t)indices.size();
+    level.indexCount = (uint32_t)indexCount;
+    indices.insert(indices.end(), meshIndices, meshIndices + indexCount);
+    meshes.push_back(level);
+    return (uint32_t)(meshes.size() - 1);
+}
+
+bool isIndirectRenderingSupported() {
+    return hasGLVersion(4, 3);
+}
+
+bool createIndirectRenderer(IndirectRenderer& renderer, const IndirectGeometry& geometry, size_t capacity,
+    bool singlePassOutline) {
+    if (!isIndirectRenderingSupported()) {
+        std::cerr << "GPU culling needs GL 4.3 (compute shaders and multi draw indirect)." << std::endl;
+        return false;
+    }
+    if (geometry.meshes.empty() || geometry.meshes.size() > (size_t)indirectMaxMeshes) {
+        std::cerr << "GPU culling takes 1 to " << indirectMaxMeshes << " meshes, got " << geometry.meshes.size() << std::endl;
+        return false;
+    }
+
+    //======================PROGRAMS======================
+    //Same programs as the instanced renderer, the instance buffer has the same layout
+    PendingProgram pendingProgram = beginShaderProgram(instancedVertexShaderSource, instancedFragmentShaderSource);
+    PendingProgram pendingOutline;
+    if (singlePassOutline)
+        pendingOutline = beginOutlineProgram(instancedVertexShaderSource);
+    renderer.cullProgram = compileComputeProgram(indirectCullShaderSource);
+    renderer.shaderProgram = finishShaderProgram(pendingProgram);
+    bool outlineBuilt = singlePassOutline && finishOutlineProgram(renderer.outline, pendingOutline);
+    if (renderer.cullProgram == 0 || renderer.shaderProgram == 0) {
+        destroyIndirectRenderer(renderer);
+        return false;
+    }
+    ProgramReflection cull = reflectProgram(renderer.cullProgram);
+    renderer.cullTransformLoc = cull.location("transform");
+    renderer.cullObjectCountLoc = cull.location("objectCount");
+    renderer.cullMeshCountLoc = cull.location("meshCount");
+    ProgramReflection reflection = reflectProgram(renderer.shaderProgram);
+    renderer.transformLoc = reflection.location("transform");
+    renderer.colorOverrideLoc = reflection.location("colorOverride");
+    renderer.singlePassOutline = singlePassOutline;
+    if (singlePassOutline && !outlineBuilt) {
+        std::cerr << "Single pass outline unavailable, drawing the outline in a second pass." << std::endl;
+        renderer.singlePassOutline = false;
+    }
+
+    //======================BUFFERS======================
+    renderer.meshes = geometry.meshes;
+    renderer.capacity = capacity;
+    renderer.objectCount = 0;
+    renderer.emptyCommands.clear();
+    for (const IndirectMesh& mesh : renderer.meshes)
+        renderer.emptyCommands.push_back(DrawElementsIndirectCommand{ mesh.indexCount, 0, mesh.firstIndex, mesh.baseVertex, 0 });
+    renderer.commands = renderer.emptyCommands;
+    renderer.instances.resize(capacity);
+    renderer.visible.resize(capacity);
+
+    glGenVertexArrays(1, &renderer.VAO);
+    glBindVertexArray(renderer.VAO);
+    glGenBuffers(1, &renderer.VBO);
+    glGenBuffers(1, &renderer.EBO);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.VBO);
+    glBufferData(GL_ARRAY_BUFFER, geometry.positions.size() * sizeof(float), geometry.positions.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, geometry.indices.size() * sizeof(unsigned int), geometry.indices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    //Written by the cull pass (or uploaded by the CPU fallback), read as instance attributes
+    glGenBuffers(1, &renderer.instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, std::max<size_t>(1, capacity) * sizeof(InstanceData), nullptr, GL_DYNAMIC_COPY);
+    setInstanceAttributes(renderer.instanceBuffer);
+    glBindVertexArray(0);
+
+    glGenBuffers(1, &renderer.objectBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, renderer.objectBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(1, capacity) * sizeof(IndirectObject), nullptr, GL_DYNAMIC_DRAW);
+    glGenBuffers(1, &renderer.visibleBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, renderer.visibleBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(1, capacity) * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+    glGenBuffers(1, &renderer.commandBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, renderer.commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, renderer.emptyCommands.size() * sizeof(DrawElementsIndirectCommand),
+        renderer.emptyCommands.data(), GL_DYNAMIC_DRAW);
+    return true;
+}
+
+void destroyIndirectRenderer(IndirectRenderer& renderer) {
+    glDeleteVertexArrays(1, &renderer.VAO);
+    unsigned int buffers[] = { renderer.VBO, renderer.EBO, renderer.objectBuffer, renderer.instanceBuffer,
+        renderer.visibleBuffer, renderer.commandBuffer };
+    glDeleteBuffers(6, buffers);
+    if (renderer.cullProgram != 0)
+        glDeleteProgram(renderer.cullProgram);
+    if (renderer.shaderProgram != 0)
+        glDeleteProgram(renderer.shaderProgram);
+    destroyOutlineProgram(renderer.outline);
+    renderer = IndirectRenderer();
+}
+
+bool setIndirectObjects(IndirectRenderer& renderer, const IndirectObject* objects, size_t count) {
+    if (count > renderer.capacity) {
+        std::cerr << "GPU culling: " << count << " objects, room for " << renderer.capacity << std::endl;
+        return false;
+    }
+    //Instance slots: each mesh's range follows the previous one's and holds all of its objects
+    std::vector<uint32_t> perMesh(renderer.meshes.size(), 0);
+    for (size_t i = 0; i < count; i++) {
+        if (objects[i].mesh >= renderer.meshes.size()) {
+            std::cerr << "GPU culling: object " << i << " uses mesh " << objects[i].mesh << " of "
+                << renderer.meshes.size() << std::endl;
+            return false;
+        }
+        perMesh[objects[i].mesh]++;
+    }
+    uint32_t base = 0;
+    for (size_t mesh = 0; mesh < renderer.meshes.size(); mesh++) {
+        renderer.emptyCommands[mesh].baseInstance = base;
+        base += perMesh[mesh];
+    }
+    if (objects != renderer.objects.data())
+        renderer.objects.assign(objects, objects + count);
+    renderer.objectCount = count;
+    renderer.objectsUploaded = false;
+    return true;
+}
+
+void updateIndirectInstances(IndirectRenderer& renderer, size_t count, float time) {
+    count = std::min(count, renderer.capacity);
+    writeInstances(renderer.instances.data(), 0, count, count, time);
+    renderer.objects.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        renderer.objects[i].instance = renderer.instances[i];
+        renderer.objects[i].mesh = 0;
+        renderer.objects[i].radius = renderer.meshes[0].boundingRadius;
+        renderer.objects[i].reserved = 0;
+    }
+    setIndirectObjects(renderer, renderer.objects.data(), count);
+}
+
+//Same test and compaction as indirectCullShaderSource, in object order
+static void cullOnCpu(IndirectRenderer& renderer, const glm::mat4& transform) {
+    renderer.commands = renderer.emptyCommands;
+    for (size_t i = 0; i < renderer.objectCount; i++) {
+        const IndirectObject& object = renderer.objects[i];
+        if (!isIndirectObjectInClip(transform, object))
+            continue;
+        DrawElementsIndirectCommand& command = renderer.commands[object.mesh];
+        uint32_t slot = command.baseInstance + command.instanceCount++;
+        renderer.instances[slot] = object.instance;
+        renderer.visible[slot] = (uint32_t)i;
+    }
+
+    //One upload per mesh of its visible instances, then the counts
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.instanceBuffer);
+    for (const DrawElementsIndirectCommand& command : renderer.commands) {
+        if (command.instanceCount > 0)
+            glBufferSubData(GL_ARRAY_BUFFER, command.baseInstance * sizeof(InstanceData),
+                command.instanceCount * sizeof(InstanceData), &renderer.instances[command.baseInstance]);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, renderer.commandBuffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, renderer.commands.size() * sizeof(DrawElementsIndirectCommand),
+        renderer.commands.data());
+}
+
+void cullIndirectObjects(IndirectRenderer& renderer, const glm::mat4& transform, GLStateCache& state) {
+    PROFILE_PASS("cull");
+    if (renderer.culling == IndirectCulling::Cpu) {
+        cullOnCpu(renderer, transform);
+        state.countCalls(3 + renderer.meshes.size());
+        return;
+    }
+
+    if (!renderer.objectsUploaded) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, renderer.objectBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, renderer.objectCount * sizeof(IndirectObject), renderer.objects.data());
+        renderer.objectsUploaded = true;
+        state.countCalls(2);
+    }
+    //Counts back to zero, then one invocation per object
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, renderer.commandBuffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, renderer.emptyCommands.size() * sizeof(DrawElementsIndirectCommand),
+        renderer.emptyCommands.data());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, renderer.objectBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, renderer.instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, renderer.visibleBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, renderer.commandBuffer);
+    state.useProgram(renderer.cullProgram);
+    state.uniformMatrix4(renderer.cullTransformLoc, transform);
+    glUniform1ui(renderer.cullObjectCountLoc, (unsigned int)renderer.objectCount);
+    glUniform1ui(renderer.cullMeshCountLoc, (unsigned int)renderer.meshes.size());
+    GLuint groups = (GLuint)((renderer.objectCount + indirectCullGroupSize - 1) / indirectCullGroupSize);
+    if (groups > 0)
+        glDispatchCompute(groups, 1, 1);
+    //The draw reads the commands and the instances the shader wrote
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    state.countCalls(10);
+}
+
+void renderIndirectFrame(IndirectRenderer& renderer, const glm::mat4& transform, GLStateCache& state) {
+    //Clear screen and set color
+    {
+        PROFILE_PASS("clear");
+        state.clearColor(0.2f, 0.3f, 0.3f, 0.1f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        state.countCalls(1);
+    }
+    cullIndirectObjects(renderer, transform, state);
+
+    //Bound here since the CPU cull leaves another buffer on the target
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, renderer.commandBuffer);
+    state.countCalls(1);
+    GLsizei drawCount = (GLsizei)renderer.meshes.size();
+    if (renderer.singlePassOutline) {
+        //Every visible object filled with its color and outlined in black by one call
+        PROFILE_PASS("draw fill+outline");
+        state.useProgram(renderer.outline.program);
+        state.uniformMatrix4(renderer.outline.transformLoc, transform);
+        state.bindVertexArray(renderer.VAO);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, drawCount, 0);
+        state.countCalls(1, 1);
+        return;
+    }
+
+    state.useProgram(renderer.shaderProgram);
+    state.uniformMatrix4(renderer.transformLoc, transform);
+    state.bindVertexArray(renderer.VAO);
+    {
+        //Filled with each object's color
+        PROFILE_PASS("draw fill");
+        state.polygonMode(GL_FILL);
+        state.uniform4f(renderer.colorOverrideLoc, 0.0f, 0.0f, 0.0f, 0.0f);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, drawCount, 0);
+        state.countCalls(1, 1);
+    }
+    {
+        //Outlines in black
+        PROFILE_PASS("draw outline");
+        state.polygonMode(GL_LINE);
+        state.lineWidth(3.0f);
+        state.uniform4f(renderer.colorOverrideLoc, 0.0f, 0.0f, 0.0f, 1.0f);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, drawCount, 0);
+        state.countCalls(1, 1);
+    }
+
+    // Restore polygon mode to fill.
+    state.polygonMode(GL_FILL);
+}
+
+void readIndirectVisibleSet(const IndirectRenderer& renderer, std::vector<std::vector<uint32_t>>& visibleByMesh) {
+    std::vector<DrawElementsIndirectCommand> commands = renderer.commands;
+    const uint32_t* visible = renderer.visible.data();
+    std::vector<uint32_t> readBack;
+    if (renderer.culling == IndirectCulling::Gpu) {
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, renderer.commandBuffer);
+        glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+        readBack.resize(std::max<size_t>(1, renderer.objectCount));
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, renderer.visibleBuffer);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, renderer.objectCount * sizeof(uint32_t), readBack.data());
+        visible = readBack.data();
+    }
+    visibleByMesh.assign(commands.size(), std::vector<uint32_t>());
+    for (size_t mesh = 0; mesh < commands.size(); mesh++) {
+        const uint32_t* first = visible + commands[mesh].baseInstance;
+        visibleByMesh[mesh].assign(first, first + commands[mesh].instanceCount);
+        std::sort(visibleByMesh[mesh].begin(), visibleByMesh[mesh].end());
+    }
+}
@@ -0,0 +1,147 @@
+#pragma once
+/*GPU driven culling and submission (GL 4.3).
+Every mesh lives in one merged VBO/EBO at its own first index and base vertex. Objects (model matrix, color, mesh,
+bounding radius) sit in a shader storage buffer. Each frame a compute shader tests every object's bounding sphere
+against the clip volume, exactly like isSphereInClip, and compacts the survivors per mesh into an instance buffer
+laid out like InstanceData, counting them into one DrawElementsIndirectCommand per mesh. The whole frame is then a
+single glMultiDrawElementsIndirect, one command per mesh, with the instanced renderer's shaders: no per object work
+on the CPU at all.
+The CPU fallback runs the same test in the same float operation order on the render thread and uploads the
+compacted instances and commands itself, so both produce the same visible set and the same draw.*/
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "GLPlatform.h"
+#include "InstancedRenderer.h"
+#include "Renderer.h"
+
+#include <glm.hpp>
+
+//Workgroup size of the culling shader, and the most meshes one renderer can hold (one shared counter each)
+const int indirectCullGroupSize = 64;
+const int indirectMaxMeshes = 256;
+
+enum class IndirectCulling {
+    Gpu,  //compute shader, nothing read back
+    Cpu   //same test on the render thread, results uploaded
+};
+
+//-- One object in the object buffer, std430 layout (80 bytes)
+struct IndirectObject {
+    InstanceData instance;  //model matrix and color, copied to the instance buffer when visible
+    uint32_t mesh;          //index into the renderer's meshes
+    float radius;           //bounding sphere around the model origin, model units
+    uint32_t reserved;
+};
+
+//-- GL's DrawElementsIndirectCommand
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+//-- Where a mesh sits in the merged buffers
+struct IndirectMesh {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t baseVertex = 0;
+    uint32_t vertexCount = 0;
+    float boundingRadius = 0.0f;  //farthest vertex from the model origin
+};
+
+//-- Meshes gathered on the CPU before createIndirectRenderer merges them into one VBO/EBO
+struct IndirectGeometry {
+    std::vector<float> positions;        //xyz
+    std::vector<unsigned int> indices;   //relative to the mesh's base vertex
+    std::vector<IndirectMesh> meshes;
+
+    //Append a mesh, returns its index
+    uint32_t addMesh(const float* meshPositions, size_t vertexCount, const unsigned int* meshIndices, size_t indexCount);
+    //Append a mesh drawing other indices over an existing mesh's vertices (a LOD level), returns its index
+    uint32_t addMeshLevel(uint32_t mesh, const unsigned int* meshIndices, size_t indexCount);
+};
+
+//-- Merged geometry, object / instance / command buffers and the programs
+struct IndirectRenderer {
+    unsigned int cullProgram = 0;
+    int cullTransformLoc = -1;
+    int cullObjectCountLoc = -1;
+    int cullMeshCountLoc = -1;
+    unsigned int shaderProgram = 0;       //instanced program, two pass outline
+    int transformLoc = -1;
+    int colorOverrideLoc = -1;
+    OutlineProgram outline;
+    bool singlePassOutline = true;
+
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
+    unsigned int objectBuffer = 0;        //IndirectObject[capacity], SSBO binding 0
+    unsigned int instanceBuffer = 0;      //InstanceData[capacity] compacted per mesh, SSBO binding 1, instanced attributes
+    unsigned int visibleBuffer = 0;       //object index of each instance, SSBO binding 2
+    unsigned int commandBuffer = 0;       //DrawElementsIndirectCommand per mesh, SSBO binding 3, GL_DRAW_INDIRECT_BUFFER
+
+    std::vector<IndirectMesh> meshes;
+    //Commands with instanceCount 0, baseInstance = first instance slot of the mesh. Reset into commandBuffer each frame.
+    std::vector<DrawElementsIndirectCommand> emptyCommands;
+    size_t capacity = 0;
+    size_t objectCount = 0;
+    bool objectsUploaded = false;         //objectBuffer holds objects, the GPU cull uploads them otherwise
+    IndirectCulling culling = IndirectCulling::Gpu;
+
+    //CPU culling: the objects as last set, and scratch reused across frames
+    std::vector<IndirectObject> objects;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<InstanceData> instances;
+    std::vector<uint32_t> visible;
+};
+
+//-- Sphere of the object's radius around its origin against the x/y planes of the clip volume, like isSphereInClip
+//on transform * model. The operations are spelled out in the order indirectCullShaderSource repeats them, so the CPU
+//and GPU decide the same for every object.
+inline bool isIndirectObjectInClip(const glm::mat4& transform, const IndirectObject& object) {
+    const float* m = object.instance.transform;
+    glm::vec4 x = (transform[0] * m[0] + transform[1] * m[1]) + (transform[2] * m[2] + transform[3] * m[3]);
+    glm::vec4 y = (transform[0] * m[4] + transform[1] * m[5]) + (transform[2] * m[6] + transform[3] * m[7]);
+    glm::vec4 z = (transform[0] * m[8] + transform[1] * m[9]) + (transform[2] * m[10] + transform[3] * m[11]);
+    glm::vec4 center = (transform[0] * m[12] + transform[1] * m[13]) + (transform[2] * m[14] + transform[3] * m[15]);
+    float lengthX = (x.x * x.x + x.y * x.y) + x.z * x.z;
+    float lengthY = (y.x * y.x + y.y * y.y) + y.z * y.z;
+    float lengthZ = (z.x * z.x + z.y * z.y) + z.z * z.z;
+    float longest = lengthX > lengthY ? lengthX : lengthY;
+    float radius = object.radius * std::sqrt(longest > lengthZ ? longest : lengthZ);
+    return center.x >= -center.w - radius && center.x <= center.w + radius &&
+        center.y >= -center.w - radius && center.y <= center.w + radius;
+}
+
+//GL 4.3 on the current context: compute shaders, storage buffers and multi draw indirect
+bool isIndirectRenderingSupported();
+
+//Compile the programs and upload the merged geometry. capacity = most objects setIndirectObjects will get.
+//Returns false (and prints why) when the context cannot do it; fall back to InstancedRenderer then.
+bool createIndirectRenderer(IndirectRenderer& renderer, const IndirectGeometry& geometry, size_t capacity,
+    bool singlePassOutline = true);
+void destroyIndirectRenderer(IndirectRenderer& renderer);
+
+//Replace the objects (up to capacity). Each mesh gets instance slots for all of its objects, so the compaction
+//never overflows. False if there are too many objects or one names a mesh that does not exist.
+//The object buffer is only uploaded by the next GPU cull, so changing meshes every frame (LOD) under CPU culling
+//costs no upload.
+bool setIndirectObjects(IndirectRenderer& renderer, const IndirectObject* objects, size_t count);
+//The instanced renderer's spinning grid (writeInstances) as count objects of mesh 0
+void updateIndirectInstances(IndirectRenderer& renderer, size_t count, float time);
+
+//Cull every object against transform and fill the command and instance buffers, on the GPU or the CPU
+void cullIndirectObjects(IndirectRenderer& renderer, const glm::mat4& transform, GLStateCache& state);
+
+//Clear the screen, cull, then draw every visible object filled and outlined with glMultiDrawElementsIndirect
+void renderIndirectFrame(IndirectRenderer& renderer, const glm::mat4& transform, GLStateCache& state);
+
+//Read the last cull back: visible object indices of each mesh, sorted (the GPU compacts in no particular order).
+//Waits for the GPU, for checks only.
+void readIndirectVisibleSet(const IndirectRenderer& renderer, std::vector<std::vector<uint32_t>>& visibleByMesh);
@@ -0,0 +1,95 @@
+#include "Input.h"
+#include "InputRecording.h"
+
+#include <chrono>
+
+const KeyBinding defaultKeyBindings[] = {
+    { GLFW_KEY_W, Command::MoveUp },
+    { GLFW_KEY_S, Command::MoveDown },
+    { GLFW_KEY_A, Command::MoveLeft },
+    { GLFW_KEY_D, Command::MoveRight },
+    { GLFW_KEY_Q, Command::RotateZPositive },
+    { GLFW_KEY_E, Command::RotateZNegative },
+    { GLFW_KEY_R, Command::ScaleZUp },
+    { GLFW_KEY_F, Command::ScaleZDown },
+    { GLFW_KEY_Z, Command::RotateYPositive },
+    { GLFW_KEY_X, Command::RotateYNegative },
+    { GLFW_KEY_T, Command::RotateXPositive },
+    { GLFW_KEY_G, Command::RotateXNegative },
+    { GLFW_KEY_ESCAPE, Command::Quit }
+};
+const int defaultKeyBindingCount = sizeof(defaultKeyBindings) / sizeof(defaultKeyBindings[0]);
+
+bool CommandState::anyLoggedCommandHeld() const {
+    for (int i = 0; i < loggedCommandCount; i++) {
+        if (held[i])
+            return true;
+    }
+    return false;
+}
+
+bool CommandState::anyHeld() const {
+    for (int i = 0; i < commandCount; i++) {
+        if (held[i])
+            return true;
+    }
+    return false;
+}
+
+double inputTimestamp() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+InputSystem::InputSystem() {
+    setBindings(defaultKeyBindings, defaultKeyBindingCount);
+    queue.reserve(64);
+}
+
+void InputSystem::setBindings(const KeyBinding* bindings, int count) {
+    for (Command& command : keyToCommand)
+        command = Command::None;
+    for (int i = 0; i < count; i++)
+        bind(bindings[i].key, bindings[i].command);
+}
+
+void InputSystem::bind(int key, Command command) {
+    if (key >= 0 && key <= GLFW_KEY_LAST)
+        keyToCommand[key] = command;
+}
+
+Command InputSystem::commandForKey(int key) const {
+    if (key < 0 || key > GLFW_KEY_LAST)
+        return Command::None;
+    return keyToCommand[key];
+}
+
+void InputSystem::onKey(int key, int action, double time) {
+    if (action == GLFW_REPEAT)
+        return;
+    Command command = commandForKey(key);
+    if (command == Command::None)
+        return;
+    queue.push_back({ time, command, action == GLFW_PRESS });
+    if (recorder)
+        recorder->recordKey(key, action == GLFW_PRESS, time);
+}
+
+void InputSystem::update(CommandState& commands) {
+    bool pressedThisStep[commandCount] = {};
+    commands.eventCount = (int)queue.size();
+    commands.oldestEventTime = -1.0;
+    for (const InputEvent& event : queue) {
+        int index = (int)event.command;
+        held[index] = event.pressed;
+        if (event.pressed)
+            pressedThisStep[index] = true;
+        if (commands.oldestEventTime < 0.0 || event.time < commands.oldestEventTime)
+            commands.oldestEventTime = event.time;
+    }
+    queue.clear();
+    if (recorder)
+        recorder->endStep();
+
+    for (int i = 0; i < commandCount; i++)
+        commands.held[i] = held[i] || pressedThisStep[i];
+}
@@ -0,0 +1,85 @@
+#pragma once
+/*Event driven input.
+GLFW key events are translated through a binding table into timestamped command events and queued.
+The update step drains the queue once per frame into a CommandState, so no key is polled with glfwGetKey.
+The timestamps let the loop measure input-to-present latency.*/
+#include <cstdint>
+#include <vector>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+class InputRecorder;
+
+//-- Everything a key can be bound to. The first 8 are the ones written to the transform log, in log order.
+enum class Command : uint8_t {
+    MoveUp, MoveDown, MoveLeft, MoveRight,
+    RotateZPositive, RotateZNegative,
+    ScaleZUp, ScaleZDown,
+    RotateYPositive, RotateYNegative,
+    RotateXPositive, RotateXNegative,
+    Quit,
+    Count,
+    None = 0xFF
+};
+const int commandCount = (int)Command::Count;
+const int loggedCommandCount = 8;
+
+//-- One row of the binding table
+struct KeyBinding {
+    int key;          //GLFW_KEY_*
+    Command command;
+};
+
+//W/S/A/D move, Q/E rotate Z, R/F scale Z, Z/X rotate Y, T/G rotate X, ESC quits
+extern const KeyBinding defaultKeyBindings[];
+extern const int defaultKeyBindingCount;
+
+//-- A bound key changing state
+struct InputEvent {
+    double time;     //inputTimestamp() when the event was received
+    Command command;
+    bool pressed;
+};
+
+//-- Commands active for one update step
+struct CommandState {
+    bool held[commandCount] = {};
+    int eventCount = 0;           //events drained for this step
+    double oldestEventTime = -1.0; //earliest event timestamp drained for this step, -1 if none
+
+    bool isHeld(Command command) const { return held[(int)command]; }
+    bool anyLoggedCommandHeld() const;
+    bool anyHeld() const;
+};
+
+//Seconds on the clock used for event timestamps (monotonic)
+double inputTimestamp();
+
+class InputSystem {
+public:
+    InputSystem();
+
+    //Replace the binding table. Keys not in the table are ignored.
+    void setBindings(const KeyBinding* bindings, int count);
+    void bind(int key, Command command);
+    Command commandForKey(int key) const;
+
+    //Key callback side: queue an event for a bound key. Repeats are ignored, held state is tracked instead.
+    void onKey(int key, int action, double time);
+
+    //Update side: apply all queued events and fill the commands for this step.
+    //A key pressed and released within one step still counts as held for that step (what GLFW_STICKY_KEYS gave us).
+    void update(CommandState& commands);
+
+    size_t pendingEvents() const { return queue.size(); }
+
+    //Report queued events and update steps to recorder (InputRecording.h), null to stop
+    void setRecorder(InputRecorder* recorder) { this->recorder = recorder; }
+
+private:
+    Command keyToCommand[GLFW_KEY_LAST + 1];
+    bool held[commandCount] = {};
+    std::vector<InputEvent> queue;
+    InputRecorder* recorder = nullptr;
+};
@@ -0,0 +1,153 @@
+#include "InputRecording.h"
+#include "Input.h"
+#include "Scene.h"
+#include "Simulation.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <gtc/type_ptr.hpp>
+
+static_assert(sizeof(InputRecordingHeader) == 128, "recording header layout");
+static_assert(sizeof(RecordedFrame) == 4, "recorded frame layout");
+static_assert(sizeof(RecordedKeyEvent) == 24, "recorded event layout");
+
+InputRecorder::~InputRecorder() {
+    if (file)
+        std::fclose(file);
+}
+
+bool InputRecorder::open(const char* path) {
+    file = std::fopen(path, "wb");
+    if (!file) {
+        std::cerr << "Error creating input recording " << path << std::endl;
+        return false;
+    }
+    InputRecordingHeader header = {};
+    failed = std::fwrite(&header, sizeof(header), 1, file) != 1;
+    startTime = inputTimestamp();
+    frames = 0;
+    steps = 0;
+    events.clear();
+    return !failed;
+}
+
+bool InputRecorder::close(const glm::mat4& finalTransform) {
+    if (!file)
+        return false;
+    //Events start 8 byte aligned for the mapped reader
+    uint64_t eventOffset = sizeof(InputRecordingHeader) + frames * sizeof(RecordedFrame);
+    const char padding[8] = {};
+    size_t pad = (size_t)((8 - eventOffset % 8) % 8);
+    if (pad > 0 && std::fwrite(padding, 1, pad, file) != pad)
+        failed = true;
+    eventOffset += pad;
+    if (!events.empty() && std::fwrite(events.data(), sizeof(RecordedKeyEvent), events.size(), file) != events.size())
+        failed = true;
+
+    InputRecordingHeader header = {};
+    std::memcpy(header.magic, inputRecordingMagic, sizeof(header.magic));
+    header.version = inputRecordingVersion;
+    header.frameCount = frames;
+    header.stepCount = steps;
+    header.eventCount = events.size();
+    header.eventOffset = eventOffset;
+    header.stepSeconds = simulationStep;
+    header.translateStep = translateStep;
+    header.scaleStep = scaleStep;
+    std::memcpy(header.finalTransform, glm::value_ptr(finalTransform), sizeof(header.finalTransform));
+    if (std::fseek(file, 0, SEEK_SET) != 0 || std::fwrite(&header, sizeof(header), 1, file) != 1)
+        failed = true;
+    if (std::fclose(file) != 0)
+        failed = true;
+    file = nullptr;
+    if (failed)
+        std::cerr << "Error writing input recording" << std::endl;
+    return !failed;
+}
+
+void InputRecorder::recordKey(int key, bool pressed, double time) {
+    RecordedKeyEvent event = {};
+    event.time = time - startTime;
+    event.step = steps;
+    event.key = key;
+    event.pressed = pressed ? 1 : 0;
+    events.push_back(event);
+}
+
+void InputRecorder::endFrame(int frameSteps, float alpha) {
+    if (!file)
+        return;
+    RecordedFrame frame = {};
+    frame.steps = (uint8_t)frameSteps;
+    frame.alpha = (uint16_t)(std::min(std::max(alpha, 0.0f), 1.0f) * 65535.0f + 0.5f);
+    if (std::fwrite(&frame, sizeof(frame), 1, file) != 1)
+        failed = true;
+    frames++;
+}
+
+bool InputReplay::open(const char* path) {
+    close();
+    if (!file.open(path))
+        return false;
+    const InputRecordingHeader* header = (const InputRecordingHeader*)file.data();
+    if (file.size() < sizeof(InputRecordingHeader) || std::memcmp(header->magic, inputRecordingMagic, sizeof(header->magic)) != 0 ||
+        header->version != inputRecordingVersion) {
+        std::cerr << "Not an input recording (or an old version): " << path << std::endl;
+        file.close();
+        return false;
+    }
+    //Counts against the file size before anything is read through them. Each count is compared with what is left
+    //after the offset, divided by the record size, so no sum or product can wrap.
+    uint64_t size = file.size();
+    bool valid = header->frameCount <= (size - sizeof(InputRecordingHeader)) / sizeof(RecordedFrame);
+    if (valid) {
+        uint64_t framesEnd = sizeof(InputRecordingHeader) + header->frameCount * sizeof(RecordedFrame);
+        valid = header->eventOffset >= framesEnd && header->eventOffset <= size && header->eventOffset % 8 == 0 &&
+            header->eventCount <= (size - header->eventOffset) / sizeof(RecordedKeyEvent);
+    }
+    if (!valid) {
+        std::cerr << "Truncated input recording " << path << std::endl;
+        file.close();
+        return false;
+    }
+    fileHeader = header;
+    frames = (const RecordedFrame*)(file.data() + sizeof(InputRecordingHeader));
+    events = (const RecordedKeyEvent*)(file.data() + header->eventOffset);
+    uint64_t steps = 0;
+    for (uint64_t i = 0; i < header->frameCount; i++)
+        steps += frames[i].steps;
+    if (steps != header->stepCount) {
+        std::cerr << "Input recording " << path << " has " << steps << " steps in its frames, header says "
+            << header->stepCount << std::endl;
+        close();
+        return false;
+    }
+    rewind();
+    return true;
+}
+
+void InputReplay::close() {
+    file.close();
+    fileHeader = nullptr;
+    frames = nullptr;
+    events = nullptr;
+}
+
+glm::mat4 InputReplay::finalTransform() const {
+    return glm::make_mat4(fileHeader->finalTransform);
+}
+
+void InputReplay::feedStep(InputSystem& input, double time) {
+    while (nextEvent < fileHeader->eventCount && events[nextEvent].step <= step) {
+        const RecordedKeyEvent& event = events[nextEvent++];
+        input.onKey(event.key, event.pressed ? GLFW_PRESS : GLFW_RELEASE, time);
+    }
+    step++;
+}
+
+void InputReplay::rewind() {
+    step = 0;
+    nextEvent = 0;
+}
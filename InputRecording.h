@@ -0,0 +1,116 @@
+#pragma once
+/*Recorded input sessions for repeatable runs.
+A recording holds every bound key event with the simulation step that drained it, plus each rendered frame's step
+count and interpolation alpha. Replaying feeds the events back through InputSystem and processInput at exactly the
+same steps, so the simulated transform is reproduced bit for bit whatever the replay's frame rate, and the final
+transform stored at the end of the recording checks that it was.
+File: header, then 4 bytes per frame (RecordedFrame), then the events (RecordedKeyEvent). The frames are streamed
+out while recording; the events and the counts are written on close.*/
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <glm.hpp>
+
+#include "MappedFile.h"
+
+class InputSystem;
+
+//-- Start of a recording file
+struct InputRecordingHeader {
+    char magic[8];          //"OGLIREC"
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t frameCount;
+    uint64_t stepCount;     //sum of the frames' steps
+    uint64_t eventCount;
+    uint64_t eventOffset;   //RecordedKeyEvent array, after the frames
+    double stepSeconds;     //simulation step and processInput amounts the recording was made with
+    float translateStep;
+    float scaleStep;
+    float finalTransform[16]; //column major, SimulationState::current after the last step
+};
+
+//-- One rendered frame
+struct RecordedFrame {
+    uint8_t steps;          //simulation steps run before the frame, at most maxSimulationStepsPerFrame
+    uint8_t reserved;
+    uint16_t alpha;         //FixedTimestep::alpha() in 1/65535, for drawing the interpolated transform
+};
+
+//-- A bound key changing state
+struct RecordedKeyEvent {
+    double time;            //seconds since the recording started
+    uint64_t step;          //simulation step whose InputSystem::update drained it
+    int32_t key;            //GLFW_KEY_*
+    uint8_t pressed;
+    uint8_t reserved[3];
+};
+
+const char inputRecordingMagic[8] = { 'O', 'G', 'L', 'I', 'R', 'E', 'C', '\0' };
+//2: processInput keeps translation / rotation / scale apart, the final transform of a version 1 file would not match
+const uint32_t inputRecordingVersion = 2;
+
+//-- Writes a recording. Attach it with InputSystem::setRecorder; the input system reports key events and steps,
+//the loop reports frames.
+class InputRecorder {
+public:
+    InputRecorder() = default;
+    ~InputRecorder();
+    InputRecorder(const InputRecorder&) = delete;
+    InputRecorder& operator=(const InputRecorder&) = delete;
+
+    //Create path and write a placeholder header. Prints to std::cerr and returns false on failure.
+    bool open(const char* path);
+    //Write the events and the final header. False if any write failed.
+    bool close(const glm::mat4& finalTransform);
+    bool isOpen() const { return file != nullptr; }
+
+    //InputSystem side: a bound key event queued for the next update, and the update itself
+    void recordKey(int key, bool pressed, double time);
+    void endStep() { steps++; }
+    //Loop side, after the frame's steps
+    void endFrame(int frameSteps, float alpha);
+
+    uint64_t frameCount() const { return frames; }
+    uint64_t stepCount() const { return steps; }
+    size_t eventCount() const { return events.size(); }
+
+private:
+    FILE* file = nullptr;
+    double startTime = 0.0;
+    uint64_t frames = 0;
+    uint64_t steps = 0;
+    std::vector<RecordedKeyEvent> events;
+    bool failed = false;
+};
+
+//-- A mapped recording, played back step by step
+class InputReplay {
+public:
+    //Map path and check it. Prints to std::cerr and returns false on failure.
+    bool open(const char* path);
+    void close();
+
+    const InputRecordingHeader& header() const { return *fileHeader; }
+    uint64_t frameCount() const { return fileHeader->frameCount; }
+    const RecordedFrame& frame(uint64_t index) const { return frames[index]; }
+    float frameAlpha(uint64_t index) const { return frames[index].alpha / 65535.0f; }
+    glm::mat4 finalTransform() const;
+    size_t fileSize() const { return file.size(); }
+
+    //Queue the events of the next step into input, call before InputSystem::update. Events get time as timestamp.
+    void feedStep(InputSystem& input, double time);
+    uint64_t currentStep() const { return step; }
+    //Back to the first step
+    void rewind();
+
+private:
+    MappedFile file;
+    const InputRecordingHeader* fileHeader = nullptr;
+    const RecordedFrame* frames = nullptr;
+    const RecordedKeyEvent* events = nullptr;
+    uint64_t step = 0;
+    uint64_t nextEvent = 0;
+};
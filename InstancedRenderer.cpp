@@ -0,0 +1,273 @@
+#include "InstancedRenderer.h"
+#include "BenchStats.h"
+#include "Profiler.h"
+#include "Scene.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include <gtc/matrix_transform.hpp>
+#include <gtc/type_ptr.hpp>
+
+//======================INSTANCE STREAM======================
+bool InstanceStream::create(size_t capacity, bool allowPersistent) {
+    destroy();
+    capacityPerFrame = capacity;
+    segment = 0;
+
+    //Persistent mapping needs buffer storage, and baseInstance to pick the segment at draw time
+    persistent = allowPersistent &&
+        (hasGLVersion(4, 4) || hasGLExtension("GL_ARB_buffer_storage")) &&
+        (hasGLVersion(4, 2) || hasGLExtension("GL_ARB_base_instance"));
+
+    glGenBuffers(1, &bufferId);
+    glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+    if (persistent) {
+        //Coherent so writes become visible without explicit flushes
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLsizeiptr size = (GLsizeiptr)(capacity * instanceStreamFrames * sizeof(InstanceData));
+        glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        mapped = (InstanceData*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        if (mapped == nullptr) {
+            std::cerr << "Failed to map the instance buffer persistently, using glBufferSubData." << std::endl;
+            glDeleteBuffers(1, &bufferId);
+            glGenBuffers(1, &bufferId);
+            glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+            persistent = false;
+        }
+    }
+    if (!persistent) {
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(capacity * sizeof(InstanceData)), nullptr, GL_STREAM_DRAW);
+        staging.resize(capacity);
+    }
+    return true;
+}
+
+void InstanceStream::destroy() {
+    for (GLsync& fence : fences) {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (bufferId != 0) {
+        if (mapped != nullptr) {
+            glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        glDeleteBuffers(1, &bufferId);
+    }
+    bufferId = 0;
+    mapped = nullptr;
+    staging.clear();
+    staging.shrink_to_fit();
+}
+
+InstanceData* InstanceStream::beginFrame() {
+    if (!persistent)
+        return staging.data();
+
+    //The fence was placed three frames ago, normally it has long signaled
+    GLsync& fence = fences[segment];
+    if (fence != nullptr) {
+        double start = wallSeconds();
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            blockedWaits++;
+            do {
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); //1 ms
+            } while (result == GL_TIMEOUT_EXPIRED);
+        }
+        fenceWaitSeconds += wallSeconds() - start;
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    return mapped + segment * capacityPerFrame;
+}
+
+void InstanceStream::commit(size_t count) {
+    if (persistent)
+        return;
+    //Orphan the old storage so the driver never waits for the previous frame's draws
+    double start = wallSeconds();
+    glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(capacityPerFrame * sizeof(InstanceData)), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(count * sizeof(InstanceData)), staging.data());
+    uploadSeconds += wallSeconds() - start;
+}
+
+void InstanceStream::endFrame() {
+    if (!persistent)
+        return;
+    fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    segment = (segment + 1) % instanceStreamFrames;
+}
+
+//======================RENDERER======================
+bool createInstancedRenderer(InstancedRenderer& renderer, size_t instanceCount, bool allowPersistent,
+    bool singlePassOutline) {
+    //Start both programs before waiting on either so they can compile in parallel
+    PendingProgram pendingProgram = beginShaderProgram(instancedVertexShaderSource, instancedFragmentShaderSource);
+    PendingProgram pendingOutline;
+    if (singlePassOutline)
+        pendingOutline = beginOutlineProgram(instancedVertexShaderSource);
+
+    renderer.shaderProgram = finishShaderProgram(pendingProgram);
+    bool outlineBuilt = singlePassOutline && finishOutlineProgram(renderer.outline, pendingOutline);
+    if (renderer.shaderProgram == 0) {
+        destroyOutlineProgram(renderer.outline);
+        return false;
+    }
+    ProgramReflection reflection = reflectProgram(renderer.shaderProgram);
+    renderer.transformLoc = reflection.location("transform");
+    renderer.colorOverrideLoc = reflection.location("colorOverride");
+
+    renderer.singlePassOutline = singlePassOutline;
+    if (singlePassOutline && !outlineBuilt) {
+        std::cerr << "Single pass outline unavailable, drawing the outline in a second pass." << std::endl;
+        renderer.singlePassOutline = false;
+    }
+    renderer.instanceCount = instanceCount;
+
+    glGenVertexArrays(1, &renderer.VAO);
+    glBindVertexArray(renderer.VAO);
+
+    //Pyramid vertices and indices, same layout as PyramidRenderer
+    glGenBuffers(1, &renderer.VBO);
+    glGenBuffers(1, &renderer.EBO);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(verticesPyramid), verticesPyramid, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    renderer.stream.create(instanceCount, allowPersistent);
+    setInstanceAttributes(renderer.stream.buffer());
+
+    glBindVertexArray(0);
+    return true;
+}
+
+void setInstanceAttributes(unsigned int buffer) {
+    //Instance attributes: a mat4 takes four vec4 locations, then the packed color
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (int column = 0; column < 4; column++) {
+        glVertexAttribPointer(1 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+            (void*)(offsetof(InstanceData, transform) + column * 4 * sizeof(float)));
+        glEnableVertexAttribArray(1 + column);
+        glVertexAttribDivisor(1 + column, 1);
+    }
+    glVertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(InstanceData), (void*)offsetof(InstanceData, color));
+    glEnableVertexAttribArray(5);
+    glVertexAttribDivisor(5, 1);
+}
+
+void destroyInstancedRenderer(InstancedRenderer& renderer) {
+    renderer.stream.destroy();
+    glDeleteVertexArrays(1, &renderer.VAO);
+    glDeleteBuffers(1, &renderer.VBO);
+    glDeleteBuffers(1, &renderer.EBO);
+    glDeleteProgram(renderer.shaderProgram);
+    destroyOutlineProgram(renderer.outline);
+    renderer.shaderProgram = renderer.VAO = renderer.VBO = renderer.EBO = 0;
+    renderer.instanceCount = 0;
+}
+
+void writeInstances(InstanceData* out, size_t first, size_t count, size_t total, float time) {
+    //Square grid covering [-0.9, 0.9], one cell per instance
+    size_t side = (size_t)std::ceil(std::sqrt((double)total));
+    float cell = 1.8f / (float)side;
+    float size = cell * 0.8f;
+    for (size_t i = first; i < first + count; i++) {
+        size_t row = i / side, column = i % side;
+        float x = -0.9f + cell * (column + 0.5f);
+        float y = -0.9f + cell * (row + 0.5f);
+
+        //T * R_y * S written out directly, cheaper than three glm::mat4 multiplies per instance
+        float angle = time + (float)i * 0.01f;
+        float c = std::cos(angle) * size, s = std::sin(angle) * size;
+        float* m = out->transform;
+        m[0] = c;    m[1] = 0.0f; m[2] = -s;    m[3] = 0.0f;
+        m[4] = 0.0f; m[5] = size; m[6] = 0.0f;  m[7] = 0.0f;
+        m[8] = s;    m[9] = 0.0f; m[10] = c;    m[11] = 0.0f;
+        m[12] = x;   m[13] = y;   m[14] = 0.0f; m[15] = 1.0f;
+
+        //Cheap integer hash for a stable color per instance
+        unsigned int h = (unsigned int)i * 2654435761u;
+        out->color[0] = (unsigned char)(128 + (h & 0x7F));
+        out->color[1] = (unsigned char)((h >> 8) & 0x7F);
+        out->color[2] = (unsigned char)((h >> 16) & 0x7F);
+        out->color[3] = 255;
+        out++;
+    }
+}
+
+void updateInstances(InstancedRenderer& renderer, float time) {
+    InstanceData* instances = renderer.stream.beginFrame();
+    writeInstances(instances, 0, renderer.instanceCount, renderer.instanceCount, time);
+    renderer.stream.commit(renderer.instanceCount);
+}
+
+void renderInstancedFrame(InstancedRenderer& renderer, const glm::mat4& transform, GLStateCache& state) {
+    //Clear screen and set color
+    {
+        PROFILE_PASS("clear");
+        state.clearColor(0.2f, 0.3f, 0.3f, 0.1f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        state.countCalls(1);
+    }
+
+    GLsizei count = (GLsizei)renderer.instanceCount;
+    unsigned int base = renderer.stream.baseInstance();
+
+    if (renderer.singlePassOutline) {
+        //Each instance filled with its color and outlined in black by one draw
+        PROFILE_PASS("draw fill+outline");
+        state.useProgram(renderer.outline.program);
+        state.uniformMatrix4(renderer.outline.transformLoc, transform);
+        state.bindVertexArray(renderer.VAO);
+        if (renderer.stream.isPersistent())
+            glDrawElementsInstancedBaseInstance(GL_TRIANGLES, pyramidIndexCount, GL_UNSIGNED_INT, 0, count, base);
+        else
+            glDrawElementsInstanced(GL_TRIANGLES, pyramidIndexCount, GL_UNSIGNED_INT, 0, count);
+        state.countCalls(1, 1);
+        renderer.stream.endFrame();
+        state.countCalls(renderer.stream.isPersistent() ? 1 : 0);
+        return;
+    }
+
+    state.useProgram(renderer.shaderProgram);
+    state.uniformMatrix4(renderer.transformLoc, transform);
+    state.bindVertexArray(renderer.VAO);
+
+    {
+        //Filled with each instance's color
+        PROFILE_PASS("draw fill");
+        state.polygonMode(GL_FILL);
+        state.uniform4f(renderer.colorOverrideLoc, 0.0f, 0.0f, 0.0f, 0.0f);
+        if (renderer.stream.isPersistent())
+            glDrawElementsInstancedBaseInstance(GL_TRIANGLES, pyramidIndexCount, GL_UNSIGNED_INT, 0, count, base);
+        else
+            glDrawElementsInstanced(GL_TRIANGLES, pyramidIndexCount, GL_UNSIGNED_INT, 0, count);
+        state.countCalls(1, 1);
+    }
+    {
+        //Outlines in black
+        PROFILE_PASS("draw outline");
+        state.polygonMode(GL_LINE);
+        state.lineWidth(3.0f);
+        state.uniform4f(renderer.colorOverrideLoc, 0.0f, 0.0f, 0.0f, 1.0f);
+        if (renderer.stream.isPersistent())
+            glDrawElementsInstancedBaseInstance(GL_TRIANGLES, pyramidIndexCount, GL_UNSIGNED_INT, 0, count, base);
+        else
+            glDrawElementsInstanced(GL_TRIANGLES, pyramidIndexCount, GL_UNSIGNED_INT, 0, count);
+        state.countCalls(1, 1);
+    }
+
+    // Restore polygon mode to fill.
+    state.polygonMode(GL_FILL);
+
+    renderer.stream.endFrame();
+    state.countCalls(renderer.stream.isPersistent() ? 1 : 0);
+}
@@ -0,0 +1,93 @@
+#pragma once
+/*Instanced pyramid rendering for very large instance counts.
+All instances are drawn with a single glDrawElementsInstanced* call (fill and outline in one pass through
+OutlineProgram), or one call per pass with the old GL_FILL + GL_LINE outline.
+Per-instance transforms and colors stream through InstanceStream: a persistently mapped buffer
+(ARB_buffer_storage / GL 4.4) split into three frame segments, each guarded by a fence,
+so the CPU writes frame N+2 while the GPU still reads frames N and N+1.
+Without buffer storage it falls back to orphaning one buffer with glBufferData + glBufferSubData.*/
+#include <cstddef>
+#include <vector>
+
+#include "GLPlatform.h"
+#include "Renderer.h"
+
+#include <glm.hpp>
+
+//-- Per-instance vertex attributes (locations 1-4 and 5)
+struct InstanceData {
+    float transform[16];    //column major
+    unsigned char color[4]; //unorm8 RGBA
+};
+
+const int instanceStreamFrames = 3;
+
+//-- Triple-buffered instance upload ring
+class InstanceStream {
+public:
+    InstanceStream() = default;
+    ~InstanceStream() { destroy(); }
+    InstanceStream(const InstanceStream&) = delete;
+    InstanceStream& operator=(const InstanceStream&) = delete;
+
+    //capacity = instances per frame. Set allowPersistent to false to force the glBufferSubData path.
+    bool create(size_t capacity, bool allowPersistent = true);
+    void destroy();
+
+    //Wait for the GPU to release the next segment and return it for writing (capacity instances)
+    InstanceData* beginFrame();
+    //Make the first count written instances visible to the GPU. Call before drawing.
+    void commit(size_t count);
+    //Fence the segment once the draws that read it are submitted
+    void endFrame();
+
+    unsigned int buffer() const { return bufferId; }
+    //First instance of the current segment, passed as baseInstance when drawing
+    unsigned int baseInstance() const { return persistent ? (unsigned int)(segment * capacityPerFrame) : 0u; }
+    bool isPersistent() const { return persistent; }
+    size_t capacity() const { return capacityPerFrame; }
+
+    //Accumulated seconds spent waiting on fences / in glBufferSubData, and how many waits actually blocked
+    double fenceWaitSeconds = 0.0;
+    double uploadSeconds = 0.0;
+    unsigned long long blockedWaits = 0;
+
+private:
+    unsigned int bufferId = 0;
+    bool persistent = false;
+    size_t capacityPerFrame = 0;
+    int segment = 0;
+    InstanceData* mapped = nullptr;
+    GLsync fences[instanceStreamFrames] = {};
+    std::vector<InstanceData> staging; //fallback path only
+};
+
+//-- Shaders, pyramid buffers and the instance stream
+struct InstancedRenderer {
+    unsigned int shaderProgram = 0;
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
+    int transformLoc = -1;
+    int colorOverrideLoc = -1;
+    OutlineProgram outline;
+    bool singlePassOutline = true;
+    size_t instanceCount = 0;
+    InstanceStream stream;
+};
+
+bool createInstancedRenderer(InstancedRenderer& renderer, size_t instanceCount, bool allowPersistent = true,
+    bool singlePassOutline = true);
+void destroyInstancedRenderer(InstancedRenderer& renderer);
+//Point attributes 1-5 of the bound VAO at buffer, one InstanceData per instance (instancedVertexShaderSource)
+void setInstanceAttributes(unsigned int buffer);
+
+//Lay out instances [first, first + count) of total on a square grid filling clip space,
+//each spinning about Y by time, with a color derived from its index
+void writeInstances(InstanceData* out, size_t first, size_t count, size_t total, float time);
+
+//Stream this frame's instance data (all instances)
+void updateInstances(InstancedRenderer& renderer, float time);
+
+//Clear the screen, then draw all instances filled and outlined
+void renderInstancedFrame(InstancedRenderer& renderer, const glm::mat4& transform, GLStateCache& state);
@@ -0,0 +1,205 @@
+#include "JobSystem.h"
+
+//Worker index of the current thread within the system that owns it
+static thread_local const JobSystem* currentSystem = nullptr;
+static thread_local int currentIndex = 0;
+
+//Failed steal rounds before an idle worker goes to sleep
+static const int idleSpins = 64;
+
+JobSystem::JobSystem(int threadCount) {
+    if (threadCount <= 0)
+        threadCount = (int)std::thread::hardware_concurrency();
+    if (threadCount <= 0)
+        threadCount = 1;
+    for (int i = 0; i < threadCount; i++)
+        queues.push_back(new WorkQueue());
+    currentSystem = this;
+    currentIndex = 0;
+    for (int i = 1; i < threadCount; i++)
+        threads.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    sleepCondition.notify_all();
+    for (std::thread& thread : threads)
+        thread.join();
+    for (WorkQueue* queue : queues)
+        delete queue;
+    if (currentSystem == this)
+        currentSystem = nullptr;
+}
+
+int JobSystem::currentWorker() const {
+    return currentSystem == this ? currentIndex : 0;
+}
+
+//======================QUEUES======================
+void JobSystem::push(const Job& job) {
+    WorkQueue& queue = *queues[currentWorker()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(job);
+    }
+    queuedJobs.fetch_add(1);
+    //Take the lock so a worker between its last check and its wait cannot miss the notification
+    if (sleeping.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        sleepCondition.notify_one();
+    }
+}
+
+bool JobSystem::pop(int worker, Job& job) {
+    WorkQueue& queue = *queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty())
+        return false;
+    job = queue.jobs.back();
+    queue.jobs.pop_back();
+    queuedJobs.fetch_sub(1);
+    return true;
+}
+
+bool JobSystem::steal(int worker, Job& job) {
+    int count = (int)queues.size();
+    for (int i = 1; i < count; i++) {
+        WorkQueue& queue = *queues[(worker + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty())
+            continue;
+        //Oldest job: for a split range that is the biggest remaining half
+        job = queue.jobs.front();
+        queue.jobs.pop_front();
+        queuedJobs.fetch_sub(1);
+        steals.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+//======================EXECUTION======================
+void JobSystem::execute(Job& job, int worker) {
+    //Keep halving a large range, leaving the upper halves for this worker or thieves
+    while (job.grain > 0 && job.end - job.begin > job.grain) {
+        size_t middle = job.begin + (job.end - job.begin) / 2;
+        Job upper = job;
+        upper.begin = middle;
+        if (upper.counter != nullptr)
+            upper.counter->pending.fetch_add(1);
+        push(upper);
+        job.end = middle;
+    }
+    job.function(job.data, job.begin, job.end, worker);
+    finish(job.counter);
+}
+
+void JobSystem::finish(JobCounter* counter) {
+    if (counter == nullptr)
+        return;
+    //Decrement under the lock: wait() takes it once after seeing zero, so the counter outlives this function
+    std::vector<Job> ready;
+    {
+        std::lock_guard<std::mutex> lock(counter->mutex);
+        if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            ready.swap(counter->continuations);
+    }
+    //Last job of the group: release what was waiting on it
+    for (const Job& job : ready)
+        push(job);
+}
+
+void JobSystem::run(void (*function)(void*, size_t, size_t, int), void* data, JobCounter* counter, size_t begin, size_t end) {
+    Job job;
+    job.function = function;
+    job.data = data;
+    job.begin = begin;
+    job.end = end;
+    job.counter = counter;
+    if (counter != nullptr)
+        counter->pending.fetch_add(1);
+    push(job);
+}
+
+void JobSystem::runAfter(JobCounter& dependency, void (*function)(void*, size_t, size_t, int), void* data,
+    JobCounter* counter, size_t begin, size_t end) {
+    Job job;
+    job.function = function;
+    job.data = data;
+    job.begin = begin;
+    job.end = end;
+    job.counter = counter;
+    if (counter != nullptr)
+        counter->pending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(dependency.mutex);
+        if (!dependency.done()) {
+            dependency.continuations.push_back(job);
+            return;
+        }
+    }
+    push(job);
+}
+
+void JobSystem::pushRange(void (*function)(void*, size_t, size_t, int), void* data, size_t count, size_t grain,
+    JobCounter* counter, JobCounter* dependency) {
+    if (count == 0)
+        return;
+    Job job;
+    job.function = function;
+    job.data = data;
+    job.begin = 0;
+    job.end = count;
+    job.grain = grain > 0 ? grain : 1;
+    job.counter = counter;
+    if (counter != nullptr)
+        counter->pending.fetch_add(1);
+    if (dependency != nullptr) {
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (!dependency->done()) {
+            dependency->continuations.push_back(job);
+            return;
+        }
+    }
+    push(job);
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    int worker = currentWorker();
+    Job job;
+    while (!counter.done()) {
+        if (pop(worker, job) || steal(worker, job))
+            execute(job, worker);
+        else
+            std::this_thread::yield();
+    }
+    //The job that reached zero may still hold the lock, see finish()
+    std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void JobSystem::workerLoop(int worker) {
+    currentSystem = this;
+    currentIndex = worker;
+    Job job;
+    int idle = 0;
+    while (!stopping.load()) {
+        if (pop(worker, job) || steal(worker, job)) {
+            execute(job, worker);
+            idle = 0;
+            continue;
+        }
+        if (++idle < idleSpins) {
+            std::this_thread::yield();
+            continue;
+        }
+        //Nothing anywhere for a while, sleep until a push
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleeping.fetch_add(1);
+        sleepCondition.wait(lock, [this] { return stopping.load() || queuedJobs.load() > 0; });
+        sleeping.fetch_sub(1);
+        idle = 0;
+    }
+}
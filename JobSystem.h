@@ -0,0 +1,106 @@
+#pragma once
+/*Work-stealing job scheduler for per-frame work.
+Every thread (the creating thread is worker 0) owns a deque: it pushes and pops its own jobs at the back,
+idle threads steal from the front of the others. parallelFor splits a range in halves recursively, so a thief
+takes a large chunk and keeps splitting it on its own deque.
+JobCounter is the dependency counter: jobs started with it increment it and decrement it when they finish.
+wait() runs other jobs until it reaches zero, and runAfter() queues a job for when it reaches zero,
+which is how the frame stages chain (input -> simulation -> transforms -> culling -> commands).*/
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+struct JobCounter;
+
+//-- Plain function plus range, no allocation per job
+struct Job {
+    void (*function)(void* data, size_t begin, size_t end, int worker) = nullptr;
+    void* data = nullptr;
+    size_t begin = 0;
+    size_t end = 0;
+    size_t grain = 0;            //parallelFor: split while the range is larger than this
+    JobCounter* counter = nullptr;
+};
+
+//-- Jobs outstanding in a group, plus the jobs waiting for the group to finish
+struct JobCounter {
+    std::atomic<int> pending{ 0 };
+
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+    std::mutex mutex;
+    std::vector<Job> continuations;
+};
+
+class JobSystem {
+public:
+    //threads includes the calling thread, so JobSystem(1) runs everything inline on wait(). 0 = hardware threads.
+    explicit JobSystem(int threads = 0);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    int threadCount() const { return (int)queues.size(); }
+    //Index of the calling thread, 0 for the owner thread and for threads outside the system
+    int currentWorker() const;
+
+    //Queue function(data, begin, end, worker) once; counter (optional) is incremented now, decremented when it ran
+    void run(void (*function)(void*, size_t, size_t, int), void* data, JobCounter* counter, size_t begin = 0, size_t end = 0);
+    //Same, but only once dependency reaches zero
+    void runAfter(JobCounter& dependency, void (*function)(void*, size_t, size_t, int), void* data,
+        JobCounter* counter, size_t begin = 0, size_t end = 0);
+
+    //Call fn(begin, end, worker) over [0, count) in chunks of at most grain. Returns immediately; wait on counter.
+    //fn must outlive the jobs (keep it alive until wait(counter) returns).
+    template <class Function>
+    void parallelFor(size_t count, size_t grain, Function& fn, JobCounter& counter) {
+        pushRange(&callRange<Function>, &fn, count, grain, &counter, nullptr);
+    }
+    //Same, started once dependency reaches zero
+    template <class Function>
+    void parallelForAfter(JobCounter& dependency, size_t count, size_t grain, Function& fn, JobCounter& counter) {
+        pushRange(&callRange<Function>, &fn, count, grain, &counter, &dependency);
+    }
+
+    //Run queued jobs on this thread until counter reaches zero
+    void wait(JobCounter& counter);
+
+    //Jobs this system executed that were taken from another thread's deque
+    unsigned long long stolenJobs() const { return steals.load(std::memory_order_relaxed); }
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    template <class Function>
+    static void callRange(void* data, size_t begin, size_t end, int worker) {
+        (*(Function*)data)(begin, end, worker);
+    }
+
+    void pushRange(void (*function)(void*, size_t, size_t, int), void* data, size_t count, size_t grain,
+        JobCounter* counter, JobCounter* dependency);
+    void push(const Job& job);
+    bool pop(int worker, Job& job);
+    bool steal(int worker, Job& job);
+    void execute(Job& job, int worker);
+    void finish(JobCounter* counter);
+    void workerLoop(int worker);
+
+    std::vector<WorkQueue*> queues;
+    std::vector<std::thread> threads;
+    std::atomic<int> queuedJobs{ 0 };
+    std::atomic<unsigned long long> steals{ 0 };
+    std::atomic<int> sleeping{ 0 };
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<bool> stopping{ false };
+};
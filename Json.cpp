@@ -0,0 +1,327 @@
+#include "Json.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+void JsonWriter::prefix(const char* key) {
+    if (!first.empty()) {
+        if (!first.back())
+            out << ",";
+        first.back() = false;
+        out << "\n" << std::string(first.size() * 2, ' ');
+    }
+    if (key != nullptr)
+        out << "\"" << escape(key) << "\": ";
+}
+
+void JsonWriter::beginObject(const char* key) {
+    prefix(key);
+    out << "{";
+    first.push_back(true);
+}
+
+void JsonWriter::endObject() {
+    bool empty = first.back();
+    first.pop_back();
+    if (!empty)
+        out << "\n" << std::string(first.size() * 2, ' ');
+    out << "}";
+    if (first.empty())
+        out << "\n";
+}
+
+void JsonWriter::beginArray(const char* key) {
+    prefix(key);
+    out << "[";
+    first.push_back(true);
+}
+
+void JsonWriter::endArray() {
+    bool empty = first.back();
+    first.pop_back();
+    if (!empty)
+        out << "\n" << std::string(first.size() * 2, ' ');
+    out << "]";
+}
+
+void JsonWriter::value(const char* key, double v) {
+    prefix(key);
+    //JSON has no inf/nan
+    if (!std::isfinite(v)) {
+        out << "null";
+        return;
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.6g", v);
+    out << buffer;
+}
+
+void JsonWriter::value(const char* key, int64_t v) {
+    prefix(key);
+    out << v;
+}
+
+void JsonWriter::value(const char* key, uint64_t v) {
+    prefix(key);
+    out << v;
+}
+
+void JsonWriter::value(const char* key, bool v) {
+    prefix(key);
+    out << (v ? "true" : "false");
+}
+
+void JsonWriter::value(const char* key, const char* v) {
+    prefix(key);
+    out << "\"" << escape(v) << "\"";
+}
+
+void JsonWriter::raw(const char* key, const std::string& json) {
+    prefix(key);
+    out << json;
+}
+
+std::string JsonWriter::escape(const char* s) {
+    std::string result;
+    for (; *s != '\0'; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += (char)c;
+        }
+        else if (c == '\n') result += "\\n";
+        else if (c == '\t') result += "\\t";
+        else if (c < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            result += buffer;
+        }
+        else result += (char)c;
+    }
+    return result;
+}
+
+
+//======================READER======================
+const JsonValue* JsonValue::find(const char* key) const {
+    if (type != Object)
+        return nullptr;
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (keys[i] == key)
+            return &items[i];
+    }
+    return nullptr;
+}
+
+double JsonValue::numberOr(const char* key, double fallback) const {
+    const JsonValue* member = find(key);
+    return member != nullptr && member->type == Number ? member->number : fallback;
+}
+
+//-- Recursive descent over the text, one instance per parseJson call
+struct JsonParser {
+    const char* text;
+    size_t length;
+    size_t position = 0;
+    std::string error;
+
+    JsonParser(const char* text, size_t length) : text(text), length(length) {}
+
+    bool fail(const char* message) {
+        if (error.empty())
+            error = std::string(message) + " at byte " + std::to_string(position);
+        return false;
+    }
+    void skipSpace() {
+        while (position < length && (text[position] == ' ' || text[position] == '\t' ||
+            text[position] == '\n' || text[position] == '\r'))
+            position++;
+    }
+    bool literal(const char* word) {
+        size_t n = std::strlen(word);
+        if (length - position < n || std::memcmp(text + position, word, n) != 0)
+            return fail("invalid literal");
+        position += n;
+        return true;
+    }
+    //Appends the code point as UTF-8
+    static void appendUtf8(std::string& out, unsigned long code) {
+        if (code < 0x80) out += (char)code;
+        else if (code < 0x800) {
+            out += (char)(0xC0 | (code >> 6));
+            out += (char)(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000) {
+            out += (char)(0xE0 | (code >> 12));
+            out += (char)(0x80 | ((code >> 6) & 0x3F));
+            out += (char)(0x80 | (code & 0x3F));
+        }
+        else {
+            out += (char)(0xF0 | (code >> 18));
+            out += (char)(0x80 | ((code >> 12) & 0x3F));
+            out += (char)(0x80 | ((code >> 6) & 0x3F));
+            out += (char)(0x80 | (code & 0x3F));
+        }
+    }
+    bool parseString(std::string& out) {
+        position++; //opening quote
+        while (position < length) {
+            char c = text[position++];
+            if (c == '"')
+                return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (position >= length)
+                break;
+            char escaped = text[position++];
+            switch (escaped) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                if (length - position < 4)
+                    return fail("truncated \\u escape");
+                char digits[5] = { text[position], text[position + 1], text[position + 2], text[position + 3], 0 };
+                position += 4;
+                unsigned long code = std::strtoul(digits, nullptr, 16);
+                //Surrogate pair
+                if (code >= 0xD800 && code < 0xDC00 && length - position >= 6 &&
+                    text[position] == '\\' && text[position + 1] == 'u') {
+                    char low[5] = { text[position + 2], text[position + 3], text[position + 4], text[position + 5], 0 };
+                    unsigned long lowCode = std::strtoul(low, nullptr, 16);
+                    if (lowCode >= 0xDC00 && lowCode < 0xE000) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (lowCode - 0xDC00);
+                        position += 6;
+                    }
+                }
+                appendUtf8(out, code);
+                break;
+            }
+            default:
+                return fail("invalid escape");
+            }
+        }
+        return fail("unterminated string");
+    }
+    bool parseNumber(double& out) {
+        //strtod needs a terminated string, numbers are short
+        char buffer[64];
+        size_t n = 0;
+        while (position + n < length && n < sizeof(buffer) - 1 &&
+            std::strchr("+-0123456789.eE", text[position + n]) != nullptr && text[position + n] != '\0')
+            n++;
+        std::memcpy(buffer, text + position, n);
+        buffer[n] = '\0';
+        char* end = nullptr;
+        out = std::strtod(buffer, &end);
+        if (n == 0 || end != buffer + n)
+            return fail("invalid number");
+        position += n;
+        return true;
+    }
+    bool parseValue(JsonValue& value, int depth) {
+        if (depth > 256)
+            return fail("nesting too deep");
+        skipSpace();
+        if (position >= length)
+            return fail("unexpected end");
+        char c = text[position];
+        if (c == '{') {
+            value.type = JsonValue::Object;
+            position++;
+            skipSpace();
+            if (position < length && text[position] == '}') {
+                position++;
+                return true;
+            }
+            for (;;) {
+                skipSpace();
+                if (position >= length || text[position] != '"')
+                    return fail("expected member name");
+                value.keys.emplace_back();
+                if (!parseString(value.keys.back()))
+                    return false;
+                skipSpace();
+                if (position >= length || text[position] != ':')
+                    return fail("expected ':'");
+                position++;
+                value.items.emplace_back();
+                if (!parseValue(value.items.back(), depth + 1))
+                    return false;
+                skipSpace();
+                if (position < length && text[position] == ',') {
+                    position++;
+                    continue;
+                }
+                if (position < length && text[position] == '}') {
+                    position++;
+                    return true;
+                }
+                return fail("expected ',' or '}'");
+            }
+        }
+        if (c == '[') {
+            value.type = JsonValue::Array;
+            position++;
+            skipSpace();
+            if (position < length && text[position] == ']') {
+                position++;
+                return true;
+            }
+            for (;;) {
+                value.items.emplace_back();
+                if (!parseValue(value.items.back(), depth + 1))
+                    return false;
+                skipSpace();
+                if (position < length && text[position] == ',') {
+                    position++;
+                    continue;
+                }
+                if (position < length && text[position] == ']') {
+                    position++;
+                    return true;
+                }
+                return fail("expected ',' or ']'");
+            }
+        }
+        if (c == '"') {
+            value.type = JsonValue::String;
+            return parseString(value.string);
+        }
+        if (c == 't') {
+            value.type = JsonValue::Bool;
+            value.boolean = true;
+            return literal("true");
+        }
+        if (c == 'f') {
+            value.type = JsonValue::Bool;
+            return literal("false");
+        }
+        if (c == 'n')
+            return literal("null");
+        value.type = JsonValue::Number;
+        return parseNumber(value.number);
+    }
+};
+
+bool parseJson(const char* text, size_t length, JsonValue& value, std::string& error) {
+    JsonParser parser{ text, length };
+    value = JsonValue();
+    bool ok = parser.parseValue(value, 0);
+    if (ok) {
+        parser.skipSpace();
+        if (parser.position != length)
+            ok = parser.fail("trailing characters");
+    }
+    error = parser.error;
+    return ok;
+}
@@ -0,0 +1,60 @@
+#pragma once
+//Minimal streaming JSON writer used for benchmark and profiler reports, and a small reader for
+//JSON documents the app loads (glTF headers).
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class JsonWriter {
+public:
+    explicit JsonWriter(std::ostream& out) : out(out) {}
+
+    //Containers. The key is ignored (must be null) inside arrays and at the top level.
+    void beginObject(const char* key = nullptr);
+    void endObject();
+    void beginArray(const char* key = nullptr);
+    void endArray();
+
+    //Members of an object (key) or elements of an array (key == nullptr)
+    void value(const char* key, double v);
+    void value(const char* key, int v) { value(key, (int64_t)v); }
+    void value(const char* key, unsigned int v) { value(key, (uint64_t)v); }
+    void value(const char* key, int64_t v);
+    void value(const char* key, uint64_t v);
+    void value(const char* key, bool v);
+    void value(const char* key, const char* v);
+    void value(const char* key, const std::string& v) { value(key, v.c_str()); }
+
+    //Insert pre-formatted JSON as a member/element
+    void raw(const char* key, const std::string& json);
+
+    static std::string escape(const char* s);
+
+private:
+    void prefix(const char* key);
+
+    std::ostream& out;
+    std::vector<bool> first; //one entry per open container, true until it gets its first member
+};
+
+//-- Parsed JSON value. Objects keep their members in file order.
+struct JsonValue {
+    enum Type { Null, Bool, Number, String, Array, Object };
+    Type type = Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> items;  //Array elements, or Object member values
+    std::vector<std::string> keys; //Object member names, parallel to items
+
+    //Object member, nullptr if missing or this is not an object
+    const JsonValue* find(const char* key) const;
+    //Number member, fallback if missing or not a number
+    double numberOr(const char* key, double fallback) const;
+    bool isArray() const { return type == Array; }
+    bool isObject() const { return type == Object; }
+};
+
+//Parse a whole document. On failure returns false with a message including the byte offset.
+bool parseJson(const char* text, size_t length, JsonValue& value, std::string& error);
@@ -0,0 +1,348 @@
+#include "Lod.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <queue>
+
+#include <glm.hpp>
+
+#include "MeshImporter.h"
+#include "Utility.h"
+
+//-- Area weighted sum of squared plane distances, symmetric 4x4 kept as its upper triangle
+struct Quadric {
+    double a[10] = {};
+    double area = 0.0;
+
+    void addPlane(const glm::dvec3& normal, double d, double weight) {
+        double n[4] = { normal.x, normal.y, normal.z, d };
+        int k = 0;
+        for (int row = 0; row < 4; row++) {
+            for (int column = row; column < 4; column++)
+                a[k++] += weight * n[row] * n[column];
+        }
+        area += weight;
+    }
+    void add(const Quadric& other) {
+        for (int k = 0; k < 10; k++)
+            a[k] += other.a[k];
+        area += other.area;
+    }
+    double evaluate(const glm::vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        return a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z + 2.0 * a[3] * x +
+            a[4] * y * y + 2.0 * a[5] * y * z + 2.0 * a[6] * y +
+            a[7] * z * z + 2.0 * a[8] * z + a[9];
+    }
+};
+
+//-- Candidate collapse of vertex from onto vertex to, valid while neither end changed since it was queued
+struct Collapse {
+    double cost;
+    unsigned int from;
+    unsigned int to;
+    unsigned int fromVersion;
+    unsigned int toVersion;
+
+    bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+//-- Simplification state. Topology works on welded vertices (one per position, the lowest index), so seams
+//look like one surface; only vertices that are alone at their position ever move.
+struct Simplifier {
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> welded;                  //vertex -> lowest vertex at the same position
+    std::vector<char> locked;                          //by welded vertex
+    std::vector<char> removed;                         //by vertex, collapsed away
+    std::vector<unsigned int> versions;                //by welded vertex, bumped when its quadric grows
+    std::vector<Quadric> quadrics;                     //by welded vertex
+    std::vector<std::vector<unsigned int>> triangles;  //by welded vertex, triangles around it (some dead)
+    std::vector<char> alive;                           //by triangle
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+    size_t liveTriangles = 0;
+    //canCollapse scratch
+    std::vector<unsigned int> fromRing, toRing;
+
+    unsigned int corner(unsigned int triangle, int c) const { return indices[triangle * 3 + c]; }
+
+    void push(unsigned int from, unsigned int to) {
+        unsigned int target = welded[to];
+        double cost = quadrics[from].evaluate(positions[to]) + quadrics[target].evaluate(positions[to]);
+        queue.push(Collapse{ std::max(cost, 0.0), from, to, versions[from], versions[target] });
+    }
+
+    //Both directions of every edge of triangle whose start may move
+    void pushEdges(unsigned int triangle) {
+        for (int a = 0; a < 3; a++) {
+            for (int b = 0; b < 3; b++) {
+                unsigned int from = corner(triangle, a), to = corner(triangle, b);
+                if (a != b && !locked[welded[from]] && welded[from] != welded[to])
+                    push(from, to);
+            }
+        }
+    }
+
+    //Welded neighbours of vertex, and how many triangles around it also touch other
+    size_t ring(unsigned int vertex, unsigned int other, std::vector<unsigned int>& out) const {
+        out.clear();
+        size_t shared = 0;
+        for (unsigned int triangle : triangles[vertex]) {
+            if (!alive[triangle])
+                continue;
+            bool touches = false;
+            for (int c = 0; c < 3; c++) {
+                unsigned int neighbour = welded[corner(triangle, c)];
+                touches = touches || neighbour == other;
+                if (neighbour != vertex)
+                    out.push_back(neighbour);
+            }
+            shared += touches ? 1 : 0;
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        return shared;
+    }
+
+    //Reject collapses that pinch the surface (the two rings share more vertices than the edge has triangles)
+    //or turn a remaining triangle over
+    bool canCollapse(unsigned int from, unsigned int to) {
+        unsigned int target = welded[to];
+        size_t shared = ring(from, target, fromRing);
+        ring(target, from, toRing);
+        size_t common = 0;
+        for (size_t i = 0, j = 0; i < fromRing.size() && j < toRing.size();) {
+            if (fromRing[i] < toRing[j])
+                i++;
+            else if (fromRing[i] > toRing[j])
+                j++;
+            else {
+                common++;
+                i++;
+                j++;
+            }
+        }
+        if (common != shared)
+            return false;
+
+        for (unsigned int triangle : triangles[from]) {
+            if (!alive[triangle])
+                continue;
+            glm::vec3 p[3];
+            bool collapses = false;
+            int moved = 0;
+            for (int c = 0; c < 3; c++) {
+                unsigned int vertex = corner(triangle, c);
+                collapses = collapses || welded[vertex] == target;
+                if (vertex == from)
+                    moved = c;
+                p[c] = positions[vertex];
+            }
+            if (collapses)
+                continue;
+            glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            p[moved] = positions[to];
+            glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+            if (glm::dot(before, after) <= 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    void collapse(unsigned int from, unsigned int to) {
+        unsigned int target = welded[to];
+        std::vector<unsigned int>& around = triangles[target];
+        for (unsigned int triangle : triangles[from]) {
+            if (!alive[triangle])
+                continue;
+            bool collapses = false;
+            for (int c = 0; c < 3; c++)
+                collapses = collapses || welded[corner(triangle, c)] == target;
+            if (collapses) {
+                alive[triangle] = 0;
+                liveTriangles--;
+                continue;
+            }
+            for (int c = 0; c < 3; c++) {
+                if (indices[triangle * 3 + c] == from)
+                    indices[triangle * 3 + c] = to;
+            }
+            around.push_back(triangle);
+        }
+        triangles[from].clear();
+        removed[from] = 1;
+        quadrics[target].add(quadrics[from]);
+        versions[target]++;
+
+        //Drop the dead triangles, then queue every edge around the grown vertex again with its new quadric
+        around.erase(std::remove_if(around.begin(), around.end(), [&](unsigned int t) { return !alive[t]; }), around.end());
+        for (unsigned int triangle : around)
+            pushEdges(triangle);
+    }
+
+    void appendLevel(LodChain& chain, float error) const {
+        LodLevel level;
+        level.firstIndex = (uint32_t)chain.indices.size();
+        level.error = error;
+        for (size_t triangle = 0; triangle < alive.size(); triangle++) {
+            if (alive[triangle])
+                chain.indices.insert(chain.indices.end(), &indices[triangle * 3], &indices[triangle * 3 + 3]);
+        }
+        level.indexCount = (uint32_t)(chain.indices.size() - level.firstIndex);
+        chain.levels.push_back(level);
+    }
+};
+
+//Weld by position, lock seams, borders and non-manifold edges, and sum every vertex's plane quadric
+static void prepare(Simplifier& simplifier, const MeshData& mesh) {
+    size_t vertexCount = mesh.vertexCount();
+    size_t triangleCount = mesh.triangleCount();
+    simplifier.positions.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+        simplifier.positions[i] = glm::vec3(mesh.positions[i * 3], mesh.positions[i * 3 + 1], mesh.positions[i * 3 + 2]);
+    simplifier.indices = mesh.indices;
+
+    std::vector<unsigned int> order(vertexCount);
+    for (unsigned int i = 0; i < (unsigned int)vertexCount; i++)
+        order[i] = i;
+    const std::vector<glm::vec3>& positions = simplifier.positions;
+    auto byPosition = [&](unsigned int a, unsigned int b) {
+        const glm::vec3& p = positions[a];
+        const glm::vec3& q = positions[b];
+        if (p.x != q.x)
+            return p.x < q.x;
+        if (p.y != q.y)
+            return p.y < q.y;
+        if (p.z != q.z)
+            return p.z < q.z;
+        return a < b;
+    };
+    std::sort(order.begin(), order.end(), byPosition);
+    simplifier.welded.resize(vertexCount);
+    simplifier.locked.assign(vertexCount, 0);
+    for (size_t i = 0; i < vertexCount;) {
+        size_t end = i + 1;
+        while (end < vertexCount && positions[order[end]] == positions[order[i]])
+            end++;
+        for (size_t j = i; j < end; j++)
+            simplifier.welded[order[j]] = order[i];
+        if (end - i > 1)
+            simplifier.locked[order[i]] = 1;
+        i = end;
+    }
+
+    //Welded edges used by anything but exactly two triangles
+    std::vector<uint64_t> edges;
+    edges.reserve(triangleCount * 3);
+    for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+        for (int c = 0; c < 3; c++) {
+            uint64_t a = simplifier.welded[mesh.indices[triangle * 3 + c]];
+            uint64_t b = simplifier.welded[mesh.indices[triangle * 3 + (c + 1) % 3]];
+            edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size();) {
+        size_t end = i + 1;
+        while (end < edges.size() && edges[end] == edges[i])
+            end++;
+        if (end - i != 2) {
+            simplifier.locked[edges[i] >> 32] = 1;
+            simplifier.locked[edges[i] & 0xFFFFFFFFu] = 1;
+        }
+        i = end;
+    }
+
+    simplifier.quadrics.assign(vertexCount, Quadric());
+    simplifier.triangles.assign(vertexCount, std::vector<unsigned int>());
+    simplifier.alive.assign(triangleCount, 1);
+    simplifier.removed.assign(vertexCount, 0);
+    simplifier.versions.assign(vertexCount, 0);
+    simplifier.liveTriangles = triangleCount;
+    for (unsigned int triangle = 0; triangle < (unsigned int)triangleCount; triangle++) {
+        glm::dvec3 p0(positions[simplifier.corner(triangle, 0)]);
+        glm::dvec3 p1(positions[simplifier.corner(triangle, 1)]);
+        glm::dvec3 p2(positions[simplifier.corner(triangle, 2)]);
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        double length = glm::length(normal);
+        for (int c = 0; c < 3; c++) {
+            unsigned int vertex = simplifier.welded[simplifier.corner(triangle, c)];
+            if (length > 0.0)
+                simplifier.quadrics[vertex].addPlane(normal / length, -glm::dot(normal, p0) / length, length * 0.5);
+            simplifier.triangles[vertex].push_back(triangle);
+        }
+    }
+}
+
+void buildLodChain(const MeshData& mesh, LodChain& chain, size_t maxLevels, size_t minimumTriangles, LodBuildStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    chain.indices = mesh.indices;
+    chain.levels.assign(1, LodLevel());
+    chain.levels[0].indexCount = (uint32_t)mesh.indices.size();
+
+    Simplifier simplifier;
+    prepare(simplifier, mesh);
+    for (unsigned int triangle = 0; triangle < (unsigned int)mesh.triangleCount(); triangle++)
+        simplifier.pushEdges(triangle);
+
+    LodBuildStats local;
+    for (size_t i = 0; i < mesh.vertexCount(); i++)
+        local.lockedVertices += simplifier.locked[simplifier.welded[i]] ? 1 : 0;
+
+    float error = 0.0f;
+    size_t previous = mesh.triangleCount();
+    size_t target = previous / 2;
+    while (chain.levels.size() < maxLevels && target >= minimumTriangles) {
+        bool exhausted = true;
+        while (!simplifier.queue.empty()) {
+            Collapse candidate = simplifier.queue.top();
+            simplifier.queue.pop();
+            unsigned int to = simplifier.welded[candidate.to];
+            if (simplifier.removed[candidate.from] || simplifier.removed[to] ||
+                simplifier.versions[candidate.from] != candidate.fromVersion || simplifier.versions[to] != candidate.toVersion)
+                continue;
+            if (!simplifier.canCollapse(candidate.from, candidate.to)) {
+                local.rejectedCollapses++;
+                continue;
+            }
+            const Quadric& merged = simplifier.quadrics[candidate.from];
+            double area = merged.area + simplifier.quadrics[to].area;
+            error = std::max(error, (float)std::sqrt(candidate.cost / std::max(area, 1e-30)));
+            simplifier.collapse(candidate.from, candidate.to);
+            local.collapses++;
+            if (simplifier.liveTriangles <= target) {
+                exhausted = false;
+                break;
+            }
+        }
+        //Out of collapses: keep what was reached if it is still a worthwhile step
+        if (exhausted && simplifier.liveTriangles * 4 > previous * 3)
+            break;
+        simplifier.appendLevel(chain, error);
+        previous = simplifier.liveTriangles;
+        target = previous / 2;
+        if (exhausted)
+            break;
+    }
+
+    local.buildMs = millisecondsSince(start);
+    if (stats != nullptr)
+        *stats = local;
+}
+
+float lodPixelScale(float viewportHeight, float fovY) {
+    return viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+}
+
+size_t selectLod(const LodChain& chain, size_t current, float pixelsPerUnit, const LodSelection& selection) {
+    size_t levelCount = chain.levels.size();
+    size_t level = std::min(current, levelCount - 1);
+    //Finer while the current level shows too much error, then coarser only with margin to spare
+    while (level > 0 && chain.levels[level].error * pixelsPerUnit > selection.pixelError)
+        level--;
+    float coarsen = selection.pixelError * (1.0f - selection.hysteresis);
+    while (level + 1 < levelCount && chain.levels[level + 1].error * pixelsPerUnit <= coarsen)
+        level++;
+    return level;
+}
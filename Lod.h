@@ -0,0 +1,60 @@
+#pragma once
+/*Level of detail: simplified index buffers built at load time, and the per frame choice between them.
+buildLodChain simplifies a mesh with quadric error metrics (Garland, Heckbert 1997): every vertex carries the sum
+of the squared distances to the planes of its original triangles, and the edge whose collapse adds the least to
+that sum goes first. Collapses move a vertex onto a neighbour (half edge collapse) instead of to a new position,
+so every level indexes the mesh's own vertices and all levels share one vertex buffer. Each level halves the
+triangles of the one before. Its error is the largest area weighted RMS distance, over the collapses so far,
+between the vertex collapsed onto and the original planes it gathered.
+Border and seam vertices (several vertices at one position) never move, so outlines and attribute seams do not
+crack.
+selectLod turns a level's error into pixels at the object's distance and picks the coarsest level that stays
+under the threshold. A level is only given up for a coarser one once it is clearly below the threshold, so objects
+near a switching distance do not flip between levels from frame to frame.*/
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MeshData;
+
+//-- One level: a range of the chain's indices
+struct LodLevel {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f;   //model units, 0 for the full mesh
+};
+
+//-- Index buffers of every level back to back, finest first, all over the mesh's unchanged vertices
+struct LodChain {
+    std::vector<unsigned int> indices;
+    std::vector<LodLevel> levels;
+
+    size_t triangleCount(size_t level) const { return levels[level].indexCount / 3; }
+};
+
+//-- What one buildLodChain did
+struct LodBuildStats {
+    size_t collapses = 0;
+    size_t rejectedCollapses = 0;   //would have flipped a triangle or pinched the surface
+    size_t lockedVertices = 0;      //border and seam vertices
+    double buildMs = 0.0;
+};
+
+//-- Thresholds for selectLod
+struct LodSelection {
+    float pixelError = 1.0f;    //largest projected error allowed, pixels
+    float hysteresis = 0.25f;   //a coarser level is taken once its error is below pixelError * (1 - hysteresis)
+};
+
+//Build up to maxLevels levels, level 0 is the mesh as it is. Simplification stops early once a level would keep
+//more than 3/4 of the previous one's triangles or drop below minimumTriangles.
+void buildLodChain(const MeshData& mesh, LodChain& chain, size_t maxLevels = 6, size_t minimumTriangles = 16,
+    LodBuildStats* stats = nullptr);
+
+//Pixels one unit covers at distance 1 under a perspective projection with this vertical field of view (radians)
+float lodPixelScale(float viewportHeight, float fovY);
+
+//Level to draw an object with, given the level it had last frame and how many pixels one of its model units
+//covers now (lodPixelScale * object scale / distance)
+size_t selectLod(const LodChain& chain, size_t current, float pixelsPerUnit,
+    const LodSelection& selection = LodSelection());
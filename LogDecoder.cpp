@@ -0,0 +1,67 @@
+//Offline decoder for binary transform logs (TransformLogFormat::Binary).
+//Reproduces the text the app writes to sample_output.txt:
+//  OpenGLIntroLogDecode transforms.bin [sample_output.txt]
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "TransformLog.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: OpenGLIntroLogDecode <binary log> [text output, default stdout]" << std::endl;
+        return 1;
+    }
+
+    FILE* in = std::fopen(argv[1], "rb");
+    if (in == nullptr) {
+        std::cerr << "Error opening " << argv[1] << std::endl;
+        return 1;
+    }
+
+    TransformLogHeader header;
+    if (std::fread(&header, sizeof(header), 1, in) != 1 ||
+        std::memcmp(header.magic, transformLogMagic, sizeof(header.magic)) != 0) {
+        std::cerr << argv[1] << " is not a binary transform log" << std::endl;
+        std::fclose(in);
+        return 1;
+    }
+    if (header.version != transformLogVersion || header.recordSize != sizeof(TransformLogRecord)) {
+        std::cerr << "Unsupported transform log version " << header.version
+            << " (record size " << header.recordSize << ")" << std::endl;
+        std::fclose(in);
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if (argc == 3) {
+        out = std::fopen(argv[2], "w");
+        if (out == nullptr) {
+            std::cerr << "Error opening " << argv[2] << std::endl;
+            std::fclose(in);
+            return 1;
+        }
+    }
+
+    //Decode in chunks so large logs need constant memory
+    const size_t chunkRecords = 4096;
+    std::vector<TransformLogRecord> records(chunkRecords);
+    std::string text;
+    size_t total = 0;
+    size_t count;
+    while ((count = std::fread(records.data(), sizeof(TransformLogRecord), chunkRecords, in)) > 0) {
+        text.clear();
+        for (size_t i = 0; i < count; i++)
+            appendTransformText(text, records[i]);
+        std::fwrite(text.data(), 1, text.size(), out);
+        total += count;
+    }
+
+    std::fclose(in);
+    if (out != stdout)
+        std::fclose(out);
+    std::cerr << "Decoded " << total << " records" << std::endl;
+    return 0;
+}
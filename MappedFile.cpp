@@ -0,0 +1,103 @@
+#include "MappedFile.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+bool MappedFile::open(const char* path) {
+    close();
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Error opening " << path << std::endl;
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        std::cerr << "Error reading the size of " << path << std::endl;
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    length = (size_t)size.QuadPart;
+    opened = true;
+    //Mapping an empty file fails, leave it unmapped
+    if (length == 0)
+        return true;
+
+    mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle != nullptr)
+        view = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        std::cerr << "Error mapping " << path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (view != nullptr)
+        UnmapViewOfFile(view);
+    if (mappingHandle != nullptr)
+        CloseHandle(mappingHandle);
+    if (fileHandle != nullptr)
+        CloseHandle(fileHandle);
+    view = nullptr;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+    length = 0;
+    opened = false;
+}
+#else
+bool MappedFile::open(const char* path) {
+    close();
+    int file = ::open(path, O_RDONLY);
+    if (file < 0) {
+        std::cerr << "Error opening " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(file, &info) != 0) {
+        std::cerr << "Error reading the size of " << path << std::endl;
+        ::close(file);
+        return false;
+    }
+    length = (size_t)info.st_size;
+    opened = true;
+    if (length > 0) {
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapped == MAP_FAILED) {
+            std::cerr << "Error mapping " << path << std::endl;
+            ::close(file);
+            length = 0;
+            opened = false;
+            return false;
+        }
+        //Parsers read front to back
+        madvise(mapped, length, MADV_SEQUENTIAL);
+        view = (const char*)mapped;
+    }
+    //The mapping keeps the file alive
+    ::close(file);
+    return true;
+}
+
+void MappedFile::close() {
+    if (view != nullptr)
+        munmap((void*)view, length);
+    view = nullptr;
+    length = 0;
+    opened = false;
+}
+#endif
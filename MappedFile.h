@@ -0,0 +1,29 @@
+#pragma once
+//Read-only memory mapped file. The pages are loaded by the OS on first touch, so parsers and
+//uploads can read a large file without copying it into a buffer first.
+#include <cstddef>
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //Map the whole file. Prints to std::cerr and returns false on failure. An empty file maps to data() == nullptr.
+    bool open(const char* path);
+    void close();
+
+    bool isOpen() const { return opened; }
+    const char* data() const { return view; }
+    size_t size() const { return length; }
+
+private:
+    const char* view = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,831 @@
+#include "MeshImporter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <gtc/quaternion.hpp>
+#include <gtc/type_ptr.hpp>
+
+#include "JobSystem.h"
+#include "Json.h"
+#include "MappedFile.h"
+#include "Utility.h"
+
+//OBJ text per parse job at least, and jobs per thread at most
+static const size_t objChunkBytes = 1 << 20;
+static const size_t objChunksPerThread = 8;
+//Keys per job when hashing, and vertices / corners per job when copying glTF attributes
+static const size_t dedupChunkKeys = 65536;
+static const size_t gltfRangeSize = 65536;
+//Dedup hash maps, indexed by the top bits of the key hash
+static const int dedupShardBits = 6;
+static const int dedupShardCount = 1 << dedupShardBits;
+
+template <class Function>
+static void parallelRun(JobSystem& jobs, size_t count, size_t grain, Function& fn) {
+    JobCounter done;
+    jobs.parallelFor(count, grain, fn, done);
+    jobs.wait(done);
+}
+
+//======================DEDUPLICATION======================
+struct ObjKeyHash {
+    uint64_t operator()(uint64_t key) const { return mixHash(key); }
+};
+
+//-- glTF vertex identity: the exact bits of the transformed position and normal
+struct GltfVertexKey {
+    float position[3];
+    float normal[3];
+
+    bool operator==(const GltfVertexKey& other) const { return std::memcmp(this, &other, sizeof(*this)) == 0; }
+};
+
+struct GltfKeyHash {
+    uint64_t operator()(const GltfVertexKey& key) const {
+        uint32_t words[6];
+        std::memcpy(words, &key, sizeof(words));
+        uint64_t hash = 0;
+        for (int i = 0; i < 6; i += 2)
+            hash = mixHash(hash ^ ((uint64_t)words[i] << 32 | words[i + 1]));
+        return hash;
+    }
+};
+
+//Number equal keys in first use order: ids[i] is the id of keys[i], firstUse[id] the first i holding that key.
+//Keys are bucketed into shards by hash (keeping index order inside a shard), each shard gets its own
+//hash map on a job, then one cheap sequential pass turns "first equal index" into dense ids.
+template <class Key, class Hash>
+static void deduplicate(const std::vector<Key>& keys, JobSystem& jobs, std::vector<unsigned int>& ids,
+    std::vector<unsigned int>& firstUse) {
+    size_t count = keys.size();
+    Hash hash;
+    size_t chunkCount = (count + dedupChunkKeys - 1) / dedupChunkKeys;
+    chunkCount = std::max<size_t>(1, std::min<size_t>(chunkCount, (size_t)jobs.threadCount() * 4));
+    size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+    std::vector<unsigned char> shardOf(count);
+    std::vector<size_t> offsets(chunkCount * dedupShardCount, 0);
+    auto countShards = [&](size_t begin, size_t end, int) {
+        for (size_t chunk = begin; chunk < end; chunk++) {
+            size_t* chunkCounts = &offsets[chunk * dedupShardCount];
+            size_t last = std::min(count, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < last; i++) {
+                unsigned int shard = (unsigned int)(hash(keys[i]) >> (64 - dedupShardBits));
+                shardOf[i] = (unsigned char)shard;
+                chunkCounts[shard]++;
+            }
+        }
+    };
+    parallelRun(jobs, chunkCount, 1, countShards);
+
+    //Shard runs one after another, and inside a run each chunk's keys after the previous chunk's
+    std::vector<size_t> shardStart(dedupShardCount + 1);
+    size_t offset = 0;
+    for (int shard = 0; shard < dedupShardCount; shard++) {
+        shardStart[shard] = offset;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            size_t n = offsets[chunk * dedupShardCount + shard];
+            offsets[chunk * dedupShardCount + shard] = offset;
+            offset += n;
+        }
+    }
+    shardStart[dedupShardCount] = offset;
+
+    std::vector<unsigned int> order(count);
+    auto scatter = [&](size_t begin, size_t end, int) {
+        for (size_t chunk = begin; chunk < end; chunk++) {
+            size_t* chunkOffsets = &offsets[chunk * dedupShardCount];
+            size_t last = std::min(count, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < last; i++)
+                order[chunkOffsets[shardOf[i]]++] = (unsigned int)i;
+        }
+    };
+    parallelRun(jobs, chunkCount, 1, scatter);
+
+    //ids[i] = first index with an equal key, found in the shard's open addressing table
+    ids.resize(count);
+    auto insertShards = [&](size_t begin, size_t end, int) {
+        std::vector<unsigned int> table;
+        for (size_t shard = begin; shard < end; shard++) {
+            size_t first = shardStart[shard], last = shardStart[shard + 1];
+            size_t capacity = 16;
+            while (capacity < (last - first) * 2)
+                capacity *= 2;
+            table.assign(capacity, 0xFFFFFFFFu);
+            for (size_t j = first; j < last; j++) {
+                unsigned int i = order[j];
+                size_t slot = (size_t)hash(keys[i]) & (capacity - 1);
+                for (;;) {
+                    unsigned int entry = table[slot];
+                    if (entry == 0xFFFFFFFFu) {
+                        table[slot] = i;
+                        ids[i] = i;
+                        break;
+                    }
+                    if (keys[entry] == keys[i]) {
+                        ids[i] = entry;
+                        break;
+                    }
+                    slot = (slot + 1) & (capacity - 1);
+                }
+            }
+        }
+    };
+    parallelRun(jobs, dedupShardCount, 1, insertShards);
+
+    //An earlier first use already holds its dense id
+    firstUse.clear();
+    for (size_t i = 0; i < count; i++) {
+        unsigned int first = ids[i];
+        if (first == i) {
+            ids[i] = (unsigned int)firstUse.size();
+            firstUse.push_back((unsigned int)i);
+        }
+        else {
+            ids[i] = ids[first];
+        }
+    }
+}
+
+static void computeBounds(MeshData& mesh) {
+    glm::vec3 low(0.0f), high(0.0f);
+    size_t count = mesh.vertexCount();
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 p(mesh.positions[i * 3], mesh.positions[i * 3 + 1], mesh.positions[i * 3 + 2]);
+        low = i == 0 ? p : glm::min(low, p);
+        high = i == 0 ? p : glm::max(high, p);
+    }
+    mesh.boundsMin = low;
+    mesh.boundsMax = high;
+}
+
+//======================OBJ======================
+//Corner indices while parsing: absolute (0 based), chunk relative (from negative OBJ indices) or missing
+static const int64_t objRelativeIndex = (int64_t)1 << 62;
+static const int64_t objNoIndex = -1;
+
+//-- One chunk of whole lines and what it declared
+struct ObjChunk {
+    size_t begin = 0;
+    size_t end = 0;
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<int64_t> corners;   //v, vn per triangle corner
+    size_t errorOffset = 0;         //byte of the first bad line, 0 = none
+};
+
+static const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    return p;
+}
+
+static bool parseObjFloat(const char*& p, const char* end, float& value) {
+    p = skipBlanks(p, end);
+    if (p < end && *p == '+')
+        p++;
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec != std::errc())
+        return false;
+    p = result.ptr;
+    return true;
+}
+
+//OBJ index (1 based, or negative counting back from the last declared element) to the corner encoding
+static bool parseObjIndex(const char*& p, const char* end, size_t declared, int64_t& index) {
+    long long value = 0;
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec != std::errc() || value == 0)
+        return false;
+    p = result.ptr;
+    index = value > 0 ? value - 1 : objRelativeIndex + (int64_t)declared + value;
+    return true;
+}
+
+//"v", "v/vt", "v//vn" or "v/vt/vn"; texture coordinates are skipped
+static bool parseObjCorner(const char*& p, const char* end, const ObjChunk& chunk, int64_t& v, int64_t& vn) {
+    if (!parseObjIndex(p, end, chunk.positions.size() / 3, v))
+        return false;
+    vn = objNoIndex;
+    if (p < end && *p == '/') {
+        p++;
+        if (p < end && *p != '/') {
+            long long texture = 0;
+            std::from_chars_result result = std::from_chars(p, end, texture);
+            if (result.ec != std::errc())
+                return false;
+            p = result.ptr;
+        }
+        if (p < end && *p == '/') {
+            p++;
+            if (!parseObjIndex(p, end, chunk.normals.size() / 3, vn))
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool parseObjLine(const char* p, const char* end, ObjChunk& chunk) {
+    p = skipBlanks(p, end);
+    if (end - p < 2)
+        return true;
+    if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+        p += 2;
+        float xyz[3];
+        for (float& value : xyz) {
+            if (!parseObjFloat(p, end, value))
+                return false;
+        }
+        chunk.positions.insert(chunk.positions.end(), xyz, xyz + 3);
+        return true;
+    }
+    if (p[0] == 'v' && p[1] == 'n' && end - p > 2 && (p[2] == ' ' || p[2] == '\t')) {
+        p += 3;
+        float xyz[3];
+        for (float& value : xyz) {
+            if (!parseObjFloat(p, end, value))
+                return false;
+        }
+        chunk.normals.insert(chunk.normals.end(), xyz, xyz + 3);
+        return true;
+    }
+    if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+        p += 2;
+        //Fan triangulation around the first corner
+        int64_t first[2] = {}, previous[2] = {};
+        int corners = 0;
+        for (;;) {
+            p = skipBlanks(p, end);
+            if (p >= end || *p == '\r' || *p == '#')
+                break;
+            int64_t v, vn;
+            if (!parseObjCorner(p, end, chunk, v, vn))
+                return false;
+            if (corners >= 2) {
+                int64_t triangle[6] = { first[0], first[1], previous[0], previous[1], v, vn };
+                chunk.corners.insert(chunk.corners.end(), triangle, triangle + 6);
+            }
+            if (corners == 0) {
+                first[0] = v;
+                first[1] = vn;
+            }
+            previous[0] = v;
+            previous[1] = vn;
+            corners++;
+        }
+        return corners >= 3;
+    }
+    //Comments, texture coordinates, groups, materials, smoothing
+    return true;
+}
+
+static void parseObjChunk(const char* text, ObjChunk& chunk) {
+    const char* p = text + chunk.begin;
+    const char* end = text + chunk.end;
+    while (p < end) {
+        const char* lineEnd = (const char*)std::memchr(p, '\n', end - p);
+        if (lineEnd == nullptr)
+            lineEnd = end;
+        if (!parseObjLine(p, lineEnd, chunk)) {
+            chunk.errorOffset = (size_t)(p - text) + 1;
+            return;
+        }
+        p = lineEnd + 1;
+    }
+}
+
+//Corner encoding to a global 0 based index, or -1 if it is outside [0, total)
+static int64_t resolveObjIndex(int64_t index, size_t chunkOffset, size_t total) {
+    if (index == objNoIndex)
+        return objNoIndex;
+    if (index >= objRelativeIndex / 2)
+        index = (int64_t)chunkOffset + (index - objRelativeIndex);
+    return index >= 0 && (size_t)index < total ? index : -2;
+}
+
+bool importObj(const char* text, size_t length, MeshData& mesh, JobSystem& jobs, MeshImportStats* stats) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mesh = MeshData();
+
+    //Chunks end after a newline so no line is split
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(length / objChunkBytes, jobs.threadCount() * objChunksPerThread));
+    std::vector<ObjChunk> chunks(chunkCount);
+    size_t begin = 0;
+    for (size_t i = 0; i < chunkCount; i++) {
+        size_t end = i + 1 == chunkCount ? length : std::max(begin, length / chunkCount * (i + 1));
+        while (end < length && text[end - 1] != '\n')
+            end++;
+        chunks[i].begin = begin;
+        chunks[i].end = end;
+        begin = end;
+    }
+    auto parse = [&](size_t first, size_t last, int) {
+        for (size_t i = first; i < last; i++)
+            parseObjChunk(text, chunks[i]);
+    };
+    parallelRun(jobs, chunkCount, 1, parse);
+    for (const ObjChunk& chunk : chunks) {
+        if (chunk.errorOffset != 0) {
+            std::cerr << "OBJ parse error in the line at byte " << chunk.errorOffset - 1 << std::endl;
+            return false;
+        }
+    }
+
+    //Chunk offsets into the whole file's position / normal / corner lists
+    std::vector<size_t> positionOffset(chunkCount + 1, 0), normalOffset(chunkCount + 1, 0), cornerOffset(chunkCount + 1, 0);
+    for (size_t i = 0; i < chunkCount; i++) {
+        positionOffset[i + 1] = positionOffset[i] + chunks[i].positions.size() / 3;
+        normalOffset[i + 1] = normalOffset[i] + chunks[i].normals.size() / 3;
+        cornerOffset[i + 1] = cornerOffset[i] + chunks[i].corners.size() / 2;
+    }
+    size_t positionCount = positionOffset[chunkCount], normalCount = normalOffset[chunkCount];
+    size_t cornerCount = cornerOffset[chunkCount];
+    if (cornerCount >= 0xFFFFFFFFu || positionCount >= 0xFFFFFFFFu) {
+        std::cerr << "OBJ has too many faces for 32 bit indices" << std::endl;
+        return false;
+    }
+
+    //Gather the attributes and resolve corners into (position, normal + 1) keys
+    std::vector<float> positions(positionCount * 3), normals(normalCount * 3);
+    std::vector<uint64_t> keys(cornerCount);
+    std::atomic<bool> badIndex{ false };
+    std::atomic<bool> anyNormal{ false };
+    auto gather = [&](size_t first, size_t last, int) {
+        for (size_t i = first; i < last; i++) {
+            const ObjChunk& chunk = chunks[i];
+            if (!chunk.positions.empty())
+                std::memcpy(&positions[positionOffset[i] * 3], chunk.positions.data(), chunk.positions.size() * sizeof(float));
+            if (!chunk.normals.empty())
+                std::memcpy(&normals[normalOffset[i] * 3], chunk.normals.data(), chunk.normals.size() * sizeof(float));
+            bool normal = false;
+            for (size_t c = 0; c < chunk.corners.size() / 2; c++) {
+                int64_t v = resolveObjIndex(chunk.corners[c * 2], positionOffset[i], positionCount);
+                int64_t vn = resolveObjIndex(chunk.corners[c * 2 + 1], normalOffset[i], normalCount);
+                if (v < 0 || vn == -2) {
+                    badIndex.store(true);
+                    return;
+                }
+                normal |= vn >= 0;
+                keys[cornerOffset[i] + c] = (uint64_t)v << 32 | (uint64_t)(vn + 1);
+            }
+            if (normal)
+                anyNormal.store(true);
+        }
+    };
+    parallelRun(jobs, chunkCount, 1, gather);
+    chunks.clear();
+    if (badIndex.load()) {
+        std::cerr << "OBJ face refers to a vertex or normal that does not exist" << std::endl;
+        return false;
+    }
+    double parseMs = millisecondsSince(start);
+
+    std::vector<unsigned int> firstUse;
+    deduplicate<uint64_t, ObjKeyHash>(keys, jobs, mesh.indices, firstUse);
+    double dedupMs = millisecondsSince(start) - parseMs;
+
+    size_t vertexCount = firstUse.size();
+    mesh.positions.resize(vertexCount * 3);
+    if (anyNormal.load())
+        mesh.normals.resize(vertexCount * 3, 0.0f);
+    auto build = [&](size_t first, size_t last, int) {
+        for (size_t id = first; id < last; id++) {
+            uint64_t key = keys[firstUse[id]];
+            size_t v = (size_t)(key >> 32), vn = (size_t)(key & 0xFFFFFFFFu);
+            std::memcpy(&mesh.positions[id * 3], &positions[v * 3], 3 * sizeof(float));
+            if (vn > 0 && !mesh.normals.empty())
+                std::memcpy(&mesh.normals[id * 3], &normals[(vn - 1) * 3], 3 * sizeof(float));
+        }
+    };
+    parallelRun(jobs, vertexCount, gltfRangeSize, build);
+    computeBounds(mesh);
+
+    if (stats != nullptr) {
+        stats->fileBytes = length;
+        stats->sourceVertices = cornerCount;
+        stats->parseMs = parseMs;
+        stats->dedupMs = dedupMs;
+        stats->buildMs = millisecondsSince(start) - parseMs - dedupMs;
+        stats->totalMs = millisecondsSince(start);
+    }
+    return true;
+}
+
+//======================GLTF======================
+static const uint32_t glbMagic = 0x46546C67;      //"glTF"
+static const uint32_t glbChunkJson = 0x4E4F534A;  //"JSON"
+static const uint32_t glbChunkBin = 0x004E4942;   //"BIN\0"
+static const int gltfFloat = 5126;
+static const int gltfTriangles = 4;
+
+//-- Strided view of one accessor inside the BIN chunk
+struct GltfAccessor {
+    const unsigned char* data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+    int componentType = 0;
+    int components = 0;
+};
+
+//Largest index, count or byte size taken from the JSON: GLB chunk lengths are 32 bit
+static const double gltfMaxSize = 4294967295.0;
+
+//A JSON number used as an index, count or byte size: finite, whole and in [0, gltfMaxSize]
+static bool gltfSize(double value, size_t& size) {
+    if (!(value >= 0.0 && value <= gltfMaxSize) || value != std::floor(value))
+        return false;
+    size = (size_t)value;
+    return true;
+}
+
+//Index into a JSON array, or -1 (never in range) if the number is not a valid one
+static size_t gltfIndex(double value) {
+    size_t index = 0;
+    return gltfSize(value, index) ? index : (size_t)-1;
+}
+
+static int gltfComponentSize(int componentType) {
+    switch (componentType) {
+    case 5120: case 5121: return 1;
+    case 5122: case 5123: return 2;
+    case 5125: case 5126: return 4;
+    }
+    return 0;
+}
+
+static int gltfComponentCount(const std::string& type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    if (type == "MAT4") return 16;
+    return 0;
+}
+
+static bool readGltfAccessor(const JsonValue& document, double index, const unsigned char* bin, size_t binLength,
+    GltfAccessor& accessor) {
+    const JsonValue* accessors = document.find("accessors");
+    const JsonValue* views = document.find("bufferViews");
+    size_t accessorIndex = gltfIndex(index);
+    if (accessors == nullptr || !accessors->isArray() || accessorIndex >= accessors->items.size())
+        return false;
+    const JsonValue& a = accessors->items[accessorIndex];
+    const JsonValue* type = a.find("type");
+    size_t viewIndex = gltfIndex(a.numberOr("bufferView", -1.0));
+    if (type == nullptr || views == nullptr || viewIndex >= views->items.size())
+        return false;  //sparse or zero filled accessors are not supported
+    const JsonValue& view = views->items[viewIndex];
+    if (view.numberOr("buffer", 0.0) != 0.0)
+        return false;  //only the GLB's own BIN chunk
+
+    size_t componentType = 0, viewOffset = 0, viewLength = 0, offset = 0;
+    if (!gltfSize(a.numberOr("componentType", 0.0), componentType) ||
+        !gltfSize(a.numberOr("count", 0.0), accessor.count) ||
+        !gltfSize(view.numberOr("byteOffset", 0.0), viewOffset) ||
+        !gltfSize(view.numberOr("byteLength", 0.0), viewLength) ||
+        !gltfSize(a.numberOr("byteOffset", 0.0), offset))
+        return false;
+    accessor.componentType = gltfComponentSize((int)componentType) > 0 ? (int)componentType : 0;
+    accessor.components = gltfComponentCount(type->string);
+    size_t elementSize = (size_t)gltfComponentSize(accessor.componentType) * accessor.components;
+    if (elementSize == 0 || !gltfSize(view.numberOr("byteStride", (double)elementSize), accessor.stride) ||
+        accessor.stride < elementSize)
+        return false;
+    //Every term checked against what is left, so no sum or product can wrap
+    if (viewOffset > binLength || viewLength > binLength - viewOffset)
+        return false;
+    if (accessor.count > 0 && (offset > viewLength || elementSize > viewLength - offset ||
+        accessor.count - 1 > (viewLength - offset - elementSize) / accessor.stride))
+        return false;
+    accessor.data = bin + viewOffset + offset;
+    return true;
+}
+
+static glm::mat4 gltfNodeMatrix(const JsonValue& node) {
+    const JsonValue* matrix = node.find("matrix");
+    if (matrix != nullptr && matrix->isArray() && matrix->items.size() == 16) {
+        float values[16];
+        for (int i = 0; i < 16; i++)
+            values[i] = (float)matrix->items[i].number;
+        return glm::make_mat4(values); //column major like glTF
+    }
+    glm::vec3 translation(0.0f), scale(1.0f);
+    glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+    const JsonValue* t = node.find("translation");
+    const JsonValue* r = node.find("rotation");
+    const JsonValue* s = node.find("scale");
+    if (t != nullptr && t->items.size() == 3)
+        translation = glm::vec3(t->items[0].number, t->items[1].number, t->items[2].number);
+    if (r != nullptr && r->items.size() == 4) //glTF stores x, y, z, w
+        rotation = glm::quat((float)r->items[3].number, (float)r->items[0].number, (float)r->items[1].number, (float)r->items[2].number);
+    if (s != nullptr && s->items.size() == 3)
+        scale = glm::vec3(s->items[0].number, s->items[1].number, s->items[2].number);
+    return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+}
+
+//-- One mesh instance to import
+struct GltfDraw {
+    size_t mesh;
+    glm::mat4 world;
+};
+
+static void collectGltfDraws(const JsonValue& nodes, size_t index, const glm::mat4& parent, int depth,
+    std::vector<GltfDraw>& draws) {
+    if (index >= nodes.items.size() || depth > 64) //bad index or a cycle
+        return;
+    const JsonValue& node = nodes.items[index];
+    glm::mat4 world = parent * gltfNodeMatrix(node);
+    size_t mesh = gltfIndex(node.numberOr("mesh", -1.0));
+    if (mesh != (size_t)-1)
+        draws.push_back(GltfDraw{ mesh, world });
+    const JsonValue* children = node.find("children");
+    if (children != nullptr) {
+        for (const JsonValue& child : children->items)
+            collectGltfDraws(nodes, gltfIndex(child.number), world, depth + 1, draws);
+    }
+}
+
+//-- One triangle primitive of one draw, and where it lands in the source vertex / corner lists
+struct GltfPrimitive {
+    GltfAccessor position;
+    GltfAccessor normal;      //data == nullptr if none
+    GltfAccessor indices;     //data == nullptr if not indexed
+    glm::mat4 world;
+    glm::mat3 normalMatrix;
+    size_t vertexBase = 0;
+    size_t cornerBase = 0;
+    size_t cornerCount = 0;
+};
+
+//-- Part of a primitive's vertices or corners, the unit of parallel work
+struct GltfRange {
+    size_t primitive;
+    size_t begin;
+    size_t end;
+    bool corners;
+};
+
+static size_t readGltfIndex(const GltfAccessor& indices, size_t i) {
+    const unsigned char* p = indices.data + i * indices.stride;
+    switch (indices.componentType) {
+    case 5121: return *p;
+    case 5123: { uint16_t v; std::memcpy(&v, p, 2); return v; }
+    case 5125: { uint32_t v; std::memcpy(&v, p, 4); return v; }
+    }
+    return (size_t)-1;
+}
+
+bool importGlb(const char* data, size_t length, MeshData& mesh, JobSystem& jobs, MeshImportStats* stats) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mesh = MeshData();
+
+    //Header, then a JSON chunk and an optional BIN chunk
+    uint32_t header[3] = {};
+    if (length >= 20)
+        std::memcpy(header, data, sizeof(header));
+    if (header[0] != glbMagic || header[1] != 2) {
+        std::cerr << "Not a glTF 2.0 binary file" << std::endl;
+        return false;
+    }
+    const char* json = nullptr;
+    const unsigned char* bin = nullptr;
+    size_t jsonLength = 0, binLength = 0;
+    size_t offset = 12;
+    size_t end = std::min<size_t>(length, header[2]);
+    while (offset + 8 <= end) {
+        uint32_t chunk[2];
+        std::memcpy(chunk, data + offset, 8);
+        if (offset + 8 + chunk[0] > end)
+            break;
+        if (chunk[1] == glbChunkJson && json == nullptr) {
+            json = data + offset + 8;
+            jsonLength = chunk[0];
+        }
+        else if (chunk[1] == glbChunkBin && bin == nullptr) {
+            bin = (const unsigned char*)data + offset + 8;
+            binLength = chunk[0];
+        }
+        offset += 8 + ((chunk[0] + 3) & ~3u);
+    }
+    JsonValue document;
+    std::string error;
+    if (json == nullptr || !parseJson(json, jsonLength, document, error)) {
+        std::cerr << "glTF JSON chunk is missing or invalid: " << error << std::endl;
+        return false;
+    }
+
+    //Mesh instances of the default scene, or every mesh once if there is no node hierarchy
+    std::vector<GltfDraw> draws;
+    const JsonValue* nodes = document.find("nodes");
+    const JsonValue* scenes = document.find("scenes");
+    const JsonValue* meshes = document.find("meshes");
+    if (meshes == nullptr || !meshes->isArray()) {
+        std::cerr << "glTF file has no meshes" << std::endl;
+        return false;
+    }
+    if (nodes != nullptr && scenes != nullptr && !scenes->items.empty()) {
+        size_t scene = gltfIndex(document.numberOr("scene", 0.0));
+        const JsonValue* roots = scene < scenes->items.size() ? scenes->items[scene].find("nodes") : nullptr;
+        if (roots != nullptr) {
+            for (const JsonValue& root : roots->items)
+                collectGltfDraws(*nodes, gltfIndex(root.number), glm::mat4(1.0f), 0, draws);
+        }
+    }
+    else {
+        for (size_t i = 0; i < meshes->items.size(); i++)
+            draws.push_back(GltfDraw{ i, glm::mat4(1.0f) });
+    }
+
+    std::vector<GltfPrimitive> primitives;
+    size_t vertexCount = 0, cornerCount = 0;
+    bool anyNormal = false;
+    for (const GltfDraw& draw : draws) {
+        if (draw.mesh >= meshes->items.size())
+            continue;
+        const JsonValue* list = meshes->items[draw.mesh].find("primitives");
+        if (list == nullptr)
+            continue;
+        for (const JsonValue& item : list->items) {
+            const JsonValue* attributes = item.find("attributes");
+            if (item.numberOr("mode", gltfTriangles) != gltfTriangles || attributes == nullptr)
+                continue;  //points and lines have no triangles to draw
+            GltfPrimitive primitive;
+            if (!readGltfAccessor(document, attributes->numberOr("POSITION", -1.0), bin, binLength, primitive.position) ||
+                primitive.position.componentType != gltfFloat || primitive.position.components != 3) {
+                std::cerr << "glTF primitive without a readable float3 POSITION" << std::endl;
+                return false;
+            }
+            double normal = attributes->numberOr("NORMAL", -1.0);
+            if (normal >= 0.0 && (!readGltfAccessor(document, normal, bin, binLength, primitive.normal) ||
+                primitive.normal.componentType != gltfFloat || primitive.normal.components != 3 ||
+                primitive.normal.count != primitive.position.count))
+                primitive.normal = GltfAccessor();
+            double indices = item.numberOr("indices", -1.0);
+            if (indices >= 0.0 && (!readGltfAccessor(document, indices, bin, binLength, primitive.indices) ||
+                primitive.indices.components != 1 || gltfComponentSize(primitive.indices.componentType) == 0 ||
+                primitive.indices.componentType == gltfFloat)) {
+                std::cerr << "glTF primitive with unreadable indices" << std::endl;
+                return false;
+            }
+            size_t corners = primitive.indices.data != nullptr ? primitive.indices.count : primitive.position.count;
+            primitive.world = draw.world;
+            primitive.normalMatrix = glm::transpose(glm::inverse(glm::mat3(draw.world)));
+            primitive.vertexBase = vertexCount;
+            primitive.cornerBase = cornerCount;
+            primitive.cornerCount = corners / 3 * 3;
+            vertexCount += primitive.position.count;
+            cornerCount += primitive.cornerCount;
+            anyNormal |= primitive.normal.data != nullptr;
+            primitives.push_back(primitive);
+        }
+    }
+    if (vertexCount >= 0xFFFFFFFFu || cornerCount >= 0xFFFFFFFFu) {
+        std::cerr << "glTF scene has too many vertices for 32 bit indices" << std::endl;
+        return false;
+    }
+
+    //Copy transformed attributes (as dedup keys) and rebased corners out of the BIN chunk in ranges
+    std::vector<GltfRange> ranges;
+    for (size_t p = 0; p < primitives.size(); p++) {
+        for (size_t i = 0; i < primitives[p].position.count; i += gltfRangeSize)
+            ranges.push_back(GltfRange{ p, i, std::min(primitives[p].position.count, i + gltfRangeSize), false });
+        for (size_t i = 0; i < primitives[p].cornerCount; i += gltfRangeSize)
+            ranges.push_back(GltfRange{ p, i, std::min(primitives[p].cornerCount, i + gltfRangeSize), true });
+    }
+    std::vector<GltfVertexKey> keys(vertexCount);
+    std::vector<unsigned int> corners(cornerCount);
+    std::atomic<bool> badIndex{ false };
+    auto copy = [&](size_t first, size_t last, int) {
+        for (size_t r = first; r < last; r++) {
+            const GltfRange& range = ranges[r];
+            const GltfPrimitive& primitive = primitives[range.primitive];
+            if (range.corners) {
+                for (size_t i = range.begin; i < range.end; i++) {
+                    size_t index = primitive.indices.data != nullptr ? readGltfIndex(primitive.indices, i) : i;
+                    if (index >= primitive.position.count) {
+                        badIndex.store(true);
+                        return;
+                    }
+                    corners[primitive.cornerBase + i] = (unsigned int)(primitive.vertexBase + index);
+                }
+                continue;
+            }
+            for (size_t i = range.begin; i < range.end; i++) {
+                GltfVertexKey& key = keys[primitive.vertexBase + i];
+                glm::vec3 p;
+                std::memcpy(&p, primitive.position.data + i * primitive.position.stride, sizeof(p));
+                glm::vec3 world = glm::vec3(primitive.world * glm::vec4(p, 1.0f));
+                glm::vec3 normal(0.0f);
+                if (primitive.normal.data != nullptr) {
+                    std::memcpy(&normal, primitive.normal.data + i * primitive.normal.stride, sizeof(normal));
+                    float length = glm::length(primitive.normalMatrix * normal);
+                    normal = length > 0.0f ? primitive.normalMatrix * normal / length : glm::vec3(0.0f);
+                }
+                std::memcpy(key.position, &world, sizeof(key.position));
+                std::memcpy(key.normal, &normal, sizeof(key.normal));
+            }
+        }
+    };
+    parallelRun(jobs, ranges.size(), 1, copy);
+    if (badIndex.load()) {
+        std::cerr << "glTF index refers to a vertex that does not exist" << std::endl;
+        return false;
+    }
+    double parseMs = millisecondsSince(start);
+
+    std::vector<unsigned int> ids, firstUse;
+    deduplicate<GltfVertexKey, GltfKeyHash>(keys, jobs, ids, firstUse);
+    double dedupMs = millisecondsSince(start) - parseMs;
+
+    size_t uniqueCount = firstUse.size();
+    mesh.positions.resize(uniqueCount * 3);
+    if (anyNormal)
+        mesh.normals.resize(uniqueCount * 3);
+    mesh.indices.resize(cornerCount);
+    auto buildVertices = [&](size_t first, size_t last, int) {
+        for (size_t id = first; id < last; id++) {
+            const GltfVertexKey& key = keys[firstUse[id]];
+            std::memcpy(&mesh.positions[id * 3], key.position, sizeof(key.position));
+            if (anyNormal)
+                std::memcpy(&mesh.normals[id * 3], key.normal, sizeof(key.normal));
+        }
+    };
+    auto buildIndices = [&](size_t first, size_t last, int) {
+        for (size_t i = first; i < last; i++)
+            mesh.indices[i] = ids[corners[i]];
+    };
+    parallelRun(jobs, uniqueCount, gltfRangeSize, buildVertices);
+    parallelRun(jobs, cornerCount, gltfRangeSize, buildIndices);
+    computeBounds(mesh);
+
+    if (stats != nullptr) {
+        stats->fileBytes = length;
+        stats->sourceVertices = vertexCount;
+        stats->parseMs = parseMs;
+        stats->dedupMs = dedupMs;
+        stats->buildMs = millisecondsSince(start) - parseMs - dedupMs;
+        stats->totalMs = millisecondsSince(start);
+    }
+    return true;
+}
+
+//======================API======================
+static bool hasExtension(const std::string& path, const char* extension) {
+    size_t n = std::strlen(extension);
+    if (path.size() < n)
+        return false;
+    for (size_t i = 0; i < n; i++) {
+        if (std::tolower((unsigned char)path[path.size() - n + i]) != extension[i])
+            return false;
+    }
+    return true;
+}
+
+bool importMesh(const char* path, MeshData& mesh, JobSystem* jobs, MeshImportStats* stats) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool obj = hasExtension(path, ".obj");
+    if (!obj && !hasExtension(path, ".glb")) {
+        std::cerr << "Unsupported mesh format " << path << " (expected .obj or .glb)" << std::endl;
+        return false;
+    }
+    MappedFile file;
+    if (!file.open(path))
+        return false;
+    double mapMs = millisecondsSince(start);
+
+    std::unique_ptr<JobSystem> localJobs;
+    if (jobs == nullptr) {
+        localJobs.reset(new JobSystem());
+        jobs = localJobs.get();
+    }
+    bool imported = obj ? importObj(file.data(), file.size(), mesh, *jobs, stats)
+        : importGlb(file.data(), file.size(), mesh, *jobs, stats);
+    if (!imported) {
+        std::cerr << "Failed to import " << path << std::endl;
+        return false;
+    }
+    if (stats != nullptr) {
+        stats->mapMs = mapMs;
+        stats->totalMs = millisecondsSince(start);
+    }
+    return true;
+}
+
+glm::mat4 unitBoxTransform(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    glm::vec3 extent = boundsMax - boundsMin;
+    float largest = std::max(extent.x, std::max(extent.y, extent.z));
+    float scale = largest > 0.0f ? 1.0f / largest : 1.0f;
+    glm::mat4 transform(scale);
+    transform[3] = glm::vec4(-center * scale, 1.0f);
+    return transform;
+}
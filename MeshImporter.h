@@ -0,0 +1,50 @@
+#pragma once
+/*Mesh importer for Wavefront OBJ and binary glTF 2.0 (.glb).
+The file is memory mapped and parsed in parallel on a JobSystem:
+    OBJ  - the text is split into chunks at line ends, each chunk parses its v / vn / f lines on its own
+           (faces are fan triangulated), then chunk offsets resolve the indices.
+    glTF - the JSON chunk is read on the calling thread, then every node's triangle primitives are copied out
+           of the BIN chunk in ranges, with the node's world transform applied.
+Vertices are deduplicated through hash maps sharded by key hash (OBJ: position/normal index pair,
+glTF: position/normal bits) and numbered in first use order, so the result is the same as a sequential import.
+The output is what the pyramid VAO already uses: tightly packed xyz floats plus unsigned int triangle indices.*/
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm.hpp>
+
+class JobSystem;
+
+//-- Indexed triangle mesh
+struct MeshData {
+    std::vector<float> positions;         //xyz per vertex, same layout as verticesPyramid
+    std::vector<float> normals;           //xyz per vertex, empty if the source has none
+    std::vector<unsigned int> indices;    //3 per triangle
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
+    size_t vertexCount() const { return positions.size() / 3; }
+    size_t triangleCount() const { return indices.size() / 3; }
+};
+
+//-- Where the time of one import went
+struct MeshImportStats {
+    uint64_t fileBytes = 0;
+    size_t sourceVertices = 0;    //OBJ face corners, glTF primitive vertices
+    double mapMs = 0.0;
+    double parseMs = 0.0;         //text / JSON and attribute copies
+    double dedupMs = 0.0;
+    double buildMs = 0.0;         //final vertex and index arrays, bounds
+    double totalMs = 0.0;
+};
+
+//Load path by extension (.obj or .glb). jobs == nullptr uses a temporary system with a thread per core.
+//Prints the reason to std::cerr and returns false on failure.
+bool importMesh(const char* path, MeshData& mesh, JobSystem* jobs = nullptr, MeshImportStats* stats = nullptr);
+//Same on a file already in memory
+bool importObj(const char* text, size_t length, MeshData& mesh, JobSystem& jobs, MeshImportStats* stats = nullptr);
+bool importGlb(const char* data, size_t length, MeshData& mesh, JobSystem& jobs, MeshImportStats* stats = nullptr);
+
+//Model matrix that scales and centers the bounds into the pyramid's [-0.5, 0.5] box, keeping proportions
+glm::mat4 unitBoxTransform(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
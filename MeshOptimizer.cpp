@@ -0,0 +1,269 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <glm.hpp>
+
+#include "MeshImporter.h"
+#include "Utility.h"
+
+//-- FIFO cache by insertion time: a vertex is cached while fewer than size misses happened since its own
+struct CacheSimulation {
+    std::vector<unsigned int> stamps;
+    unsigned int time;
+    unsigned int size;
+
+    CacheSimulation(size_t vertexCount, unsigned int cacheSize) : stamps(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+    bool cached(unsigned int vertex) const { return time - stamps[vertex] <= size; }
+    //Returns 1 on a miss
+    unsigned int touch(unsigned int vertex) {
+        if (cached(vertex))
+            return 0;
+        stamps[vertex] = time++;
+        return 1;
+    }
+    //Age everything out
+    void flush() { time += size + 1; }
+};
+
+VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+    unsigned int cacheSize) {
+    VertexCacheStats stats;
+    CacheSimulation cache(vertexCount, cacheSize);
+    std::vector<char> referenced(vertexCount, 0);
+    size_t unique = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        stats.misses += cache.touch(indices[i]);
+        if (!referenced[indices[i]]) {
+            referenced[indices[i]] = 1;
+            unique++;
+        }
+    }
+    stats.acmr = indexCount > 0 ? (double)stats.misses / (indexCount / 3) : 0.0;
+    stats.atvr = unique > 0 ? (double)stats.misses / unique : 0.0;
+    return stats;
+}
+
+//======================VERTEX CACHE======================
+void optimizeVertexCache(MeshData& mesh, std::vector<unsigned int>* clusterStarts, unsigned int cacheSize) {
+    const std::vector<unsigned int>& indices = mesh.indices;
+    size_t vertexCount = mesh.vertexCount();
+    size_t triangleCount = indices.size() / 3;
+    if (clusterStarts != nullptr) {
+        clusterStarts->clear();
+        clusterStarts->push_back(0);
+    }
+    if (triangleCount == 0)
+        return;
+
+    //Triangles around each vertex (CSR), and how many of them are still to be emitted
+    std::vector<unsigned int> live(vertexCount, 0);
+    for (unsigned int vertex : indices)
+        live[vertex]++;
+    std::vector<size_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + live[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+        adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+    CacheSimulation cache(vertexCount, cacheSize);
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<unsigned int> deadEnds, candidates;
+    deadEnds.reserve(indices.size());
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    size_t scan = 0;
+
+    long long fan = 0;
+    while (live[fan] == 0)
+        fan++;
+    while (fan >= 0) {
+        //Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (size_t a = offsets[fan]; a < offsets[fan + 1]; a++) {
+            unsigned int triangle = adjacency[a];
+            if (emitted[triangle])
+                continue;
+            emitted[triangle] = 1;
+            for (int corner = 0; corner < 3; corner++) {
+                unsigned int vertex = indices[triangle * 3 + corner];
+                output.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                live[vertex]--;
+                cache.touch(vertex);
+            }
+        }
+
+        //Next fan: the candidate that stays cached longest while its remaining triangles are emitted
+        long long next = -1;
+        long long bestPriority = -1;
+        for (unsigned int vertex : candidates) {
+            if (live[vertex] == 0)
+                continue;
+            long long age = (long long)(cache.time - cache.stamps[vertex]);
+            long long priority = age + 2 * (long long)live[vertex] <= (long long)cacheSize ? age : 0;
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = vertex;
+            }
+        }
+        if (next < 0) {
+            //Dead end: back up through recently emitted vertices, then scan for any vertex with triangles left
+            while (!deadEnds.empty() && next < 0) {
+                unsigned int vertex = deadEnds.back();
+                deadEnds.pop_back();
+                if (live[vertex] > 0)
+                    next = vertex;
+            }
+            while (next < 0 && scan < vertexCount) {
+                if (live[scan] > 0)
+                    next = (long long)scan;
+                else
+                    scan++;
+            }
+            //The new fan starts from a cold cache
+            if (next >= 0 && !cache.cached((unsigned int)next) && clusterStarts != nullptr)
+                clusterStarts->push_back((unsigned int)(output.size() / 3));
+        }
+        fan = next;
+    }
+    mesh.indices.swap(output);
+}
+
+//======================OVERDRAW======================
+size_t optimizeOverdraw(MeshData& mesh, const std::vector<unsigned int>& clusterStarts, float threshold,
+    unsigned int cacheSize) {
+    const std::vector<unsigned int>& indices = mesh.indices;
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return 0;
+
+    //Split the hard clusters wherever the cluster so far is already as cache efficient as the whole one
+    //(within threshold), so the sort gets small units without costing much ACMR
+    std::vector<unsigned int> starts;
+    CacheSimulation cache(mesh.vertexCount(), cacheSize);
+    for (size_t c = 0; c < clusterStarts.size(); c++) {
+        size_t first = clusterStarts[c];
+        size_t last = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+        if (first >= last)
+            continue;
+        cache.flush();
+        size_t clusterMisses = 0;
+        for (size_t i = first * 3; i < last * 3; i++)
+            clusterMisses += cache.touch(indices[i]);
+        double limit = threshold * (double)clusterMisses / (double)(last - first);
+
+        cache.flush();
+        starts.push_back((unsigned int)first);
+        size_t runStart = first, runMisses = 0;
+        for (size_t t = first; t < last; t++) {
+            for (int corner = 0; corner < 3; corner++)
+                runMisses += cache.touch(indices[t * 3 + corner]);
+            if (t + 1 < last && (double)runMisses / (double)(t + 1 - runStart) <= limit) {
+                starts.push_back((unsigned int)(t + 1));
+                runStart = t + 1;
+                runMisses = 0;
+                cache.flush();
+            }
+        }
+    }
+
+    //Area weighted centroid and normal per cluster
+    auto position = [&](unsigned int vertex) {
+        return glm::vec3(mesh.positions[vertex * 3], mesh.positions[vertex * 3 + 1], mesh.positions[vertex * 3 + 2]);
+    };
+    size_t clusterCount = starts.size();
+    std::vector<glm::vec3> centroids(clusterCount), normals(clusterCount);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; c++) {
+        size_t first = starts[c];
+        size_t last = c + 1 < clusterCount ? starts[c + 1] : triangleCount;
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = first; t < last; t++) {
+            glm::vec3 a = position(indices[t * 3]), b = position(indices[t * 3 + 1]), d = position(indices[t * 3 + 2]);
+            glm::vec3 cross = glm::cross(b - a, d - a);
+            float weight = glm::length(cross);
+            centroid += (a + b + d) * (weight / 3.0f);
+            normal += cross;
+            area += weight;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids[c] = area > 0.0f ? centroid / area : position(indices[first * 3]);
+        float length = glm::length(normal);
+        normals[c] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    //Outward facing clusters first
+    std::vector<float> keys(clusterCount);
+    std::vector<unsigned int> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) {
+        keys[c] = glm::dot(centroids[c] - meshCentroid, normals[c]);
+        order[c] = (unsigned int)c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return keys[a] > keys[b]; });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (unsigned int c : order) {
+        size_t first = starts[c];
+        size_t last = c + 1 < clusterCount ? starts[c + 1] : triangleCount;
+        output.insert(output.end(), indices.begin() + first * 3, indices.begin() + last * 3);
+    }
+    mesh.indices.swap(output);
+    return clusterCount;
+}
+
+//======================VERTEX FETCH======================
+void optimizeVertexFetch(MeshData& mesh) {
+    size_t vertexCount = mesh.vertexCount();
+    bool hasNormals = !mesh.normals.empty();
+    std::vector<unsigned int> remap(vertexCount, 0xFFFFFFFFu);
+    std::vector<float> positions, normals;
+    positions.reserve(mesh.positions.size());
+    if (hasNormals)
+        normals.reserve(mesh.normals.size());
+    unsigned int next = 0;
+    for (unsigned int& index : mesh.indices) {
+        if (remap[index] == 0xFFFFFFFFu) {
+            remap[index] = next++;
+            positions.insert(positions.end(), &mesh.positions[index * 3], &mesh.positions[index * 3] + 3);
+            if (hasNormals)
+                normals.insert(normals.end(), &mesh.normals[index * 3], &mesh.normals[index * 3] + 3);
+        }
+        index = remap[index];
+    }
+    mesh.positions.swap(positions);
+    mesh.normals.swap(normals);
+}
+
+void optimizeMesh(MeshData& mesh, MeshOptimizeStats* stats) {
+    MeshOptimizeStats local;
+    MeshOptimizeStats& result = stats != nullptr ? *stats : local;
+    result = MeshOptimizeStats();
+    result.before = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount());
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<unsigned int> clusterStarts;
+    optimizeVertexCache(mesh, &clusterStarts);
+    result.vertexCacheMs = millisecondsSince(start);
+    result.afterVertexCache = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount());
+
+    start = std::chrono::steady_clock::now();
+    result.clusters = optimizeOverdraw(mesh, clusterStarts);
+    result.overdrawMs = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    optimizeVertexFetch(mesh);
+    result.vertexFetchMs = millisecondsSince(start);
+    result.after = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount());
+}
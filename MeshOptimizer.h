@@ -0,0 +1,52 @@
+#pragma once
+/*Load time index and vertex reordering for imported meshes, run before a mesh is packed (GeometryCache.h).
+    1. vertex cache - Tipsify (Sander, Nehab, Barczak 2007): fan around the vertex that is still in a simulated
+                      FIFO post-transform cache, so each vertex is shaded about once instead of up to six times
+    2. overdraw     - split the cache ordered triangles into clusters that each start with a cold cache, and draw
+                      the clusters that face away from the mesh center first; those tend to occlude the rest, so
+                      fewer fragments are shaded. Splits are only made where the cache cost stays within threshold.
+    3. vertex fetch - renumber vertices in first use order so the vertex shader reads the VBO front to back
+Quality is reported as ACMR (cache misses per triangle, 0.5 is ideal for a regular grid, 3 is the worst) and
+ATVR (cache misses per referenced vertex, 1 is ideal).*/
+#include <cstddef>
+#include <vector>
+
+struct MeshData;
+
+//FIFO entries simulated; small enough to be pessimistic for current GPUs
+const unsigned int postTransformCacheSize = 16;
+
+//-- Simulated post-transform cache behaviour of an index order
+struct VertexCacheStats {
+    size_t misses = 0;         //vertex shader invocations
+    double acmr = 0.0;
+    double atvr = 0.0;
+};
+
+//-- Before / after of optimizeMesh
+struct MeshOptimizeStats {
+    VertexCacheStats before;
+    VertexCacheStats afterVertexCache;
+    VertexCacheStats after;    //after overdraw ordering, vertex fetch does not change it
+    size_t clusters = 0;       //overdraw sort units
+    double vertexCacheMs = 0.0;
+    double overdrawMs = 0.0;
+    double vertexFetchMs = 0.0;
+};
+
+VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+    unsigned int cacheSize = postTransformCacheSize);
+
+//Reorder the triangles for cache reuse. clusterStarts (optional) receives the first triangle of every run that
+//starts with a cold cache, the input optimizeOverdraw needs.
+void optimizeVertexCache(MeshData& mesh, std::vector<unsigned int>* clusterStarts = nullptr,
+    unsigned int cacheSize = postTransformCacheSize);
+//Reorder the clusters front to back as seen from outside; the ACMR grows by at most threshold
+//Returns the number of clusters sorted.
+size_t optimizeOverdraw(MeshData& mesh, const std::vector<unsigned int>& clusterStarts, float threshold = 1.05f,
+    unsigned int cacheSize = postTransformCacheSize);
+//Renumber vertices (positions and normals) in first use order, dropping unreferenced ones
+void optimizeVertexFetch(MeshData& mesh);
+
+//All three in order
+void optimizeMesh(MeshData& mesh, MeshOptimizeStats* stats = nullptr);
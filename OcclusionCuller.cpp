@@ -0,0 +1,324 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <emmintrin.h>
+
+#include "JobSystem.h"
+
+//The SSE2 rasterizer is the x64 baseline; the AVX one is compiled for AVX on its own and only called after the CPU
+//check, as in VertexTransform.cpp
+#if defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#define OCCLUSION_AVX 1
+#define AVX_KERNEL
+#elif defined(__GNUC__)
+#include <immintrin.h>
+#define OCCLUSION_AVX 1
+#define AVX_KERNEL __attribute__((target("avx")))
+#endif
+
+//Clip w below which a vertex counts as at or behind the eye
+static const float nearW = 1e-4f;
+
+void OcclusionCuller::resize(int width, int height, int workers) {
+    tilesX = std::max(1, (width + occlusionTileSize - 1) / occlusionTileSize);
+    tilesY = std::max(1, (height + occlusionTileSize - 1) / occlusionTileSize);
+    bufferWidth = tilesX * occlusionTileSize;
+    bufferHeight = tilesY * occlusionTileSize;
+    levels.resize(occlusionLevels);
+    for (int level = 0; level < occlusionLevels; level++)
+        levels[level].assign((size_t)(bufferWidth >> level) * (bufferHeight >> level), 1.0f);
+    bins.assign(std::max(1, workers), Bins());
+    for (Bins& worker : bins)
+        worker.tiles.resize((size_t)tilesX * tilesY);
+}
+
+void OcclusionCuller::beginFrame() {
+    for (Bins& worker : bins) {
+        worker.triangles.clear();
+        for (std::vector<uint32_t>& tile : worker.tiles)
+            tile.clear();
+    }
+}
+
+size_t OcclusionCuller::occluderTriangles() const {
+    size_t count = 0;
+    for (const Bins& worker : bins)
+        count += worker.triangles.size();
+    return count;
+}
+
+//======================BIN======================
+void OcclusionCuller::addOccluder(const glm::mat4& mvp, const float* positions, size_t vertexCount,
+    const unsigned int* indices, size_t indexCount, int worker) {
+    Bins& target = bins[worker];
+    target.clip.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+        target.clip[i] = mvp * glm::vec4(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2], 1.0f);
+
+    float halfWidth = 0.5f * (float)bufferWidth, halfHeight = 0.5f * (float)bufferHeight;
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        Triangle triangle;
+        bool inFront = true;
+        for (int corner = 0; corner < 3; corner++) {
+            const glm::vec4& p = target.clip[indices[i + corner]];
+            inFront = inFront && p.w > nearW && p.z > -p.w;
+            float inverseW = 1.0f / p.w;
+            triangle.x[corner] = (p.x * inverseW + 1.0f) * halfWidth;
+            triangle.y[corner] = (p.y * inverseW + 1.0f) * halfHeight;
+            triangle.z[corner] = p.z * inverseW;
+        }
+        if (!inFront)
+            continue;
+        float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) -
+            (triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+        if (std::fabs(area) < 1e-6f)
+            continue;
+
+        float minX = std::min(triangle.x[0], std::min(triangle.x[1], triangle.x[2]));
+        float maxX = std::max(triangle.x[0], std::max(triangle.x[1], triangle.x[2]));
+        float minY = std::min(triangle.y[0], std::min(triangle.y[1], triangle.y[2]));
+        float maxY = std::max(triangle.y[0], std::max(triangle.y[1], triangle.y[2]));
+        if (maxX < 0.0f || maxY < 0.0f || minX >= (float)bufferWidth || minY >= (float)bufferHeight)
+            continue;
+        int tileX0 = std::max(0, (int)minX / occlusionTileSize);
+        int tileX1 = std::min(tilesX - 1, (int)maxX / occlusionTileSize);
+        int tileY0 = std::max(0, (int)minY / occlusionTileSize);
+        int tileY1 = std::min(tilesY - 1, (int)maxY / occlusionTileSize);
+        uint32_t index = (uint32_t)target.triangles.size();
+        target.triangles.push_back(triangle);
+        for (int tileY = tileY0; tileY <= tileY1; tileY++) {
+            for (int tileX = tileX0; tileX <= tileX1; tileX++)
+                target.tiles[(size_t)tileY * tilesX + tileX].push_back(index);
+        }
+    }
+}
+
+//======================RASTERIZE======================
+//-- One triangle clipped to a tile's pixel rectangle
+struct RasterSetup {
+    float a[3], b[3], c[3];  //edge functions A px + B py + C, positive inside
+    float dzdx, dzdy;        //depth plane: z = z0 + dzdx (px - x0) + dzdy (py - y0)
+    float x0, y0, z0;
+    int minX, maxX, minY, maxY;
+};
+
+//Both span loops start on a multiple of their width and the tile is a multiple of 8 pixels wide, so the loads and
+//stores never leave the tile's rows
+static void rasterizeSpansSse(const RasterSetup& s, float* depth, int stride) {
+    const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 a0 = _mm_set1_ps(s.a[0]), a1 = _mm_set1_ps(s.a[1]), a2 = _mm_set1_ps(s.a[2]);
+    __m128 zx = _mm_set1_ps(s.dzdx);
+    for (int y = s.minY; y <= s.maxY; y++) {
+        float centerY = (float)y + 0.5f;
+        __m128 row0 = _mm_set1_ps(s.b[0] * centerY + s.c[0]);
+        __m128 row1 = _mm_set1_ps(s.b[1] * centerY + s.c[1]);
+        __m128 row2 = _mm_set1_ps(s.b[2] * centerY + s.c[2]);
+        __m128 rowZ = _mm_set1_ps(s.z0 + s.dzdy * (centerY - s.y0) - s.dzdx * s.x0);
+        float* out = depth + (size_t)y * stride;
+        for (int x = s.minX & ~3; x <= s.maxX; x += 4) {
+            __m128 centerX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, centerX), row0);
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, centerX), row1);
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, centerX), row2);
+            __m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+            if (_mm_movemask_ps(inside) == 0)
+                continue;
+            __m128 z = _mm_add_ps(_mm_mul_ps(zx, centerX), rowZ);
+            __m128 previous = _mm_loadu_ps(out + x);
+            __m128 nearest = _mm_min_ps(previous, z);
+            _mm_storeu_ps(out + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+        }
+    }
+}
+
+#ifdef OCCLUSION_AVX
+//Same as the SSE2 loop, 8 pixels a step; mul and add stay separate so both give the same depths
+AVX_KERNEL static void rasterizeSpansAvx(const RasterSetup& s, float* depth, int stride) {
+    const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 a0 = _mm256_set1_ps(s.a[0]), a1 = _mm256_set1_ps(s.a[1]), a2 = _mm256_set1_ps(s.a[2]);
+    __m256 zx = _mm256_set1_ps(s.dzdx);
+    for (int y = s.minY; y <= s.maxY; y++) {
+        float centerY = (float)y + 0.5f;
+        __m256 row0 = _mm256_set1_ps(s.b[0] * centerY + s.c[0]);
+        __m256 row1 = _mm256_set1_ps(s.b[1] * centerY + s.c[1]);
+        __m256 row2 = _mm256_set1_ps(s.b[2] * centerY + s.c[2]);
+        __m256 rowZ = _mm256_set1_ps(s.z0 + s.dzdy * (centerY - s.y0) - s.dzdx * s.x0);
+        float* out = depth + (size_t)y * stride;
+        for (int x = s.minX & ~7; x <= s.maxX; x += 8) {
+            __m256 centerX = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+            __m256 e0 = _mm256_add_ps(_mm256_mul_ps(a0, centerX), row0);
+            __m256 e1 = _mm256_add_ps(_mm256_mul_ps(a1, centerX), row1);
+            __m256 e2 = _mm256_add_ps(_mm256_mul_ps(a2, centerX), row2);
+            __m256 inside = _mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ),
+                _mm256_and_ps(_mm256_cmp_ps(e1, zero, _CMP_GE_OQ), _mm256_cmp_ps(e2, zero, _CMP_GE_OQ)));
+            if (_mm256_movemask_ps(inside) == 0)
+                continue;
+            __m256 z = _mm256_add_ps(_mm256_mul_ps(zx, centerX), rowZ);
+            __m256 previous = _mm256_loadu_ps(out + x);
+            __m256 nearest = _mm256_min_ps(previous, z);
+            _mm256_storeu_ps(out + x, _mm256_or_ps(_mm256_and_ps(inside, nearest), _mm256_andnot_ps(inside, previous)));
+        }
+    }
+}
+
+static bool cpuHasAvx() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    //AVX, and the OS saves the YMM registers (OSXSAVE + XCR0 bits 1 and 2)
+    if ((info[2] & (1 << 28)) == 0 || (info[2] & (1 << 27)) == 0)
+        return false;
+    return (_xgetbv(0) & 6) == 6;
+#else
+    return __builtin_cpu_supports("avx") != 0;
+#endif
+}
+#endif
+
+bool OcclusionCuller::usesAvx() {
+#ifdef OCCLUSION_AVX
+    static const bool avx = cpuHasAvx();
+    return avx;
+#else
+    return false;
+#endif
+}
+
+void OcclusionCuller::rasterizeTile(int tile) {
+    int tileX = (tile % tilesX) * occlusionTileSize;
+    int tileY = (tile / tilesX) * occlusionTileSize;
+    float* depth = levels[0].data();
+    for (int y = tileY; y < tileY + occlusionTileSize; y++)
+        std::fill(depth + (size_t)y * bufferWidth + tileX, depth + (size_t)y * bufferWidth + tileX + occlusionTileSize, 1.0f);
+
+    for (const Bins& worker : bins) {
+        for (uint32_t index : worker.tiles[tile]) {
+            Triangle t = worker.triangles[index];
+            //Counter-clockwise on screen, so all three edge functions are positive inside
+            float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+            if (area < 0.0f) {
+                std::swap(t.x[1], t.x[2]);
+                std::swap(t.y[1], t.y[2]);
+                std::swap(t.z[1], t.z[2]);
+                area = -area;
+            }
+            //Edge a->b: E(px, py) = (xb - xa) (py - ya) - (yb - ya) (px - xa) = A px + B py + C
+            RasterSetup s;
+            for (int edge = 0; edge < 3; edge++) {
+                int from = edge, to = (edge + 1) % 3;
+                s.a[edge] = t.y[from] - t.y[to];
+                s.b[edge] = t.x[to] - t.x[from];
+                s.c[edge] = t.x[from] * t.y[to] - t.y[from] * t.x[to];
+            }
+            //Depth is linear in screen space
+            s.dzdx = ((t.z[1] - t.z[0]) * (t.y[2] - t.y[0]) - (t.z[2] - t.z[0]) * (t.y[1] - t.y[0])) / area;
+            s.dzdy = ((t.z[2] - t.z[0]) * (t.x[1] - t.x[0]) - (t.z[1] - t.z[0]) * (t.x[2] - t.x[0])) / area;
+            s.x0 = t.x[0];
+            s.y0 = t.y[0];
+            s.z0 = t.z[0];
+
+            s.minX = std::max(tileX, (int)std::floor(std::min(t.x[0], std::min(t.x[1], t.x[2]))));
+            s.maxX = std::min(tileX + occlusionTileSize - 1, (int)std::ceil(std::max(t.x[0], std::max(t.x[1], t.x[2]))));
+            s.minY = std::max(tileY, (int)std::floor(std::min(t.y[0], std::min(t.y[1], t.y[2]))));
+            s.maxY = std::min(tileY + occlusionTileSize - 1, (int)std::ceil(std::max(t.y[0], std::max(t.y[1], t.y[2]))));
+            if (s.minX > s.maxX || s.minY > s.maxY)
+                continue;
+#ifdef OCCLUSION_AVX
+            if (usesAvx()) {
+                rasterizeSpansAvx(s, depth, bufferWidth);
+                continue;
+            }
+#endif
+            rasterizeSpansSse(s, depth, bufferWidth);
+        }
+    }
+}
+
+//Each level keeps the farthest depth of the 2x2 texels under it, so a tile stays within itself at every level
+void OcclusionCuller::reduceTile(int tile) {
+    for (int level = 1; level < occlusionLevels; level++) {
+        int size = occlusionTileSize >> level;
+        int x0 = (tile % tilesX) * size, y0 = (tile / tilesX) * size;
+        int fineWidth = bufferWidth >> (level - 1), width = bufferWidth >> level;
+        const float* fine = levels[level - 1].data();
+        float* coarse = levels[level].data();
+        for (int y = y0; y < y0 + size; y++) {
+            const float* top = fine + (size_t)(2 * y) * fineWidth;
+            const float* bottom = top + fineWidth;
+            for (int x = x0; x < x0 + size; x++) {
+                float upper = std::max(top[2 * x], top[2 * x + 1]);
+                float lower = std::max(bottom[2 * x], bottom[2 * x + 1]);
+                coarse[(size_t)y * width + x] = std::max(upper, lower);
+            }
+        }
+    }
+}
+
+void OcclusionCuller::rasterize(JobSystem* jobs) {
+    size_t tiles = (size_t)tilesX * tilesY;
+    auto run = [this](size_t begin, size_t end, int) {
+        for (size_t tile = begin; tile < end; tile++) {
+            rasterizeTile((int)tile);
+            reduceTile((int)tile);
+        }
+    };
+    if (jobs == nullptr) {
+        run(0, tiles, 0);
+        return;
+    }
+    JobCounter done;
+    jobs->parallelFor(tiles, 1, run, done);
+    jobs->wait(done);
+}
+
+//======================TEST======================
+bool OcclusionCuller::isVisible(const glm::mat4& mvp, const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+    float minX = 1.0f, maxX = -1.0f, minY = 1.0f, maxY = -1.0f, minZ = 1.0f;
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec4 p = mvp * glm::vec4(corner & 1 ? boundsMax.x : boundsMin.x, corner & 2 ? boundsMax.y : boundsMin.y,
+            corner & 4 ? boundsMax.z : boundsMin.z, 1.0f);
+        if (p.w <= nearW)
+            return true;
+        float inverseW = 1.0f / p.w;
+        float x = p.x * inverseW, y = p.y * inverseW, z = p.z * inverseW;
+        if (corner == 0) {
+            minX = maxX = x;
+            minY = maxY = y;
+            minZ = z;
+            continue;
+        }
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minZ = std::min(minZ, z);
+    }
+    if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f || minZ > 1.0f)
+        return false;
+
+    //Every pixel the rectangle touches
+    float halfWidth = 0.5f * (float)bufferWidth, halfHeight = 0.5f * (float)bufferHeight;
+    int x0 = std::max(0, (int)std::floor((minX + 1.0f) * halfWidth));
+    int x1 = std::min(bufferWidth - 1, (int)std::floor((maxX + 1.0f) * halfWidth));
+    int y0 = std::max(0, (int)std::floor((minY + 1.0f) * halfHeight));
+    int y1 = std::min(bufferHeight - 1, (int)std::floor((maxY + 1.0f) * halfHeight));
+
+    int level = 0;
+    while (level + 1 < occlusionLevels && std::max(x1 - x0, y1 - y0) >> level >= 4)
+        level++;
+    int width = bufferWidth >> level;
+    const float* depth = levels[level].data();
+    for (int y = y0 >> level; y <= y1 >> level; y++) {
+        for (int x = x0 >> level; x <= x1 >> level; x++) {
+            if (minZ <= depth[(size_t)y * width + x])
+                return true;
+        }
+    }
+    return false;
+}
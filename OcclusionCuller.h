@@ -0,0 +1,78 @@
+#pragma once
+/*Software occlusion culling on the CPU.
+Large objects close to the camera are rasterized as occluders into a small depth buffer (a few hundred pixels
+wide), and every other object's screen bounds are tested against it before a draw is recorded for it.
+    bin       - addOccluder transforms an occluder's vertices and files each triangle under every tile its screen
+                bounds touch. Workers bin into their own lists, so occluders are added from recording jobs.
+    rasterize - one job per tile: edge functions and depth plane evaluated 8 pixels a step with AVX when the CPU
+                has it, else 4 with SSE2 (the x64 baseline), depth kept as the nearest NDC z per pixel, then the
+                tile is reduced into a Hi-Z pyramid holding the farthest depth of every 2x2, 4x4, ... block
+    test      - isVisible projects a model space box, takes its nearest depth and its pixel rectangle, and reads
+                the pyramid level where the rectangle spans at most 4x4 texels. Hidden only if the box is behind
+                the farthest occluder depth in all of them.
+Occluder triangles crossing the near plane are dropped and boxes crossing it are always visible, so both errors go
+toward drawing too much. The buffer is coarse, though: an object seen through a gap narrower than one of its
+pixels can be culled.*/
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm.hpp>
+
+class JobSystem;
+
+//Pixels per tile side; also the coarsest Hi-Z level is one texel per tile
+const int occlusionTileSize = 32;
+const int occlusionLevels = 6;
+
+class OcclusionCuller {
+public:
+    //Depth buffer of about width x height pixels (rounded up to whole tiles), binning for workers threads
+    void resize(int width, int height, int workers = 1);
+    int width() const { return bufferWidth; }
+    int height() const { return bufferHeight; }
+
+    //Drop last frame's occluders
+    void beginFrame();
+    //Bin the triangles of a mesh drawn with mvp as occluders. worker is the calling job's worker index.
+    void addOccluder(const glm::mat4& mvp, const float* positions, size_t vertexCount, const unsigned int* indices,
+        size_t indexCount, int worker = 0);
+    //Clear, rasterize and reduce every tile, in parallel on jobs when given
+    void rasterize(JobSystem* jobs = nullptr);
+
+    //False if the model space box drawn with mvp is hidden behind the occluders or entirely off screen.
+    //Only reads, so any number of threads can test after rasterize.
+    bool isVisible(const glm::mat4& mvp, const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+
+    //True if rasterize runs the 8 wide AVX loop, picked once from the CPU
+    static bool usesAvx();
+
+    //Triangles binned since beginFrame (after near plane and off screen rejection)
+    size_t occluderTriangles() const;
+    //Hi-Z level, (width >> level) x (height >> level) floats; level 0 is the depth buffer
+    const float* depth(int level = 0) const { return levels[level].data(); }
+
+private:
+    //-- Screen space triangle: pixel x / y, NDC z
+    struct Triangle {
+        float x[3];
+        float y[3];
+        float z[3];
+    };
+    //-- One worker's triangles and its list of them per tile
+    struct Bins {
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<uint32_t>> tiles;
+        std::vector<glm::vec4> clip;  //addOccluder scratch
+    };
+
+    void rasterizeTile(int tile);
+    void reduceTile(int tile);
+
+    int bufferWidth = 0;
+    int bufferHeight = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    std::vector<std::vector<float>> levels;
+    std::vector<Bins> bins;
+};
@@ -2,86 +2,92 @@
 // OpenGLIntro.cpp : This file contains the 'main' function. Program execution begins and ends there.
 #include <iostream>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
-#include <GL/glew.h>    
+#include "GLPlatform.h"
 #include <GLFW/glfw3.h> 
 #include <glm.hpp>
-#include <gtc/matrix_transform.hpp>
-#include <gtc/type_ptr.hpp>
-
-/*Defining vertex shaders sources.
-Line by line description of vertex source:
-Creating GLSL program stored as string lateral.
-Indicate OpenGL version (3.30)
-3 coord vector aPos bound to location 0
-const 4*4 matrice variable delcared, named transform
-the main loop calculates the following:
-    gl_position = final vertex position; transform * vec4(aPos, 1.0) = applies transformation using transform matrix to aPos;
-    final vertex position = applied transformation, using transform matrix, on aPos*/
-const char* vertexShaderSource = R"glsl(
-    #version 330 core
-    layout (location = 0) in vec3 aPos;
-    uniform mat4 transform;
-    void main() {
-        gl_Position = transform * vec4(aPos, 1.0);
-    }
-)glsl";
-
-/*Defining fragment shaders sources.
-Line by line description of vertex source:
-Creating GLSL program stored as string lateral.
-Indicate OpenGL version (3.30)
-Define 3 coord vector as color and as ourColor
-The main loop enforces the color vector ourColor (read in RGB)*/
-const char* fragmentShaderSource = R"glsl(
-    #version 330 core
-    out vec3 color;
-    uniform vec3 ourColor;
-    void main(){
-      color = ourColor;
-    }
-)glsl";
-
-
-
-//-- Process keyboard input and update the transformation matrix
-void processInput(GLFWwindow* window, glm::mat4& transform, float d, float s) {
-    // Translation
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        transform = glm::translate(transform, glm::vec3(0.0f, d, 0.0f));
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        transform = glm::translate(transform, glm::vec3(0.0f, -d, 0.0f));
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        transform = glm::translate(transform, glm::vec3(-d, 0.0f, 0.0f));
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        transform = glm::translate(transform, glm::vec3(d, 0.0f, 0.0f));
-
-    // Rotation rotate around the Z-axis
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
-        transform = glm::rotate(transform, glm::radians(30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
-        transform = glm::rotate(transform, glm::radians(-30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-
-    // Scaling only the Z axis
-    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS)
-        transform = glm::scale(transform, glm::vec3(1.0f, 1.0f, s));
-    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS)
-        transform = glm::scale(transform, glm::vec3(1.0f, 1.0f, 1.0f / s));
-
-    // Demo Additions
-    //Y ROTATIONS
-    if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS)
-        transform = glm::rotate(transform, glm::radians(5.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS)
-        transform = glm::rotate(transform, glm::radians(-5.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    //X ROTATIONS
-    if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS)
-        transform = glm::rotate(transform, glm::radians(5.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS)
-        transform = glm::rotate(transform, glm::radians(-5.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+
+#include "FrameCapture.h"
+#include "FramePacer.h"
+#include "GeometryCache.h"
+#include "IndirectRenderer.h"
+#include "InputRecording.h"
+#include "InstancedRenderer.h"
+#include "MeshImporter.h"
+#include "Profiler.h"
+#include "ProgramCache.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Simulation.h"
+#include "TransformLog.h"
+
+//-- Forward GLFW key events to the input system stored in the window user pointer
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    InputSystem* input = (InputSystem*)glfwGetWindowUserPointer(window);
+    input->onKey(key, action, inputTimestamp());
 }
 
-int main(){
+//-- The window was exposed or resized and has to be drawn again, even with nothing else changing
+static bool windowNeedsRedraw = true;
+void refreshCallback(GLFWwindow* window) {
+    windowNeedsRedraw = true;
+}
+
+int main(int argc, char** argv){
+    //======================ARGUMENTS======================
+    //--instances N draws an N pyramid grid with the instanced renderer instead of the single pyramid
+    //--cull gpu|cpu draws that grid culled and in one glMultiDrawElementsIndirect instead (IndirectRenderer.h, GL 4.3)
+    //--mesh PATH draws an OBJ or glTF (.glb) mesh in place of the single pyramid, through the geometry_cache packs
+    //--profile prints CPU zone and GPU pass times over the last frames on exit (Profiler.h)
+    //--trace PATH also writes the first frames as a Chrome trace to PATH
+    //--record PATH records the key events and frame steps for OpenGLIntroBench --mode replay (InputRecording.h)
+    //--capture DIR writes every frame as DIR/frame_NNNNNN.png, --capture-pipe CMD streams them raw into CMD
+    //(FrameCapture.h), e.g. --capture-pipe "ffmpeg -f rawvideo -pix_fmt rgba -s 1024x768 -r 60 -i - session.mp4"
+    //--pacing uncapped|vsync|capped|on-demand|low-latency picks when frames are drawn (FramePacer.h, default vsync),
+    //--fps N the capped rate, and the refresh rate low-latency predicts (default 60, low-latency: the monitor's)
+    size_t instanceCount = 0;
+    const char* meshPath = nullptr;
+    bool profile = false;
+    const char* tracePath = nullptr;
+    const char* recordPath = nullptr;
+    const char* cullMode = nullptr;
+    const char* captureDir = nullptr;
+    const char* capturePipe = nullptr;
+    PacingOptions pacingOptions;
+    bool fpsGiven = false;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--instances") == 0 && hasValue)
+            instanceCount = (size_t)std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--mesh") == 0 && hasValue)
+            meshPath = argv[++i];
+        else if (std::strcmp(argv[i], "--profile") == 0)
+            profile = true;
+        else if (std::strcmp(argv[i], "--trace") == 0 && hasValue) {
+            tracePath = argv[++i];
+            profile = true;
+        }
+        else if (std::strcmp(argv[i], "--record") == 0 && hasValue)
+            recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--cull") == 0 && hasValue)
+            cullMode = argv[++i];
+        else if (std::strcmp(argv[i], "--capture") == 0 && hasValue)
+            captureDir = argv[++i];
+        else if (std::strcmp(argv[i], "--capture-pipe") == 0 && hasValue)
+            capturePipe = argv[++i];
+        else if (std::strcmp(argv[i], "--pacing") == 0 && hasValue) {
+            if (!parsePacingMode(argv[++i], pacingOptions.mode))
+                std::cerr << "Unknown pacing mode " << argv[i] << ", using " << pacingModeName(pacingOptions.mode) << std::endl;
+        }
+        else if (std::strcmp(argv[i], "--fps") == 0 && hasValue) {
+            pacingOptions.targetFps = std::atof(argv[++i]);
+            fpsGiven = true;
+        }
+    }
+    bool indirect = cullMode != nullptr && instanceCount > 0;
+
     //======================OUTPUT======================
     //Direct std::out to txt file
     FILE* pFile = nullptr;
@@ -90,6 +96,12 @@ int main(){
         std::cerr << "Error redirecting stdout" << std::endl;
         return 1;
     }
+    //Matrix/vertex log is written by a background thread so the frame never waits on the file
+    TransformLog transformLog;
+    if (!transformLog.open(stdout, TransformLogFormat::Text)) {
+        std::cerr << "Error starting transform log" << std::endl;
+        return 1;
+    }
 
     //======================WINDOW======================
     //Initializing GLFW
@@ -99,12 +111,18 @@ int main(){
     }
 
     //GLFW Initialized. Adjusting context window.
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); //Version 3.3
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3); //Version 3.3
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, indirect ? 4 : 3); //Version 3.3, 4.3 for compute culling
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); //Not old openGL
 
     //Create GLFW window
     GLFWwindow* window = glfwCreateWindow(1024, 768, "OpenGLIntro", nullptr, nullptr);
+    if (window == NULL && indirect) {
+        std::cerr << "No GL 4.3 context, drawing the grid with the instanced renderer." << std::endl;
+        indirect = false;
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        window = glfwCreateWindow(1024, 768, "OpenGLIntro", nullptr, nullptr);
+    }
     //Error handling
     if (window == NULL) {
         std::cerr << "Failed to open GLFW window." << std::endl;
@@ -121,213 +139,244 @@ int main(){
         return -1;
     }
 
-    //Set up capturing sticky keys
-    glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
+    //Key events are queued by the callback and drained once per frame (see Input.h)
+    InputSystem input;
+    glfwSetWindowUserPointer(window, &input);
+    glfwSetKeyCallback(window, keyCallback);
+    glfwSetWindowRefreshCallback(window, refreshCallback);
+    InputRecorder recorder;
+    if (recordPath) {
+        if (!recorder.open(recordPath))
+            return 1;
+        input.setRecorder(&recorder);
+    }
 
     //Enable depth testing
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
 
-    //======================SHADERS======================
-    //Create vertex shaders
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    //Compile vertex shaders
-    glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr); //Set to source
-    glCompileShader(vertexShader); //Compile
-
-    //Create fragment shaders
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    //Compile fragment shaders
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr); //Set to source
-    glCompileShader(fragmentShader); //Compile
-
-    //Create shader program
-    unsigned int shaderProgram = glCreateProgram();
-
-    //Add shaders to program
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-
-    //Finalize and link to openGL
-    glLinkProgram(shaderProgram);
-
-    //Delete unused shaders after linking
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    //Get uniform location for gradiant
-    int colorLoc = glGetUniformLocation(shaderProgram, "ourColor");
-
-    //======================SHAPE======================
-    /*Pyramid vertices
-    Translating the triangle into a pyramid is doable by shifting the base points of the 2D plane along the z-axis equaly on both sides:
-    (-0.5,-0.5,0.5), (0.5,-0.5,0.5) & (-0.5,-0.5,-0.5), (0.5,-0.5,-0.5) with apex (0,0.5,0)*/
-    float verticesPyramid[] = {
-        -0.5f, -0.5f, 0.5f,
-        0.5f, -0.5f, 0.5f,
-        -0.5f, -0.5f, -0.5f,
-        0.5f, -0.5f, -0.5f,
-        0.0f, 0.5f, 0.0f
-    };
-
-    //Defining the indices of the pyramid where each num represents the index of a vertice in verticesPyramid
-    unsigned int indices[] = {
-        0, 1, 2, //Base 1
-        1, 3, 2, //Base 2
-        0, 1, 4,
-        1, 3, 4,
-        3, 2, 4,
-        2, 0, 4
-    };
-
-    //Declare Vertex Buffer Object, Vertex Array Object & Element Buffer Object
-    unsigned int VBO[2], VAO[2], EBO;
-
-    //Genereate Vertex array and bind array to openGL
-    glGenVertexArrays(2, VAO); 
-    glBindVertexArray(VAO[0]);
-
-    //Generate buffers
-    glGenBuffers(2, VBO);
-    glGenBuffers(1, &EBO);
-
-    //Bind VBO buffer to openGL
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-    //Fill buffer with pyramid vertices
-    glBufferData(GL_ARRAY_BUFFER, sizeof(verticesPyramid), verticesPyramid, GL_STATIC_DRAW);
-
-    //Bind EBO buffer to openGL
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    //Fill buffer with pyramid indices
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-    //Explain how to interpret vertices data
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    //Create identity matrix as baseline for shader
-    glUseProgram(shaderProgram);
-    int transformLoc = glGetUniformLocation(shaderProgram, "transform");
-    float identity[] = {
-         1.0f, 0.0f, 0.0f, 0.0f,
-         0.0f, 1.0f, 0.0f, 0.0f,
-         0.0f, 0.0f, 1.0f, 0.0f,
-         0.0f, 0.0f, 0.0f, 1.0f
-    };
-    glUniformMatrix4fv(transformLoc, 1, GL_FALSE, identity);
-
-    //-- Create an initial identity matrix that will be updated based on input
-    glm::mat4 transform = glm::mat4(1.0f);
-
-    // translation and scaling factor
-    const float d = 0.01f;  // Change in position per key press
-    const float s = 1.05f;  // Scale factor for z-axis scaling
+    //======================SHADERS & SHAPE======================
+    //Linked programs are cached in shader_cache/ so later launches skip compiling (see ProgramCache.h)
+    double shaderStart = glfwGetTime();
+    enableParallelShaderCompile();
+    enableProgramCache("shader_cache");
+
+    //Compile the pyramid program and upload its vertices/indices (see Renderer.cpp)
+    PyramidRenderer renderer;
+    InstancedRenderer instancedRenderer;
+    IndirectRenderer indirectRenderer;
+    if (indirect) {
+        IndirectGeometry geometry;
+        geometry.addMesh(verticesPyramid, pyramidVertexCount, indices, pyramidIndexCount);
+        indirect = createIndirectRenderer(indirectRenderer, geometry, instanceCount);
+        indirectRenderer.culling = std::strcmp(cullMode, "cpu") == 0 ? IndirectCulling::Cpu : IndirectCulling::Gpu;
+    }
+    bool created = indirect || (instanceCount > 0 ? createInstancedRenderer(instancedRenderer, instanceCount)
+        : createPyramidRenderer(renderer));
+    if (!created) {
+        glfwTerminate();
+        return -1;
+    }
+    double shaderSeconds = glfwGetTime() - shaderStart;
+
+    //Mapped from its geometry pack, imported in parallel and packed first if the source is new or changed,
+    //then scaled to the pyramid's size by the model matrix
+    glm::mat4 meshTransform(1.0f);
+    if (meshPath != nullptr && instanceCount == 0) {
+        GeometryPack pack;
+        GeometryCacheStats packStats;
+        bool loaded = loadCachedGeometry(meshPath, "geometry_cache", pack, nullptr, &packStats);
+        PackedMesh mesh = pack.mesh(0);
+        if (!loaded || pack.meshCount() == 0 || !uploadPackedMesh(renderer, mesh)) {
+            destroyPyramidRenderer(renderer);
+            glfwTerminate();
+            return -1;
+        }
+        meshTransform = unitBoxTransform(mesh.boundsMin, mesh.boundsMax) * mesh.positionDecode;
+        std::cerr << "Loaded " << meshPath << ": " << mesh.indexCount / 3 << " triangles, " << mesh.vertexCount
+            << " vertices in " << packStats.totalMs << " ms ("
+            << (packStats.hit ? "geometry cache hit" : "imported and packed") << ")" << std::endl;
+        if (!packStats.hit)
+            std::cerr << "Vertex cache ACMR " << packStats.optimize.before.acmr << " -> " << packStats.optimize.after.acmr
+                << ", ATVR " << packStats.optimize.before.atvr << " -> " << packStats.optimize.after.atvr << std::endl;
+        //GL has its own copy now
+        pack.close();
+    }
 
-    //======================MAIN LOOP======================
-    do {
+    //Frames are read back through a PBO ring and written by a background thread, the loop never waits on them
+    FrameCapture capture;
+    if (captureDir != nullptr || capturePipe != nullptr) {
+        int captureWidth = 0, captureHeight = 0;
+        glfwGetFramebufferSize(window, &captureWidth, &captureHeight);
+        bool capturing = capturePipe != nullptr ? capture.openPipe(capturePipe, captureWidth, captureHeight)
+            : capture.openPng(captureDir, captureWidth, captureHeight);
+        if (!capturing)
+            std::cerr << "Frame capture disabled." << std::endl;
+    }
 
-        // Process keyboard input to update the transformation matrix
-        processInput(window, transform, d, s);
-
-        // If any transformation key is pressed, output current matrix and transformed vertices.
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS ||
-            glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS ||
-            glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS ||
-            glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS ||
-            glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS ||
-            glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS ||
-            glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS ||
-            glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS)
-        {
-            //Output
-            if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-                std::cout << "Pressed W: Move pyramid upwards" << std::endl;
-            if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-                std::cout << "Pressed S: Move pyramid downwards" << std::endl;
-            if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-                std::cout << "Pressed A: Move pyramid left" << std::endl;
-            if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-                std::cout << "Pressed D: Move pyramid right" << std::endl;
-            if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
-                std::cout << "Pressed Q: Rotate pyramid along z axis anticlockwise" << std::endl;
-            if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
-                std::cout << "Pressed E: Rotate pyramid along z axis clockwise" << std::endl;
-            if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS)
-                std::cout << "Pressed R: Scale pyramid down along z axis" << std::endl;
-            if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS)
-                std::cout << "Pressed F: Scale pyramid up along z axis" << std::endl;
-
-            std::cout << "Current Transformation Matrix:" << std::endl;
-            // Print matrix in row-major order for clarity
-            for (int row = 0; row < 4; row++) {
-                std::cout << transform[0][row] << " "
-                    << transform[1][row] << " "
-                    << transform[2][row] << " "
-                    << transform[3][row] << std::endl;
-            }
-            std::cout << "Transformed Vertex Positions:" << std::endl;
-            for (int i = 0; i < 5; i++) {
-                glm::vec4 original(verticesPyramid[i * 3],
-                    verticesPyramid[i * 3 + 1],
-                    verticesPyramid[i * 3 + 2],
-                    1.0f);
-                glm::vec4 newPos = transform * original;
-                std::cout << "Vertex " << i << ": ("
-                    << newPos.x << ", "
-                    << newPos.y << ", "
-                    << newPos.z << ")" << std::endl;
-            }
-            std::cout << "-----------------------------" << std::endl;
-        }
+    //-- Simulated transform at the last two steps, starts as identity and is updated based on input
+    SimulationState state;
+    FixedTimestep timestep;
 
-        //Clear screen and set color
-        glClearColor(0.2f, 0.3f, 0.3f, 0.1f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    CommandState commands;
+    GLStateCache glState;
 
-        //Run shaders program
-        glUseProgram(shaderProgram);
-		//-- update the uniform transform matrix
-        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(transform));
+    //Input-to-present latency of frames that received key events
+    double latencySum = 0.0, latencyMax = 0.0;
+    unsigned int latencyFrames = 0;
+    double pendingEventTime = -1.0;
+    double lastTime = glfwGetTime();
 
-        //(OPTIONAL) ROTATION TO TEST========================
-        //float timeValue = glfwGetTime();
-        //glm::mat4 trans = glm::rotate(glm::mat4(1.0f), timeValue, glm::vec3(0.0f, 1.0f, 0.0f));
-        //glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(trans));
-        //==================================================
+    if (profile) {
+        ProfilerOptions profilerOptions;
+        profilerOptions.traceEvents = tracePath ? 200000 : 0;
+        enableProfiler(profilerOptions);
+        setProfilerThreadName("main");
+    }
 
-        //Draw filled pyramid with red color.
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glUniform3f(colorLoc, 1.0f, 0.0f, 0.0f);
+    //Swap interval, and when to sample input and draw (see FramePacer.h)
+    if (pacingOptions.mode == PacingMode::LowLatency && !fpsGiven) {
+        const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        if (videoMode != nullptr && videoMode->refreshRate > 0)
+            pacingOptions.targetFps = videoMode->refreshRate;
+    }
+    FramePacer pacer(pacingOptions);
+    glfwSwapInterval(pacer.swapInterval());
+    bool idled = false;
 
-        //Bind Vertex Array
-        glBindVertexArray(VAO[0]);
+    //======================MAIN LOOP======================
+    do {
+        //The next frame differs from the last one while a key is held, events are queued, the transform is still
+        //between two steps, the grid animates, or the window asks to be redrawn
+        bool dirty = commands.anyHeld() || input.pendingEvents() > 0 || !(state.previous == state.current) ||
+            instanceCount > 0 || windowNeedsRedraw;
+        double eventWait = pacer.beforeInput(dirty);
+        if (eventWait > 0.0)
+            glfwWaitEventsTimeout(eventWait);
+        else
+            glfwPollEvents();
+        if (!pacer.shouldDraw(dirty || input.pendingEvents() > 0 || windowNeedsRedraw)) {
+            idled = true;
+            continue;
+        }
+        windowNeedsRedraw = false;
 
-        //Draw element bases on elements array and object array, 18 vertices
-        glDrawElements(GL_TRIANGLES, 18, GL_UNSIGNED_INT, 0);
+        double now = glfwGetTime();
+        //Idle time is not simulated; it counts as one step so the event that ended it is handled this frame
+        if (idled) {
+            lastTime = now - timestep.step();
+            idled = false;
+        }
+        double frameSeconds = now - lastTime;
+        lastTime = now;
+
+        // Advance the simulation in fixed steps; each step drains input and updates the transformation matrix
+        int steps = timestep.advance(frameSeconds);
+        for (int i = 0; i < steps; i++) {
+            {
+                PROFILE_ZONE("input");
+                input.update(commands);
+                if (commands.eventCount > 0 && pendingEventTime < 0.0)
+                    pendingEventTime = commands.oldestEventTime;
+            }
+            {
+                PROFILE_ZONE("update");
+                state.beginStep();
+                processInput(commands, state.current, translateStep, scaleStep);
+            }
 
-        //Draw outlines in black.
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        glLineWidth(3.0f);
-        glUniform3f(colorLoc, 0.0f, 0.0f, 0.0f); // Black outline.
+            // If any transformation key is pressed, output current matrix and transformed vertices.
+            PROFILE_ZONE("log");
+            transformLog.log((unsigned int)(timestep.totalSteps() - steps + i), commands, state.current);
+        }
+        recorder.endFrame(steps, timestep.alpha());
 
-        //Draw element bases on elements array and object array, 18 vertices
-        glDrawElements(GL_TRIANGLES, 18, GL_UNSIGNED_INT, 0);
+        //Clear screen and draw the filled pyramid with its black outline, between the last two steps
+        const glm::mat4& drawTransform = state.drawTransform(timestep.alpha());
+        if (indirect) {
+            updateIndirectInstances(indirectRenderer, instanceCount, (float)now);
+            renderIndirectFrame(indirectRenderer, drawTransform, glState);
+        }
+        else if (instanceCount > 0) {
+            updateInstances(instancedRenderer, (float)now);
+            renderInstancedFrame(instancedRenderer, drawTransform, glState);
+        }
+        else {
+            renderFrame(renderer, drawTransform * meshTransform, glState);
+        }
 
-        // Restore polygon mode to fill.
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        {
+            PROFILE_ZONE("capture");
+            capture.capture();
+        }
 
         // Swap buffers
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        {
+            PROFILE_ZONE("swap");
+            if (pacer.finishFrames())
+                glFinish();
+            pacer.beforePresent();
+            glfwSwapBuffers(window);
+            if (pacer.finishFrames())
+                glFinish();
+        }
+        pacer.afterPresent();
+        profilerEndFrame();
+        if (pendingEventTime >= 0.0) {
+            double latency = inputTimestamp() - pendingEventTime;
+            latencySum += latency;
+            latencyMax = latency > latencyMax ? latency : latencyMax;
+            latencyFrames++;
+            pendingEventTime = -1.0;
+        }
 
     } //Check if exit key is pressed
-    while (glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS &&
+    while (!commands.isHeld(Command::Quit) &&
         glfwWindowShouldClose(window) == 0);
 
     //======================EXIT======================
+    //Profiler queries go with the context
+    if (profile) {
+        disableProfiler();
+        if (tracePath)
+            writeChromeTrace(tracePath);
+    }
+
+    //Reads in flight are written out before the context goes away
+    bool captured = capture.isOpen();
+    capture.close();
+
     //Clean up and exit
+    if (indirect)
+        destroyIndirectRenderer(indirectRenderer);
+    else if (instanceCount > 0)
+        destroyInstancedRenderer(instancedRenderer);
+    else
+        destroyPyramidRenderer(renderer);
     glfwDestroyWindow(window);
     glfwTerminate();
+
+    transformLog.close();
+    if (recorder.isOpen() && recorder.close(state.current.matrix()))
+        std::cerr << "Recorded " << recorder.frameCount() << " frames, " << recorder.stepCount() << " steps and "
+            << recorder.eventCount() << " key events to " << recordPath << std::endl;
+    const ProgramCacheStats& cacheStats = programCacheStats();
+    std::cerr << "Shader programs ready in " << shaderSeconds * 1000.0 << " ms (" << cacheStats.hits
+        << " from cache, " << cacheStats.misses + cacheStats.stale << " compiled)" << std::endl;
+    if (latencyFrames > 0)
+        std::cerr << "Input to present latency: avg " << latencySum / latencyFrames * 1000.0
+            << " ms, max " << latencyMax * 1000.0 << " ms over " << latencyFrames << " frames" << std::endl;
+    PacingReport pacing = pacer.report();
+    std::cerr << "Pacing " << pacingModeName(pacingOptions.mode) << ": " << pacing.frames << " frames, "
+        << pacing.idleWaits << " idle waits, CPU " << pacing.cpuUtilization * 100.0 << "%, frame interval "
+        << pacing.intervalMeanMs << " ms (stddev " << pacing.intervalStddevMs << " ms)" << std::endl;
+    if (captured)
+        std::cerr << "Captured " << capture.writtenFrames() << " frames (" << capture.droppedFrames() << " dropped, "
+            << capture.failedFrames() << " failed), " << capture.bytesWritten() / 1048576 << " MB" << std::endl;
+    if (transformLog.droppedRecords() > 0)
+        std::cerr << "Transform log dropped " << transformLog.droppedRecords() << " records" << std::endl;
+    if (profile)
+        printProfilerStats(std::cerr);
     return 0;
 
 }
@@ -0,0 +1,199 @@
+#include "PngWriter.h"
+
+#include <cstdio>
+#include <iostream>
+
+//======================CHECKSUMS======================
+static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0) {
+    static uint32_t table[256];
+    static bool built = false;
+    if (!built) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        built = true;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+//-- Adler-32 of the zlib stream, fed as the filtered rows are produced
+struct Adler32 {
+    uint32_t a = 1;
+    uint32_t b = 0;
+
+    void add(uint8_t byte) {
+        a += byte;
+        if (a >= 65521)
+            a -= 65521;
+        b += a;
+        if (b >= 65521)
+            b -= 65521;
+    }
+    uint32_t value() const { return (b << 16) | a; }
+};
+
+//======================DEFLATE======================
+//-- Bits packed LSB first, as deflate wants
+struct BitWriter {
+    std::vector<uint8_t>& out;
+    uint32_t buffer = 0;
+    int count = 0;
+
+    explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+    void write(uint32_t bits, int length) {
+        buffer |= bits << count;
+        count += length;
+        while (count >= 8) {
+            out.push_back((uint8_t)buffer);
+            buffer >>= 8;
+            count -= 8;
+        }
+    }
+    //Huffman codes go out most significant bit first
+    void writeCode(uint32_t code, int length) {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; i++)
+            reversed |= ((code >> i) & 1) << (length - 1 - i);
+        write(reversed, length);
+    }
+    void flush() {
+        if (count > 0)
+            out.push_back((uint8_t)buffer);
+        buffer = 0;
+        count = 0;
+    }
+};
+
+//Fixed literal / length code of symbol (RFC 1951 3.2.6)
+static void writeSymbol(BitWriter& bits, int symbol) {
+    if (symbol < 144)
+        bits.writeCode(0x30 + symbol, 8);
+    else if (symbol < 256)
+        bits.writeCode(0x190 + symbol - 144, 9);
+    else if (symbol < 280)
+        bits.writeCode(symbol - 256, 7);
+    else
+        bits.writeCode(0xC0 + symbol - 280, 8);
+}
+
+static const int lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83,
+    99, 115, 131, 163, 195, 227, 258 };
+static const int lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+//Repeat the previous byte length (3-258) more times: a match at distance 1, distance code 0 has no extra bits
+static void writeRun(BitWriter& bits, int length) {
+    int code = 28;
+    while (lengthBase[code] > length)
+        code--;
+    writeSymbol(bits, 257 + code);
+    bits.write((uint32_t)(length - lengthBase[code]), lengthExtra[code]);
+    bits.writeCode(0, 5);
+}
+
+//======================PNG======================
+static void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back((uint8_t)(value >> 24));
+    out.push_back((uint8_t)(value >> 16));
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)value);
+}
+
+//Length, type and data are already in out from start; append the CRC of type and data
+static void finishChunk(std::vector<uint8_t>& out, size_t start) {
+    uint32_t length = (uint32_t)(out.size() - start - 8);
+    out[start] = (uint8_t)(length >> 24);
+    out[start + 1] = (uint8_t)(length >> 16);
+    out[start + 2] = (uint8_t)(length >> 8);
+    out[start + 3] = (uint8_t)length;
+    appendBigEndian(out, crc32(&out[start + 4], length + 4));
+}
+
+static size_t beginChunk(std::vector<uint8_t>& out, const char* type) {
+    size_t start = out.size();
+    out.insert(out.end(), 4, 0);
+    out.insert(out.end(), type, type + 4);
+    return start;
+}
+
+void encodePng(const uint8_t* rgba, int width, int height, bool bottomUp, std::vector<uint8_t>& out) {
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    out.assign(signature, signature + 8);
+
+    size_t header = beginChunk(out, "IHDR");
+    appendBigEndian(out, (uint32_t)width);
+    appendBigEndian(out, (uint32_t)height);
+    const uint8_t format[5] = { 8, 2, 0, 0, 0 };  //8 bit RGB, deflate, adaptive filtering, no interlace
+    out.insert(out.end(), format, format + 5);
+    finishChunk(out, header);
+
+    size_t data = beginChunk(out, "IDAT");
+    out.push_back(0x78);  //deflate, 32K window
+    out.push_back(0x01);
+    BitWriter bits(out);
+    bits.write(1, 1);     //final block
+    bits.write(1, 2);     //fixed Huffman codes
+    Adler32 adler;
+    size_t rowBytes = (size_t)width * 4;
+    uint8_t left[3];
+    int previous = -1, run = 0;
+    auto flushRun = [&]() {
+        while (run >= 3) {
+            int length = run > 258 ? 258 : run;
+            if (run - length > 0 && run - length < 3)
+                length = run - 3;
+            writeRun(bits, length);
+            run -= length;
+        }
+        for (; run > 0; run--)
+            writeSymbol(bits, previous);
+    };
+    auto put = [&](int byte) {
+        adler.add((uint8_t)byte);
+        if (byte == previous) {
+            run++;
+            return;
+        }
+        flushRun();
+        writeSymbol(bits, byte);
+        previous = byte;
+    };
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = rgba + (size_t)(bottomUp ? height - 1 - y : y) * rowBytes;
+        put(1);  //Sub: each byte minus the same channel of the pixel to its left
+        left[0] = left[1] = left[2] = 0;
+        for (size_t i = 0; i < rowBytes; i += 4) {
+            for (int channel = 0; channel < 3; channel++) {
+                put((uint8_t)(row[i + channel] - left[channel]));
+                left[channel] = row[i + channel];
+            }
+        }
+    }
+    flushRun();
+    writeSymbol(bits, 256);
+    bits.flush();
+    appendBigEndian(out, adler.value());
+    finishChunk(out, data);
+
+    finishChunk(out, beginChunk(out, "IEND"));
+}
+
+bool writePng(const char* path, const uint8_t* rgba, int width, int height, bool bottomUp) {
+    std::vector<uint8_t> png;
+    encodePng(rgba, width, height, bottomUp, png);
+    FILE* file = std::fopen(path, "wb");
+    if (file == nullptr) {
+        std::cerr << "Error opening image file " << path << std::endl;
+        return false;
+    }
+    bool written = std::fwrite(png.data(), 1, png.size(), file) == png.size();
+    written = std::fclose(file) == 0 && written;
+    if (!written)
+        std::cerr << "Error writing image file " << path << std::endl;
+    return written;
+}
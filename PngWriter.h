@@ -0,0 +1,13 @@
+#pragma once
+//PNG encoder for framebuffer dumps (RGBA8 in, RGB out since alpha never reaches the screen; no zlib dependency).
+//Every row uses the Sub filter, which turns flat colored runs into zeros, and the deflate stream is one fixed Huffman
+//block of literals and distance 1 matches (zlib's Z_RLE strategy). Rendered frames with large flat areas shrink
+//10x or more; noise costs at most one extra bit per byte over the raw pixels.
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Encode width x height RGBA8 pixels into out (replaced). bottomUp = rows bottom first, as glReadPixels returns them.
+void encodePng(const uint8_t* rgba, int width, int height, bool bottomUp, std::vector<uint8_t>& out);
+//Encode and write to path. Prints to std::cerr and returns false on failure.
+bool writePng(const char* path, const uint8_t* rgba, int width, int height, bool bottomUp);
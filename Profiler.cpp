@@ -0,0 +1,453 @@
+#include "Profiler.h"
+#include "GLPlatform.h"
+#include "Json.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+std::atomic<bool> profilerActive(false);
+
+//Trace thread id of the GPU track, after any real thread
+static const uint32_t gpuTrackId = 1000000;
+
+//Nanoseconds on the profiler clock
+static const std::chrono::steady_clock::time_point profilerEpoch = std::chrono::steady_clock::now();
+static int64_t profilerNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profilerEpoch).count();
+}
+
+//-- One closed zone, or one resolved GPU pass already moved to the CPU clock
+struct ZoneEvent {
+    const char* name;
+    int64_t beginNs;
+    int64_t endNs;
+    uint32_t tid;
+};
+
+//-- Zones a thread closed since the last profilerEndFrame. The owning thread appends, the GL thread drains.
+struct ThreadZones {
+    std::mutex mutex;
+    std::vector<ZoneEvent> events;
+    uint32_t tid = 0;
+    std::string name;
+};
+
+//Buffers of every thread that ever opened a zone, kept until exit so the trace can still name them
+static std::mutex threadsMutex;
+static std::vector<std::unique_ptr<ThreadZones>> threadBuffers;
+static thread_local ThreadZones* localZones = nullptr;
+
+static ThreadZones& threadZones() {
+    if (!localZones) {
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        threadBuffers.emplace_back(new ThreadZones());
+        localZones = threadBuffers.back().get();
+        localZones->tid = (uint32_t)threadBuffers.size();
+        localZones->name = "thread " + std::to_string(localZones->tid);
+    }
+    return *localZones;
+}
+
+//-- Per frame totals of one zone over the last rollingFrames frames
+struct ZoneSeries {
+    const char* name;
+    bool gpu;
+    std::vector<double> window;
+    size_t next = 0;
+    size_t count = 0;
+    double frameMs = 0.0;  //CPU: accumulated during the current frame
+};
+
+//-- Timestamp queries of one frame's passes
+struct GpuPassQueries {
+    const char* name;
+    unsigned int begin;
+    unsigned int end;      //0 while the pass is open
+};
+struct GpuQuerySet {
+    std::vector<unsigned int> pool;  //query objects, reused every time the set comes round
+    size_t used = 0;
+    std::vector<GpuPassQueries> passes;
+    bool pending = false;            //frame ended, results not read yet
+};
+
+//Everything below is only touched on the GL thread
+static ProfilerOptions profilerOptions;
+static ProfilerCounters counters;
+static std::vector<ZoneSeries> series;
+static std::vector<ZoneEvent> trace;
+static std::vector<ZoneEvent> drained;
+static int64_t lastFrameEndNs = 0;
+static bool gpuEnabled = false;
+static bool gpuTimed = false;      //GPU timers were on since the last enableProfiler, for the report
+static int64_t gpuToCpuNs = 0;
+static GpuQuerySet gpuSets[gpuProfileLatency];
+static unsigned int gpuCurrent = 0;
+
+static ZoneSeries& findSeries(const char* name, bool gpu) {
+    for (ZoneSeries& zone : series) {
+        if (zone.gpu == gpu && (zone.name == name || std::strcmp(zone.name, name) == 0))
+            return zone;
+    }
+    ZoneSeries zone;
+    zone.name = name;
+    zone.gpu = gpu;
+    zone.window.resize(profilerOptions.rollingFrames);
+    series.push_back(zone);
+    return series.back();
+}
+
+static void pushSample(ZoneSeries& zone, double ms) {
+    zone.window[zone.next] = ms;
+    zone.next = (zone.next + 1) % zone.window.size();
+    zone.count = std::min(zone.count + 1, zone.window.size());
+}
+
+static void captureEvent(const ZoneEvent& event) {
+    if (trace.size() < profilerOptions.traceEvents) {
+        trace.push_back(event);
+        counters.traceEvents++;
+    }
+    else if (profilerOptions.traceEvents > 0) {
+        counters.traceEventsDropped++;
+    }
+}
+
+static void clearGpuSet(GpuQuerySet& set) {
+    set.used = 0;
+    set.passes.clear();
+    set.pending = false;
+}
+
+//Read a finished set without waiting: false if any of its queries is still in flight
+static bool resolveGpuSet(GpuQuerySet& set) {
+    for (const GpuPassQueries& pass : set.passes) {
+        if (pass.end == 0)
+            return false;
+    }
+    for (size_t i = 0; i < set.used; i++) {
+        GLint available = 0;
+        glGetQueryObjectiv(set.pool[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+    }
+
+    int64_t frameBegin = INT64_MAX, frameEnd = INT64_MIN;
+    for (const GpuPassQueries& pass : set.passes) {
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(pass.begin, GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(pass.end, GL_QUERY_RESULT, &end);
+        ZoneEvent event = { pass.name, (int64_t)begin + gpuToCpuNs, (int64_t)end + gpuToCpuNs, gpuTrackId };
+        findSeries(pass.name, true).frameMs += (event.endNs - event.beginNs) / 1.0e6;
+        frameBegin = std::min(frameBegin, event.beginNs);
+        frameEnd = std::max(frameEnd, event.endNs);
+        captureEvent(event);
+    }
+    for (ZoneSeries& zone : series) {
+        if (zone.gpu && zone.frameMs > 0.0) {
+            pushSample(zone, zone.frameMs);
+            zone.frameMs = 0.0;
+        }
+    }
+    if (!set.passes.empty())
+        pushSample(findSeries("gpu frame", true), (frameEnd - frameBegin) / 1.0e6);
+    counters.gpuFramesResolved++;
+    clearGpuSet(set);
+    return true;
+}
+
+static unsigned int nextQuery(GpuQuerySet& set) {
+    if (set.used == set.pool.size()) {
+        unsigned int query = 0;
+        glGenQueries(1, &query);
+        set.pool.push_back(query);
+    }
+    return set.pool[set.used++];
+}
+
+bool enableProfiler(const ProfilerOptions& options) {
+    disableProfiler();
+    profilerOptions = options;
+    profilerOptions.rollingFrames = std::max<size_t>(options.rollingFrames, 1);
+    resetProfiler();
+
+    bool result = true;
+    gpuTimed = false;
+    if (options.gpuTimers) {
+        GLint bits = 0;
+        glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+        if (bits > 0) {
+            //GPU timestamps to the profiler clock, good enough for lining the tracks up in the trace
+            GLint64 gpuNow = 0;
+            glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+            gpuToCpuNs = profilerNs() - (int64_t)gpuNow;
+            gpuEnabled = true;
+            gpuTimed = true;
+        }
+        else {
+            std::cerr << "GPU timestamp queries not available, profiling CPU zones only" << std::endl;
+            result = false;
+        }
+    }
+    profilerActive.store(true, std::memory_order_relaxed);
+    return result;
+}
+
+void disableProfiler() {
+    profilerActive.store(false, std::memory_order_relaxed);
+    if (gpuEnabled) {
+        for (GpuQuerySet& set : gpuSets) {
+            if (!set.pool.empty())
+                glDeleteQueries((GLsizei)set.pool.size(), set.pool.data());
+            set.pool.clear();
+            clearGpuSet(set);
+        }
+        gpuEnabled = false;
+    }
+}
+
+void resetProfiler() {
+    series.clear();
+    trace.clear();
+    counters = ProfilerCounters();
+    {
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        for (std::unique_ptr<ThreadZones>& zones : threadBuffers) {
+            std::lock_guard<std::mutex> zonesLock(zones->mutex);
+            zones->events.clear();
+        }
+    }
+    //Results of frames already in flight are not wanted any more, their queries are simply reissued
+    for (GpuQuerySet& set : gpuSets) {
+        if (set.pending)
+            clearGpuSet(set);
+    }
+    lastFrameEndNs = profilerNs();
+}
+
+void setProfilerThreadName(const char* name) {
+    ThreadZones& zones = threadZones();
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    zones.name = name;
+}
+
+int64_t profileZoneBegin() {
+    return profilerNs();
+}
+
+void profileZoneEnd(const char* name, int64_t begin) {
+    int64_t end = profilerNs();
+    ThreadZones& zones = threadZones();
+    std::lock_guard<std::mutex> lock(zones.mutex);
+    zones.events.push_back({ name, begin, end, zones.tid });
+}
+
+int gpuPassBegin(const char* name) {
+    if (!gpuEnabled)
+        return -1;
+    GpuQuerySet& set = gpuSets[gpuCurrent];
+    unsigned int query = nextQuery(set);
+    glQueryCounter(query, GL_TIMESTAMP);
+    set.passes.push_back({ name, query, 0 });
+    return (int)set.passes.size() - 1;
+}
+
+void gpuPassEnd(int pass) {
+    GpuQuerySet& set = gpuSets[gpuCurrent];
+    //Profiler disabled or reset while the pass was open
+    if (!gpuEnabled || (size_t)pass >= set.passes.size())
+        return;
+    unsigned int query = nextQuery(set);
+    glQueryCounter(query, GL_TIMESTAMP);
+    set.passes[pass].end = query;
+}
+
+void profilerEndFrame() {
+    if (!profilerActive.load(std::memory_order_relaxed))
+        return;
+
+    //The frame itself as a zone on the GL thread, everything else of the frame nests inside it in the trace
+    int64_t now = profilerNs();
+    profileZoneEnd("frame", lastFrameEndNs);
+    lastFrameEndNs = now;
+
+    //Collect the zones every thread closed during the frame
+    {
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        for (std::unique_ptr<ThreadZones>& zones : threadBuffers) {
+            std::lock_guard<std::mutex> zonesLock(zones->mutex);
+            drained.insert(drained.end(), zones->events.begin(), zones->events.end());
+            zones->events.clear();
+        }
+    }
+    for (const ZoneEvent& event : drained) {
+        findSeries(event.name, false).frameMs += (event.endNs - event.beginNs) / 1.0e6;
+        captureEvent(event);
+    }
+    drained.clear();
+    for (ZoneSeries& zone : series) {
+        if (!zone.gpu) {
+            pushSample(zone, zone.frameMs);
+            zone.frameMs = 0.0;
+        }
+    }
+
+    //Close this frame's query set, read whatever has finished and make room for the next frame
+    if (gpuEnabled) {
+        GpuQuerySet& current = gpuSets[gpuCurrent];
+        current.pending = !current.passes.empty();
+        gpuCurrent = (gpuCurrent + 1) % gpuProfileLatency;
+        //Oldest first, so the statistics see frames in order
+        for (unsigned int i = 0; i < gpuProfileLatency; i++) {
+            GpuQuerySet& set = gpuSets[(gpuCurrent + i) % gpuProfileLatency];
+            if (set.pending)
+                resolveGpuSet(set);
+        }
+        GpuQuerySet& next = gpuSets[gpuCurrent];
+        if (next.pending) {
+            counters.gpuFramesDropped++;
+            clearGpuSet(next);
+        }
+    }
+    counters.frames++;
+}
+
+std::vector<ProfileZoneStats> profilerStats() {
+    std::vector<ProfileZoneStats> result;
+    std::vector<double> sorted;
+    for (const ZoneSeries& zone : series) {
+        if (zone.count == 0)
+            continue;
+        ProfileZoneStats stats;
+        stats.name = zone.name;
+        stats.gpu = zone.gpu;
+        stats.frames = zone.count;
+        stats.lastMs = zone.window[(zone.next + zone.window.size() - 1) % zone.window.size()];
+        //The window is full or filled from the start
+        sorted.assign(zone.window.begin(), zone.window.begin() + zone.count);
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (double ms : sorted)
+            sum += ms;
+        //Nearest-rank percentiles, as in BenchStats
+        auto percentile = [&](double p) {
+            size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+            return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+        };
+        stats.meanMs = sum / sorted.size();
+        stats.minMs = sorted.front();
+        stats.p50Ms = percentile(50.0);
+        stats.p95Ms = percentile(95.0);
+        stats.maxMs = sorted.back();
+        result.push_back(stats);
+    }
+    return result;
+}
+
+const ProfilerCounters& profilerCounters() {
+    return counters;
+}
+
+void printProfilerStats(std::ostream& out) {
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-24s %9s %9s %9s %9s   (ms per frame, last %llu frames)\n", "zone", "mean", "p50",
+        "p95", "max", (unsigned long long)profilerOptions.rollingFrames);
+    out << line;
+    for (const ProfileZoneStats& stats : profilerStats()) {
+        std::string name = (stats.gpu ? "gpu " : "") + stats.name;
+        std::snprintf(line, sizeof(line), "%-24s %9.3f %9.3f %9.3f %9.3f\n", name.c_str(), stats.meanMs, stats.p50Ms,
+            stats.p95Ms, stats.maxMs);
+        out << line;
+    }
+    if (counters.gpuFramesDropped > 0)
+        out << counters.gpuFramesDropped << " GPU frames dropped (queries not ready in time)\n";
+}
+
+void writeProfilerStats(JsonWriter& json, const char* key) {
+    json.beginObject(key);
+    json.value("rolling_frames", (uint64_t)profilerOptions.rollingFrames);
+    json.value("frames", counters.frames);
+    json.value("gpu_timers", gpuTimed);
+    json.value("gpu_frames_resolved", counters.gpuFramesResolved);
+    json.value("gpu_frames_dropped", counters.gpuFramesDropped);
+    json.value("trace_events", counters.traceEvents);
+    json.value("trace_events_dropped", counters.traceEventsDropped);
+    json.beginArray("zones");
+    for (const ProfileZoneStats& stats : profilerStats()) {
+        json.beginObject();
+        json.value("name", stats.name);
+        json.value("gpu", stats.gpu);
+        json.value("frames", (uint64_t)stats.frames);
+        json.value("last_ms", stats.lastMs);
+        json.value("mean_ms", stats.meanMs);
+        json.value("min_ms", stats.minMs);
+        json.value("p50_ms", stats.p50Ms);
+        json.value("p95_ms", stats.p95Ms);
+        json.value("max_ms", stats.maxMs);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+}
+
+static void writeThreadName(JsonWriter& json, uint32_t tid, const std::string& name) {
+    json.beginObject();
+    json.value("name", "thread_name");
+    json.value("ph", "M");
+    json.value("pid", 1);
+    json.value("tid", (uint64_t)tid);
+    json.beginObject("args");
+    json.value("name", name);
+    json.endObject();
+    json.endObject();
+}
+
+bool writeChromeTrace(const std::string& path) {
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Error opening trace file " << path << std::endl;
+        return false;
+    }
+    JsonWriter json(out);
+    json.beginObject();
+    json.value("displayTimeUnit", "ms");
+    json.beginArray("traceEvents");
+    json.beginObject();
+    json.value("name", "process_name");
+    json.value("ph", "M");
+    json.value("pid", 1);
+    json.beginObject("args");
+    json.value("name", "OpenGLIntro");
+    json.endObject();
+    json.endObject();
+    {
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        for (const std::unique_ptr<ThreadZones>& zones : threadBuffers)
+            writeThreadName(json, zones->tid, zones->name);
+    }
+    writeThreadName(json, gpuTrackId, "GPU");
+
+    //Complete ("X") events, microseconds
+    for (const ZoneEvent& event : trace) {
+        json.beginObject();
+        json.value("name", event.name);
+        json.value("cat", event.tid == gpuTrackId ? "gpu" : "cpu");
+        json.value("ph", "X");
+        json.value("ts", event.beginNs / 1000.0);
+        json.value("dur", (event.endNs - event.beginNs) / 1000.0);
+        json.value("pid", 1);
+        json.value("tid", (uint64_t)event.tid);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    out << "\n";
+    return (bool)out;
+}
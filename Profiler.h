@@ -0,0 +1,127 @@
+#pragma once
+/*Frame profiler: named CPU zones on any thread and GPU pass timers, kept as rolling per-frame statistics and,
+when asked for, as a Chrome trace (trace event JSON for chrome://tracing or Perfetto).
+    CPU zones  - PROFILE_ZONE("name") times the rest of the enclosing scope. While the profiler is disabled a zone
+                 costs one relaxed atomic load and a branch; building with OPENGLINTRO_NO_PROFILER compiles them out.
+    GPU passes - PROFILE_PASS("name") is a CPU zone plus a GL_TIMESTAMP query (glQueryCounter) at each end of the
+                 scope, GL thread only. Query sets rotate over gpuProfileLatency frames and are read once
+                 GL_QUERY_RESULT_AVAILABLE says so; a set still busy when its turn comes round again is dropped and
+                 counted rather than waited for, so profiling never stalls the pipeline.
+Frames end at profilerEndFrame, called on the GL thread after the swap. Zone names are kept by pointer and must
+outlive the profiler (string literals).*/
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class JsonWriter;
+
+//Frames a GPU query set may stay in flight before it is reused (dropped if still not available). Drivers
+//commonly let the GPU run 2-3 frames behind the CPU, so fewer sets would drop most frames under vsync.
+const unsigned int gpuProfileLatency = 5;
+
+//-- What to collect
+struct ProfilerOptions {
+    bool gpuTimers = true;       //GL_TIMESTAMP queries for PROFILE_PASS, needs a current GL context
+    size_t rollingFrames = 120;  //frames the statistics cover
+    size_t traceEvents = 0;      //zone events kept for writeChromeTrace, 0 = no trace
+};
+
+//-- Rolling statistics of one zone over the last rollingFrames frames, per frame totals in milliseconds
+struct ProfileZoneStats {
+    std::string name;
+    bool gpu = false;            //GPU time of a pass, otherwise CPU wall time
+    size_t frames = 0;           //frames in the window (GPU: resolved frames)
+    double lastMs = 0.0;
+    double meanMs = 0.0;
+    double minMs = 0.0;
+    double p50Ms = 0.0;
+    double p95Ms = 0.0;
+    double maxMs = 0.0;
+};
+
+//-- Totals since the profiler was enabled or reset
+struct ProfilerCounters {
+    uint64_t frames = 0;
+    uint64_t gpuFramesResolved = 0;
+    uint64_t gpuFramesDropped = 0;  //query set reused before its results were available
+    uint64_t traceEvents = 0;
+    uint64_t traceEventsDropped = 0; //beyond ProfilerOptions::traceEvents
+};
+
+//Start collecting. Returns false, with CPU zones still on, if GPU timers were asked for and the context has no
+//usable timestamp queries.
+bool enableProfiler(const ProfilerOptions& options = ProfilerOptions());
+//Stop collecting and release the queries (GL thread). Statistics and trace stay readable.
+void disableProfiler();
+//Forget statistics, counters and trace events (end of warm-up)
+void resetProfiler();
+void profilerEndFrame();
+//Name shown for the calling thread in the trace
+void setProfilerThreadName(const char* name);
+
+std::vector<ProfileZoneStats> profilerStats();
+const ProfilerCounters& profilerCounters();
+//Statistics table, one zone per line
+void printProfilerStats(std::ostream& out);
+//Statistics and counters as members of the open JSON object
+void writeProfilerStats(JsonWriter& json, const char* key);
+//Trace events collected so far as a Chrome trace file
+bool writeChromeTrace(const std::string& path);
+
+//Zone plumbing behind the macros
+extern std::atomic<bool> profilerActive;
+int64_t profileZoneBegin();
+void profileZoneEnd(const char* name, int64_t begin);
+int gpuPassBegin(const char* name);
+void gpuPassEnd(int pass);
+
+//-- Times its scope as a CPU zone
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) : name(name) {
+        if (profilerActive.load(std::memory_order_relaxed))
+            begin = profileZoneBegin();
+    }
+    ~ProfileScope() {
+        if (begin >= 0)
+            profileZoneEnd(name, begin);
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    int64_t begin = -1;
+};
+
+//-- CPU zone plus GPU timestamps around its scope
+class ProfilePassScope {
+public:
+    explicit ProfilePassScope(const char* name) : zone(name) {
+        if (profilerActive.load(std::memory_order_relaxed))
+            pass = gpuPassBegin(name);
+    }
+    ~ProfilePassScope() {
+        if (pass >= 0)
+            gpuPassEnd(pass);
+    }
+    ProfilePassScope(const ProfilePassScope&) = delete;
+    ProfilePassScope& operator=(const ProfilePassScope&) = delete;
+
+private:
+    ProfileScope zone;
+    int pass = -1;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#ifdef OPENGLINTRO_NO_PROFILER
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_PASS(name) ((void)0)
+#else
+#define PROFILE_ZONE(name) ProfileScope PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_PASS(name) ProfilePassScope PROFILE_CONCAT(profilePass, __LINE__)(name)
+#endif
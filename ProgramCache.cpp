@@ -0,0 +1,226 @@
+#include "ProgramCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#ifdef OPENGLINTRO_HEADLESS
+#include "HeadlessContext.h"
+#endif
+
+#include "Renderer.h"
+#include "Utility.h"
+
+//-- File header in front of the driver's binary
+struct ProgramCacheHeader {
+    char magic[8];          //"OGLPBIN"
+    uint32_t version;
+    uint32_t binaryFormat;  //GLenum returned by glGetProgramBinary
+    uint64_t key;           //guards against a file renamed by hand
+    uint32_t binaryLength;
+    uint32_t reserved;
+};
+
+static const char programCacheMagic[8] = "OGLPBIN";
+static const uint32_t programCacheVersion = 1;
+static const char* programCacheExtension = ".glprog";
+
+static bool cacheEnabled = false;
+static bool parallelCompile = false;
+static std::string cacheDirectory;
+static ProgramCacheStats cacheStats;
+
+//======================HELPERS======================
+//Hash the string and its terminator so ("ab", "c") and ("a", "bc") differ, null hashes as a lone 0xFF
+static uint64_t hashString(uint64_t hash, const char* text) {
+    if (text == nullptr) {
+        unsigned char none = 0xFF;
+        return hashBytes(hash, &none, 1);
+    }
+    return hashBytes(hash, text, std::strlen(text) + 1);
+}
+
+static std::string cachePath(uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+    return cacheDirectory + "/" + name + programCacheExtension;
+}
+
+//======================CACHE======================
+bool enableProgramCache(const std::string& directory) {
+    cacheEnabled = false;
+    if (!hasGLVersion(4, 1) && !hasGLExtension("GL_ARB_get_program_binary")) {
+        std::cerr << "Program binaries not supported, shader programs will always be compiled." << std::endl;
+        return false;
+    }
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats == 0) {
+        std::cerr << "Driver offers no program binary format, shader programs will always be compiled." << std::endl;
+        return false;
+    }
+    if (!makeDirectory(directory)) {
+        std::cerr << "Error creating shader cache directory " << directory << std::endl;
+        return false;
+    }
+    cacheDirectory = directory;
+    cacheEnabled = true;
+    return true;
+}
+
+void disableProgramCache() {
+    cacheEnabled = false;
+}
+
+bool programCacheEnabled() {
+    return cacheEnabled;
+}
+
+void clearProgramCache() {
+    if (cacheDirectory.empty())
+        return;
+    std::vector<std::string> files;
+#ifdef _WIN32
+    WIN32_FIND_DATAA found;
+    HANDLE search = FindFirstFileA((cacheDirectory + "/*" + programCacheExtension).c_str(), &found);
+    if (search != INVALID_HANDLE_VALUE) {
+        do {
+            files.push_back(found.cFileName);
+        } while (FindNextFileA(search, &found));
+        FindClose(search);
+    }
+#else
+    if (DIR* dir = opendir(cacheDirectory.c_str())) {
+        size_t extensionLength = std::strlen(programCacheExtension);
+        while (dirent* entry = readdir(dir)) {
+            size_t length = std::strlen(entry->d_name);
+            if (length > extensionLength && std::strcmp(entry->d_name + length - extensionLength, programCacheExtension) == 0)
+                files.push_back(entry->d_name);
+        }
+        closedir(dir);
+    }
+#endif
+    for (const std::string& file : files)
+        std::remove((cacheDirectory + "/" + file).c_str());
+}
+
+const ProgramCacheStats& programCacheStats() {
+    return cacheStats;
+}
+
+void resetProgramCacheStats() {
+    cacheStats = ProgramCacheStats();
+}
+
+uint64_t programCacheKey(const char* vertexSource, const char* fragmentSource, const char* geometrySource) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = hashString(hash, vertexSource);
+    hash = hashString(hash, fragmentSource);
+    hash = hashString(hash, geometrySource);
+    //Binaries are only valid for the driver that produced them
+    hash = hashString(hash, (const char*)glGetString(GL_VENDOR));
+    hash = hashString(hash, (const char*)glGetString(GL_RENDERER));
+    hash = hashString(hash, (const char*)glGetString(GL_VERSION));
+    return hash;
+}
+
+bool loadCachedProgram(uint64_t key, unsigned int program) {
+    if (!cacheEnabled)
+        return false;
+    FILE* file = std::fopen(cachePath(key).c_str(), "rb");
+    if (file == nullptr) {
+        cacheStats.misses++;
+        return false;
+    }
+    ProgramCacheHeader header;
+    std::vector<char> binary;
+    bool valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+        std::memcmp(header.magic, programCacheMagic, sizeof(header.magic)) == 0 &&
+        header.version == programCacheVersion && header.key == key && header.binaryLength > 0;
+    if (valid) {
+        binary.resize(header.binaryLength);
+        valid = std::fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    std::fclose(file);
+    if (!valid) {
+        cacheStats.misses++;
+        return false;
+    }
+
+    glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+    int linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        cacheStats.stale++;
+        return false;
+    }
+    cacheStats.hits++;
+    return true;
+}
+
+bool storeCachedProgram(uint64_t key, unsigned int program) {
+    if (!cacheEnabled)
+        return false;
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    ProgramCacheHeader header = {};
+    std::memcpy(header.magic, programCacheMagic, sizeof(header.magic));
+    header.version = programCacheVersion;
+    header.binaryFormat = format;
+    header.key = key;
+    header.binaryLength = (uint32_t)length;
+
+    //Write to a temporary name first so a crash never leaves a truncated binary under the real name
+    std::string path = cachePath(key);
+    std::string temporary = path + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+        std::fwrite(binary.data(), 1, (size_t)length, file) == (size_t)length;
+    written = std::fclose(file) == 0 && written;
+    std::remove(path.c_str());
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    cacheStats.stores++;
+    return true;
+}
+
+//======================PARALLEL COMPILE======================
+bool enableParallelShaderCompile() {
+    bool khr = hasGLExtension("GL_KHR_parallel_shader_compile");
+    if (!khr && !hasGLExtension("GL_ARB_parallel_shader_compile"))
+        return false;
+    //Both extensions share the entry point signature and GL_COMPLETION_STATUS
+#ifdef OPENGLINTRO_HEADLESS
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)
+        headlessProcAddress(khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB");
+#else
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxThreads = khr ? glMaxShaderCompilerThreadsKHR :
+        (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glMaxShaderCompilerThreadsARB;
+#endif
+    if (maxThreads == nullptr)
+        return false;
+    maxThreads(0xFFFFFFFFu); //as many threads as the implementation wants
+    parallelCompile = true;
+    return true;
+}
+
+bool parallelShaderCompileEnabled() {
+    return parallelCompile;
+}
@@ -0,0 +1,40 @@
+#pragma once
+/*On-disk cache of linked shader programs (glGetProgramBinary / glProgramBinary, GL 4.1 or ARB_get_program_binary).
+One file per program named after a 64 bit key hashed from the shader sources and the GL vendor, renderer and
+version strings, so a driver update or a source change simply misses. A binary the driver refuses (link status
+false after glProgramBinary) counts as stale and the program is compiled from source and stored again.
+compileShaderProgram / beginShaderProgram (Renderer.h) go through the cache once it is enabled.*/
+#include <cstdint>
+#include <string>
+
+#include "GLPlatform.h"
+
+//-- Cache activity since it was enabled
+struct ProgramCacheStats {
+    unsigned int hits = 0;    //loaded with glProgramBinary
+    unsigned int misses = 0;  //no file (or a different key in it)
+    unsigned int stale = 0;   //file found but rejected by the driver
+    unsigned int stores = 0;  //binaries written
+};
+
+//Cache programs in directory (created if missing). Returns false, leaving the cache off,
+//if the context cannot retrieve program binaries or the directory is unusable.
+bool enableProgramCache(const std::string& directory);
+void disableProgramCache();
+bool programCacheEnabled();
+//Delete every cached binary in the directory (cold start measurements)
+void clearProgramCache();
+const ProgramCacheStats& programCacheStats();
+void resetProgramCacheStats();
+
+//Key for a program built from these sources (geometrySource may be null) on the current driver
+uint64_t programCacheKey(const char* vertexSource, const char* fragmentSource, const char* geometrySource);
+//Load the binary stored under key into program. False on a miss or a stale binary.
+bool loadCachedProgram(uint64_t key, unsigned int program);
+//Write program's binary under key. The program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+bool storeCachedProgram(uint64_t key, unsigned int program);
+
+//Let the driver compile and link on its own threads (KHR/ARB_parallel_shader_compile).
+//Returns false if neither extension is available.
+bool enableParallelShaderCompile();
+bool parallelShaderCompileEnabled();
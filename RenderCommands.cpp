@@ -0,0 +1,114 @@
+#include "RenderCommands.h"
+
+#include <cmath>
+#include <cstring>
+
+uint64_t makeSortKey(unsigned int program, unsigned int mesh, unsigned int material, float depth) {
+    if (depth < 0.0f) depth = 0.0f;
+    if (depth > 1.0f) depth = 1.0f;
+    uint64_t depthBits = (uint64_t)(depth * (float)((1 << sortKeyDepthBits) - 1));
+    return ((uint64_t)(program & 0xFF) << 56) |
+        ((uint64_t)(mesh & 0xFF) << 48) |
+        ((uint64_t)(material & 0xFFFF) << 32) |
+        (depthBits << 8);
+}
+
+float clipRadius(const glm::mat4& mvp, float radius) {
+    float x = glm::dot(glm::vec3(mvp[0]), glm::vec3(mvp[0]));
+    float y = glm::dot(glm::vec3(mvp[1]), glm::vec3(mvp[1]));
+    float z = glm::dot(glm::vec3(mvp[2]), glm::vec3(mvp[2]));
+    float longest = x > y ? x : y;
+    return radius * std::sqrt(longest > z ? longest : z);
+}
+
+void mergeCommandBuffers(const std::vector<CommandBuffer>& buffers, std::vector<DrawPacket>& packets) {
+    size_t total = 0;
+    for (const CommandBuffer& buffer : buffers)
+        total += buffer.packets.size();
+    packets.resize(total);
+    size_t offset = 0;
+    for (const CommandBuffer& buffer : buffers) {
+        if (!buffer.packets.empty())
+            std::memcpy(&packets[offset], buffer.packets.data(), buffer.packets.size() * sizeof(DrawPacket));
+        offset += buffer.packets.size();
+    }
+}
+
+void radixSortPackets(std::vector<DrawPacket>& packets, std::vector<DrawPacket>& scratch) {
+    size_t count = packets.size();
+    if (count < 2)
+        return;
+
+    //All eight histograms in one read pass
+    static const int passes = 8;
+    std::vector<size_t> histograms(passes * 256, 0);
+    for (const DrawPacket& packet : packets) {
+        for (int pass = 0; pass < passes; pass++)
+            histograms[pass * 256 + ((packet.key >> (pass * 8)) & 0xFF)]++;
+    }
+
+    scratch.resize(count);
+    DrawPacket* source = packets.data();
+    DrawPacket* destination = scratch.data();
+    for (int pass = 0; pass < passes; pass++) {
+        size_t* histogram = &histograms[pass * 256];
+        //Every key shares this digit, the pass would only copy
+        if (histogram[(source[0].key >> (pass * 8)) & 0xFF] == count)
+            continue;
+
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; digit++) {
+            size_t bucket = histogram[digit];
+            histogram[digit] = offset;
+            offset += bucket;
+        }
+        for (size_t i = 0; i < count; i++) {
+            size_t digit = (source[i].key >> (pass * 8)) & 0xFF;
+            destination[histogram[digit]++] = source[i];
+        }
+        DrawPacket* swap = source;
+        source = destination;
+        destination = swap;
+    }
+    //An odd number of passes left the result in scratch
+    if (source != packets.data())
+        packets.swap(scratch);
+}
+
+SubmitStats submitPackets(const std::vector<DrawPacket>& packets, const CommandTables& tables,
+    const glm::mat4* transforms, GLStateCache& state) {
+    SubmitStats stats;
+    unsigned int lastProgram = 0xFFFFFFFFu, lastMesh = 0xFFFFFFFFu, lastMaterial = 0xFFFFFFFFu;
+    for (const DrawPacket& packet : packets) {
+        unsigned int programIndex = sortKeyProgram(packet.key);
+        unsigned int meshIndex = sortKeyMesh(packet.key);
+        unsigned int material = sortKeyMaterial(packet.key);
+        const CommandProgram& program = tables.programs[programIndex];
+        const CommandMesh& mesh = tables.meshes[meshIndex];
+
+        //Switch counts follow the key; the state cache drops the redundant GL calls
+        if (programIndex != lastProgram) {
+            stats.programSwitches++;
+            lastProgram = programIndex;
+            lastMaterial = 0xFFFFFFFFu; //uniforms are per program
+        }
+        if (meshIndex != lastMesh) {
+            stats.meshSwitches++;
+            lastMesh = meshIndex;
+        }
+        if (material != lastMaterial) {
+            stats.materialSwitches++;
+            lastMaterial = material;
+        }
+
+        state.useProgram(program.program);
+        state.bindVertexArray(mesh.VAO);
+        const glm::vec3& color = tables.materials[material];
+        state.uniform3f(program.colorLoc, color.r, color.g, color.b);
+        state.uniformMatrix4(program.transformLoc, transforms[packet.object]);
+        glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
+        state.countCalls(1, 1);
+        stats.draws++;
+    }
+    return stats;
+}
@@ -0,0 +1,85 @@
+#pragma once
+/*Render command recording.
+Worker threads traverse and cull the scene and record compact DrawPackets into their own CommandBuffer,
+no locks and no GL. The buffers are merged and radix sorted by their 64 bit key, then the GL thread
+submits the sorted list through GLStateCache: packets sharing a program / VAO / material sit next to each other,
+so each of those is bound once per run instead of once per object.
+
+Sort key, most significant first:
+    program 8 bits | mesh (VAO) 8 bits | material 16 bits | depth 24 bits (front to back) | unused 8 bits*/
+#include <cstdint>
+#include <vector>
+
+#include "GLStateCache.h"
+
+#include <glm.hpp>
+
+const int sortKeyProgramBits = 8;
+const int sortKeyMeshBits = 8;
+const int sortKeyMaterialBits = 16;
+const int sortKeyDepthBits = 24;
+
+//-- Build a sort key. depth is normalized device depth in [0, 1], clamped.
+uint64_t makeSortKey(unsigned int program, unsigned int mesh, unsigned int material, float depth);
+inline unsigned int sortKeyProgram(uint64_t key) { return (unsigned int)(key >> 56); }
+inline unsigned int sortKeyMesh(uint64_t key) { return (unsigned int)(key >> 48) & 0xFF; }
+inline unsigned int sortKeyMaterial(uint64_t key) { return (unsigned int)(key >> 32) & 0xFFFF; }
+
+//-- Sphere of radius around the object's origin (mvp[3]) against the x/y planes of the clip volume
+inline bool isSphereInClip(const glm::mat4& mvp, float radius) {
+    const glm::vec4& center = mvp[3];
+    return center.x >= -center.w - radius && center.x <= center.w + radius &&
+        center.y >= -center.w - radius && center.y <= center.w + radius;
+}
+//Clip-space radius of a model-space radius, from the longest of the three basis vectors
+float clipRadius(const glm::mat4& mvp, float radius);
+
+//-- One draw: what to bind comes from the key, the per-object data from object
+struct DrawPacket {
+    uint64_t key;
+    uint32_t object;   //index into the transform array passed to submitPackets
+    uint32_t reserved;
+};
+
+//-- Packets recorded by one thread
+struct CommandBuffer {
+    std::vector<DrawPacket> packets;
+
+    void clear() { packets.clear(); }
+    void draw(uint64_t key, uint32_t object) { packets.push_back(DrawPacket{ key, object, 0 }); }
+};
+
+//Concatenate buffers into packets (cleared first)
+void mergeCommandBuffers(const std::vector<CommandBuffer>& buffers, std::vector<DrawPacket>& packets);
+
+//LSD radix sort on the key, 8 bits per pass, stable. Passes where every key has the same digit are skipped.
+//scratch is resized as needed and can be reused across frames.
+void radixSortPackets(std::vector<DrawPacket>& packets, std::vector<DrawPacket>& scratch);
+
+//-- GL objects the key indices refer to
+struct CommandProgram {
+    unsigned int program = 0;
+    int transformLoc = -1;
+    int colorLoc = -1;
+};
+struct CommandMesh {
+    unsigned int VAO = 0;
+    int indexCount = 0;
+};
+struct CommandTables {
+    std::vector<CommandProgram> programs;
+    std::vector<CommandMesh> meshes;
+    std::vector<glm::vec3> materials;  //color per material
+};
+
+//-- What submitting a packet list changed
+struct SubmitStats {
+    unsigned long long draws = 0;
+    unsigned long long programSwitches = 0;
+    unsigned long long meshSwitches = 0;
+    unsigned long long materialSwitches = 0;
+};
+
+//Issue every packet in order on the GL thread. transforms[packet.object] is the object's final matrix.
+SubmitStats submitPackets(const std::vector<DrawPacket>& packets, const CommandTables& tables,
+    const glm::mat4* transforms, GLStateCache& state);
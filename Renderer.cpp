@@ -0,0 +1,358 @@
+#include "Renderer.h"
+#include "GeometryCache.h"
+#include "MeshImporter.h"
+#include "Profiler.h"
+#include "ProgramCache.h"
+#include "Scene.h"
+#include "VertexFormat.h"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <gtc/type_ptr.hpp>
+
+bool hasGLVersion(int major, int minor) {
+    int contextMajor = 0, contextMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+    return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+}
+
+bool hasGLExtension(const char* name) {
+    int count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (int i = 0; i < count; i++) {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension != nullptr && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+//Print the compile or link log of a shader object / program if it failed
+static bool checkShader(unsigned int shader, const char* name) {
+    int success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (success)
+        return true;
+    char log[1024];
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    std::cerr << "Failed to compile " << name << " shader:\n" << log << std::endl;
+    return false;
+}
+
+static bool checkProgram(unsigned int program) {
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success)
+        return true;
+    char log[1024];
+    glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+    std::cerr << "Failed to link shader program:\n" << log << std::endl;
+    return false;
+}
+
+PendingProgram beginShaderProgram(const char* vertexSource, const char* fragmentSource, const char* geometrySource) {
+    PendingProgram pending;
+    //Create shader program
+    pending.program = glCreateProgram();
+
+    //Try the binary cache first, a hit needs no compiling at all
+    if (programCacheEnabled()) {
+        pending.cacheKey = programCacheKey(vertexSource, fragmentSource, geometrySource);
+        if (loadCachedProgram(pending.cacheKey, pending.program)) {
+            pending.fromCache = true;
+            return pending;
+        }
+        //Ask for a retrievable binary so finishShaderProgram can store it
+        glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    //Create vertex shaders
+    pending.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    //Compile vertex shaders
+    glShaderSource(pending.vertexShader, 1, &vertexSource, nullptr); //Set to source
+    glCompileShader(pending.vertexShader); //Compile
+
+    //Create fragment shaders
+    pending.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    //Compile fragment shaders
+    glShaderSource(pending.fragmentShader, 1, &fragmentSource, nullptr); //Set to source
+    glCompileShader(pending.fragmentShader); //Compile
+
+    //Create and compile the optional geometry shader
+    if (geometrySource != nullptr) {
+        pending.geometryShader = glCreateShader(GL_GEOMETRY_SHADER);
+        glShaderSource(pending.geometryShader, 1, &geometrySource, nullptr);
+        glCompileShader(pending.geometryShader);
+    }
+
+    //Add shaders to program
+    glAttachShader(pending.program, pending.vertexShader);
+    glAttachShader(pending.program, pending.fragmentShader);
+    if (pending.geometryShader != 0)
+        glAttachShader(pending.program, pending.geometryShader);
+
+    //Finalize and link to openGL. With parallel compile this returns before the driver threads are done.
+    glLinkProgram(pending.program);
+    return pending;
+}
+
+unsigned int finishShaderProgram(PendingProgram& pending) {
+    unsigned int shaderProgram = pending.program;
+    pending.program = 0;
+    if (pending.fromCache)
+        return shaderProgram;
+
+    //Status queries wait for the compile and link to complete
+    bool ok = checkShader(pending.vertexShader, "vertex") && checkShader(pending.fragmentShader, "fragment") &&
+        (pending.geometryShader == 0 || checkShader(pending.geometryShader, "geometry")) && checkProgram(shaderProgram);
+
+    //Delete unused shaders after linking
+    glDeleteShader(pending.vertexShader);
+    glDeleteShader(pending.fragmentShader);
+    if (pending.geometryShader != 0)
+        glDeleteShader(pending.geometryShader);
+    pending.vertexShader = pending.fragmentShader = pending.geometryShader = 0;
+
+    if (!ok) {
+        glDeleteProgram(shaderProgram);
+        return 0;
+    }
+    if (programCacheEnabled())
+        storeCachedProgram(pending.cacheKey, shaderProgram);
+    return shaderProgram;
+}
+
+unsigned int compileShaderProgram(const char* vertexSource, const char* fragmentSource, const char* geometrySource) {
+    PendingProgram pending = beginShaderProgram(vertexSource, fragmentSource, geometrySource);
+    return finishShaderProgram(pending);
+}
+
+unsigned int compileComputeProgram(const char* computeSource) {
+    unsigned int program = glCreateProgram();
+    unsigned int shader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(shader, 1, &computeSource, nullptr);
+    glCompileShader(shader);
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+    bool ok = checkShader(shader, "compute") && checkProgram(program);
+    glDeleteShader(shader);
+    if (!ok) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+PendingProgram beginOutlineProgram(const char* vertexSource) {
+    return beginShaderProgram(vertexSource, outlineFragmentShaderSource, outlineGeometryShaderSource);
+}
+
+bool finishOutlineProgram(OutlineProgram& outline, PendingProgram& pending) {
+    outline.program = finishShaderProgram(pending);
+    if (outline.program == 0)
+        return false;
+    ProgramReflection reflection = reflectProgram(outline.program);
+    outline.transformLoc = reflection.location("transform");
+    outline.fillColorLoc = reflection.location("ourColor");
+    outline.outlineColorLoc = reflection.location("outlineColor");
+    outline.outlineWidthLoc = reflection.location("outlineWidth");
+    outline.viewportSizeLoc = reflection.location("viewportSize");
+
+    //Uniforms that do not change per frame are set once here, the program keeps them
+    int viewport[4] = {};
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glUseProgram(outline.program);
+    glUniform3f(outline.outlineColorLoc, 0.0f, 0.0f, 0.0f); //Black outline
+    setOutlineWidth(outline, defaultOutlineWidth);
+    setOutlineViewport(outline, viewport[2], viewport[3]);
+    return true;
+}
+
+void destroyOutlineProgram(OutlineProgram& outline) {
+    if (outline.program != 0)
+        glDeleteProgram(outline.program);
+    outline = OutlineProgram();
+}
+
+void setOutlineWidth(const OutlineProgram& outline, float pixels) {
+    glUseProgram(outline.program);
+    glUniform1f(outline.outlineWidthLoc, pixels);
+}
+
+void setOutlineViewport(const OutlineProgram& outline, int width, int height) {
+    glUseProgram(outline.program);
+    glUniform2f(outline.viewportSizeLoc, (float)width, (float)height);
+}
+
+//Fill the bound EBO at the narrowest index size the vertex count allows
+static void uploadIndices(PyramidRenderer& renderer, const unsigned int* source, size_t count, size_t vertexCount) {
+    unsigned int indexSize = indexSizeFor(vertexCount);
+    if (indexSize == sizeof(unsigned int)) {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), source, GL_STATIC_DRAW);
+    }
+    else {
+        std::vector<uint16_t> narrow(count);
+        writeIndices(source, count, indexSize, narrow.data());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(uint16_t), narrow.data(), GL_STATIC_DRAW);
+    }
+    renderer.indexCount = (int)count;
+    renderer.indexType = indexTypeFor(indexSize);
+}
+
+bool createPyramidRenderer(PyramidRenderer& renderer, bool singlePassOutline) {
+    //======================SHADERS======================
+    //Start both programs before waiting on either so they can compile in parallel
+    PendingProgram pendingProgram = beginShaderProgram(vertexShaderSource, fragmentShaderSource);
+    PendingProgram pendingOutline;
+    if (singlePassOutline)
+        pendingOutline = beginOutlineProgram(outlineVertexShaderSource);
+
+    renderer.shaderProgram = finishShaderProgram(pendingProgram);
+    bool outlineBuilt = singlePassOutline && finishOutlineProgram(renderer.outline, pendingOutline);
+    if (renderer.shaderProgram == 0) {
+        destroyOutlineProgram(renderer.outline);
+        return false;
+    }
+
+    //Get uniform locations for gradiant and transform
+    ProgramReflection reflection = reflectProgram(renderer.shaderProgram);
+    renderer.colorLoc = reflection.location("ourColor");
+    renderer.transformLoc = reflection.location("transform");
+
+    //Single pass outline program, the fill color never changes so it is set once
+    renderer.singlePassOutline = singlePassOutline;
+    if (singlePassOutline) {
+        if (outlineBuilt) {
+            glUniform3f(renderer.outline.fillColorLoc, 1.0f, 0.0f, 0.0f);
+        }
+        else {
+            std::cerr << "Single pass outline unavailable, drawing the outline in a second pass." << std::endl;
+            renderer.singlePassOutline = false;
+        }
+    }
+
+    //======================SHAPE======================
+    //Genereate Vertex array and bind array to openGL
+    glGenVertexArrays(1, &renderer.VAO);
+    glBindVertexArray(renderer.VAO);
+
+    //Generate buffers
+    glGenBuffers(1, &renderer.VBO);
+    glGenBuffers(1, &renderer.EBO);
+
+    //Bind VBO buffer to openGL
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.VBO);
+    //Fill buffer with pyramid vertices
+    glBufferData(GL_ARRAY_BUFFER, sizeof(verticesPyramid), verticesPyramid, GL_STATIC_DRAW);
+
+    //Bind EBO buffer to openGL
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.EBO);
+    //Fill buffer with pyramid indices
+    uploadIndices(renderer, indices, pyramidIndexCount, sizeof(verticesPyramid) / (3 * sizeof(float)));
+
+    //Explain how to interpret vertices data
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    //Create identity matrix as baseline for shader
+    glUseProgram(renderer.shaderProgram);
+    glm::mat4 identity(1.0f);
+    glUniformMatrix4fv(renderer.transformLoc, 1, GL_FALSE, glm::value_ptr(identity));
+
+    return true;
+}
+
+void destroyPyramidRenderer(PyramidRenderer& renderer) {
+    glDeleteVertexArrays(1, &renderer.VAO);
+    glDeleteBuffers(1, &renderer.VBO);
+    glDeleteBuffers(1, &renderer.EBO);
+    glDeleteProgram(renderer.shaderProgram);
+    destroyOutlineProgram(renderer.outline);
+    renderer = PyramidRenderer();
+}
+
+bool uploadMesh(PyramidRenderer& renderer, const MeshData& mesh) {
+    if (mesh.indices.empty() || mesh.indices.size() > 0x7FFFFFFF) {
+        std::cerr << "Mesh has no triangles or too many indices to draw at once." << std::endl;
+        return false;
+    }
+    //The VAO keeps its EBO binding, only the buffer contents and the vertex layout change
+    glBindVertexArray(renderer.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.VBO);
+    glBufferData(GL_ARRAY_BUFFER, mesh.positions.size() * sizeof(float), mesh.positions.data(), GL_STATIC_DRAW);
+    setupVertexAttributes(makeVertexFormat(PositionEncoding::Float32));
+    uploadIndices(renderer, mesh.indices.data(), mesh.indices.size(), mesh.vertexCount());
+    return true;
+}
+
+bool uploadPackedMesh(PyramidRenderer& renderer, const PackedMesh& mesh) {
+    if (mesh.indexCount == 0 || mesh.indexCount > 0x7FFFFFFF || (mesh.indexSize != 2 && mesh.indexSize != 4)) {
+        std::cerr << "Packed mesh has no triangles, too many indices or an unsupported index size." << std::endl;
+        return false;
+    }
+    glBindVertexArray(renderer.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.VBO);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertexBytes, mesh.vertices, GL_STATIC_DRAW);
+    setupVertexAttributes(mesh.format);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBytes, mesh.indices, GL_STATIC_DRAW);
+    renderer.indexCount = (int)mesh.indexCount;
+    renderer.indexType = indexTypeFor(mesh.indexSize);
+    return true;
+}
+
+void renderFrame(const PyramidRenderer& renderer, const glm::mat4& transform, GLStateCache& state) {
+    //Clear screen and set color
+    {
+        PROFILE_PASS("clear");
+        state.clearColor(0.2f, 0.3f, 0.3f, 0.1f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        state.countCalls(1);
+    }
+
+    if (renderer.singlePassOutline) {
+        //Filled red pyramid with its black outline in one draw, no polygon mode or line width changes
+        PROFILE_PASS("draw fill+outline");
+        state.useProgram(renderer.outline.program);
+        state.uniformMatrix4(renderer.outline.transformLoc, transform);
+        state.bindVertexArray(renderer.VAO);
+        glDrawElements(GL_TRIANGLES, renderer.indexCount, renderer.indexType, 0);
+        state.countCalls(1, 1);
+        return;
+    }
+
+    //Run shaders program
+    state.useProgram(renderer.shaderProgram);
+    //-- update the uniform transform matrix
+    state.uniformMatrix4(renderer.transformLoc, transform);
+
+    {
+        //Draw filled pyramid with red color.
+        PROFILE_PASS("draw fill");
+        state.polygonMode(GL_FILL);
+        state.uniform3f(renderer.colorLoc, 1.0f, 0.0f, 0.0f);
+
+        //Bind Vertex Array
+        state.bindVertexArray(renderer.VAO);
+
+        //Draw element bases on elements array and object array, 18 vertices
+        glDrawElements(GL_TRIANGLES, renderer.indexCount, renderer.indexType, 0);
+        state.countCalls(1, 1);
+    }
+    {
+        //Draw outlines in black.
+        PROFILE_PASS("draw outline");
+        state.polygonMode(GL_LINE);
+        state.lineWidth(3.0f);
+        state.uniform3f(renderer.colorLoc, 0.0f, 0.0f, 0.0f); // Black outline.
+
+        //Draw element bases on elements array and object array, 18 vertices
+        glDrawElements(GL_TRIANGLES, renderer.indexCount, renderer.indexType, 0);
+        state.countCalls(1, 1);
+    }
+
+    // Restore polygon mode to fill.
+    state.polygonMode(GL_FILL);
+}
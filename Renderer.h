@@ -0,0 +1,85 @@
+#pragma once
+//GL resources and draw calls for the pyramid, shared by the windowed app and the headless benchmark.
+#include <cstdint>
+
+#include "GLPlatform.h"
+#include "GLStateCache.h"
+
+#include <glm.hpp>
+
+struct MeshData;
+struct PackedMesh;
+
+//-- Single pass fill + outline program (outline*ShaderSource in Scene.cpp) and its uniforms
+struct OutlineProgram {
+    unsigned int program = 0;
+    int transformLoc = -1;
+    int fillColorLoc = -1;      //single pyramid only, instances carry their own color
+    int outlineColorLoc = -1;
+    int outlineWidthLoc = -1;
+    int viewportSizeLoc = -1;
+};
+
+const float defaultOutlineWidth = 3.0f; //pixels, same as the old glLineWidth
+
+//-- Everything needed to draw the pyramid
+struct PyramidRenderer {
+    unsigned int shaderProgram = 0;
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
+    int indexCount = 0;            //pyramidIndexCount until uploadMesh replaces the geometry
+    unsigned int indexType = GL_UNSIGNED_INT;  //GL_UNSIGNED_SHORT when the vertex count allows (VertexFormat.h)
+    int transformLoc = -1;
+    int colorLoc = -1;
+    OutlineProgram outline;
+    bool singlePassOutline = true; //false = GL_FILL pass + GL_LINE pass
+};
+
+//Context capability checks, valid once a context is current
+bool hasGLVersion(int major, int minor);
+bool hasGLExtension(const char* name);
+
+//-- A program whose compile and link may still be running on driver threads
+struct PendingProgram {
+    unsigned int program = 0;
+    unsigned int vertexShader = 0;
+    unsigned int fragmentShader = 0;
+    unsigned int geometryShader = 0;
+    uint64_t cacheKey = 0;
+    bool fromCache = false;  //loaded from the program binary cache, nothing to compile
+};
+
+//Compile and link a program from vertex, optional geometry and fragment source. Returns 0 and prints the log on failure.
+//Goes through the program binary cache when it is enabled (ProgramCache.h).
+unsigned int compileShaderProgram(const char* vertexSource, const char* fragmentSource, const char* geometrySource = nullptr);
+//Same in two steps: begin several programs before finishing any so the driver can build them in parallel
+//(KHR_parallel_shader_compile). finishShaderProgram blocks until that program is linked.
+PendingProgram beginShaderProgram(const char* vertexSource, const char* fragmentSource, const char* geometrySource = nullptr);
+unsigned int finishShaderProgram(PendingProgram& pending);
+//Compile and link a compute program (GL 4.3). Not cached. Returns 0 and prints the log on failure.
+unsigned int compileComputeProgram(const char* computeSource);
+
+//Build the outline program around vertexSource, black outline of defaultOutlineWidth sized to the current viewport.
+//Split like beginShaderProgram / finishShaderProgram.
+PendingProgram beginOutlineProgram(const char* vertexSource);
+bool finishOutlineProgram(OutlineProgram& outline, PendingProgram& pending);
+void destroyOutlineProgram(OutlineProgram& outline);
+//Outline width in pixels; viewport size in pixels, call again when the framebuffer is resized
+void setOutlineWidth(const OutlineProgram& outline, float pixels);
+void setOutlineViewport(const OutlineProgram& outline, int width, int height);
+
+//Create shaders, buffers and vertex layout. Expects a current GL context.
+//Falls back to the two pass outline if singlePassOutline is set but the outline program does not build.
+bool createPyramidRenderer(PyramidRenderer& renderer, bool singlePassOutline = true);
+void destroyPyramidRenderer(PyramidRenderer& renderer);
+//Replace the pyramid in the renderer's VBO/EBO with an imported mesh (MeshImporter.h), float positions,
+//16 bit indices when it has few enough vertices
+bool uploadMesh(PyramidRenderer& renderer, const MeshData& mesh);
+//Same from a geometry pack (GeometryCache.h): the mapped blobs go to glBufferData as they are, the attributes
+//follow the pack's vertex format. Draw with mesh.positionDecode in the transform.
+bool uploadPackedMesh(PyramidRenderer& renderer, const PackedMesh& mesh);
+
+//Clear the screen then draw the filled pyramid and its outline, in one draw or two depending on singlePassOutline
+//State changes and uniform uploads go through state, redundant ones are skipped
+void renderFrame(const PyramidRenderer& renderer, const glm::mat4& transform, GLStateCache& state);
@@ -0,0 +1,329 @@
+#include "Scene.h"
+#include "VertexTransform.h"
+
+#include <vector>
+
+/*Defining vertex shaders sources.
+Line by line description of vertex source:
+Creating GLSL program stored as string lateral.
+Indicate OpenGL version (3.30)
+3 coord vector aPos bound to location 0
+const 4*4 matrice variable delcared, named transform
+the main loop calculates the following:
+    gl_position = final vertex position; transform * vec4(aPos, 1.0) = applies transformation using transform matrix to aPos;
+    final vertex position = applied transformation, using transform matrix, on aPos*/
+const char* vertexShaderSource = R"glsl(
+    #version 330 core
+    layout (location = 0) in vec3 aPos;
+    uniform mat4 transform;
+    void main() {
+        gl_Position = transform * vec4(aPos, 1.0);
+    }
+)glsl";
+
+/*Defining fragment shaders sources.
+Line by line description of vertex source:
+Creating GLSL program stored as string lateral.
+Indicate OpenGL version (3.30)
+Define 3 coord vector as color and as ourColor
+The main loop enforces the color vector ourColor (read in RGB)*/
+const char* fragmentShaderSource = R"glsl(
+    #version 330 core
+    out vec3 color;
+    uniform vec3 ourColor;
+    void main(){
+      color = ourColor;
+    }
+)glsl";
+
+/*Defining instanced vertex shaders sources.
+Same as vertexShaderSource, plus:
+4*4 matrix aInstanceTransform bound to locations 1-4 and vec4 aInstanceColor bound to location 5, both advancing once per instance
+the instance transform places the pyramid in the grid, transform then applies the keyboard transformation to the whole grid
+the instance color is passed on to the fragment shader*/
+const char* instancedVertexShaderSource = R"glsl(
+    #version 330 core
+    layout (location = 0) in vec3 aPos;
+    layout (location = 1) in mat4 aInstanceTransform;
+    layout (location = 5) in vec4 aInstanceColor;
+    uniform mat4 transform;
+    out vec3 vertexColor;
+    void main() {
+        gl_Position = transform * aInstanceTransform * vec4(aPos, 1.0);
+        vertexColor = aInstanceColor.rgb;
+    }
+)glsl";
+
+/*Defining instanced fragment shaders sources.
+colorOverride.rgb replaces the instance color by colorOverride.a (0 = instance color, 1 = override, used for the outline)*/
+const char* instancedFragmentShaderSource = R"glsl(
+    #version 330 core
+    in vec3 vertexColor;
+    out vec3 color;
+    uniform vec4 colorOverride;
+    void main(){
+      color = mix(vertexColor, colorOverride.rgb, colorOverride.a);
+    }
+)glsl";
+
+/*Defining single pass outline shaders sources.
+The filled triangle and its outline come out of one draw instead of a GL_FILL pass plus a GL_LINE pass.
+outlineVertexShaderSource is vertexShaderSource with the uniform color moved to the vertex stage,
+so it reaches the geometry shader the same way the per-instance color does (instancedVertexShaderSource)*/
+const char* outlineVertexShaderSource = R"glsl(
+    #version 330 core
+    layout (location = 0) in vec3 aPos;
+    uniform mat4 transform;
+    uniform vec3 ourColor;
+    out vec3 vertexColor;
+    void main() {
+        gl_Position = transform * vec4(aPos, 1.0);
+        vertexColor = ourColor;
+    }
+)glsl";
+
+/*Geometry shader: for each triangle, project the corners to pixels (viewportSize) and give every corner
+its distance to the opposite edge (twice the area / edge length), zero for the two other edges.
+Interpolated without perspective, edgeDistance then holds the pixel distance of a fragment to each of the three edges*/
+const char* outlineGeometryShaderSource = R"glsl(
+    #version 330 core
+    layout (triangles) in;
+    layout (triangle_strip, max_vertices = 3) out;
+    in vec3 vertexColor[];
+    uniform vec2 viewportSize;
+    out vec3 fillColor;
+    noperspective out vec3 edgeDistance;
+    void main() {
+        vec2 p0 = 0.5 * viewportSize * gl_in[0].gl_Position.xy / gl_in[0].gl_Position.w;
+        vec2 p1 = 0.5 * viewportSize * gl_in[1].gl_Position.xy / gl_in[1].gl_Position.w;
+        vec2 p2 = 0.5 * viewportSize * gl_in[2].gl_Position.xy / gl_in[2].gl_Position.w;
+        vec2 e0 = p2 - p1;
+        vec2 e1 = p2 - p0;
+        vec2 e2 = p1 - p0;
+        float doubleArea = abs(e1.x * e2.y - e1.y * e2.x);
+        vec3 heights = doubleArea / max(vec3(length(e0), length(e1), length(e2)), 1e-6);
+
+        fillColor = vertexColor[0];
+        edgeDistance = vec3(heights.x, 0.0, 0.0);
+        gl_Position = gl_in[0].gl_Position;
+        EmitVertex();
+        fillColor = vertexColor[1];
+        edgeDistance = vec3(0.0, heights.y, 0.0);
+        gl_Position = gl_in[1].gl_Position;
+        EmitVertex();
+        fillColor = vertexColor[2];
+        edgeDistance = vec3(0.0, 0.0, heights.z);
+        gl_Position = gl_in[2].gl_Position;
+        EmitVertex();
+        EndPrimitive();
+    }
+)glsl";
+
+/*Fragment shader: fragments closer than half of outlineWidth pixels to an edge take outlineColor, with one pixel of smoothing.
+Each triangle covers its own half of a shared edge, so interior edges come out outlineWidth wide like the old GL_LINE pass,
+silhouette edges half as wide since nothing is drawn outside the triangle*/
+const char* outlineFragmentShaderSource = R"glsl(
+    #version 330 core
+    in vec3 fillColor;
+    noperspective in vec3 edgeDistance;
+    out vec3 color;
+    uniform vec3 outlineColor;
+    uniform float outlineWidth;
+    void main(){
+      float nearest = min(edgeDistance.x, min(edgeDistance.y, edgeDistance.z));
+      float halfWidth = 0.5 * outlineWidth;
+      float coverage = 1.0 - smoothstep(halfWidth - 0.5, halfWidth + 0.5, nearest);
+      color = mix(fillColor, outlineColor, coverage);
+    }
+)glsl";
+
+/*GPU culling compute shader (IndirectRenderer.h), one invocation per object.
+The sphere test repeats isIndirectObjectInClip operation for operation; precise keeps the compiler from fusing or
+reordering them, so it decides exactly like the CPU fallback. Visible objects are counted per mesh in shared memory
+first, then each group reserves its slots with one atomicAdd per mesh on the draw command's instanceCount and copies
+the objects' instance data into them. groupCounts holds indirectMaxMeshes entries.*/
+const char* indirectCullShaderSource = R"glsl(
+    #version 430 core
+    layout (local_size_x = 64) in;
+    struct Object { float model[16]; uint color; uint mesh; float radius; uint reserved; };
+    struct Instance { float model[16]; uint color; };
+    struct DrawCommand { uint count; uint instanceCount; uint firstIndex; int baseVertex; uint baseInstance; };
+    layout (std430, binding = 0) readonly buffer Objects { Object objects[]; };
+    layout (std430, binding = 1) writeonly buffer Instances { Instance instances[]; };
+    layout (std430, binding = 2) writeonly buffer Visible { uint visible[]; };
+    layout (std430, binding = 3) buffer Commands { DrawCommand commands[]; };
+    uniform mat4 transform;
+    uniform uint objectCount;
+    uniform uint meshCount;
+    shared uint groupCounts[256];
+    shared uint groupBases[256];
+    void main() {
+        uint local = gl_LocalInvocationIndex;
+        for (uint j = local; j < meshCount; j += gl_WorkGroupSize.x)
+            groupCounts[j] = 0u;
+        memoryBarrierShared();
+        barrier();
+
+        uint i = gl_GlobalInvocationID.x;
+        bool inside = false;
+        uint mesh = 0u;
+        uint slot = 0u;
+        if (i < objectCount) {
+            float m[16] = objects[i].model;
+            precise vec4 x = (transform[0] * m[0] + transform[1] * m[1]) + (transform[2] * m[2] + transform[3] * m[3]);
+            precise vec4 y = (transform[0] * m[4] + transform[1] * m[5]) + (transform[2] * m[6] + transform[3] * m[7]);
+            precise vec4 z = (transform[0] * m[8] + transform[1] * m[9]) + (transform[2] * m[10] + transform[3] * m[11]);
+            precise vec4 center = (transform[0] * m[12] + transform[1] * m[13]) + (transform[2] * m[14] + transform[3] * m[15]);
+            precise float lengthX = (x.x * x.x + x.y * x.y) + x.z * x.z;
+            precise float lengthY = (y.x * y.x + y.y * y.y) + y.z * y.z;
+            precise float lengthZ = (z.x * z.x + z.y * z.y) + z.z * z.z;
+            precise float longest = lengthX > lengthY ? lengthX : lengthY;
+            precise float radius = objects[i].radius * sqrt(longest > lengthZ ? longest : lengthZ);
+            inside = center.x >= -center.w - radius && center.x <= center.w + radius &&
+                center.y >= -center.w - radius && center.y <= center.w + radius;
+            if (inside) {
+                mesh = objects[i].mesh;
+                slot = atomicAdd(groupCounts[mesh], 1u);
+            }
+        }
+        memoryBarrierShared();
+        barrier();
+
+        for (uint j = local; j < meshCount; j += gl_WorkGroupSize.x) {
+            if (groupCounts[j] > 0u)
+                groupBases[j] = commands[j].baseInstance + atomicAdd(commands[j].instanceCount, groupCounts[j]);
+        }
+        memoryBarrierShared();
+        barrier();
+
+        if (inside) {
+            uint target = groupBases[mesh] + slot;
+            instances[target].model = objects[i].model;
+            instances[target].color = objects[i].color;
+            visible[target] = i;
+        }
+    }
+)glsl";
+
+/*Pyramid vertices
+Translating the triangle into a pyramid is doable by shifting the base points of the 2D plane along the z-axis equaly on both sides:
+(-0.5,-0.5,0.5), (0.5,-0.5,0.5) & (-0.5,-0.5,-0.5), (0.5,-0.5,-0.5) with apex (0,0.5,0)*/
+const float verticesPyramid[pyramidVertexCount * 3] = {
+    -0.5f, -0.5f, 0.5f,
+    0.5f, -0.5f, 0.5f,
+    -0.5f, -0.5f, -0.5f,
+    0.5f, -0.5f, -0.5f,
+    0.0f, 0.5f, 0.0f
+};
+
+//Defining the indices of the pyramid where each num represents the index of a vertice in verticesPyramid
+const unsigned int indices[pyramidIndexCount] = {
+    0, 1, 2, //Base 1
+    1, 3, 2, //Base 2
+    0, 1, 4,
+    1, 3, 4,
+    3, 2, 4,
+    2, 0, 4
+};
+
+//Same order and amounts as the original if-chain: W S A D, Q E, R F, Z X, T G
+const CommandAction commandActions[commandCount] = {
+    // Translation
+    { CommandAction::Translate, glm::vec3(0.0f, 1.0f, 0.0f), 0.0f },
+    { CommandAction::Translate, glm::vec3(0.0f, -1.0f, 0.0f), 0.0f },
+    { CommandAction::Translate, glm::vec3(-1.0f, 0.0f, 0.0f), 0.0f },
+    { CommandAction::Translate, glm::vec3(1.0f, 0.0f, 0.0f), 0.0f },
+    // Rotation rotate around the Z-axis
+    { CommandAction::Rotate, glm::vec3(0.0f, 0.0f, 1.0f), 30.0f },
+    { CommandAction::Rotate, glm::vec3(0.0f, 0.0f, 1.0f), -30.0f },
+    // Scaling only the Z axis
+    { CommandAction::Scale, glm::vec3(0.0f, 0.0f, 1.0f), 1.0f },
+    { CommandAction::Scale, glm::vec3(0.0f, 0.0f, 1.0f), -1.0f },
+    // Demo Additions
+    //Y ROTATIONS
+    { CommandAction::Rotate, glm::vec3(0.0f, 1.0f, 0.0f), 5.0f },
+    { CommandAction::Rotate, glm::vec3(0.0f, 1.0f, 0.0f), -5.0f },
+    //X ROTATIONS
+    { CommandAction::Rotate, glm::vec3(1.0f, 0.0f, 0.0f), 5.0f },
+    { CommandAction::Rotate, glm::vec3(1.0f, 0.0f, 0.0f), -5.0f },
+    //Quit is handled by the loop
+    { CommandAction::None, glm::vec3(0.0f), 0.0f }
+};
+
+void processInput(const CommandState& commands, TransformState& transform, float d, float s) {
+    //The rotation of each Rotate command, built once instead of a sin and cos per held key and step
+    static const std::vector<glm::quat> rotations = [] {
+        std::vector<glm::quat> result(commandCount, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+        for (int i = 0; i < commandCount; i++) {
+            if (commandActions[i].kind == CommandAction::Rotate)
+                result[i] = glm::angleAxis(glm::radians(commandActions[i].amount), commandActions[i].axis);
+        }
+        return result;
+    }();
+    for (int i = 0; i < commandCount; i++) {
+        if (!commands.held[i])
+            continue;
+        const CommandAction& action = commandActions[i];
+        switch (action.kind) {
+        case CommandAction::Translate:
+            transform.translateLocal(action.axis * d);
+            break;
+        case CommandAction::Rotate:
+            transform.rotateLocal(rotations[i]);
+            break;
+        case CommandAction::Scale: {
+            //Scale the axis by s (or 1/s), leave the others at 1
+            float factor = action.amount > 0.0f ? s : 1.0f / s;
+            transform.scaleLocal(glm::vec3(1.0f) + action.axis * (factor - 1.0f));
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+bool logTransform(std::ostream& out, const CommandState& commands, const glm::mat4& transform) {
+    // If any transformation key is pressed, output current matrix and transformed vertices.
+    if (!commands.anyLoggedCommandHeld())
+        return false;
+
+    //Output
+    if (commands.isHeld(Command::MoveUp))
+        out << "Pressed W: Move pyramid upwards" << std::endl;
+    if (commands.isHeld(Command::MoveDown))
+        out << "Pressed S: Move pyramid downwards" << std::endl;
+    if (commands.isHeld(Command::MoveLeft))
+        out << "Pressed A: Move pyramid left" << std::endl;
+    if (commands.isHeld(Command::MoveRight))
+        out << "Pressed D: Move pyramid right" << std::endl;
+    if (commands.isHeld(Command::RotateZPositive))
+        out << "Pressed Q: Rotate pyramid along z axis anticlockwise" << std::endl;
+    if (commands.isHeld(Command::RotateZNegative))
+        out << "Pressed E: Rotate pyramid along z axis clockwise" << std::endl;
+    if (commands.isHeld(Command::ScaleZUp))
+        out << "Pressed R: Scale pyramid down along z axis" << std::endl;
+    if (commands.isHeld(Command::ScaleZDown))
+        out << "Pressed F: Scale pyramid up along z axis" << std::endl;
+
+    out << "Current Transformation Matrix:" << std::endl;
+    // Print matrix in row-major order for clarity
+    for (int row = 0; row < 4; row++) {
+        out << transform[0][row] << " "
+            << transform[1][row] << " "
+            << transform[2][row] << " "
+            << transform[3][row] << std::endl;
+    }
+    out << "Transformed Vertex Positions:" << std::endl;
+    glm::vec4 transformed[pyramidVertexCount];
+    transformPositions(transform, verticesPyramid, 3, pyramidVertexCount, transformed);
+    for (int i = 0; i < pyramidVertexCount; i++) {
+        const glm::vec4& newPos = transformed[i];
+        out << "Vertex " << i << ": ("
+            << newPos.x << ", "
+            << newPos.y << ", "
+            << newPos.z << ")" << std::endl;
+    }
+    out << "-----------------------------" << std::endl;
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+//Scene data and per-frame update logic shared by the windowed app and the headless benchmark.
+#include <ostream>
+
+#include <glm.hpp>
+
+#include "Input.h"
+#include "Transform.h"
+
+//Shader sources (see Scene.cpp for the line by line description)
+extern const char* vertexShaderSource;
+extern const char* fragmentShaderSource;
+//Instanced variants: per-instance transform and color come from vertex attributes
+extern const char* instancedVertexShaderSource;
+extern const char* instancedFragmentShaderSource;
+//Single pass fill + outline: the geometry shader feeds per-edge pixel distances to the fragment shader.
+//Pair outlineVertexShaderSource (single pyramid) or instancedVertexShaderSource with the other two.
+extern const char* outlineVertexShaderSource;
+extern const char* outlineGeometryShaderSource;
+extern const char* outlineFragmentShaderSource;
+//GPU culling compute shader for IndirectRenderer.h: frustum tests the objects and compacts the visible ones per mesh
+extern const char* indirectCullShaderSource;
+
+//Pyramid geometry, 5 vertices (xyz) and 6 triangles
+const int pyramidVertexCount = 5;
+const int pyramidIndexCount = 18;
+extern const float verticesPyramid[pyramidVertexCount * 3];
+extern const unsigned int indices[pyramidIndexCount];
+//Radius of a sphere around the origin containing every pyramid vertex (sqrt(0.75))
+const float pyramidBoundingRadius = 0.87f;
+
+// translation and scaling factor
+const float translateStep = 0.01f;  // Change in position per key press
+const float scaleStep = 1.05f;      // Scale factor for z-axis scaling
+
+//-- What a command does to the transform, applied in Command order
+struct CommandAction {
+    enum Kind { None, Translate, Rotate, Scale } kind;
+    glm::vec3 axis;  //translate direction (times d), rotation axis, or scale direction
+    float amount;    //rotation in degrees, or +1/-1 for scale by s or 1/s
+};
+extern const CommandAction commandActions[commandCount];
+
+//-- Apply the held commands to the transform state
+void processInput(const CommandState& commands, TransformState& transform, float d, float s);
+
+//-- Output current matrix and transformed vertices if a transformation command is held. Returns true if anything was written.
+//Synchronous std::endl version kept for comparison with TransformLog.
+bool logTransform(std::ostream& out, const CommandState& commands, const glm::mat4& transform);
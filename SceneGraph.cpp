@@ -0,0 +1,191 @@
+#include "SceneGraph.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+
+void SceneGraph::reserve(size_t nodes) {
+    translations.reserve(nodes);
+    rotations.reserve(nodes);
+    scales.reserve(nodes);
+    parents.reserve(nodes);
+    firstChildren.reserve(nodes);
+    nextSiblings.reserve(nodes);
+    subtreeSizes.reserve(nodes);
+    worlds.reserve(nodes);
+    dirty.reserve(nodes);
+}
+
+uint32_t SceneGraph::addNode(uint32_t parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale) {
+    uint32_t node = (uint32_t)parents.size();
+    if (parent != sceneGraphNoParent && parent >= node)
+        parent = sceneGraphNoParent;
+    translations.push_back(translation);
+    rotations.push_back(rotation);
+    scales.push_back(scale);
+    parents.push_back(parent);
+    firstChildren.push_back(sceneGraphNoParent);
+    nextSiblings.push_back(sceneGraphNoParent);
+    subtreeSizes.push_back(1);
+    worlds.push_back(glm::mat4(1.0f));
+    dirty.push_back(0);
+    if (parent != sceneGraphNoParent) {
+        //Still depth first if the node extends its parent's subtree, which then ends at the new node
+        depthFirst = depthFirst && parent + subtreeSizes[parent] == node;
+        nextSiblings[node] = firstChildren[parent];
+        firstChildren[parent] = node;
+        for (uint32_t ancestor = parent; ancestor != sceneGraphNoParent; ancestor = parents[ancestor])
+            subtreeSizes[ancestor]++;
+    }
+    markDirty(node);
+    return node;
+}
+
+void SceneGraph::markDirty(uint32_t node) {
+    if (!dirty[node]) {
+        dirty[node] = 1;
+        dirtyNodes.push_back(node);
+    }
+}
+
+void SceneGraph::setLocal(uint32_t node, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale) {
+    translations[node] = translation;
+    rotations[node] = rotation;
+    scales[node] = scale;
+    markDirty(node);
+}
+
+void SceneGraph::setTranslation(uint32_t node, const glm::vec3& translation) {
+    translations[node] = translation;
+    markDirty(node);
+}
+
+void SceneGraph::setRotation(uint32_t node, const glm::quat& rotation) {
+    rotations[node] = rotation;
+    markDirty(node);
+}
+
+void SceneGraph::setScale(uint32_t node, const glm::vec3& scale) {
+    scales[node] = scale;
+    markDirty(node);
+}
+
+void SceneGraph::invalidateAll() {
+    for (uint32_t node = 0; node < (uint32_t)parents.size(); node++) {
+        if (parents[node] == sceneGraphNoParent)
+            markDirty(node);
+    }
+}
+
+void SceneGraph::updateNode(uint32_t node) {
+    glm::mat4 local = composeTransform(translations[node], rotations[node], scales[node]);
+    uint32_t parent = parents[node];
+    worlds[node] = parent == sceneGraphNoParent ? local : worlds[parent] * local;
+}
+
+//Depth first, a node is always popped after its parent was updated
+void SceneGraph::updateSubtree(uint32_t root, std::vector<uint32_t>& stack) {
+    if (depthFirst) {
+        //The subtree is the index range starting at root
+        for (uint32_t node = root, end = root + subtreeSizes[root]; node < end; node++)
+            updateNode(node);
+        return;
+    }
+    stack.clear();
+    stack.push_back(root);
+    while (!stack.empty()) {
+        uint32_t node = stack.back();
+        stack.pop_back();
+        updateNode(node);
+        for (uint32_t child = firstChildren[node]; child != sceneGraphNoParent; child = nextSiblings[child])
+            stack.push_back(child);
+    }
+}
+
+SceneGraphUpdate SceneGraph::updateWorld(JobSystem* jobs) {
+    SceneGraphUpdate result;
+    result.dirtyNodes = dirtyNodes.size();
+    if (dirtyNodes.empty())
+        return result;
+
+    //A dirty node under a dirty ancestor is redone with the ancestor's subtree
+    roots.clear();
+    if (depthFirst) {
+        //In index order a node is covered exactly when it falls inside the last kept node's range
+        tasks.assign(dirtyNodes.begin(), dirtyNodes.end());
+        std::sort(tasks.begin(), tasks.end());
+        uint32_t coveredEnd = 0;
+        for (uint32_t node : tasks) {
+            if (node >= coveredEnd) {
+                roots.push_back(node);
+                result.updatedNodes += subtreeSizes[node];
+                coveredEnd = node + subtreeSizes[node];
+            }
+        }
+    }
+    else {
+        for (uint32_t node : dirtyNodes) {
+            bool covered = false;
+            for (uint32_t ancestor = parents[node]; ancestor != sceneGraphNoParent && !covered; ancestor = parents[ancestor])
+                covered = dirty[ancestor] != 0;
+            if (!covered) {
+                roots.push_back(node);
+                result.updatedNodes += subtreeSizes[node];
+            }
+        }
+    }
+    result.subtrees = roots.size();
+
+    int threads = jobs ? jobs->threadCount() : 1;
+    if (threads == 1 && !depthFirst && result.updatedNodes >= parents.size() / 4) {
+        //Most of the graph: one pass in index order from the first dirty node, a node is redone when it or its
+        //parent is flagged. Sequential access beats chasing child lists through memory.
+        uint32_t first = *std::min_element(roots.begin(), roots.end());
+        uint32_t count = (uint32_t)parents.size();
+        for (uint32_t node = first; node < count; node++) {
+            uint32_t parent = parents[node];
+            if (!dirty[node] && parent != sceneGraphNoParent && dirty[parent])
+                dirty[node] = 2;
+            if (dirty[node])
+                updateNode(node);
+        }
+        std::fill(dirty.begin() + first, dirty.end(), (uint8_t)0);
+        dirtyNodes.clear();
+        return result;
+    }
+    if (threads > 1 && result.updatedNodes >= sceneGraphParallelNodes) {
+        //Split subtrees larger than a share of the work: update the node here and hand out its children instead.
+        //roots grows while it is walked, children are appended after their parent.
+        size_t share = std::max<size_t>(1024, result.updatedNodes / ((size_t)threads * 8));
+        tasks.clear();
+        for (size_t i = 0; i < roots.size(); i++) {
+            uint32_t node = roots[i];
+            if (subtreeSizes[node] > share && firstChildren[node] != sceneGraphNoParent) {
+                updateNode(node);
+                for (uint32_t child = firstChildren[node]; child != sceneGraphNoParent; child = nextSiblings[child])
+                    roots.push_back(child);
+            }
+            else {
+                tasks.push_back(node);
+            }
+        }
+        stacks.resize(threads);
+        auto run = [this](size_t begin, size_t end, int worker) {
+            for (size_t i = begin; i < end; i++)
+                updateSubtree(tasks[i], stacks[worker]);
+        };
+        JobCounter counter;
+        jobs->parallelFor(tasks.size(), 1, run, counter);
+        jobs->wait(counter);
+        result.tasks = tasks.size();
+    }
+    else {
+        stacks.resize(1);
+        for (uint32_t root : roots)
+            updateSubtree(root, stacks[0]);
+    }
+
+    for (uint32_t node : dirtyNodes)
+        dirty[node] = 0;
+    dirtyNodes.clear();
+    return result;
+}
@@ -0,0 +1,86 @@
+#pragma once
+/*Transform hierarchy for large scenes.
+Local translation / rotation / scale live in separate arrays (SoA), one entry per node, and nodes are stored in
+topological order: a node's parent always has a smaller index, so any walk in index order or down the child
+lists sees parents first. Setting a local transform only flags the node; updateWorld then recomputes the world
+matrices of the flagged nodes' subtrees and nothing else, walking their child lists (or, when most of the graph
+is dirty, in one pass in index order). Subtrees of flagged nodes without a flagged ancestor are disjoint, so once
+enough nodes are dirty they are split into jobs and run in parallel on the JobSystem.
+As long as nodes are added depth first (every node right after its parent's subtree so far, the order a scene
+file is usually in) each subtree is one index range and is updated by a plain loop over it.*/
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm.hpp>
+#include <gtc/quaternion.hpp>
+
+#include "Transform.h"
+
+class JobSystem;
+
+const uint32_t sceneGraphNoParent = 0xFFFFFFFFu;
+//Recomputed nodes below which updateWorld stays on the calling thread
+const size_t sceneGraphParallelNodes = 16384;
+
+//-- What one updateWorld did
+struct SceneGraphUpdate {
+    size_t dirtyNodes = 0;    //nodes whose local transform was set
+    size_t subtrees = 0;      //dirty nodes without a dirty ancestor
+    size_t updatedNodes = 0;  //world matrices recomputed
+    size_t tasks = 0;         //jobs the subtrees were split into, 0 = ran on the calling thread
+};
+
+class SceneGraph {
+public:
+    void reserve(size_t nodes);
+    //Append a node under parent (sceneGraphNoParent for a root), which must already exist. Returns its index.
+    uint32_t addNode(uint32_t parent, const glm::vec3& translation = glm::vec3(0.0f),
+        const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f));
+    size_t size() const { return parents.size(); }
+
+    void setLocal(uint32_t node, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+    void setTranslation(uint32_t node, const glm::vec3& translation);
+    void setRotation(uint32_t node, const glm::quat& rotation);
+    void setScale(uint32_t node, const glm::vec3& scale);
+    //Flag every root, so the next update recomputes the whole graph
+    void invalidateAll();
+    //True while every subtree is a contiguous index range
+    bool isDepthFirst() const { return depthFirst; }
+
+    uint32_t parent(uint32_t node) const { return parents[node]; }
+    size_t subtreeSize(uint32_t node) const { return subtreeSizes[node]; }
+    const glm::vec3& translation(uint32_t node) const { return translations[node]; }
+    const glm::quat& rotation(uint32_t node) const { return rotations[node]; }
+    const glm::vec3& scale(uint32_t node) const { return scales[node]; }
+
+    //Recompute the world matrices of everything under a node set since the last update. jobs may be null.
+    SceneGraphUpdate updateWorld(JobSystem* jobs = nullptr);
+    //World matrix as of the last updateWorld
+    const glm::mat4& world(uint32_t node) const { return worlds[node]; }
+    const glm::mat4* worldMatrices() const { return worlds.data(); }
+
+private:
+    void markDirty(uint32_t node);
+    void updateSubtree(uint32_t root, std::vector<uint32_t>& stack);
+    void updateNode(uint32_t node);
+
+    //Local transform, SoA
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    //Hierarchy: parent index, first child / next sibling lists, node count of the subtree including the node
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> firstChildren;
+    std::vector<uint32_t> nextSiblings;
+    std::vector<uint32_t> subtreeSizes;
+    std::vector<glm::mat4> worlds;
+    bool depthFirst = true;
+    //Nodes set since the last update, once each
+    std::vector<uint8_t> dirty;
+    std::vector<uint32_t> dirtyNodes;
+    //updateWorld scratch
+    std::vector<uint32_t> roots;
+    std::vector<uint32_t> tasks;
+    std::vector<std::vector<uint32_t>> stacks;  //one DFS stack per worker
+};
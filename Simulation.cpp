@@ -0,0 +1,31 @@
+#include "Simulation.h"
+
+int FixedTimestep::advance(double frameSeconds) {
+    if (frameSeconds > 0.0)
+        accumulator += frameSeconds;
+
+    int count = (int)(accumulator / stepSeconds);
+    if (count > maxSteps) {
+        //Keep the fraction so interpolation stays smooth, drop whole steps we cannot afford
+        double excess = (count - maxSteps) * stepSeconds;
+        dropped += excess;
+        accumulator -= excess;
+        count = maxSteps;
+    }
+    accumulator -= count * stepSeconds;
+    steps += count;
+    return count;
+}
+
+const glm::mat4& SimulationState::drawTransform(float alpha) {
+    //At rest every alpha blends to the same state
+    if (previous == current)
+        alpha = 1.0f;
+    if (alpha != drawnAlpha || previous != drawnPrevious || current != drawnCurrent) {
+        drawn = interpolateTransform(previous, current, alpha).matrix();
+        drawnPrevious = previous;
+        drawnCurrent = current;
+        drawnAlpha = alpha;
+    }
+    return drawn;
+}
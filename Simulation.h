@@ -0,0 +1,58 @@
+#pragma once
+/*Fixed timestep simulation clock.
+Input commands move the pyramid once per simulation step, not once per rendered frame,
+so motion speed is the same at 30, 60 or 500 FPS. Render frames feed real time into an accumulator,
+the simulation consumes it in fixed steps, and the leftover fraction interpolates the drawn transform
+between the last two simulated states.*/
+#include <cstdint>
+
+#include <glm.hpp>
+
+#include "Transform.h"
+
+//60 steps per second keeps the old per-frame d/s/angle amounts feeling the same as on a 60Hz display
+const double simulationStep = 1.0 / 60.0;
+//Catch-up limit per frame. Any time beyond it is dropped instead of stalling (spiral of death).
+const int maxSimulationStepsPerFrame = 8;
+
+class FixedTimestep {
+public:
+    explicit FixedTimestep(double step = simulationStep, int maxSteps = maxSimulationStepsPerFrame)
+        : stepSeconds(step), maxSteps(maxSteps) {}
+
+    //Add the elapsed frame time and return how many steps to simulate now
+    int advance(double frameSeconds);
+
+    //Fraction of a step left in the accumulator, used to interpolate the rendered state [0, 1)
+    float alpha() const { return (float)(accumulator / stepSeconds); }
+
+    double step() const { return stepSeconds; }
+    uint64_t totalSteps() const { return steps; }
+    double droppedSeconds() const { return dropped; }
+
+private:
+    double stepSeconds;
+    int maxSteps;
+    double accumulator = 0.0;
+    uint64_t steps = 0;
+    double dropped = 0.0;
+};
+
+//-- Transform at the last two simulation steps
+struct SimulationState {
+    TransformState previous;
+    TransformState current;
+
+    //Call before simulating a step
+    void beginStep() { previous = current; }
+
+    //Interpolated matrix to draw this frame. Composed only when a step changed the state or alpha moved,
+    //so an idle scene costs a few compares per frame.
+    const glm::mat4& drawTransform(float alpha);
+
+private:
+    glm::mat4 drawn = glm::mat4(1.0f);
+    TransformState drawnPrevious;
+    TransformState drawnCurrent;
+    float drawnAlpha = 1.0f;
+};
@@ -0,0 +1,374 @@
+#include "SoftwareRenderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <emmintrin.h>
+
+#include "JobSystem.h"
+#include "Utility.h"
+
+//Clip w below which a vertex counts as at or behind the eye
+static const float nearW = 1e-6f;
+//Subpixel precision vertices snap to
+static const double subpixels = 256.0;
+//Bias that keeps an edge out of the outline
+static const float noOutline = 1e30f;
+
+//Unorm conversion of 4 colors, RGBA8 little endian, alpha 255
+static __m128i packColors(__m128 r, __m128 g, __m128 b) {
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), scale = _mm_set1_ps(255.0f);
+    __m128i red = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(r, zero), one), scale));
+    __m128i green = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(g, zero), one), scale));
+    __m128i blue = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(b, zero), one), scale));
+    __m128i packed = _mm_or_si128(red, _mm_or_si128(_mm_slli_epi32(green, 8), _mm_slli_epi32(blue, 16)));
+    return _mm_or_si128(packed, _mm_set1_epi32((int)0xFF000000u));
+}
+
+static uint32_t packColor(const glm::vec4& color) {
+    __m128i packed = packColors(_mm_set1_ps(color.r), _mm_set1_ps(color.g), _mm_set1_ps(color.b));
+    uint32_t rgb = (uint32_t)_mm_cvtsi128_si32(packed) & 0x00FFFFFFu;
+    float alpha = std::min(std::max(color.a, 0.0f), 1.0f);
+    return rgb | (uint32_t)std::lround(alpha * 255.0f) << 24;
+}
+
+void SoftwareRenderer::resize(int width, int height) {
+    framebufferWidth = std::max(1, width);
+    framebufferHeight = std::max(1, height);
+    tilesX = (framebufferWidth + softwareTileSize - 1) / softwareTileSize;
+    tilesY = (framebufferHeight + softwareTileSize - 1) / softwareTileSize;
+    colorBuffer.assign((size_t)framebufferWidth * framebufferHeight, packColor(clearColor));
+    depthBuffer.assign((size_t)framebufferWidth * framebufferHeight, 1.0f);
+    for (Chunk& chunk : chunks)
+        chunk.tiles.assign((size_t)tilesX * tilesY, std::vector<uint32_t>());
+}
+
+void SoftwareRenderer::setClearColor(const glm::vec4& color) {
+    clearColor = color;
+}
+
+void SoftwareRenderer::setOutline(float width, const glm::vec3& color) {
+    outlineWidth = width;
+    outlineColor = color;
+}
+
+void SoftwareRenderer::drawElements(const glm::mat4& transform, const float* positions, size_t vertexCount,
+    const unsigned int* indices, size_t indexCount, const glm::vec3& color) {
+    if (indexCount < 3)
+        return;
+    Draw draw;
+    draw.transform = transform;
+    draw.positions = positions;
+    draw.vertexCount = vertexCount;
+    draw.indices = indices;
+    draw.firstTriangle = queuedTriangles;
+    draw.triangleCount = indexCount / 3;
+    draw.color = color;
+    draws.push_back(draw);
+    queuedTriangles += draw.triangleCount;
+}
+
+//======================GEOMETRY======================
+//corners in clip space, all with w > 0 and z >= -w. clipEdges[k] marks edge k -> k + 1 as made by clipping.
+void SoftwareRenderer::setupTriangle(Chunk& chunk, const glm::vec4* corners, const bool* clipEdges, const glm::vec3& color) {
+    double x[3], y[3];
+    float z[3];
+    for (int corner = 0; corner < 3; corner++) {
+        const glm::vec4& p = corners[corner];
+        double inverseW = 1.0 / (double)p.w;
+        x[corner] = std::round(((double)p.x * inverseW + 1.0) * 0.5 * framebufferWidth * subpixels) / subpixels;
+        y[corner] = std::round(((double)p.y * inverseW + 1.0) * 0.5 * framebufferHeight * subpixels) / subpixels;
+        z[corner] = (float)((double)p.z * inverseW * 0.5 + 0.5);
+    }
+    double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area == 0.0)
+        return;
+
+    double minX = std::min(x[0], std::min(x[1], x[2])), maxX = std::max(x[0], std::max(x[1], x[2]));
+    double minY = std::min(y[0], std::min(y[1], y[2])), maxY = std::max(y[0], std::max(y[1], y[2]));
+    if (maxX < 0.0 || maxY < 0.0 || minX > (double)framebufferWidth || minY > (double)framebufferHeight)
+        return;
+    Triangle t;
+    t.minX = std::max(0, (int)std::floor(minX));
+    t.maxX = std::min(framebufferWidth - 1, (int)std::ceil(maxX));
+    t.minY = std::max(0, (int)std::floor(minY));
+    t.maxY = std::min(framebufferHeight - 1, (int)std::ceil(maxY));
+    if (t.minX > t.maxX || t.minY > t.maxY)
+        return;
+
+    //Edge from -> to: E(px, py) = (xt - xf) (py - yf) - (yt - yf) (px - xf), positive left of it, so inside a
+    //counter-clockwise triangle. Clockwise ones are negated, GL fills both faces.
+    double sign = area > 0.0 ? 1.0 : -1.0;
+    t.topLeft = 0;
+    for (int edge = 0; edge < 3; edge++) {
+        int from = edge, to = (edge + 1) % 3;
+        double a = sign * (y[from] - y[to]), b = sign * (x[to] - x[from]);
+        t.edgeA[edge] = (float)a;
+        t.edgeB[edge] = (float)b;
+        t.edgeC[edge] = sign * (x[from] * y[to] - y[from] * x[to]);
+        //Interior on the left and y up: a left edge runs down, a top edge runs right to left
+        if (a > 0.0 || (a == 0.0 && b < 0.0))
+            t.topLeft |= 1u << edge;
+        t.outlineScale[edge] = clipEdges[edge] ? 0.0f : (float)(1.0 / std::sqrt(a * a + b * b));
+        t.outlineBias[edge] = clipEdges[edge] ? noOutline : 0.0f;
+    }
+    //Window depth is linear in screen space
+    double dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+    double dzdy = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+    t.depthA = (float)dzdx;
+    t.depthB = (float)dzdy;
+    t.depthC = z[0] - dzdx * x[0] - dzdy * y[0];
+    t.color = color;
+
+    uint32_t index = (uint32_t)chunk.triangles.size();
+    chunk.triangles.push_back(t);
+    for (int tileY = t.minY / softwareTileSize; tileY <= t.maxY / softwareTileSize; tileY++) {
+        for (int tileX = t.minX / softwareTileSize; tileX <= t.maxX / softwareTileSize; tileX++)
+            chunk.tiles[(size_t)tileY * tilesX + tileX].push_back(index);
+    }
+}
+
+//Clip against the near plane z = -w (the only plane that changes what is drawn: x / y are bounded by the viewport
+//and the depth test already drops z > 1 against a buffer cleared to 1), then set up the one or two triangles left
+static void clipNear(const glm::vec4* corners, glm::vec4* out, bool* clipEdges, int& count) {
+    float distance[3];
+    for (int corner = 0; corner < 3; corner++)
+        distance[corner] = corners[corner].z + corners[corner].w;
+    count = 0;
+    for (int corner = 0; corner < 3; corner++) {
+        int next = (corner + 1) % 3;
+        bool inside = distance[corner] >= 0.0f, nextInside = distance[next] >= 0.0f;
+        if (inside) {
+            out[count] = corners[corner];
+            clipEdges[count++] = false;
+        }
+        if (inside != nextInside) {
+            float t = distance[corner] / (distance[corner] - distance[next]);
+            out[count] = corners[corner] + t * (corners[next] - corners[corner]);
+            //Leaving the half space: the polygon continues along the plane to where it comes back in
+            clipEdges[count++] = inside;
+        }
+    }
+}
+
+void SoftwareRenderer::processChunk(size_t index) {
+    Chunk& chunk = chunks[index];
+    chunk.triangles.clear();
+    if (chunk.tiles.size() != (size_t)tilesX * tilesY)
+        chunk.tiles.assign((size_t)tilesX * tilesY, std::vector<uint32_t>());
+    for (std::vector<uint32_t>& tile : chunk.tiles)
+        tile.clear();
+
+    size_t begin = index * softwareChunkTriangles;
+    size_t end = std::min(begin + softwareChunkTriangles, queuedTriangles);
+    //Last draw starting at or before begin
+    size_t drawIndex = (size_t)(std::upper_bound(draws.begin(), draws.end(), begin,
+        [](size_t triangle, const Draw& draw) { return triangle < draw.firstTriangle; }) - draws.begin()) - 1;
+
+    for (; drawIndex < draws.size() && draws[drawIndex].firstTriangle < end; drawIndex++) {
+        const Draw& draw = draws[drawIndex];
+        size_t first = std::max(begin, draw.firstTriangle) - draw.firstTriangle;
+        size_t last = std::min(end, draw.firstTriangle + draw.triangleCount) - draw.firstTriangle;
+        //Transform every vertex once when the chunk covers enough of the draw, else each corner as it comes
+        bool wholeDraw = draw.vertexCount <= (last - first) * 3;
+        if (wholeDraw) {
+            chunk.clip.resize(draw.vertexCount);
+            for (size_t i = 0; i < draw.vertexCount; i++) {
+                const float* p = draw.positions + i * 3;
+                chunk.clip[i] = draw.transform * glm::vec4(p[0], p[1], p[2], 1.0f);
+            }
+        }
+        for (size_t triangle = first; triangle < last; triangle++) {
+            const unsigned int* corner = draw.indices + triangle * 3;
+            glm::vec4 clip[3];
+            int behind = 0;
+            for (int k = 0; k < 3; k++) {
+                if (wholeDraw) {
+                    clip[k] = chunk.clip[corner[k]];
+                } else {
+                    const float* p = draw.positions + (size_t)corner[k] * 3;
+                    clip[k] = draw.transform * glm::vec4(p[0], p[1], p[2], 1.0f);
+                }
+                if (clip[k].z < -clip[k].w || clip[k].w <= nearW)
+                    behind++;
+            }
+            if (behind == 3)
+                continue;
+            if (behind == 0) {
+                const bool original[3] = { false, false, false };
+                setupTriangle(chunk, clip, original, draw.color);
+                continue;
+            }
+            glm::vec4 polygon[4];
+            bool clipEdges[4];
+            int count = 0;
+            clipNear(clip, polygon, clipEdges, count);
+            bool valid = count >= 3;
+            for (int k = 0; k < count; k++)
+                valid = valid && polygon[k].w > nearW;
+            if (!valid)
+                continue;
+            //Fan; the diagonal of a quad is inside the original triangle, so it never gets an outline
+            const bool firstEdges[3] = { clipEdges[0], clipEdges[1], count == 3 ? clipEdges[2] : true };
+            setupTriangle(chunk, polygon, firstEdges, draw.color);
+            if (count == 4) {
+                const glm::vec4 second[3] = { polygon[0], polygon[2], polygon[3] };
+                const bool secondEdges[3] = { true, clipEdges[2], clipEdges[3] };
+                setupTriangle(chunk, second, secondEdges, draw.color);
+            }
+        }
+    }
+}
+
+//======================RASTER======================
+size_t SoftwareRenderer::rasterizeTile(int tile) {
+    alignas(16) float tileDepth[softwareTileSize * softwareTileSize];
+    alignas(16) uint32_t tileColor[softwareTileSize * softwareTileSize];
+    std::fill(tileDepth, tileDepth + softwareTileSize * softwareTileSize, 1.0f);
+    std::fill(tileColor, tileColor + softwareTileSize * softwareTileSize, packColor(clearColor));
+
+    int originX = (tile % tilesX) * softwareTileSize, originY = (tile / tilesX) * softwareTileSize;
+    int tileWidth = std::min(softwareTileSize, framebufferWidth - originX);
+    int tileHeight = std::min(softwareTileSize, framebufferHeight - originY);
+    bool outline = outlineWidth > 0.0f;
+    float halfWidth = 0.5f * outlineWidth;
+
+    const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), three = _mm_set1_ps(3.0f);
+    const __m128 columns = _mm_set1_ps((float)tileWidth);
+    const __m128 outlineStart = _mm_set1_ps(halfWidth - 0.5f), outlineEnd = _mm_set1_ps(halfWidth + 0.5f);
+    const __m128 outlineR = _mm_set1_ps(outlineColor.r), outlineG = _mm_set1_ps(outlineColor.g),
+        outlineB = _mm_set1_ps(outlineColor.b);
+    static const int laneCounts[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+    size_t fragments = 0;
+
+    for (size_t c = 0; c < chunkCount; c++) {
+        const Chunk& chunk = chunks[c];
+        for (uint32_t index : chunk.tiles[tile]) {
+            const Triangle& t = chunk.triangles[index];
+            int x0 = std::max(t.minX, originX) - originX, x1 = std::min(t.maxX, originX + tileWidth - 1) - originX;
+            int y0 = std::max(t.minY, originY) - originY, y1 = std::min(t.maxY, originY + tileHeight - 1) - originY;
+            if (x0 > x1 || y0 > y1)
+                continue;
+            x0 &= ~3;
+
+            __m128 a0 = _mm_set1_ps(t.edgeA[0]), a1 = _mm_set1_ps(t.edgeA[1]), a2 = _mm_set1_ps(t.edgeA[2]);
+            __m128 depthA = _mm_set1_ps(t.depthA);
+            __m128 topLeft0 = _mm_castsi128_ps(_mm_set1_epi32(t.topLeft & 1 ? -1 : 0));
+            __m128 topLeft1 = _mm_castsi128_ps(_mm_set1_epi32(t.topLeft & 2 ? -1 : 0));
+            __m128 topLeft2 = _mm_castsi128_ps(_mm_set1_epi32(t.topLeft & 4 ? -1 : 0));
+            __m128 scale0 = _mm_set1_ps(t.outlineScale[0]), scale1 = _mm_set1_ps(t.outlineScale[1]),
+                scale2 = _mm_set1_ps(t.outlineScale[2]);
+            __m128 bias0 = _mm_set1_ps(t.outlineBias[0]), bias1 = _mm_set1_ps(t.outlineBias[1]),
+                bias2 = _mm_set1_ps(t.outlineBias[2]);
+            __m128 fillR = _mm_set1_ps(t.color.r), fillG = _mm_set1_ps(t.color.g), fillB = _mm_set1_ps(t.color.b);
+            __m128i fill = packColors(fillR, fillG, fillB);
+
+            //Values at the center of the row's local pixel 0, in double since C can be large
+            double centerX = (double)originX + 0.5;
+            for (int y = y0; y <= y1; y++) {
+                double centerY = (double)(originY + y) + 0.5;
+                __m128 row0 = _mm_set1_ps((float)(t.edgeA[0] * centerX + t.edgeB[0] * centerY + t.edgeC[0]));
+                __m128 row1 = _mm_set1_ps((float)(t.edgeA[1] * centerX + t.edgeB[1] * centerY + t.edgeC[1]));
+                __m128 row2 = _mm_set1_ps((float)(t.edgeA[2] * centerX + t.edgeB[2] * centerY + t.edgeC[2]));
+                __m128 rowZ = _mm_set1_ps((float)(t.depthA * centerX + t.depthB * centerY + t.depthC));
+                float* depthRow = tileDepth + y * softwareTileSize;
+                uint32_t* colorRow = tileColor + y * softwareTileSize;
+                for (int x = x0; x <= x1; x += 4) {
+                    __m128 column = _mm_add_ps(_mm_set1_ps((float)x), lanes);
+                    __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, column), row0);
+                    __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, column), row1);
+                    __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, column), row2);
+                    __m128 in0 = _mm_or_ps(_mm_cmpgt_ps(e0, zero), _mm_and_ps(_mm_cmpeq_ps(e0, zero), topLeft0));
+                    __m128 in1 = _mm_or_ps(_mm_cmpgt_ps(e1, zero), _mm_and_ps(_mm_cmpeq_ps(e1, zero), topLeft1));
+                    __m128 in2 = _mm_or_ps(_mm_cmpgt_ps(e2, zero), _mm_and_ps(_mm_cmpeq_ps(e2, zero), topLeft2));
+                    __m128 inside = _mm_and_ps(_mm_and_ps(in0, in1), _mm_and_ps(in2, _mm_cmplt_ps(column, columns)));
+                    if (_mm_movemask_ps(inside) == 0)
+                        continue;
+                    __m128 z = _mm_add_ps(_mm_mul_ps(depthA, column), rowZ);
+                    __m128 previous = _mm_load_ps(depthRow + x);
+                    __m128 write = _mm_and_ps(inside, _mm_cmplt_ps(z, previous));
+                    int mask = _mm_movemask_ps(write);
+                    if (mask == 0)
+                        continue;
+                    fragments += laneCounts[mask];
+                    _mm_store_ps(depthRow + x, _mm_or_ps(_mm_and_ps(write, z), _mm_andnot_ps(write, previous)));
+
+                    __m128i color = fill;
+                    if (outline) {
+                        //outlineFragmentShaderSource: mix(fill, outline, 1 - smoothstep(hw - 0.5, hw + 0.5, nearest))
+                        __m128 d0 = _mm_add_ps(_mm_mul_ps(e0, scale0), bias0);
+                        __m128 d1 = _mm_add_ps(_mm_mul_ps(e1, scale1), bias1);
+                        __m128 d2 = _mm_add_ps(_mm_mul_ps(e2, scale2), bias2);
+                        __m128 nearest = _mm_min_ps(d0, _mm_min_ps(d1, d2));
+                        if (_mm_movemask_ps(_mm_and_ps(write, _mm_cmplt_ps(nearest, outlineEnd))) != 0) {
+                            __m128 s = _mm_min_ps(_mm_max_ps(_mm_sub_ps(nearest, outlineStart), zero), one);
+                            __m128 coverage = _mm_sub_ps(one, _mm_mul_ps(_mm_mul_ps(s, s), _mm_sub_ps(three, _mm_mul_ps(two, s))));
+                            color = packColors(_mm_add_ps(fillR, _mm_mul_ps(_mm_sub_ps(outlineR, fillR), coverage)),
+                                _mm_add_ps(fillG, _mm_mul_ps(_mm_sub_ps(outlineG, fillG), coverage)),
+                                _mm_add_ps(fillB, _mm_mul_ps(_mm_sub_ps(outlineB, fillB), coverage)));
+                        }
+                    }
+                    __m128i keep = _mm_castps_si128(write);
+                    __m128i old = _mm_load_si128((const __m128i*)(colorRow + x));
+                    _mm_store_si128((__m128i*)(colorRow + x), _mm_or_si128(_mm_and_si128(keep, color), _mm_andnot_si128(keep, old)));
+                }
+            }
+        }
+    }
+
+    for (int y = 0; y < tileHeight; y++) {
+        size_t offset = (size_t)(originY + y) * framebufferWidth + originX;
+        std::copy(tileColor + y * softwareTileSize, tileColor + y * softwareTileSize + tileWidth, colorBuffer.begin() + offset);
+        std::copy(tileDepth + y * softwareTileSize, tileDepth + y * softwareTileSize + tileWidth, depthBuffer.begin() + offset);
+    }
+    return fragments;
+}
+
+SoftwareFrameStats SoftwareRenderer::flush(JobSystem* jobs) {
+    SoftwareFrameStats stats;
+    stats.draws = draws.size();
+    stats.triangles = queuedTriangles;
+
+    auto start = std::chrono::steady_clock::now();
+    chunkCount = (queuedTriangles + softwareChunkTriangles - 1) / softwareChunkTriangles;
+    if (chunks.size() < chunkCount)
+        chunks.resize(chunkCount);
+    auto geometry = [this](size_t begin, size_t end, int) {
+        for (size_t chunk = begin; chunk < end; chunk++)
+            processChunk(chunk);
+    };
+    if (jobs == nullptr) {
+        geometry(0, chunkCount, 0);
+    } else {
+        JobCounter done;
+        jobs->parallelFor(chunkCount, 1, geometry, done);
+        jobs->wait(done);
+    }
+    for (size_t chunk = 0; chunk < chunkCount; chunk++)
+        stats.binnedTriangles += chunks[chunk].triangles.size();
+    stats.geometryMs = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    size_t tiles = (size_t)tilesX * tilesY;
+    std::vector<size_t> fragments(tiles, 0);
+    auto raster = [this, &fragments](size_t begin, size_t end, int) {
+        for (size_t tile = begin; tile < end; tile++)
+            fragments[tile] = rasterizeTile((int)tile);
+    };
+    if (jobs == nullptr) {
+        raster(0, tiles, 0);
+    } else {
+        JobCounter done;
+        jobs->parallelFor(tiles, 1, raster, done);
+        jobs->wait(done);
+    }
+    for (size_t count : fragments)
+        stats.fragments += count;
+    stats.rasterMs = millisecondsSince(start);
+
+    draws.clear();
+    queuedTriangles = 0;
+    return stats;
+}
@@ -0,0 +1,109 @@
+#pragma once
+/*CPU implementation of the app's draw pipeline, for machines without a GPU.
+Same pipeline as renderFrame with the single pass outline: indexed triangles, one mat4 per draw, flat color,
+depth test GL_LESS, and the outline fragment shader's edge distance blend. No GL dependency.
+Draws are recorded and run on flush, in two parallel passes:
+    geometry - the triangles of all draws are cut into fixed chunks. Per chunk: transform, near plane clip, viewport,
+               setup of edge / depth / outline planes, and binning into softwareTileSize tiles. A chunk bins in its
+               own lists, so chunks run in any order and on any worker.
+    raster   - one job per tile: clear, then every chunk's list for the tile in submission order, edge functions
+               with the top-left fill rule and the depth test evaluated 4 pixels a step with SSE2.
+The framebuffer is RGBA8 with rows bottom first, like glReadPixels. Vertices snap to 1/256 pixel as GL
+implementations do; coverage matches GL's exactly apart from that, colors within one unit of rounding.
+Triangles crossing the near plane are clipped and keep the outline on their original edges only. There GL differs:
+outlineGeometryShaderSource projects the corner behind the eye too, and the edge distances it gets are garbage.*/
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm.hpp>
+
+class JobSystem;
+
+//Pixels per tile side
+const int softwareTileSize = 64;
+//Triangles per geometry chunk
+const size_t softwareChunkTriangles = 4096;
+
+//-- Work done by one flush
+struct SoftwareFrameStats {
+    size_t draws = 0;
+    size_t triangles = 0;         //submitted
+    size_t binnedTriangles = 0;   //after near plane clipping, back of the eye and off screen rejection
+    size_t fragments = 0;         //pixels written (passed coverage and depth)
+    double geometryMs = 0.0;
+    double rasterMs = 0.0;
+};
+
+class SoftwareRenderer {
+public:
+    //Framebuffer of width x height pixels
+    void resize(int width, int height);
+    int width() const { return framebufferWidth; }
+    int height() const { return framebufferHeight; }
+
+    //Color the framebuffer is cleared to on flush (renderFrame's clear color by default)
+    void setClearColor(const glm::vec4& color);
+    //Outline width in pixels (0 = none) and color, as setOutlineWidth / outlineColor
+    void setOutline(float width, const glm::vec3& color);
+
+    //Queue a draw of indexed triangles with positions (3 floats per vertex) transformed by transform and filled
+    //with color. The arrays are read on flush, keep them alive until it returns.
+    void drawElements(const glm::mat4& transform, const float* positions, size_t vertexCount,
+        const unsigned int* indices, size_t indexCount, const glm::vec3& color);
+    //Clear, then render the queued draws and drop them. In parallel on jobs when given, one job per tile.
+    SoftwareFrameStats flush(JobSystem* jobs = nullptr);
+
+    //width x height RGBA8 pixels, bottom row first
+    const uint8_t* color() const { return (const uint8_t*)colorBuffer.data(); }
+    //width x height window depths in [0, 1], bottom row first
+    const float* depth() const { return depthBuffer.data(); }
+
+private:
+    //-- Queued draw
+    struct Draw {
+        glm::mat4 transform;
+        const float* positions;
+        size_t vertexCount;
+        const unsigned int* indices;
+        size_t firstTriangle;     //of all the frame's triangles
+        size_t triangleCount;
+        glm::vec3 color;
+    };
+    //-- Set up screen space triangle, all planes in pixels: value = a x + b y + c at pixel centers
+    struct Triangle {
+        float edgeA[3], edgeB[3];            //positive inside
+        double edgeC[3];                     //large far from the origin, rows start from it in double
+        uint32_t topLeft;                    //bit per edge: pixel centers exactly on it are inside
+        float outlineScale[3];               //pixel distance to the edge = value * scale + bias;
+        float outlineBias[3];                //edges made by near plane clipping get a bias out of reach
+        float depthA, depthB;
+        double depthC;
+        int minX, minY, maxX, maxY;          //pixel bounds, inclusive
+        glm::vec3 color;
+    };
+    //-- One geometry chunk's triangles and its list of them per tile
+    struct Chunk {
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<uint32_t>> tiles;
+        std::vector<glm::vec4> clip;         //transformed vertices of the current draw
+    };
+
+    void processChunk(size_t chunk);
+    void setupTriangle(Chunk& chunk, const glm::vec4* corners, const bool* clipEdges, const glm::vec3& color);
+    size_t rasterizeTile(int tile);
+
+    int framebufferWidth = 0;
+    int framebufferHeight = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    glm::vec4 clearColor = glm::vec4(0.2f, 0.3f, 0.3f, 0.1f);
+    float outlineWidth = 3.0f;
+    glm::vec3 outlineColor = glm::vec3(0.0f);
+    std::vector<uint32_t> colorBuffer;
+    std::vector<float> depthBuffer;
+    std::vector<Draw> draws;
+    size_t queuedTriangles = 0;
+    std::vector<Chunk> chunks;
+    size_t chunkCount = 0;
+};
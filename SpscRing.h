@@ -0,0 +1,62 @@
+#pragma once
+//Bounded lock-free single-producer/single-consumer ring buffer.
+//One thread may call tryPush, one other thread may call tryPop; neither ever blocks.
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+template <typename T>
+class SpscRing {
+public:
+    //Capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity = 1024) {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    //Producer side. Returns false (and leaves the ring untouched) when full.
+    bool tryPush(const T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - cachedTail > mask) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h - cachedTail > mask)
+                return false;
+        }
+        slots[h & mask] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    //Consumer side. Returns false when empty.
+    bool tryPop(T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == cachedHead) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t == cachedHead)
+                return false;
+        }
+        item = slots[t & mask];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    //Approximate when called concurrently with push/pop
+    size_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+    size_t capacity() const { return mask + 1; }
+
+private:
+    std::vector<T> slots;
+    size_t mask = 0;
+
+    //Producer and consumer indices on separate cache lines so the two threads do not false-share
+    alignas(64) std::atomic<size_t> head{ 0 };
+    size_t cachedTail = 0; //producer's last view of tail
+    alignas(64) std::atomic<size_t> tail{ 0 };
+    size_t cachedHead = 0; //consumer's last view of head
+};
@@ -0,0 +1,24 @@
+#include "Transform.h"
+
+glm::mat4 composeTransform(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale) {
+    glm::mat3 r = glm::mat3_cast(rotation);
+    glm::mat4 m;
+    m[0] = glm::vec4(r[0] * scale.x, 0.0f);
+    m[1] = glm::vec4(r[1] * scale.y, 0.0f);
+    m[2] = glm::vec4(r[2] * scale.z, 0.0f);
+    m[3] = glm::vec4(translation, 1.0f);
+    return m;
+}
+
+TransformState interpolateTransform(const TransformState& previous, const TransformState& current, float alpha) {
+    if (alpha <= 0.0f)
+        return previous;
+    if (alpha >= 1.0f || previous == current)
+        return current;
+    TransformState result;
+    result.translation = glm::mix(previous.translation, current.translation, alpha);
+    result.scale = glm::mix(previous.scale, current.scale, alpha);
+    //glm::slerp takes the short way; its near-parallel case is a plain lerp, hence the normalize
+    result.rotation = glm::normalize(glm::slerp(previous.rotation, current.rotation, alpha));
+    return result;
+}
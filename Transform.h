@@ -0,0 +1,39 @@
+#pragma once
+/*Decomposed transform: translation, rotation quaternion and scale kept apart instead of one accumulated matrix.
+Every held key used to multiply another glm::translate / rotate / scale into a mat4, so after enough steps the
+rotation part picked up float error and stopped being orthonormal (the pyramid slowly shears and shrinks). Here a
+step touches a vec3 or renormalizes one quaternion, and the matrix is composed only when something reads it.*/
+#include <glm.hpp>
+#include <gtc/quaternion.hpp>
+
+//Matrix of translate(t) * rotate(r) * scale(s), without the full matrix products
+glm::mat4 composeTransform(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+
+//-- Local transform as translation, rotation and scale, applied scale first
+struct TransformState {
+    glm::vec3 translation = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+
+    //Same as right-multiplying the matrix with translate(offset): the offset is in the local (scaled, rotated) frame
+    void translateLocal(const glm::vec3& offset) { translation += rotation * (scale * offset); }
+    //Same as right-multiplying with rotate(radians, axis). One Newton step back towards unit length keeps the
+    //length from drifting without a sqrt and divide in the chain from one step to the next.
+    void rotateLocal(const glm::quat& delta) {
+        rotation = rotation * delta;
+        rotation *= (3.0f - glm::dot(rotation, rotation)) * 0.5f;
+    }
+    void rotateLocal(float radians, const glm::vec3& axis) { rotateLocal(glm::angleAxis(radians, axis)); }
+    //Scale along the local axes. Unlike the matrix version a later rotation does not shear a non-uniform scale.
+    void scaleLocal(const glm::vec3& factors) { scale *= factors; }
+
+    glm::mat4 matrix() const { return composeTransform(translation, rotation, scale); }
+
+    bool operator==(const TransformState& other) const {
+        return translation == other.translation && rotation == other.rotation && scale == other.scale;
+    }
+    bool operator!=(const TransformState& other) const { return !(*this == other); }
+};
+
+//Blend two states: translation and scale lerp, rotation slerps the short way
+TransformState interpolateTransform(const TransformState& previous, const TransformState& current, float alpha);
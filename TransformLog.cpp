@@ -0,0 +1,187 @@
+#include "TransformLog.h"
+#include "Scene.h"
+#include "VertexTransform.h"
+
+#include <chrono>
+#include <cstring>
+
+#include <gtc/type_ptr.hpp>
+
+//One line per logged command, in Command order
+static const char* transformLogMessages[loggedCommandCount] = {
+    "Pressed W: Move pyramid upwards",
+    "Pressed S: Move pyramid downwards",
+    "Pressed A: Move pyramid left",
+    "Pressed D: Move pyramid right",
+    "Pressed Q: Rotate pyramid along z axis anticlockwise",
+    "Pressed E: Rotate pyramid along z axis clockwise",
+    "Pressed R: Scale pyramid down along z axis",
+    "Pressed F: Scale pyramid up along z axis"
+};
+
+//Records formatted per write, and how long the writer sleeps when the ring is empty
+static const size_t writerBatchSize = 256;
+static const std::chrono::milliseconds writerIdleSleep(2);
+
+uint32_t transformLogKeyMask(const CommandState& commands) {
+    uint32_t mask = 0;
+    for (int i = 0; i < loggedCommandCount; i++) {
+        if (commands.held[i])
+            mask |= 1u << i;
+    }
+    return mask;
+}
+
+//%g with 6 significant digits is what std::ostream prints for a float by default
+static void appendFloat(std::string& out, float v) {
+    char buffer[32];
+    int n = std::snprintf(buffer, sizeof(buffer), "%g", v);
+    out.append(buffer, n);
+}
+
+void appendTransformText(std::string& out, const TransformLogRecord& record) {
+    for (int i = 0; i < loggedCommandCount; i++) {
+        if (record.keyMask & (1u << i)) {
+            out += transformLogMessages[i];
+            out += '\n';
+        }
+    }
+
+    glm::mat4 transform = glm::make_mat4(record.matrix);
+    out += "Current Transformation Matrix:\n";
+    // Print matrix in row-major order for clarity
+    for (int row = 0; row < 4; row++) {
+        for (int col = 0; col < 4; col++) {
+            appendFloat(out, transform[col][row]);
+            out += col < 3 ? ' ' : '\n';
+        }
+    }
+    out += "Transformed Vertex Positions:\n";
+    glm::vec4 transformed[pyramidVertexCount];
+    transformPositions(transform, verticesPyramid, 3, pyramidVertexCount, transformed);
+    for (int i = 0; i < pyramidVertexCount; i++) {
+        const glm::vec4& newPos = transformed[i];
+        out += "Vertex ";
+        out += std::to_string(i);
+        out += ": (";
+        appendFloat(out, newPos.x);
+        out += ", ";
+        appendFloat(out, newPos.y);
+        out += ", ";
+        appendFloat(out, newPos.z);
+        out += ")\n";
+    }
+    out += "-----------------------------\n";
+}
+
+bool TransformLog::open(const char* path, TransformLogFormat format, size_t capacity) {
+    FILE* f = std::fopen(path, format == TransformLogFormat::Binary ? "wb" : "w");
+    if (f == nullptr)
+        return false;
+    if (!open(f, format, capacity)) {
+        std::fclose(f);
+        return false;
+    }
+    ownsFile = true;
+    return true;
+}
+
+bool TransformLog::open(FILE* f, TransformLogFormat fmt, size_t capacity) {
+    if (isOpen() || f == nullptr)
+        return false;
+    file = f;
+    ownsFile = false;
+    format = fmt;
+    ring.reset(new SpscRing<TransformLogRecord>(capacity));
+    queued = 0;
+    dropped = 0;
+    written = 0;
+    bytes = 0;
+    stopping = false;
+
+    if (format == TransformLogFormat::Binary) {
+        TransformLogHeader header;
+        std::memcpy(header.magic, transformLogMagic, sizeof(header.magic));
+        header.version = transformLogVersion;
+        header.recordSize = sizeof(TransformLogRecord);
+        std::fwrite(&header, sizeof(header), 1, file);
+        bytes += sizeof(header);
+    }
+
+    writer = std::thread(&TransformLog::writerLoop, this);
+    return true;
+}
+
+void TransformLog::close() {
+    if (!isOpen())
+        return;
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+    std::fflush(file);
+    if (ownsFile)
+        std::fclose(file);
+    file = nullptr;
+    ownsFile = false;
+    ring.reset();
+}
+
+bool TransformLog::log(uint32_t frame, const CommandState& commands, const glm::mat4& transform) {
+    // If any transformation key is pressed, output current matrix and transformed vertices.
+    uint32_t mask = transformLogKeyMask(commands);
+    if (mask == 0 || !ring)
+        return false;
+
+    TransformLogRecord record;
+    record.frame = frame;
+    record.keyMask = mask;
+    std::memcpy(record.matrix, glm::value_ptr(transform), sizeof(record.matrix));
+    if (ring->tryPush(record))
+        queued.fetch_add(1, std::memory_order_relaxed);
+    else
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool TransformLog::log(uint32_t frame, const CommandState& commands, const TransformState& transform) {
+    if (transformLogKeyMask(commands) == 0 || !ring)
+        return false;
+    return log(frame, commands, transform.matrix());
+}
+
+//Pop up to one batch from the ring and write it with a single fwrite
+void TransformLog::drain(std::string& batch) {
+    batch.clear();
+    TransformLogRecord record;
+    size_t count = 0;
+    while (count < writerBatchSize && ring->tryPop(record)) {
+        if (format == TransformLogFormat::Binary)
+            batch.append((const char*)&record, sizeof(record));
+        else
+            appendTransformText(batch, record);
+        count++;
+    }
+    if (count == 0)
+        return;
+    std::fwrite(batch.data(), 1, batch.size(), file);
+    written.fetch_add(count, std::memory_order_relaxed);
+    bytes.fetch_add(batch.size(), std::memory_order_relaxed);
+}
+
+void TransformLog::writerLoop() {
+    std::string batch;
+    batch.reserve(writerBatchSize * 512);
+    for (;;) {
+        bool stop = stopping.load(std::memory_order_acquire);
+        size_t before = written.load(std::memory_order_relaxed);
+        drain(batch);
+        bool wroteSomething = written.load(std::memory_order_relaxed) != before;
+        if (!wroteSomething) {
+            //Everything pushed before stop was requested has been written
+            if (stop)
+                break;
+            //Let a partially filled file become visible while the app idles
+            std::fflush(file);
+            std::this_thread::sleep_for(writerIdleSleep);
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+/*Asynchronous transform log.
+The render thread pushes one small record per logged frame into a lock-free ring and never waits on disk.
+A background writer thread drains the ring in batches and writes either today's text
+("Pressed W: ...", matrix, transformed vertices) or a compact binary record that
+OpenGLIntroLogDecode turns back into the exact same text.
+When the ring is full the record is dropped and counted instead of stalling the frame.*/
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <glm.hpp>
+
+#include "SpscRing.h"
+#include "Transform.h"
+
+struct CommandState;
+
+enum class TransformLogFormat {
+    Text,   //same output as the old std::cout logging
+    Binary  //TransformLogRecord stream behind a TransformLogHeader
+};
+
+//-- One logged frame: which transform keys were held and the resulting matrix.
+//Transformed vertices are not stored, they are recomputed from the matrix when formatting.
+struct TransformLogRecord {
+    uint32_t frame;
+    uint32_t keyMask; //bit i set = Command i held (the first loggedCommandCount commands)
+    float matrix[16]; //column major, as glm::value_ptr
+};
+
+//-- Start of a binary log file
+struct TransformLogHeader {
+    char magic[8];       //"OGLTLOG"
+    uint32_t version;
+    uint32_t recordSize; //sizeof(TransformLogRecord)
+};
+
+const char transformLogMagic[8] = { 'O', 'G', 'L', 'T', 'L', 'O', 'G', '\0' };
+const uint32_t transformLogVersion = 1;
+
+//Bit mask of the held logged commands, 0 when nothing should be logged
+uint32_t transformLogKeyMask(const CommandState& commands);
+
+//Append the text block for one record, identical to what logTransform prints
+void appendTransformText(std::string& out, const TransformLogRecord& record);
+
+class TransformLog {
+public:
+    TransformLog() = default;
+    ~TransformLog() { close(); }
+    TransformLog(const TransformLog&) = delete;
+    TransformLog& operator=(const TransformLog&) = delete;
+
+    //Start the writer thread. The FILE* overload does not take ownership (e.g. stdout).
+    bool open(const char* path, TransformLogFormat format, size_t capacity = 4096);
+    bool open(FILE* file, TransformLogFormat format, size_t capacity = 4096);
+
+    //Flush everything still queued, stop the writer thread and close the file if we opened it
+    void close();
+
+    bool isOpen() const { return writer.joinable(); }
+
+    //Render thread: queue a record if a transform command is held. Never blocks.
+    //Returns true if the frame produced a record (queued or dropped).
+    bool log(uint32_t frame, const CommandState& commands, const glm::mat4& transform);
+    //Same, composing the matrix only when a record is made
+    bool log(uint32_t frame, const CommandState& commands, const TransformState& transform);
+
+    uint64_t queuedRecords() const { return queued.load(std::memory_order_relaxed); }
+    uint64_t droppedRecords() const { return dropped.load(std::memory_order_relaxed); }
+    uint64_t writtenRecords() const { return written.load(std::memory_order_relaxed); }
+    uint64_t bytesWritten() const { return bytes.load(std::memory_order_relaxed); }
+
+private:
+    void writerLoop();
+    void drain(std::string& batch);
+
+    std::unique_ptr<SpscRing<TransformLogRecord>> ring;
+    FILE* file = nullptr;
+    bool ownsFile = false;
+    TransformLogFormat format = TransformLogFormat::Text;
+    std::thread writer;
+    std::atomic<bool> stopping{ false };
+
+    std::atomic<uint64_t> queued{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };
+    std::atomic<uint64_t> written{ 0 };
+    std::atomic<uint64_t> bytes{ 0 };
+};
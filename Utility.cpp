@@ -0,0 +1,22 @@
+#include "Utility.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+bool makeDirectory(const std::string& path) {
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes != INVALID_FILE_ATTRIBUTES)
+        return (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    return _mkdir(path.c_str()) == 0;
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0)
+        return S_ISDIR(info.st_mode);
+    return mkdir(path.c_str(), 0755) == 0;
+#endif
+}
@@ -0,0 +1,33 @@
+#pragma once
+//Small helpers the loaders and caches share: timing, hashing and creating a cache directory.
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+inline double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//splitmix64 finalizer
+inline uint64_t mixHash(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+//FNV-1a, 64 bit
+inline uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+//Create path (one level) unless it exists; false if it cannot be created or is not a directory
+bool makeDirectory(const std::string& path);
@@ -0,0 +1,320 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <gtc/matrix_transform.hpp>
+
+#include "GLPlatform.h"
+
+//======================LAYOUT======================
+static unsigned int positionBytes(PositionEncoding position) {
+    return position == PositionEncoding::Float32 ? 12 : 8;
+}
+
+static unsigned int normalBytes(NormalEncoding normal) {
+    return normal == NormalEncoding::Float32 ? 12 : normal == NormalEncoding::Octahedral ? 4 : 0;
+}
+
+static unsigned int colorBytes(ColorEncoding color) {
+    return color == ColorEncoding::Float32 ? 16 : color == ColorEncoding::Unorm8 ? 4 : 0;
+}
+
+VertexFormat makeVertexFormat(PositionEncoding position, NormalEncoding normal, ColorEncoding color) {
+    VertexFormat format;
+    format.position = position;
+    format.normal = normal;
+    format.color = color;
+    //Every size is a multiple of 4, so each attribute stays 4 byte aligned as GL wants
+    format.normalOffset = positionBytes(position);
+    format.colorOffset = format.normalOffset + normalBytes(normal);
+    format.stride = format.colorOffset + colorBytes(color);
+    return format;
+}
+
+uint32_t vertexFormatCode(const VertexFormat& format) {
+    return (uint32_t)format.position | ((uint32_t)format.normal << 8) | ((uint32_t)format.color << 16);
+}
+
+bool vertexFormatFromCode(uint32_t code, VertexFormat& format) {
+    uint32_t position = code & 0xFF, normal = (code >> 8) & 0xFF, color = (code >> 16) & 0xFF;
+    if (position > (uint32_t)PositionEncoding::Half || normal > (uint32_t)NormalEncoding::Octahedral ||
+        color > (uint32_t)ColorEncoding::Unorm8 || (code >> 24) != 0)
+        return false;
+    format = makeVertexFormat((PositionEncoding)position, (NormalEncoding)normal, (ColorEncoding)color);
+    return true;
+}
+
+std::string vertexFormatName(const VertexFormat& format) {
+    static const char* positions[] = { "float32", "snorm16", "half" };
+    static const char* normals[] = { "none", "float32", "octahedral" };
+    static const char* colors[] = { "none", "float32", "unorm8" };
+    return std::string(positions[(int)format.position]) + " / " + normals[(int)format.normal] + " / " + colors[(int)format.color];
+}
+
+//======================ENCODING======================
+static int16_t toSnorm16(float value) {
+    return (int16_t)std::round(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f);
+}
+
+static float fromSnorm16(int16_t value) {
+    return std::max(value / 32767.0f, -1.0f);
+}
+
+//Octahedral projection onto the z >= 0 square, the lower half folded over the diagonals
+static glm::vec2 octahedralProject(const glm::vec3& normal) {
+    glm::vec3 n = normal / (std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z));
+    if (n.z >= 0.0f)
+        return glm::vec2(n.x, n.y);
+    return glm::vec2((1.0f - std::fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+        (1.0f - std::fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+static glm::vec3 octahedralUnproject(const glm::vec2& e) {
+    glm::vec3 n(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+//Of the four snorm16 roundings around the projection, keep the one that decodes closest to the normal
+static void encodeOctahedral(const glm::vec3& normal, int16_t out[2]) {
+    float length = glm::length(normal);
+    if (length == 0.0f) {
+        out[0] = 0;
+        out[1] = 32767;
+        return;
+    }
+    glm::vec3 n = normal / length;
+    glm::vec2 projected = octahedralProject(n) * 32767.0f;
+    float best = -2.0f;
+    for (int corner = 0; corner < 4; corner++) {
+        float x = (corner & 1) ? std::ceil(projected.x) : std::floor(projected.x);
+        float y = (corner & 2) ? std::ceil(projected.y) : std::floor(projected.y);
+        int16_t candidate[2] = { (int16_t)std::min(std::max(x, -32767.0f), 32767.0f), (int16_t)std::min(std::max(y, -32767.0f), 32767.0f) };
+        float similarity = glm::dot(n, octahedralUnproject(glm::vec2(fromSnorm16(candidate[0]), fromSnorm16(candidate[1]))));
+        if (similarity > best) {
+            best = similarity;
+            out[0] = candidate[0];
+            out[1] = candidate[1];
+        }
+    }
+}
+
+static uint8_t toUnorm8(float value) {
+    return (uint8_t)std::round(std::min(std::max(value, 0.0f), 1.0f) * 255.0f);
+}
+
+void encodeVertices(const VertexFormat& format, const float* positions, const float* normals, const float* colors,
+    size_t vertexCount, const glm::vec3& boundsMin, const glm::vec3& boundsMax, unsigned char* out) {
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    glm::vec3 halfExtent = (boundsMax - boundsMin) * 0.5f;
+    glm::vec3 inverse(halfExtent.x > 0.0f ? 1.0f / halfExtent.x : 0.0f, halfExtent.y > 0.0f ? 1.0f / halfExtent.y : 0.0f,
+        halfExtent.z > 0.0f ? 1.0f / halfExtent.z : 0.0f);
+    for (size_t v = 0; v < vertexCount; v++) {
+        unsigned char* vertex = out + v * format.stride;
+        glm::vec3 position(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]);
+        if (format.position == PositionEncoding::Float32) {
+            std::memcpy(vertex, &positions[v * 3], 12);
+        }
+        else {
+            glm::vec3 unit = (position - center) * inverse;
+            uint16_t packed[4] = { 0, 0, 0, 0 };
+            for (int axis = 0; axis < 3; axis++) {
+                if (format.position == PositionEncoding::Snorm16)
+                    packed[axis] = (uint16_t)toSnorm16(unit[axis]);
+                else
+                    packed[axis] = (uint16_t)(glm::packHalf2x16(glm::vec2(unit[axis], 0.0f)) & 0xFFFF);
+            }
+            std::memcpy(vertex, packed, 8);
+        }
+
+        if (format.normal == NormalEncoding::Float32) {
+            std::memcpy(vertex + format.normalOffset, &normals[v * 3], 12);
+        }
+        else if (format.normal == NormalEncoding::Octahedral) {
+            int16_t packed[2];
+            encodeOctahedral(glm::vec3(normals[v * 3], normals[v * 3 + 1], normals[v * 3 + 2]), packed);
+            std::memcpy(vertex + format.normalOffset, packed, 4);
+        }
+
+        if (format.color == ColorEncoding::Float32) {
+            std::memcpy(vertex + format.colorOffset, &colors[v * 4], 16);
+        }
+        else if (format.color == ColorEncoding::Unorm8) {
+            uint8_t packed[4];
+            for (int channel = 0; channel < 4; channel++)
+                packed[channel] = toUnorm8(colors[v * 4 + channel]);
+            std::memcpy(vertex + format.colorOffset, packed, 4);
+        }
+    }
+}
+
+glm::mat4 positionDecodeTransform(PositionEncoding position, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    if (position == PositionEncoding::Float32)
+        return glm::mat4(1.0f);
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), (boundsMin + boundsMax) * 0.5f);
+    return glm::scale(transform, (boundsMax - boundsMin) * 0.5f);
+}
+
+//======================DECODING======================
+glm::vec3 decodePosition(const VertexFormat& format, const unsigned char* vertex, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    if (format.position == PositionEncoding::Float32) {
+        glm::vec3 position;
+        std::memcpy(&position[0], vertex, 12);
+        return position;
+    }
+    uint16_t packed[3];
+    std::memcpy(packed, vertex, 6);
+    glm::vec3 unit;
+    for (int axis = 0; axis < 3; axis++)
+        unit[axis] = format.position == PositionEncoding::Snorm16 ? fromSnorm16((int16_t)packed[axis])
+            : glm::unpackHalf2x16(packed[axis]).x;
+    return (boundsMin + boundsMax) * 0.5f + unit * (boundsMax - boundsMin) * 0.5f;
+}
+
+glm::vec3 decodeNormal(const VertexFormat& format, const unsigned char* vertex) {
+    if (format.normal == NormalEncoding::Float32) {
+        glm::vec3 normal;
+        std::memcpy(&normal[0], vertex + format.normalOffset, 12);
+        return normal;
+    }
+    if (format.normal == NormalEncoding::Octahedral) {
+        int16_t packed[2];
+        std::memcpy(packed, vertex + format.normalOffset, 4);
+        return octahedralUnproject(glm::vec2(fromSnorm16(packed[0]), fromSnorm16(packed[1])));
+    }
+    return glm::vec3(0.0f, 0.0f, 1.0f);
+}
+
+glm::vec4 decodeColor(const VertexFormat& format, const unsigned char* vertex) {
+    if (format.color == ColorEncoding::Float32) {
+        glm::vec4 color;
+        std::memcpy(&color[0], vertex + format.colorOffset, 16);
+        return color;
+    }
+    if (format.color == ColorEncoding::Unorm8) {
+        const unsigned char* packed = vertex + format.colorOffset;
+        return glm::vec4(packed[0], packed[1], packed[2], packed[3]) / 255.0f;
+    }
+    return glm::vec4(1.0f);
+}
+
+VertexFormatError measureEncodingError(const VertexFormat& format, const unsigned char* encoded, const float* positions,
+    const float* normals, const float* colors, size_t vertexCount, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    VertexFormatError error;
+    double squared = 0.0, angleSum = 0.0;
+    size_t normalCount = 0;
+    for (size_t v = 0; v < vertexCount; v++) {
+        const unsigned char* vertex = encoded + v * format.stride;
+        glm::vec3 position(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]);
+        double distance = glm::length(decodePosition(format, vertex, boundsMin, boundsMax) - position);
+        error.positionMax = std::max(error.positionMax, distance);
+        squared += distance * distance;
+
+        if (format.normal != NormalEncoding::None && normals != nullptr) {
+            //Double precision, float acos alone reads about 0.02 degrees for identical normals
+            glm::dvec3 normal(normals[v * 3], normals[v * 3 + 1], normals[v * 3 + 2]);
+            double length = glm::length(normal);
+            if (length > 0.0) {
+                double cosine = glm::dot(normal / length, glm::normalize(glm::dvec3(decodeNormal(format, vertex))));
+                double degrees = std::acos(std::min(std::max(cosine, -1.0), 1.0)) * 180.0 / 3.14159265358979323846;
+                error.normalMaxDegrees = std::max(error.normalMaxDegrees, degrees);
+                angleSum += degrees;
+                normalCount++;
+            }
+        }
+        if (format.color != ColorEncoding::None && colors != nullptr) {
+            glm::vec4 color = decodeColor(format, vertex);
+            for (int channel = 0; channel < 4; channel++)
+                error.colorMax = std::max(error.colorMax, (double)std::fabs(color[channel] - colors[v * 4 + channel]));
+        }
+    }
+    double diagonal = glm::length(boundsMax - boundsMin);
+    error.positionRms = vertexCount > 0 ? std::sqrt(squared / vertexCount) : 0.0;
+    error.positionMaxRelative = diagonal > 0.0 ? error.positionMax / diagonal : 0.0;
+    error.normalMeanDegrees = normalCount > 0 ? angleSum / normalCount : 0.0;
+    return error;
+}
+
+//======================INDICES======================
+unsigned int indexSizeFor(size_t vertexCount) {
+    return vertexCount <= 65536 ? 2 : 4;
+}
+
+unsigned int indexTypeFor(unsigned int indexSize) {
+    return indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+void writeIndices(const unsigned int* indices, size_t indexCount, unsigned int indexSize, void* out) {
+    if (indexSize == 4) {
+        std::memcpy(out, indices, indexCount * sizeof(unsigned int));
+        return;
+    }
+    uint16_t* narrow = (uint16_t*)out;
+    for (size_t i = 0; i < indexCount; i++)
+        narrow[i] = (uint16_t)indices[i];
+}
+
+//======================GL======================
+void setupVertexAttributes(const VertexFormat& format) {
+    GLsizei stride = (GLsizei)format.stride;
+    if (format.position == PositionEncoding::Float32)
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    else if (format.position == PositionEncoding::Snorm16)
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, stride, (void*)0);
+    else
+        glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, stride, (void*)0);
+    glEnableVertexAttribArray(0);
+
+    if (format.normal == NormalEncoding::None) {
+        glDisableVertexAttribArray(1);
+    }
+    else {
+        if (format.normal == NormalEncoding::Float32)
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(size_t)format.normalOffset);
+        else
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)(size_t)format.normalOffset);
+        glEnableVertexAttribArray(1);
+    }
+
+    if (format.color == ColorEncoding::None) {
+        glDisableVertexAttribArray(2);
+    }
+    else {
+        if (format.color == ColorEncoding::Float32)
+            glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)(size_t)format.colorOffset);
+        else
+            glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(size_t)format.colorOffset);
+        glEnableVertexAttribArray(2);
+    }
+}
+
+std::string vertexDecodeShaderSource(const VertexFormat& format) {
+    //Normalized integer attributes arrive already scaled to [-1, 1] / [0, 1], so only the normal needs math
+    std::string source = "//Vertex decode for " + vertexFormatName(format) + "\n";
+    source += "layout (location = 0) in vec3 aPos;\n";
+    if (format.normal != NormalEncoding::None)
+        source += format.normal == NormalEncoding::Octahedral ? "layout (location = 1) in vec2 aNormal;\n" : "layout (location = 1) in vec3 aNormal;\n";
+    if (format.color != ColorEncoding::None)
+        source += "layout (location = 2) in vec4 aColor;\n";
+
+    source += "vec3 decodePosition() { return aPos; }\n";
+    if (format.normal == NormalEncoding::Octahedral)
+        source +=
+            "vec3 decodeNormal() {\n"
+            "    vec3 n = vec3(aNormal, 1.0 - abs(aNormal.x) - abs(aNormal.y));\n"
+            "    float t = max(-n.z, 0.0);\n"
+            "    n.x += n.x >= 0.0 ? -t : t;\n"
+            "    n.y += n.y >= 0.0 ? -t : t;\n"
+            "    return normalize(n);\n"
+            "}\n";
+    else if (format.normal == NormalEncoding::Float32)
+        source += "vec3 decodeNormal() { return aNormal; }\n";
+    else
+        source += "vec3 decodeNormal() { return vec3(0.0, 0.0, 1.0); }\n";
+    source += format.color != ColorEncoding::None ? "vec4 decodeColor() { return aColor; }\n" : "vec4 decodeColor() { return vec4(1.0); }\n";
+    return source;
+}
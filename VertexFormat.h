@@ -0,0 +1,74 @@
+#pragma once
+/*Quantized vertex layouts for meshes, with the GL attribute setup and GLSL decode generated from the layout.
+    position - float32 xyz (12 bytes), or snorm16 / half xyz + pad (8 bytes) stored relative to the mesh bounds:
+               [-1, 1] across the box, positionDecodeTransform maps that back into model space, so the decode
+               costs nothing in the shader (it folds into the transform uniform)
+    normal   - float32 xyz (12 bytes), or octahedral in two snorm16 with the bit layout of packSnorm2x16 (4 bytes)
+    color    - float32 rgba (16 bytes), or unorm8 rgba (4 bytes)
+Attribute locations are fixed: 0 position (aPos, what every program in Scene.cpp reads), 1 normal, 2 color.
+Indices go down to 16 bit whenever the vertex count allows (indexSizeFor).*/
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm.hpp>
+
+enum class PositionEncoding : uint8_t { Float32, Snorm16, Half };
+enum class NormalEncoding : uint8_t { None, Float32, Octahedral };
+enum class ColorEncoding : uint8_t { None, Float32, Unorm8 };
+
+//-- Interleaved layout, offsets in bytes from the start of a vertex
+struct VertexFormat {
+    PositionEncoding position = PositionEncoding::Float32;
+    NormalEncoding normal = NormalEncoding::None;
+    ColorEncoding color = ColorEncoding::None;
+    unsigned int normalOffset = 0;
+    unsigned int colorOffset = 0;
+    unsigned int stride = 12;
+};
+
+VertexFormat makeVertexFormat(PositionEncoding position, NormalEncoding normal = NormalEncoding::None,
+    ColorEncoding color = ColorEncoding::None);
+//Compact code for file headers and back (GeometryCache.h)
+uint32_t vertexFormatCode(const VertexFormat& format);
+bool vertexFormatFromCode(uint32_t code, VertexFormat& format);
+//"snorm16 / octahedral / unorm8" style description
+std::string vertexFormatName(const VertexFormat& format);
+
+//Write vertexCount vertices in format to out (vertexCount * format.stride bytes). normals and colors (rgba) may be
+//null when the format has none. Bounds are the position bounds the quantized encodings are relative to.
+void encodeVertices(const VertexFormat& format, const float* positions, const float* normals, const float* colors,
+    size_t vertexCount, const glm::vec3& boundsMin, const glm::vec3& boundsMax, unsigned char* out);
+//Model matrix for the stored positions: identity for float32, [-1, 1] to the bounds otherwise
+glm::mat4 positionDecodeTransform(PositionEncoding position, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+//CPU reference decode of one vertex, in model space (the same math as the generated GLSL)
+glm::vec3 decodePosition(const VertexFormat& format, const unsigned char* vertex, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+glm::vec3 decodeNormal(const VertexFormat& format, const unsigned char* vertex);
+glm::vec4 decodeColor(const VertexFormat& format, const unsigned char* vertex);
+
+//-- Worst and average error of an encoding against the source attributes
+struct VertexFormatError {
+    double positionMax = 0.0;        //model space units
+    double positionRms = 0.0;
+    double positionMaxRelative = 0.0; //positionMax over the bounds diagonal
+    double normalMaxDegrees = 0.0;
+    double normalMeanDegrees = 0.0;
+    double colorMax = 0.0;           //0..1 channel units
+};
+
+VertexFormatError measureEncodingError(const VertexFormat& format, const unsigned char* encoded, const float* positions,
+    const float* normals, const float* colors, size_t vertexCount, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+//Bytes per index needed to address vertexCount vertices (2 or 4), and the matching GL type
+unsigned int indexSizeFor(size_t vertexCount);
+unsigned int indexTypeFor(unsigned int indexSize);
+//Copy indices at indexSize bytes each (2 truncates, check indexSizeFor first)
+void writeIndices(const unsigned int* indices, size_t indexCount, unsigned int indexSize, void* out);
+
+//glVertexAttribPointer / glEnableVertexAttribArray for the bound VAO and GL_ARRAY_BUFFER; attributes the format
+//does not have are disabled
+void setupVertexAttributes(const VertexFormat& format);
+//GLSL (330) attribute declarations plus decodePosition() / decodeNormal() / decodeColor() for format. The position
+//comes out in the stored space; multiply by positionDecodeTransform on the CPU side.
+std::string vertexDecodeShaderSource(const VertexFormat& format);
@@ -0,0 +1,349 @@
+#include "VertexTransform.h"
+#include "JobSystem.h"
+
+//SSE2 is baseline on x64 (and with /arch:SSE2 on Win32); AVX kernels are compiled for it separately
+//and only called after the CPU check, so the rest of the program keeps its target
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VERTEX_TRANSFORM_SSE 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define VERTEX_TRANSFORM_AVX 1
+#define AVX_KERNEL
+#elif defined(__GNUC__)
+#define VERTEX_TRANSFORM_AVX 1
+#define AVX_KERNEL __attribute__((target("avx")))
+#endif
+#endif
+
+//Parallel jobs work on whole blocks so every job starts on a 64 byte boundary of the output
+static const size_t blockVertices = 16;
+static const size_t grainBlocks = 1024;
+
+//======================KERNELS======================
+//Each kernel writes out[i] for i in [begin, end) and does glm's operation order:
+//(c0 * x + c1 * y) + (c2 * z + c3 * w), with w = 1 so c3 * w is exactly c3.
+
+static void transformAoSScalar(const glm::mat4& m, const float* positions, size_t stride, size_t begin, size_t end,
+    glm::vec4* out) {
+    for (size_t i = begin; i < end; i++) {
+        const float* p = positions + i * stride;
+        out[i] = m * glm::vec4(p[0], p[1], p[2], 1.0f);
+    }
+}
+
+static void transformSoAScalar(const glm::mat4& m, const PositionStreams& in, size_t begin, size_t end,
+    const TransformedStreams& out) {
+    for (size_t i = begin; i < end; i++) {
+        glm::vec4 r = m * glm::vec4(in.x[i], in.y[i], in.z[i], 1.0f);
+        out.x[i] = r.x;
+        out.y[i] = r.y;
+        out.z[i] = r.z;
+        out.w[i] = r.w;
+    }
+}
+
+#ifdef VERTEX_TRANSFORM_SSE
+//One vertex per iteration: the matrix columns stay in registers, the vertex is broadcast
+template <bool Stream>
+static void transformAoSSSE(const glm::mat4& m, const float* positions, size_t stride, size_t begin, size_t end,
+    glm::vec4* out) {
+    __m128 c0 = _mm_loadu_ps(&m[0][0]);
+    __m128 c1 = _mm_loadu_ps(&m[1][0]);
+    __m128 c2 = _mm_loadu_ps(&m[2][0]);
+    __m128 c3 = _mm_loadu_ps(&m[3][0]);
+    for (size_t i = begin; i < end; i++) {
+        const float* p = positions + i * stride;
+        __m128 xy = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p[0])), _mm_mul_ps(c1, _mm_set1_ps(p[1])));
+        __m128 zw = _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p[2])), c3);
+        if (Stream)
+            _mm_stream_ps(&out[i].x, _mm_add_ps(xy, zw));
+        else
+            _mm_storeu_ps(&out[i].x, _mm_add_ps(xy, zw));
+    }
+    if (Stream)
+        _mm_sfence();
+}
+
+//Four vertices per iteration, one output row at a time
+template <bool Stream>
+static void transformSoASSE(const glm::mat4& m, const PositionStreams& in, size_t begin, size_t end,
+    const TransformedStreams& out) {
+    float* rows[4] = { out.x, out.y, out.z, out.w };
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 x = _mm_loadu_ps(in.x + i);
+        __m128 y = _mm_loadu_ps(in.y + i);
+        __m128 z = _mm_loadu_ps(in.z + i);
+        for (int row = 0; row < 4; row++) {
+            __m128 xy = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0][row]), x), _mm_mul_ps(_mm_set1_ps(m[1][row]), y));
+            __m128 zw = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[2][row]), z), _mm_set1_ps(m[3][row]));
+            if (Stream)
+                _mm_stream_ps(rows[row] + i, _mm_add_ps(xy, zw));
+            else
+                _mm_storeu_ps(rows[row] + i, _mm_add_ps(xy, zw));
+        }
+    }
+    if (Stream)
+        _mm_sfence();
+    transformSoAScalar(m, in, i, end, out);
+}
+#endif
+
+#ifdef VERTEX_TRANSFORM_AVX
+//Two vertices per iteration, one in each 128 bit lane
+template <bool Stream>
+AVX_KERNEL static void transformAoSAVX(const glm::mat4& m, const float* positions, size_t stride, size_t begin,
+    size_t end, glm::vec4* out) {
+    size_t i = begin;
+    //Streaming stores need 32 byte alignment, finish an odd leading vertex with SSE
+    if (Stream && i < end && ((uintptr_t)&out[i] & 31) != 0) {
+        transformAoSSSE<true>(m, positions, stride, i, i + 1, out);
+        i++;
+    }
+    __m256 c0 = _mm256_broadcast_ps((const __m128*)&m[0][0]);
+    __m256 c1 = _mm256_broadcast_ps((const __m128*)&m[1][0]);
+    __m256 c2 = _mm256_broadcast_ps((const __m128*)&m[2][0]);
+    __m256 c3 = _mm256_broadcast_ps((const __m128*)&m[3][0]);
+    for (; i + 2 <= end; i += 2) {
+        const float* p0 = positions + i * stride;
+        const float* p1 = p0 + stride;
+        __m256 x = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(p0[0])), _mm_set1_ps(p1[0]), 1);
+        __m256 y = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(p0[1])), _mm_set1_ps(p1[1]), 1);
+        __m256 z = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(p0[2])), _mm_set1_ps(p1[2]), 1);
+        __m256 xy = _mm256_add_ps(_mm256_mul_ps(c0, x), _mm256_mul_ps(c1, y));
+        __m256 zw = _mm256_add_ps(_mm256_mul_ps(c2, z), c3);
+        if (Stream)
+            _mm256_stream_ps(&out[i].x, _mm256_add_ps(xy, zw));
+        else
+            _mm256_storeu_ps(&out[i].x, _mm256_add_ps(xy, zw));
+    }
+    if (Stream)
+        _mm_sfence();
+    transformAoSSSE<Stream>(m, positions, stride, i, end, out);
+}
+
+//Eight vertices per iteration, one output row at a time
+template <bool Stream>
+AVX_KERNEL static void transformSoAAVX(const glm::mat4& m, const PositionStreams& in, size_t begin, size_t end,
+    const TransformedStreams& out) {
+    float* rows[4] = { out.x, out.y, out.z, out.w };
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(in.x + i);
+        __m256 y = _mm256_loadu_ps(in.y + i);
+        __m256 z = _mm256_loadu_ps(in.z + i);
+        for (int row = 0; row < 4; row++) {
+            __m256 xy = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[0][row]), x),
+                _mm256_mul_ps(_mm256_set1_ps(m[1][row]), y));
+            __m256 zw = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[2][row]), z), _mm256_set1_ps(m[3][row]));
+            if (Stream)
+                _mm256_stream_ps(rows[row] + i, _mm256_add_ps(xy, zw));
+            else
+                _mm256_storeu_ps(rows[row] + i, _mm256_add_ps(xy, zw));
+        }
+    }
+    if (Stream)
+        _mm_sfence();
+    transformSoASSE<false>(m, in, i, end, out);
+}
+
+static bool cpuHasAvx() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    //AVX, and the OS saves the YMM registers (OSXSAVE + XCR0 bits 1 and 2)
+    if ((info[2] & (1 << 28)) == 0 || (info[2] & (1 << 27)) == 0)
+        return false;
+    return (_xgetbv(0) & 6) == 6;
+#else
+    return __builtin_cpu_supports("avx") != 0;
+#endif
+}
+#endif
+
+//======================DISPATCH======================
+bool isVertexTransformPathSupported(VertexTransformPath path) {
+    switch (path) {
+    case VertexTransformPath::Auto:
+    case VertexTransformPath::Scalar:
+        return true;
+    case VertexTransformPath::SSE:
+#ifdef VERTEX_TRANSFORM_SSE
+        return true;
+#else
+        return false;
+#endif
+    case VertexTransformPath::AVX: {
+#ifdef VERTEX_TRANSFORM_AVX
+        static const bool avx = cpuHasAvx();
+        return avx;
+#else
+        return false;
+#endif
+    }
+    }
+    return false;
+}
+
+VertexTransformPath bestVertexTransformPath() {
+    if (isVertexTransformPathSupported(VertexTransformPath::AVX))
+        return VertexTransformPath::AVX;
+    if (isVertexTransformPathSupported(VertexTransformPath::SSE))
+        return VertexTransformPath::SSE;
+    return VertexTransformPath::Scalar;
+}
+
+const char* vertexTransformPathName(VertexTransformPath path) {
+    switch (path) {
+    case VertexTransformPath::Auto: return "auto";
+    case VertexTransformPath::Scalar: return "scalar";
+    case VertexTransformPath::SSE: return "sse";
+    case VertexTransformPath::AVX: return "avx";
+    }
+    return "unknown";
+}
+
+//-- One call's arguments, shared by the jobs it is split into
+struct TransformBatch {
+    const glm::mat4* matrices = nullptr;
+    size_t matrixCount = 1;
+    size_t count = 0;              //vertices per matrix
+    VertexTransformPath path = VertexTransformPath::Scalar;
+    bool stream = false;
+
+    //AoS
+    const float* positions = nullptr;
+    size_t stride = 3;
+    glm::vec4* out = nullptr;
+    //SoA (single matrix)
+    bool soa = false;
+    PositionStreams streams = {};
+    TransformedStreams soaOut = {};
+};
+
+static void transformAoS(const TransformBatch& batch, const glm::mat4& m, size_t begin, size_t end, glm::vec4* out) {
+    switch (batch.path) {
+#ifdef VERTEX_TRANSFORM_AVX
+    case VertexTransformPath::AVX:
+        if (batch.stream)
+            transformAoSAVX<true>(m, batch.positions, batch.stride, begin, end, out);
+        else
+            transformAoSAVX<false>(m, batch.positions, batch.stride, begin, end, out);
+        return;
+#endif
+#ifdef VERTEX_TRANSFORM_SSE
+    case VertexTransformPath::SSE:
+        if (batch.stream)
+            transformAoSSSE<true>(m, batch.positions, batch.stride, begin, end, out);
+        else
+            transformAoSSSE<false>(m, batch.positions, batch.stride, begin, end, out);
+        return;
+#endif
+    default:
+        transformAoSScalar(m, batch.positions, batch.stride, begin, end, out);
+        return;
+    }
+}
+
+static void transformSoA(const TransformBatch& batch, size_t begin, size_t end) {
+    const glm::mat4& m = batch.matrices[0];
+    switch (batch.path) {
+#ifdef VERTEX_TRANSFORM_AVX
+    case VertexTransformPath::AVX:
+        if (batch.stream)
+            transformSoAAVX<true>(m, batch.streams, begin, end, batch.soaOut);
+        else
+            transformSoAAVX<false>(m, batch.streams, begin, end, batch.soaOut);
+        return;
+#endif
+#ifdef VERTEX_TRANSFORM_SSE
+    case VertexTransformPath::SSE:
+        if (batch.stream)
+            transformSoASSE<true>(m, batch.streams, begin, end, batch.soaOut);
+        else
+            transformSoASSE<false>(m, batch.streams, begin, end, batch.soaOut);
+        return;
+#endif
+    default:
+        transformSoAScalar(m, batch.streams, begin, end, batch.soaOut);
+        return;
+    }
+}
+
+//Outputs [begin, end) of the flattened matrix * vertex index space
+static void transformRange(const TransformBatch& batch, size_t begin, size_t end) {
+    if (batch.soa) {
+        transformSoA(batch, begin, end);
+        return;
+    }
+    for (size_t m = begin / batch.count; m < batch.matrixCount && m * batch.count < end; m++) {
+        size_t first = m * batch.count;
+        size_t vertexBegin = begin > first ? begin - first : 0;
+        size_t vertexEnd = end - first < batch.count ? end - first : batch.count;
+        transformAoS(batch, batch.matrices[m], vertexBegin, vertexEnd, batch.out + first);
+    }
+}
+
+static bool isAligned(const void* pointer, size_t alignment) {
+    return ((uintptr_t)pointer & (alignment - 1)) == 0;
+}
+
+static void runBatch(TransformBatch& batch, const VertexTransformSettings& settings) {
+    size_t total = batch.matrixCount * batch.count;
+    if (total == 0)
+        return;
+    batch.path = settings.path;
+    if (batch.path == VertexTransformPath::Auto || !isVertexTransformPathSupported(batch.path))
+        batch.path = bestVertexTransformPath();
+
+    //Streaming stores need aligned outputs: 16 bytes, 32 for the AVX SoA rows (the AVX AoS kernel aligns itself)
+    size_t alignment = batch.soa && batch.path == VertexTransformPath::AVX ? 32 : 16;
+    bool aligned = batch.soa ?
+        isAligned(batch.soaOut.x, alignment) && isAligned(batch.soaOut.y, alignment) &&
+        isAligned(batch.soaOut.z, alignment) && isAligned(batch.soaOut.w, alignment) :
+        isAligned(batch.out, alignment);
+    batch.stream = aligned && batch.path != VertexTransformPath::Scalar &&
+        total * sizeof(glm::vec4) >= settings.streamingThreshold;
+
+    if (settings.jobs == nullptr || settings.jobs->threadCount() < 2 || total < settings.parallelThreshold) {
+        transformRange(batch, 0, total);
+        return;
+    }
+    auto transformBlocks = [&batch, total](size_t begin, size_t end, int) {
+        size_t last = end * blockVertices;
+        transformRange(batch, begin * blockVertices, last < total ? last : total);
+    };
+    JobCounter done;
+    settings.jobs->parallelFor((total + blockVertices - 1) / blockVertices, grainBlocks, transformBlocks, done);
+    settings.jobs->wait(done);
+}
+
+//======================API======================
+void transformPositions(const glm::mat4& matrix, const float* positions, size_t stride, size_t count,
+    glm::vec4* out, const VertexTransformSettings& settings) {
+    transformPositions(&matrix, 1, positions, stride, count, out, settings);
+}
+
+void transformPositions(const glm::mat4& matrix, const PositionStreams& positions, size_t count,
+    const TransformedStreams& out, const VertexTransformSettings& settings) {
+    TransformBatch batch;
+    batch.matrices = &matrix;
+    batch.count = count;
+    batch.soa = true;
+    batch.streams = positions;
+    batch.soaOut = out;
+    runBatch(batch, settings);
+}
+
+void transformPositions(const glm::mat4* matrices, size_t matrixCount, const float* positions, size_t stride,
+    size_t count, glm::vec4* out, const VertexTransformSettings& settings) {
+    TransformBatch batch;
+    batch.matrices = matrices;
+    batch.matrixCount = matrixCount;
+    batch.count = count;
+    batch.positions = positions;
+    batch.stride = stride;
+    batch.out = out;
+    runBatch(batch, settings);
+}
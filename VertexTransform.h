@@ -0,0 +1,62 @@
+#pragma once
+/*Batched CPU vertex transform.
+Transforms a whole vertex stream by one or many matrices in one call instead of one glm::vec4 at a time:
+used by the transform log ("Transformed Vertex Positions") and anywhere CPU side positions are needed
+(picking, bounds). Positions are points (w = 1) and come either interleaved (AoS, any stride) or as
+separate x/y/z arrays (SoA).
+
+Kernels: scalar, SSE (4 wide) and AVX (8 wide, chosen at run time when the CPU has it).
+Every kernel does the same operations in the same order as glm's mat4 * vec4, so the results are
+bit identical to the old per-vertex loop. Large outputs use streaming (non-temporal) stores so they do not
+evict the input from the cache, and large batches are split over a JobSystem when one is given.*/
+#include <cstddef>
+#include <cstdint>
+
+#include <glm.hpp>
+
+class JobSystem;
+
+enum class VertexTransformPath {
+    Auto,   //best the CPU supports
+    Scalar,
+    SSE,
+    AVX
+};
+
+//-- How a batch runs. The defaults suit the render thread: best kernel, no threads.
+struct VertexTransformSettings {
+    VertexTransformPath path = VertexTransformPath::Auto;
+    JobSystem* jobs = nullptr;              //split batches of at least parallelThreshold vertices over its threads
+    size_t parallelThreshold = 65536;       //vertices (times matrices)
+    size_t streamingThreshold = 8u << 20;   //output bytes from which stores bypass the cache, SIZE_MAX = never
+};
+
+//-- Separate position arrays, count floats each
+struct PositionStreams {
+    const float* x;
+    const float* y;
+    const float* z;
+};
+//-- Separate result arrays, count floats each
+struct TransformedStreams {
+    float* x;
+    float* y;
+    float* z;
+    float* w;
+};
+
+//Kernel Auto resolves to on this CPU, and its name for reports ("scalar", "sse", "avx")
+VertexTransformPath bestVertexTransformPath();
+const char* vertexTransformPathName(VertexTransformPath path);
+//False if the kernel is not compiled in or the CPU lacks it (it then falls back to the best available one)
+bool isVertexTransformPathSupported(VertexTransformPath path);
+
+//AoS: vertex i is positions[i * stride], [i * stride + 1], [i * stride + 2]. stride in floats, >= 3.
+void transformPositions(const glm::mat4& matrix, const float* positions, size_t stride, size_t count,
+    glm::vec4* out, const VertexTransformSettings& settings = VertexTransformSettings());
+//SoA in and out
+void transformPositions(const glm::mat4& matrix, const PositionStreams& positions, size_t count,
+    const TransformedStreams& out, const VertexTransformSettings& settings = VertexTransformSettings());
+//One stream by many matrices (e.g. a mesh per instance): out[m * count + i] = matrices[m] * vertex i
+void transformPositions(const glm::mat4* matrices, size_t matrixCount, const float* positions, size_t stride,
+    size_t count, glm::vec4* out, const VertexTransformSettings& settings = VertexTransformSettings());